@@ -502,6 +502,14 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/MissionManager/TransectStyleComplexItemTest.h \
         src/MissionManager/TransectStyleComplexItemTestBase.h \
         src/MissionManager/VisualMissionItemTest.h \
+        src/QtLocationPlugin/QGCMemoryTileCacheTest.h \
+        src/QtLocationPlugin/QGCTileCacheWorkerTest.h \
+        src/Terrain/TerrainQueryTest.h \
+        src/Terrain/TerrainTileStoreTest.h \
+        src/comm/MAVLinkDecoderTest.h \
+        src/comm/TLogIndexTest.h \
+        src/comm/TLogWriterTest.h \
+        src/comm/LogReplayLinkTest.h \
         src/qgcunittest/ComponentInformationCacheTest.h \
         src/qgcunittest/ComponentInformationTranslationTest.h \
         src/qgcunittest/GeoTest.h \
@@ -514,9 +522,14 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/Vehicle/RequestMessageTest.h \
         src/Vehicle/SendMavCommandWithHandlerTest.h \
         src/Vehicle/SendMavCommandWithSignallingTest.h \
+        src/Vehicle/TerrainProtocolHandlerTest.h \
+        src/Vehicle/TrajectoryPointsTest.h \
         src/Vehicle/VehicleLinkManagerTest.h \
         #src/qgcunittest/RadioConfigTest.h \
         #src/AnalyzeView/LogDownloadTest.h \
+        src/AnalyzeView/MAVLinkInspectorControllerTest.h \
+        src/AnalyzeView/MAVLinkInspectorStoreTest.h \
+        src/AnalyzeView/ULogReaderTest.h \
         #src/qgcunittest/FileDialogTest.h \
         #src/qgcunittest/FileManagerTest.h \
         #src/qgcunittest/MainWindowTest.h \
@@ -551,6 +564,14 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/MissionManager/TransectStyleComplexItemTest.cc \
         src/MissionManager/TransectStyleComplexItemTestBase.cc \
         src/MissionManager/VisualMissionItemTest.cc \
+        src/QtLocationPlugin/QGCMemoryTileCacheTest.cpp \
+        src/QtLocationPlugin/QGCTileCacheWorkerTest.cpp \
+        src/Terrain/TerrainQueryTest.cc \
+        src/Terrain/TerrainTileStoreTest.cc \
+        src/comm/MAVLinkDecoderTest.cc \
+        src/comm/TLogIndexTest.cc \
+        src/comm/TLogWriterTest.cc \
+        src/comm/LogReplayLinkTest.cc \
         src/qgcunittest/ComponentInformationCacheTest.cc \
         src/qgcunittest/ComponentInformationTranslationTest.cc \
         src/qgcunittest/GeoTest.cc \
@@ -564,9 +585,14 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/Vehicle/RequestMessageTest.cc \
         src/Vehicle/SendMavCommandWithHandlerTest.cc \
         src/Vehicle/SendMavCommandWithSignallingTest.cc \
+        src/Vehicle/TerrainProtocolHandlerTest.cc \
+        src/Vehicle/TrajectoryPointsTest.cc \
         src/Vehicle/VehicleLinkManagerTest.cc \
         #src/qgcunittest/RadioConfigTest.cc \
         #src/AnalyzeView/LogDownloadTest.cc \
+        src/AnalyzeView/MAVLinkInspectorControllerTest.cc \
+        src/AnalyzeView/MAVLinkInspectorStoreTest.cc \
+        src/AnalyzeView/ULogReaderTest.cc \
         #src/qgcunittest/FileDialogTest.cc \
         #src/qgcunittest/FileManagerTest.cc \
         #src/qgcunittest/MainWindowTest.cc \
@@ -581,7 +607,9 @@ HEADERS += \
     src/ADSB/ADSBVehicleManager.h \
     src/AnalyzeView/LogDownloadController.h \
     src/AnalyzeView/PX4LogParser.h \
+    src/AnalyzeView/TLogExporter.h \
     src/AnalyzeView/ULogParser.h \
+    src/AnalyzeView/ULogReader.h \
     src/AnalyzeView/MavlinkConsoleController.h \
     src/Audio/AudioOutput.h \
     src/Vehicle/Autotune.h \
@@ -703,6 +731,7 @@ HEADERS += \
     src/ShapeFileHelper.h \
     src/SHPFileHelper.h \
     src/Terrain/TerrainQuery.h \
+    src/Terrain/TerrainTileStore.h \
     src/TerrainTile.h \
     src/Vehicle/Actuators/ActuatorActions.h \
     src/Vehicle/Actuators/Actuators.h \
@@ -759,9 +788,12 @@ HEADERS += \
     src/comm/LinkInterface.h \
     src/comm/LinkManager.h \
     src/comm/LogReplayLink.h \
+    src/comm/MAVLinkDecoder.h \
     src/comm/MAVLinkProtocol.h \
     src/comm/QGCMAVLink.h \
     src/comm/TCPLink.h \
+    src/comm/TLogIndex.h \
+    src/comm/TLogWriter.h \
     src/comm/UDPLink.h \
     src/comm/UdpIODevice.h \
     src/uas/UAS.h \
@@ -846,7 +878,9 @@ SOURCES += \
     src/ADSB/ADSBVehicleManager.cc \
     src/AnalyzeView/LogDownloadController.cc \
     src/AnalyzeView/PX4LogParser.cc \
+    src/AnalyzeView/TLogExporter.cc \
     src/AnalyzeView/ULogParser.cc \
+    src/AnalyzeView/ULogReader.cc \
     src/AnalyzeView/MavlinkConsoleController.cc \
     src/Audio/AudioOutput.cc \
     src/Vehicle/Autotune.cpp \
@@ -964,6 +998,7 @@ SOURCES += \
     src/ShapeFileHelper.cc \
     src/SHPFileHelper.cc \
     src/Terrain/TerrainQuery.cc \
+    src/Terrain/TerrainTileStore.cc \
     src/TerrainTile.cc\
     src/Vehicle/Actuators/ActuatorActions.cc \
     src/Vehicle/Actuators/Actuators.cc \
@@ -1020,9 +1055,12 @@ SOURCES += \
     src/comm/LinkInterface.cc \
     src/comm/LinkManager.cc \
     src/comm/LogReplayLink.cc \
+    src/comm/MAVLinkDecoder.cc \
     src/comm/MAVLinkProtocol.cc \
     src/comm/QGCMAVLink.cc \
     src/comm/TCPLink.cc \
+    src/comm/TLogIndex.cc \
+    src/comm/TLogWriter.cc \
     src/comm/UDPLink.cc \
     src/comm/UdpIODevice.cc \
     src/main.cc \
@@ -1279,6 +1317,7 @@ HEADERS += \
     src/FactSystem/FactMetaData.h \
     src/FactSystem/FactSystem.h \
     src/FactSystem/FactValueSliderListModel.h \
+    src/FactSystem/ParameterCache.h \
     src/FactSystem/ParameterManager.h \
     src/FactSystem/SettingsFact.h \
 
@@ -1289,6 +1328,7 @@ SOURCES += \
     src/FactSystem/FactMetaData.cc \
     src/FactSystem/FactSystem.cc \
     src/FactSystem/FactValueSliderListModel.cc \
+    src/FactSystem/ParameterCache.cc \
     src/FactSystem/ParameterManager.cc \
     src/FactSystem/SettingsFact.cc \
 
@@ -1299,9 +1339,11 @@ contains (DEFINES, QGC_DISABLE_MAVLINK_INSPECTOR) {
     message("Disable mavlink inspector")
 } else {
     HEADERS += \
-        src/AnalyzeView/MAVLinkInspectorController.h
+        src/AnalyzeView/MAVLinkInspectorController.h \
+        src/AnalyzeView/MAVLinkInspectorStore.h
     SOURCES += \
-        src/AnalyzeView/MAVLinkInspectorController.cc
+        src/AnalyzeView/MAVLinkInspectorController.cc \
+        src/AnalyzeView/MAVLinkInspectorStore.cc
     QT += \
         charts
 }
@@ -13,8 +13,11 @@
 #include <QtEndian>
 #include <QDebug>
 #include <cfloat>
+#include <limits>
 #include <QDir>
 #include <QUrl>
+#include <QMutex>
+#include <QThreadPool>
 
 #include "ExifParser.h"
 #include "ULogParser.h"
@@ -161,26 +164,16 @@ void GeoTagWorker::run()
     emit progressChanged((100/nSteps));
 
     // Parse EXIF
-    ExifParser exifParser;
-    _imageTime.clear();
-    for (int i = 0; i < _imageList.size(); ++i) {
-        QFile file(_imageList.at(i).absoluteFilePath());
-        if (!file.open(QIODevice::ReadOnly)) {
-            emit error(tr("Geotagging failed. Couldn't open an image."));
-            return;
-        }
-        QByteArray imageBuffer = file.readAll();
-        file.close();
-
-        _imageTime.append(exifParser.readTime(imageBuffer));
-
-        emit progressChanged((100/nSteps) + ((100/nSteps) / _imageList.size())*i);
-
+    _imageTime.fill(0, _imageList.size());
+    QString errorMsg;
+    if (!_runParallel(_imageList.size(), [this](int index, QString& taskError) { return _readImageTime(index, taskError); }, 100/nSteps, 100/nSteps, errorMsg)) {
         if (_cancel) {
             qCDebug(GeotaggingLog) << "Tagging cancelled";
             emit error(tr("Tagging cancelled"));
-            return;
+        } else {
+            emit error(errorMsg);
         }
+        return;
     }
 
     // Load log
@@ -190,8 +183,14 @@ void GeoTagWorker::run()
         emit error(tr("Geotagging failed. Couldn't open log file."));
         return;
     }
-    QByteArray log = file.readAll();
-    file.close();
+    // Map the log rather than reading it in, logs from long flights can run to gigabytes
+    QByteArray log;
+    const uchar* logMap = file.size() <= std::numeric_limits<int>::max() ? file.map(0, file.size()) : nullptr;
+    if (logMap) {
+        log = QByteArray::fromRawData(reinterpret_cast<const char*>(logMap), static_cast<int>(file.size()));
+    } else {
+        log = file.readAll();
+    }
 
     // Instantiate appropriate parser
     _triggerList.clear();
@@ -246,42 +245,9 @@ void GeoTagWorker::run()
     // Tag images
     int maxIndex = std::min(_imageIndices.count(), _triggerIndices.count());
     maxIndex = std::min(maxIndex, _imageList.count());
-    for(int i = 0; i < maxIndex; i++) {
-        int imageIndex = _imageIndices[i];
-        if (imageIndex >= _imageList.count()) {
-            emit error(tr("Geotagging failed. Requesting image #%1, but only %2 images present.").arg(imageIndex).arg(_imageList.count()));
-            return;
-        }
-        QFile fileRead(_imageList.at(_imageIndices[i]).absoluteFilePath());
-        if (!fileRead.open(QIODevice::ReadOnly)) {
-            emit error(tr("Geotagging failed. Couldn't open an image."));
-            return;
-        }
-        QByteArray imageBuffer = fileRead.readAll();
-        fileRead.close();
-
-        if (!exifParser.write(imageBuffer, _triggerList[_triggerIndices[i]])) {
-            emit error(tr("Geotagging failed. Couldn't write to image."));
-            return;
-        } else {
-            QFile fileWrite;
-            if(_saveDirectory == "") {
-                fileWrite.setFileName(_imageDirectory + "/TAGGED/" + _imageList.at(_imageIndices[i]).fileName());
-            } else {
-                fileWrite.setFileName(_saveDirectory + "/" + _imageList.at(_imageIndices[i]).fileName());
-            }
-            if (!fileWrite.open(QFile::WriteOnly)) {
-                emit error(tr("Geotagging failed. Couldn't write to an image."));
-                return;
-            }
-            fileWrite.write(imageBuffer);
-            fileWrite.close();
-        }
-        emit progressChanged(4*(100/nSteps) + ((100/nSteps) / maxIndex)*i);
-
-        if (_cancel) {
-            qCDebug(GeotaggingLog) << "Tagging cancelled";
-            emit error(tr("Tagging cancelled"));
+    if (!_runParallel(maxIndex, [this](int index, QString& taskError) { return _tagImage(index, taskError); }, 4*(100/nSteps), 100/nSteps, errorMsg)) {
+        if (!_cancel) {
+            emit error(errorMsg);
             return;
         }
     }
@@ -310,3 +276,116 @@ bool GeoTagWorker::triggerFiltering()
     }
     return true;
 }
+
+/// Runs task for indices 0 to count - 1 on a bounded pool of threads, reporting progress while waiting
+///     @param task Returns false and sets errorMsg on failure
+/// @return false: A task failed or tagging was cancelled
+bool GeoTagWorker::_runParallel(int count, const std::function<bool(int, QString&)>& task, double progressStart, double progressSpan, QString& errorMsg)
+{
+    if (count == 0) {
+        return !_cancel;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), _maxThreads));
+
+    QAtomicInt  nextIndex   = 0;
+    QAtomicInt  doneCount   = 0;
+    QAtomicInt  failed      = 0;
+    QMutex      errorMutex;
+
+    for (int i = 0; i < pool.maxThreadCount(); i++) {
+        pool.start([&]() {
+            QString taskError;
+            for (int index = nextIndex.fetchAndAddRelaxed(1); index < count; index = nextIndex.fetchAndAddRelaxed(1)) {
+                if (_cancel || failed.loadRelaxed()) {
+                    return;
+                }
+                if (!task(index, taskError)) {
+                    // Only the first error is reported
+                    if (failed.testAndSetRelaxed(0, 1)) {
+                        QMutexLocker locker(&errorMutex);
+                        errorMsg = taskError;
+                    }
+                    return;
+                }
+                doneCount.fetchAndAddRelaxed(1);
+            }
+        });
+    }
+
+    while (!pool.waitForDone(100)) {
+        emit progressChanged(progressStart + (progressSpan * doneCount.loadRelaxed()) / count);
+    }
+
+    return !_cancel && !failed.loadRelaxed();
+}
+
+/// Reads just the start of the file, which holds the EXIF data
+QByteArray GeoTagWorker::_readExifHeader(QFile& file)
+{
+    return file.read(_exifHeaderBytes);
+}
+
+bool GeoTagWorker::_readImageTime(int imageListIndex, QString& errorMsg)
+{
+    QFile file(_imageList.at(imageListIndex).absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorMsg = tr("Geotagging failed. Couldn't open an image.");
+        return false;
+    }
+    QByteArray exifHeader = _readExifHeader(file);
+
+    ExifParser exifParser;
+    _imageTime[imageListIndex] = exifParser.readTime(exifHeader);
+
+    return true;
+}
+
+/// The tags only change the EXIF data at the start of the image. That is updated in memory and the rest of the
+/// image is streamed across unchanged.
+bool GeoTagWorker::_tagImage(int tagIndex, QString& errorMsg)
+{
+    const int imageIndex = _imageIndices[tagIndex];
+    if (imageIndex >= _imageList.count()) {
+        errorMsg = tr("Geotagging failed. Requesting image #%1, but only %2 images present.").arg(imageIndex).arg(_imageList.count());
+        return false;
+    }
+
+    QFile fileRead(_imageList.at(imageIndex).absoluteFilePath());
+    if (!fileRead.open(QIODevice::ReadOnly)) {
+        errorMsg = tr("Geotagging failed. Couldn't open an image.");
+        return false;
+    }
+    QByteArray exifHeader = _readExifHeader(fileRead);
+
+    ExifParser              exifParser;
+    cameraFeedbackPacket    geotag = _triggerList[_triggerIndices[tagIndex]];
+    if (!exifParser.write(exifHeader, geotag)) {
+        errorMsg = tr("Geotagging failed. Couldn't write to image.");
+        return false;
+    }
+
+    QFile fileWrite;
+    if(_saveDirectory == "") {
+        fileWrite.setFileName(_imageDirectory + "/TAGGED/" + _imageList.at(imageIndex).fileName());
+    } else {
+        fileWrite.setFileName(_saveDirectory + "/" + _imageList.at(imageIndex).fileName());
+    }
+    if (!fileWrite.open(QFile::WriteOnly)) {
+        errorMsg = tr("Geotagging failed. Couldn't write to an image.");
+        return false;
+    }
+
+    bool writeOk = fileWrite.write(exifHeader) == exifHeader.size();
+    while (writeOk && !fileRead.atEnd()) {
+        const QByteArray chunk = fileRead.read(_copyChunkBytes);
+        writeOk = !chunk.isEmpty() && fileWrite.write(chunk) == chunk.size();
+    }
+    if (!writeOk) {
+        errorMsg = tr("Geotagging failed. Couldn't write to an image.");
+        return false;
+    }
+
+    return true;
+}
@@ -23,6 +23,10 @@
 #include <QElapsedTimer>
 #include <QDebug>
 #include <QGeoCoordinate>
+#include <QFile>
+
+#include <atomic>
+#include <functional>
 
 class GeoTagWorker : public QThread
 {
@@ -63,17 +67,25 @@ signals:
 
 private:
     bool triggerFiltering();
+    bool _runParallel       (int count, const std::function<bool(int, QString&)>& task, double progressStart, double progressSpan, QString& errorMsg);
+    bool _readImageTime     (int imageListIndex, QString& errorMsg);
+    bool _tagImage          (int tagIndex, QString& errorMsg);
+
+    static QByteArray _readExifHeader(QFile& file);
 
-    bool                    _cancel;
+    std::atomic<bool>       _cancel;
     QString                 _logFile;
     QString                 _imageDirectory;
     QString                 _saveDirectory;
     QFileInfoList           _imageList;
-    QList<double>           _imageTime;
+    QVector<double>         _imageTime;
     QList<cameraFeedbackPacket> _triggerList;
     QList<int>              _imageIndices;
     QList<int>              _triggerIndices;
 
+    static const int _maxThreads        = 8;                ///< Image files are mostly I/O bound, more threads than this just thrash the disk
+    static const int _exifHeaderBytes   = 128 * 1024;       ///< Covers the APP1 segment holding the EXIF data, which is limited to 64K
+    static const int _copyChunkBytes    = 1024 * 1024;
 };
 
 /// Controller for GeoTagPage.qml. Supports geotagging images based on logfile camera tags.
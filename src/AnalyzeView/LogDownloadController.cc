@@ -23,63 +23,92 @@
 #include <QSettings>
 #include <QUrl>
 #include <QBitArray>
+#include <QDataStream>
+#include <QSaveFile>
 #include <QtCore/qmath.h>
 
-#define kTimeOutMilliseconds 500
-#define kGUIRateMilliseconds 17
-#define kTableBins           512
-#define kChunkSize           (kTableBins * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN)
+#define kTimeOutMilliseconds        500
+#define kGUIRateMilliseconds        17
+#define kBinSize                    MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN
+#define kMinWindowBytes             (512 * kBinSize)
+#define kMaxWindowBytes             (64 * kMinWindowBytes)
+#define kWindowRtts                 4
+#define kInitialRttMilliseconds     200
+#define kSaveProgressMilliseconds   2000
+
+static const char*   kProgressSuffix    = ".download";
+static const quint32 kProgressMagic     = 0x514c4744;
+static const quint32 kProgressVersion   = 1;
 
 QGC_LOGGING_CATEGORY(LogDownloadLog, "LogDownloadLog")
 
 //-----------------------------------------------------------------------------
 struct LogDownloadData {
     LogDownloadData(QGCLogEntry* entry);
-    QBitArray     chunk_table;
-    uint32_t      current_chunk;
+    QBitArray     bins;             ///< One bit per kBinSize bytes of the log, set once received
+    int           binsReceived;
     QFile         file;
     QString       filename;
+    QString       progressFilename; ///< Sidecar file holding bins, so an interrupted download can be resumed
     uint          ID;
     QGCLogEntry*  entry;
     uint          written;
     size_t        rate_bytes;
     qreal         rate_avg;
     QElapsedTimer elapsed;
-
-    void advanceChunk()
+    QElapsedTimer saveElapsed;
+
+    // The outstanding LOG_REQUEST_DATA range. The vehicle serves a single range at a time, a new request replaces
+    // the previous one.
+    uint32_t      requestStart;
+    uint32_t      requestEnd;
+    uint32_t      receivedEnd;      ///< End of the highest data received from within the range
+    bool          rttPending;       ///< Still waiting for the first data of the range
+    bool          rttSample;        ///< The range does not overlap the one it replaced, so its first data times the request
+    QElapsedTimer requestElapsed;
+    qreal         rtt;              ///< Smoothed request round trip time in msecs
+
+    // The number of kBinSize bins in the log
+    int binCount() const
     {
-           current_chunk++;
-           chunk_table = QBitArray(chunkBins(), false);
+        return qCeil(entry->size() / static_cast<qreal>(kBinSize));
     }
 
-    // The number of MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN bins in the current chunk
-    uint32_t chunkBins() const
+    bool complete() const
     {
-        return qMin(qCeil((entry->size() - current_chunk*kChunkSize)/static_cast<qreal>(MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN)),
-                    kTableBins);
+        return binsReceived == bins.size();
     }
 
-    // The number of kChunkSize chunks in the file
-    uint32_t numChunks() const
+    // Bytes to ask for in a single request. Enough to keep the link busy for a few round trips, so the
+    // time spent waiting on the next request is small compared to the time spent streaming.
+    uint32_t windowBytes() const
     {
-        return qCeil(entry->size() / static_cast<qreal>(kChunkSize));
+        const qreal bytes = rate_avg * (rtt / 1000.0) * kWindowRtts;
+        return static_cast<uint32_t>(qBound(static_cast<qreal>(kMinWindowBytes), bytes, static_cast<qreal>(kMaxWindowBytes)));
     }
 
-    // True if all bins in the chunk have been set to val
-    bool chunkEquals(const bool val) const
+    // Bytes which arrive during one round trip. Once no more than that is left in the outstanding range the
+    // next range is requested, so it starts streaming as the current one finishes.
+    uint32_t pipelineBytes() const
     {
-        return chunk_table == QBitArray(chunk_table.size(), val);
+        return static_cast<uint32_t>(rate_avg * (rtt / 1000.0));
     }
-
 };
 
 //----------------------------------------------------------------------------------------
 LogDownloadData::LogDownloadData(QGCLogEntry* entry_)
-    : ID(entry_->id())
+    : binsReceived(0)
+    , ID(entry_->id())
     , entry(entry_)
     , written(0)
     , rate_bytes(0)
     , rate_avg(0)
+    , requestStart(0)
+    , requestEnd(0)
+    , receivedEnd(0)
+    , rttPending(false)
+    , rttSample(false)
+    , rtt(kInitialRttMilliseconds)
 {
 
 }
@@ -118,6 +147,17 @@ LogDownloadController::LogDownloadController(void)
     _setActiveVehicle(manager->activeVehicle());
 }
 
+//----------------------------------------------------------------------------------------
+LogDownloadController::~LogDownloadController()
+{
+    //-- Keep what has been downloaded so far, the download picks up from there next time
+    if(_downloadData) {
+        _saveProgress();
+        delete _downloadData;
+        _downloadData = nullptr;
+    }
+}
+
 //----------------------------------------------------------------------------------------
 void
 LogDownloadController::_processDownload()
@@ -133,6 +173,15 @@ LogDownloadController::_processDownload()
 void
 LogDownloadController::_setActiveVehicle(Vehicle* vehicle)
 {
+    if(_downloadData) {
+        //-- Vehicle went away mid download. Keep what we have so it can be resumed.
+        _timer.stop();
+        _saveProgress();
+        delete _downloadData;
+        _downloadData = nullptr;
+        _downloadingLogs = false;
+        emit downloadingLogsChanged();
+    }
     if(_uas) {
         _logEntriesModel.clear();
         disconnect(_uas, &UASInterface::logEntry, this, &LogDownloadController::_logEntry);
@@ -325,80 +374,65 @@ LogDownloadController::_logData(UASInterface* uas, uint32_t ofs, uint16_t id, ui
         return;
     }
 
-    if ((ofs % MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN) != 0) {
+    if ((ofs % kBinSize) != 0) {
         qWarning() << "Ignored misaligned incoming packet @" << ofs;
         return;
     }
 
-    bool result = false;
-    uint32_t timeout_time = kTimeOutMilliseconds;
-    if(ofs <= _downloadData->entry->size()) {
-        const uint32_t chunk = ofs / kChunkSize;
-        if (chunk != _downloadData->current_chunk) {
-            qWarning() << "Ignored packet for out of order chunk actual:expected" << chunk << _downloadData->current_chunk;
-            return;
-        }
-        const uint16_t bin = (ofs - chunk*kChunkSize) / MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
-        if (bin >= _downloadData->chunk_table.size()) {
-            qWarning() << "Out of range bin received";
-        } else
-            _downloadData->chunk_table.setBit(bin);
-        if (_downloadData->file.pos() != ofs) {
-            // Seek to correct position
-            if (!_downloadData->file.seek(ofs)) {
-                qWarning() << "Error while seeking log file offset";
-                return;
-            }
-        }
-
-        //-- Write chunk to file
-        if(_downloadData->file.write((const char*)data, count)) {
-            _downloadData->written += count;
-            _downloadData->rate_bytes += count;
-            _updateDataRate();
-            result = true;
-            //-- reset retries
-            _retries = 0;
-            //-- Reset timer
-            _timer.start(timeout_time);
-            //-- Do we have it all?
-            if(_logComplete()) {
-                _downloadData->entry->setStatus(tr("Downloaded"));
-                //-- Check for more
-                _receivedAllData();
-            } else if (_chunkComplete()) {
-                _downloadData->advanceChunk();
-                _requestLogData(_downloadData->ID,
-                                _downloadData->current_chunk*kChunkSize,
-                                _downloadData->chunk_table.size()*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
-            } else if (bin < _downloadData->chunk_table.size() - 1 && _downloadData->chunk_table.at(bin+1)) {
-                // Likely to be grabbing fragments and got to the end of a gap
-                _findMissingData();
-            }
-        } else {
-            qWarning() << "Error while writing log file chunk";
-        }
-    } else {
+    const int bin = static_cast<int>(ofs / kBinSize);
+    if (bin >= _downloadData->bins.size()) {
         qWarning() << "Received log offset greater than expected";
-    }
-    if(!result) {
         _downloadData->entry->setStatus(tr("Error"));
+        return;
     }
-}
 
+    //-- Track the outstanding request. Stragglers from a replaced request are still written below.
+    if (ofs >= _downloadData->requestStart && ofs < _downloadData->requestEnd) {
+        if (_downloadData->rttPending) {
+            _downloadData->rttPending = false;
+            if (_downloadData->rttSample) {
+                _downloadData->rtt = (_downloadData->rtt * 0.8) + (_downloadData->requestElapsed.elapsed() * 0.2);
+            }
+        }
+        _downloadData->receivedEnd = qMax(_downloadData->receivedEnd, ofs + count);
+    }
 
-//----------------------------------------------------------------------------------------
-bool
-LogDownloadController::_chunkComplete() const
-{
-    return _downloadData->chunkEquals(true);
-}
+    if (!_downloadData->bins.testBit(bin)) {
+        //-- Write data to file
+        if (!_downloadData->file.seek(ofs) || _downloadData->file.write((const char*)data, count) != count) {
+            qWarning() << "Error while writing log file data";
+            _downloadData->entry->setStatus(tr("Error"));
+            return;
+        }
+        _downloadData->bins.setBit(bin);
+        _downloadData->binsReceived++;
+        _downloadData->written += count;
+        _downloadData->rate_bytes += count;
+    }
+    _updateDataRate();
+    //-- reset retries
+    _retries = 0;
+    //-- Reset timer
+    _timer.start(kTimeOutMilliseconds);
 
-//----------------------------------------------------------------------------------------
-bool
-LogDownloadController::_logComplete() const
-{
-    return _chunkComplete() && (_downloadData->current_chunk+1) == _downloadData->numChunks();
+    //-- Do we have it all?
+    if(_downloadData->complete()) {
+        _downloadData->entry->setStatus(tr("Downloaded"));
+        //-- Check for more
+        _receivedAllData();
+        return;
+    }
+    if (_downloadData->saveElapsed.elapsed() >= kSaveProgressMilliseconds) {
+        _saveProgress();
+    }
+    //-- Ask for the next range while the tail of this one is still in flight. Only ranges past the tail are asked for,
+    //   going back for gaps waits until the tail is in, otherwise the request would overlap data still on its way.
+    if (!_downloadData->rttPending &&
+            _downloadData->requestEnd - qMin(_downloadData->receivedEnd, _downloadData->requestEnd) <= _downloadData->pipelineBytes()) {
+        if (!_requestNextRange(_downloadData->requestEnd, false) && _downloadData->receivedEnd >= _downloadData->requestEnd) {
+            _requestNextRange(0);
+        }
+    }
 }
 
 //----------------------------------------------------------------------------------------
@@ -406,26 +440,35 @@ void
 LogDownloadController::_receivedAllData()
 {
     _timer.stop();
+    if (_downloadData && _downloadData->complete()) {
+        QFile::remove(_downloadData->progressFilename);
+    }
     //-- Anything queued up for download?
-    if(_prepareLogDownload()) {
-        //-- Request Log
-        _requestLogData(_downloadData->ID, 0, _downloadData->chunk_table.size()*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
-        _timer.start(kTimeOutMilliseconds);
-    } else {
-        _resetSelection();
-        _setDownloading(false);
+    while(_prepareLogDownload()) {
+        if (!_downloadData->complete()) {
+            //-- Request Log
+            _requestNextRange(0);
+            _timer.start(kTimeOutMilliseconds);
+            return;
+        }
+        //-- Everything was already there from an earlier, interrupted download
+        _downloadData->entry->setStatus(tr("Downloaded"));
+        QFile::remove(_downloadData->progressFilename);
     }
+    _resetSelection();
+    _setDownloading(false);
 }
 
 //----------------------------------------------------------------------------------------
 void
 LogDownloadController::_findMissingData()
 {
-    if (_logComplete()) {
+    if (!_downloadData) {
+        return;
+    }
+    if (_downloadData->complete()) {
          _receivedAllData();
          return;
-    } else if (_chunkComplete()) {
-        _downloadData->advanceChunk();
     }
 
     _retries++;
@@ -442,24 +485,103 @@ LogDownloadController::_findMissingData()
 #endif
 
     _updateDataRate();
+    //-- Nothing arrived for a while, start over from the first gap in the outstanding range
+    _requestNextRange(_downloadData->requestStart);
+}
+
+//----------------------------------------------------------------------------------------
+bool
+LogDownloadController::_requestNextRange(uint32_t from, bool wrap)
+{
+    const QBitArray& bins  = _downloadData->bins;
+    const int        size  = bins.size();
+    int              start = static_cast<int>(from / kBinSize);
 
-    uint16_t start = 0, end = 0;
-    const int size = _downloadData->chunk_table.size();
-    for (; start < size; start++) {
-        if (!_downloadData->chunk_table.testBit(start)) {
-            break;
+    //-- First missing bin at or after from, wrapping around to pick up gaps left behind
+    while (start < size && bins.testBit(start)) {
+        start++;
+    }
+    if (start >= size && wrap) {
+        for (start = 0; start < size && bins.testBit(start); start++) {
         }
     }
+    if (start >= size) {
+        return false;
+    }
 
-    for (end = start; end < size; end++) {
-        if (_downloadData->chunk_table.testBit(end)) {
-            break;
-        }
+    //-- Up to a window's worth of contiguous missing bins
+    const int maxBins = qMax(1, static_cast<int>(_downloadData->windowBytes() / kBinSize));
+    int end = start + 1;
+    while (end < size && end - start < maxBins && !bins.testBit(end)) {
+        end++;
+    }
+
+    const uint32_t requestStart = start * kBinSize;
+    const uint32_t requestEnd   = qMin(static_cast<uint32_t>(end * kBinSize), _downloadData->entry->size());
+
+    //-- Stragglers from the replaced range could land in an overlapping one and would look like a very short round trip
+    _downloadData->rttSample    = requestEnd <= _downloadData->requestStart || requestStart >= _downloadData->requestEnd;
+    _downloadData->requestStart = requestStart;
+    _downloadData->requestEnd   = requestEnd;
+    _downloadData->receivedEnd  = requestStart;
+    _downloadData->rttPending   = true;
+    _downloadData->requestElapsed.start();
+    _requestLogData(_downloadData->ID,
+                    _downloadData->requestStart,
+                    _downloadData->requestEnd - _downloadData->requestStart,
+                    _retries);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+void
+LogDownloadController::_saveProgress()
+{
+    QSaveFile progressFile(_downloadData->progressFilename);
+    if (!progressFile.open(QIODevice::WriteOnly)) {
+        qCWarning(LogDownloadLog) << "Unable to save download progress" << progressFile.fileName() << progressFile.errorString();
+        return;
+    }
+    //-- Log data first, so the progress file never claims more than what is on disk
+    _downloadData->file.flush();
+    QDataStream stream(&progressFile);
+    stream << kProgressMagic << kProgressVersion
+           << static_cast<quint32>(_downloadData->entry->size())
+           << static_cast<qint64>(_downloadData->entry->time().toSecsSinceEpoch())
+           << _downloadData->bins;
+    if (stream.status() != QDataStream::Ok || !progressFile.commit()) {
+        qCWarning(LogDownloadLog) << "Unable to save download progress" << progressFile.fileName() << progressFile.errorString();
     }
+    _downloadData->saveElapsed.start();
+}
 
-    const uint32_t pos = _downloadData->current_chunk*kChunkSize + start*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN,
-                   len = (end - start)*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
-    _requestLogData(_downloadData->ID, pos, len, _retries);
+//----------------------------------------------------------------------------------------
+bool
+LogDownloadController::_loadProgress()
+{
+    QFile progressFile(_downloadData->progressFilename);
+    if (!_downloadData->file.exists() || _downloadData->file.size() != _downloadData->entry->size() || !progressFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    quint32   magic   = 0;
+    quint32   version = 0;
+    quint32   size    = 0;
+    qint64    time    = 0;
+    QBitArray bins;
+    QDataStream stream(&progressFile);
+    stream >> magic >> version >> size >> time >> bins;
+    if (stream.status() != QDataStream::Ok || magic != kProgressMagic || version != kProgressVersion ||
+            size != _downloadData->entry->size() || time != _downloadData->entry->time().toSecsSinceEpoch() ||
+            bins.size() != _downloadData->binCount()) {
+        //-- Partial download of some other log which happens to have the same name
+        qCDebug(LogDownloadLog) << "Ignoring stale download progress" << progressFile.fileName();
+        return false;
+    }
+    _downloadData->bins         = bins;
+    _downloadData->binsReceived = bins.count(true);
+    _downloadData->written      = qMin(static_cast<uint>(_downloadData->binsReceived * kBinSize), _downloadData->entry->size());
+    qCDebug(LogDownloadLog) << "Resuming download of" << _downloadData->filename << "with" << _downloadData->written << "bytes";
+    return true;
 }
 
 //----------------------------------------------------------------------------------------
@@ -616,31 +738,42 @@ LogDownloadController::_prepareLogDownload()
         _downloadData->filename += ".bin";
     }
     _downloadData->file.setFileName(_downloadPath + _downloadData->filename);
+    _downloadData->progressFilename = _downloadData->file.fileName() + kProgressSuffix;
+    //-- Pick up an earlier download of this log which did not finish
+    const bool resume = _loadProgress();
     //-- Append a number to the end if the filename already exists
-    if (_downloadData->file.exists()){
+    if (!resume && _downloadData->file.exists()){
         uint num_dups = 0;
         QStringList filename_spl = _downloadData->filename.split('.');
         do {
             num_dups +=1;
-            _downloadData->file.setFileName(filename_spl[0] + '_' + QString::number(num_dups) + '.' + filename_spl[1]);
+            _downloadData->file.setFileName(_downloadPath + filename_spl[0] + '_' + QString::number(num_dups) + '.' + filename_spl[1]);
         } while( _downloadData->file.exists());
+        _downloadData->progressFilename = _downloadData->file.fileName() + kProgressSuffix;
     }
-    //-- Create file
-    if (!_downloadData->file.open(QIODevice::WriteOnly)) {
+    if (resume) {
+        if (!_downloadData->file.open(QIODevice::ReadWrite)) {
+            qWarning() << "Failed to open log file:" <<  _downloadData->filename;
+        } else {
+            result = true;
+        }
+    } else if (!_downloadData->file.open(QIODevice::WriteOnly)) {
+        //-- Create file
         qWarning() << "Failed to create log file:" <<  _downloadData->filename;
     } else {
         //-- Preallocate file
         if(!_downloadData->file.resize(entry->size())) {
             qWarning() << "Failed to allocate space for log file:" <<  _downloadData->filename;
         } else {
-            _downloadData->current_chunk = 0;
-            _downloadData->chunk_table = QBitArray(_downloadData->chunkBins(), false);
-            _downloadData->elapsed.start();
+            _downloadData->bins = QBitArray(_downloadData->binCount(), false);
             result = true;
         }
     }
-    if(!result) {
-        if (_downloadData->file.exists()) {
+    if (result) {
+        _downloadData->elapsed.start();
+        _downloadData->saveElapsed.start();
+    } else {
+        if (!resume && _downloadData->file.exists()) {
             _downloadData->file.remove();
         }
         _downloadData->entry->setStatus(tr("Error"));
@@ -703,9 +836,8 @@ LogDownloadController::cancel(void)
     }
     if(_downloadData) {
         _downloadData->entry->setStatus(tr("Canceled"));
-        if (_downloadData->file.exists()) {
-            _downloadData->file.remove();
-        }
+        //-- Keep the partial log, downloading it again resumes where this left off
+        _saveProgress();
         delete _downloadData;
         _downloadData = 0;
     }
@@ -21,10 +21,11 @@ Q_DECLARE_METATYPE(QAbstractSeries*)
 #define UPDATE_FREQUENCY (1000 / 15)    // 15Hz
 
 //-----------------------------------------------------------------------------
-QGCMAVLinkMessageField::QGCMAVLinkMessageField(QGCMAVLinkMessage *parent, QString name, QString type)
+QGCMAVLinkMessageField::QGCMAVLinkMessageField(QGCMAVLinkMessage *parent, int index, QString name, QString type)
     : QObject(parent)
     , _type(type)
     , _name(name)
+    , _index(index)
     , _msg(parent)
 {
     qCDebug(MAVLinkInspectorLog) << "Field:" << name << type;
@@ -37,8 +38,10 @@ QGCMAVLinkMessageField::addSeries(MAVLinkChartController* chart, QAbstractSeries
     if(!_pSeries) {
         _chart = chart;
         _pSeries = series;
+        //-- Record from here on, on the decode thread
+        _series = _msg->entry()->enableSeries(_index);
+        _seriesSequence = _series ? _series->sequence() : 0;
         emit seriesChanged();
-        _dataIndex = 0;
         _msg->updateFieldSelection();
     }
 }
@@ -48,9 +51,10 @@ void
 QGCMAVLinkMessageField::delSeries()
 {
     if(_pSeries) {
-        _values.clear();
+        _msg->entry()->disableSeries(_index);
+        _series = nullptr;
         QLineSeries* lineSeries = static_cast<QLineSeries*>(_pSeries);
-        lineSeries->replace(_values);
+        lineSeries->clear();
         _pSeries = nullptr;
         _chart   = nullptr;
         emit seriesChanged();
@@ -87,76 +91,73 @@ QGCMAVLinkMessageField::chartIndex()
 
 //-----------------------------------------------------------------------------
 void
-QGCMAVLinkMessageField::updateValue(QString newValue, qreal v)
+QGCMAVLinkMessageField::updateValue(QString newValue)
 {
     if(_value != newValue) {
         _value = newValue;
         emit valueChanged();
     }
-    if(_pSeries && _chart) {
-        int count = _values.count();
-        //-- Arbitrary limit of 1 minute of data at 50Hz for now
-        if(count < (50 * 60)) {
-            QPointF p(QGC::bootTimeMilliseconds(), v);
-            _values.append(p);
-        } else {
-            if(_dataIndex >= count) _dataIndex = 0;
-            _values[_dataIndex].setX(QGC::bootTimeMilliseconds());
-            _values[_dataIndex].setY(v);
-            _dataIndex++;
-        }
-        //-- Auto Range
-        if(_chart->rangeYIndex() == 0) {
-            qreal vmin  = std::numeric_limits<qreal>::max();
-            qreal vmax  = std::numeric_limits<qreal>::min();
-            for(int i = 0; i < _values.count(); i++) {
-                qreal v = _values[i].y();
-                if(vmax < v) vmax = v;
-                if(vmin > v) vmin = v;
-            }
-            bool changed = false;
-            if(std::abs(_rangeMin - vmin) > 0.000001) {
-                _rangeMin = vmin;
-                changed = true;
-            }
-            if(std::abs(_rangeMax - vmax) > 0.000001) {
-                _rangeMax = vmax;
-                changed = true;
-            }
-            if(changed) {
-                _chart->updateYRange();
-            }
-        }
-    }
 }
 
 //-----------------------------------------------------------------------------
 void
 QGCMAVLinkMessageField::updateSeries()
 {
-    int count = _values.count();
-    if (count > 1) {
-        QList<QPointF> s;
-        s.reserve(count);
-        int idx = _dataIndex;
-        for(int i = 0; i < count; i++, idx++) {
-            if(idx >= count) idx = 0;
-            QPointF p(_values[idx]);
-            s.append(p);
+    if(!_pSeries || !_chart || !_series) {
+        return;
+    }
+    QLineSeries* lineSeries = static_cast<QLineSeries*>(_pSeries);
+    //-- Only what arrived since the last refresh is added to the chart
+    QList<QPointF> points;
+    _seriesSequence = _series->read(_seriesSequence, points);
+    if(points.count()) {
+        lineSeries->append(points);
+    }
+    //-- Drop what is older than the longest time scale
+    const QList<MAVLinkInspectorController::TimeScale_st*>& timeScales = _chart->controller()->timeScaleSt();
+    const qreal oldest = static_cast<qreal>(QGC::bootTimeMilliseconds()) - (timeScales.count() ? timeScales.last()->timeScale : 0);
+    int expired = 0;
+    const int count = lineSeries->count();
+    while(expired < count && lineSeries->at(expired).x() < oldest) {
+        expired++;
+    }
+    if(expired) {
+        lineSeries->removePoints(0, expired);
+    }
+    //-- Auto Range
+    if(_chart->rangeYIndex() == 0 && (points.count() || expired) && lineSeries->count()) {
+        qreal vmin  = std::numeric_limits<qreal>::max();
+        qreal vmax  = std::numeric_limits<qreal>::lowest();
+        for(int i = 0; i < lineSeries->count(); i++) {
+            const qreal v = lineSeries->at(i).y();
+            if(vmax < v) vmax = v;
+            if(vmin > v) vmin = v;
+        }
+        bool changed = false;
+        if(std::abs(_rangeMin - vmin) > 0.000001) {
+            _rangeMin = vmin;
+            changed = true;
+        }
+        if(std::abs(_rangeMax - vmax) > 0.000001) {
+            _rangeMax = vmax;
+            changed = true;
+        }
+        if(changed) {
+            _chart->updateYRange();
         }
-        QLineSeries* lineSeries = static_cast<QLineSeries*>(_pSeries);
-        lineSeries->replace(s);
     }
 }
 
 //-----------------------------------------------------------------------------
-QGCMAVLinkMessage::QGCMAVLinkMessage(QObject *parent, mavlink_message_t* message)
+QGCMAVLinkMessage::QGCMAVLinkMessage(QObject *parent, MAVLinkInspectorStore::Entry* entry)
     : QObject(parent)
+    , _count(entry->count())
+    , _entry(entry)
 {
-    _message = *message;
-    const mavlink_message_info_t* msgInfo = mavlink_get_message_info(message);
+    _entry->latest(_message);
+    const mavlink_message_info_t* msgInfo = _entry->info();
     if (!msgInfo) {
-        qCWarning(MAVLinkInspectorLog) << QStringLiteral("QGCMAVLinkMessage NULL msgInfo msgid(%1)").arg(message->msgid);
+        qCWarning(MAVLinkInspectorLog) << QStringLiteral("QGCMAVLinkMessage NULL msgInfo msgid(%1)").arg(_entry->msgid());
         return;
     }
     _name = QString(msgInfo->name);
@@ -176,7 +177,7 @@ QGCMAVLinkMessage::QGCMAVLinkMessage(QObject *parent, mavlink_message_t* message
             case MAVLINK_TYPE_UINT64_T: type = QString("uint64_t"); break;
             case MAVLINK_TYPE_INT64_T:  type = QString("int64_t");  break;
         }
-        QGCMAVLinkMessageField* f = new QGCMAVLinkMessageField(this, msgInfo->fields[i].name, type);
+        QGCMAVLinkMessageField* f = new QGCMAVLinkMessageField(this, static_cast<int>(i), msgInfo->fields[i].name, type);
         _fields.append(f);
     }
 }
@@ -211,9 +212,10 @@ QGCMAVLinkMessage::updateFieldSelection()
 void
 QGCMAVLinkMessage::updateFreq()
 {
-    quint64 msgCount = _count - _lastCount;
-    _messageHz = (0.2 * _messageHz) + (0.8 * msgCount);
-    _lastCount = _count;
+    //-- Smoothed on the decode thread as messages arrive
+    const qint64 now = static_cast<qint64>(QGC::bootTimeMilliseconds());
+    _messageHz      = _entry->rate(now);
+    _bytesPerSecond = _entry->bandwidth(now);
     emit freqChanged();
 }
 
@@ -221,20 +223,26 @@ void QGCMAVLinkMessage::setSelected(bool sel)
 {
     if (_selected != sel) {
         _selected = sel;
-        _updateFields();
+        if (_selected) {
+            _entry->latest(_message);
+            _updateFields();
+        }
         emit selectedChanged();
     }
 }
 
 //-----------------------------------------------------------------------------
 void
-QGCMAVLinkMessage::update(mavlink_message_t* message)
+QGCMAVLinkMessage::update()
 {
-    _count++;
-    _message = *message;
-
+    const quint64 count = _entry->count();
+    if (count == _count) {
+        return;
+    }
+    _count = count;
     if (_selected) {
-        // Don't update field info unless selected to reduce perf hit of message processing
+        // Don't format fields unless selected, only the selected message is shown
+        _entry->latest(_message);
         _updateFields();
     }
     emit countChanged();
@@ -266,12 +274,12 @@ void QGCMAVLinkMessage::_updateFields(void)
                     // Enforce null termination
                     str[array_length - 1] = '\0';
                     QString v(str);
-                    f->updateValue(v, 0);
+                    f->updateValue(v);
                 } else {
                     // Single char
                     char b = *(reinterpret_cast<char*>(m + offset));
                     QString v(b);
-                    f->updateValue(v, 0);
+                    f->updateValue(v);
                 }
                 break;
             case MAVLINK_TYPE_UINT8_T:
@@ -283,11 +291,11 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     uint8_t u = *(m + offset);
-                    f->updateValue(QString::number(u), static_cast<qreal>(u));
+                    f->updateValue(QString::number(u));
                 }
                 break;
             case MAVLINK_TYPE_INT8_T:
@@ -299,11 +307,11 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     int8_t n = *(reinterpret_cast<int8_t*>(m + offset));
-                    f->updateValue(QString::number(n), static_cast<qreal>(n));
+                    f->updateValue(QString::number(n));
                 }
                 break;
             case MAVLINK_TYPE_UINT16_T:
@@ -316,12 +324,12 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     uint16_t n;
                     memcpy(&n, m + offset, sizeof(uint16_t));
-                    f->updateValue(QString::number(n), static_cast<qreal>(n));
+                    f->updateValue(QString::number(n));
                 }
                 break;
             case MAVLINK_TYPE_INT16_T:
@@ -334,12 +342,12 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     int16_t n;
                     memcpy(&n, m + offset, sizeof(int16_t));
-                    f->updateValue(QString::number(n), static_cast<qreal>(n));
+                    f->updateValue(QString::number(n));
                 }
                 break;
             case MAVLINK_TYPE_UINT32_T:
@@ -352,7 +360,7 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     uint32_t n;
@@ -360,9 +368,9 @@ void QGCMAVLinkMessage::_updateFields(void)
                     //-- Special case
                     if(_message.msgid == MAVLINK_MSG_ID_SYSTEM_TIME) {
                         QDateTime d = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(n),Qt::UTC,0);
-                        f->updateValue(d.toString("HH:mm:ss"), static_cast<qreal>(n));
+                        f->updateValue(d.toString("HH:mm:ss"));
                     } else {
-                        f->updateValue(QString::number(n), static_cast<qreal>(n));
+                        f->updateValue(QString::number(n));
                     }
                 }
                 break;
@@ -376,12 +384,12 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     int32_t n;
                     memcpy(&n, m + offset, sizeof(int32_t));
-                    f->updateValue(QString::number(n), static_cast<qreal>(n));
+                    f->updateValue(QString::number(n));
                 }
                 break;
             case MAVLINK_TYPE_FLOAT:
@@ -394,12 +402,12 @@ void QGCMAVLinkMessage::_updateFields(void)
                        string += tmp.arg(static_cast<double>(nums[j]));
                     }
                     string += QString::number(static_cast<double>(nums[array_length - 1]));
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     float fv;
                     memcpy(&fv, m + offset, sizeof(float));
-                    f->updateValue(QString::number(static_cast<double>(fv)), static_cast<qreal>(fv));
+                    f->updateValue(QString::number(static_cast<double>(fv)));
                 }
                 break;
             case MAVLINK_TYPE_DOUBLE:
@@ -412,12 +420,12 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(static_cast<double>(nums[array_length - 1]));
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     double d;
                     memcpy(&d, m + offset, sizeof(double));
-                    f->updateValue(QString::number(d), static_cast<qreal>(d));
+                    f->updateValue(QString::number(d));
                 }
                 break;
             case MAVLINK_TYPE_UINT64_T:
@@ -430,7 +438,7 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     uint64_t n;
@@ -438,9 +446,9 @@ void QGCMAVLinkMessage::_updateFields(void)
                     //-- Special case
                     if(_message.msgid == MAVLINK_MSG_ID_SYSTEM_TIME) {
                         QDateTime d = QDateTime::fromMSecsSinceEpoch(n/1000,Qt::UTC,0);
-                        f->updateValue(d.toString("yyyy MM dd HH:mm:ss"), static_cast<qreal>(n));
+                        f->updateValue(d.toString("yyyy MM dd HH:mm:ss"));
                     } else {
-                        f->updateValue(QString::number(n), static_cast<qreal>(n));
+                        f->updateValue(QString::number(n));
                     }
                 }
                 break;
@@ -454,12 +462,12 @@ void QGCMAVLinkMessage::_updateFields(void)
                         string += tmp.arg(nums[j]);
                     }
                     string += QString::number(nums[array_length - 1]);
-                    f->updateValue(string, static_cast<qreal>(nums[0]));
+                    f->updateValue(string);
                 } else {
                     // Single value
                     int64_t n;
                     memcpy(&n, m + offset, sizeof(int64_t));
-                    f->updateValue(QString::number(n), static_cast<qreal>(n));
+                    f->updateValue(QString::number(n));
                 }
                 break;
             }
@@ -485,15 +493,33 @@ QGCMAVLinkSystem::~QGCMAVLinkSystem()
 QGCMAVLinkMessage*
 QGCMAVLinkSystem::findMessage(uint32_t id, uint8_t cid)
 {
+    return _messageIndex.value((static_cast<quint32>(cid) << 24) | id, nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCMAVLinkSystem::clearMessages()
+{
+    _messageIndex.clear();
+    _messages.clearAndDeleteContents();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCMAVLinkSystem::updateFreq()
+{
+    qreal bytesPerSecond = 0;
     for(int i = 0; i < _messages.count(); i++) {
         QGCMAVLinkMessage* m = qobject_cast<QGCMAVLinkMessage*>(_messages.get(i));
         if(m) {
-            if(m->id() == id && m->cid() == cid) {
-                return m;
-            }
+            m->updateFreq();
+            bytesPerSecond += m->bytesPerSecond();
         }
     }
-    return nullptr;
+    if(std::abs(_bytesPerSecond - bytesPerSecond) > 0.000001) {
+        _bytesPerSecond = bytesPerSecond;
+        emit bytesPerSecondChanged();
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -562,6 +588,7 @@ QGCMAVLinkSystem::append(QGCMAVLinkMessage* message)
         message->setSelected(true);
     }
     _messages.append(message);
+    _messageIndex[(static_cast<quint32>(message->cid()) << 24) | message->id()] = message;
     //-- Sort messages by id and then cid
     if (_messages.count() > 0) {
         _messages.beginReset();
@@ -730,9 +757,12 @@ MAVLinkInspectorController::MAVLinkInspectorController()
     connect(multiVehicleManager, &MultiVehicleManager::vehicleAdded,   this, &MAVLinkInspectorController::_vehicleAdded);
     connect(multiVehicleManager, &MultiVehicleManager::vehicleRemoved, this, &MAVLinkInspectorController::_vehicleRemoved);
     MAVLinkProtocol* mavlinkProtocol = qgcApp()->toolbox()->mavlinkProtocol();
-    connect(mavlinkProtocol, &MAVLinkProtocol::messageReceived, this, &MAVLinkInspectorController::_receiveMessage);
+    _store.reset(new MAVLinkInspectorStore);
+    mavlinkProtocol->addDecodeObserver(_store);
     connect(&_updateFrequencyTimer, &QTimer::timeout, this, &MAVLinkInspectorController::_refreshFrequency);
     _updateFrequencyTimer.start(1000);
+    connect(&_refreshMessagesTimer, &QTimer::timeout, this, &MAVLinkInspectorController::_refreshMessages);
+    _refreshMessagesTimer.start(UPDATE_FREQUENCY);
     MultiVehicleManager *manager = qgcApp()->toolbox()->multiVehicleManager();
     connect(manager, &MultiVehicleManager::activeVehicleChanged, this, &MAVLinkInspectorController::_setActiveVehicle);
     _timeScaleSt.append(new TimeScale_st(this, tr("5 Sec"),   5 * 1000));
@@ -756,6 +786,7 @@ MAVLinkInspectorController::MAVLinkInspectorController()
 //-----------------------------------------------------------------------------
 MAVLinkInspectorController::~MAVLinkInspectorController()
 {
+    qgcApp()->toolbox()->mavlinkProtocol()->removeDecodeObserver(_store);
     _charts.clearAndDeleteContents();
     _systems.clearAndDeleteContents();
 }
@@ -805,15 +836,7 @@ MAVLinkInspectorController::_setActiveVehicle(Vehicle* vehicle)
 QGCMAVLinkSystem*
 MAVLinkInspectorController::_findVehicle(uint8_t id)
 {
-    for(int i = 0; i < _systems.count(); i++) {
-        QGCMAVLinkSystem* v = qobject_cast<QGCMAVLinkSystem*>(_systems.get(i));
-        if(v) {
-            if(v->id() == id) {
-                return v;
-            }
-        }
-    }
-    return nullptr;
+    return _systemIndex.value(id, nullptr);
 }
 
 //-----------------------------------------------------------------------------
@@ -823,11 +846,22 @@ MAVLinkInspectorController::_refreshFrequency()
     for(int i = 0; i < _systems.count(); i++) {
         QGCMAVLinkSystem* v = qobject_cast<QGCMAVLinkSystem*>(_systems.get(i));
         if(v) {
-            for(int i = 0; i < v->messages()->count(); i++) {
-                QGCMAVLinkMessage* m = qobject_cast<QGCMAVLinkMessage*>(v->messages()->get(i));
-                if(m) {
-                    m->updateFreq();
-                }
+            v->updateFreq();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkInspectorController::_refreshMessages()
+{
+    _discoverMessages();
+    //-- Only the active system is on screen
+    if(_activeSystem) {
+        for(int i = 0; i < _activeSystem->messages()->count(); i++) {
+            QGCMAVLinkMessage* m = qobject_cast<QGCMAVLinkMessage*>(_activeSystem->messages()->get(i));
+            if(m) {
+                m->update();
             }
         }
     }
@@ -839,12 +873,15 @@ MAVLinkInspectorController::_vehicleAdded(Vehicle* vehicle)
 {
     QGCMAVLinkSystem* v = _findVehicle(static_cast<uint8_t>(vehicle->id()));
     if(v) {
-        v->messages()->clearAndDeleteContents();
+        v->clearMessages();
     } else {
         v = new QGCMAVLinkSystem(this, static_cast<uint8_t>(vehicle->id()));
         _systems.append(v);
+        _systemIndex[v->id()] = v;
         _systemNames.append(tr("System %1").arg(vehicle->id()));
     }
+    //-- The store still has messages seen earlier, add them back in
+    _rescanEntries = true;
     emit systemsChanged();
 }
 
@@ -856,6 +893,7 @@ MAVLinkInspectorController::_vehicleRemoved(Vehicle* vehicle)
     if(v) {
         v->deleteLater();
         _systems.removeOne(v);
+        _systemIndex.remove(v->id());
         QString vs = tr("System %1").arg(vehicle->id());
         _systemNames.removeOne(vs);
         emit systemsChanged();
@@ -864,27 +902,48 @@ MAVLinkInspectorController::_vehicleRemoved(Vehicle* vehicle)
 
 //-----------------------------------------------------------------------------
 void
-MAVLinkInspectorController::_receiveMessage(LinkInterface*, mavlink_message_t message)
+MAVLinkInspectorController::_discoverMessages()
+{
+    if(_rescanEntries) {
+        _rescanEntries = false;
+        for(int i = 0; i < _knownEntries; i++) {
+            _addMessage(_store->entryAt(i), false);
+        }
+    }
+    //-- Anything seen for the first time since the last pass
+    const int entryCount = _store->entryCount();
+    while(_knownEntries < entryCount) {
+        MAVLinkInspectorStore::Entry* entry = _store->entryAt(_knownEntries);
+        if(!entry) {
+            //-- Still being added on a decode thread, pick it up next time
+            break;
+        }
+        _addMessage(entry, true);
+        _knownEntries++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkInspectorController::_addMessage(MAVLinkInspectorStore::Entry* entry, bool createSystem)
 {
-    QGCMAVLinkMessage* m = nullptr;
-    QGCMAVLinkSystem* v = _findVehicle(message.sysid);
+    QGCMAVLinkSystem* v = _findVehicle(entry->sysid());
     if(!v) {
-        v = new QGCMAVLinkSystem(this, message.sysid);
+        if(!createSystem) {
+            return;
+        }
+        v = new QGCMAVLinkSystem(this, entry->sysid());
         _systems.append(v);
-        _systemNames.append(tr("System %1").arg(message.sysid));
+        _systemIndex[v->id()] = v;
+        _systemNames.append(tr("System %1").arg(entry->sysid()));
         emit systemsChanged();
         if(!_activeSystem) {
             _activeSystem = v;
             emit activeSystemChanged();
         }
-    } else {
-        m = v->findMessage(message.msgid, message.compid);
     }
-    if(!m) {
-        m = new QGCMAVLinkMessage(this, &message);
-        v->append(m);
-    } else {
-        m->update(&message);
+    if(!v->findMessage(entry->msgid(), entry->compid())) {
+        v->append(new QGCMAVLinkMessage(this, entry));
     }
 }
 
@@ -9,23 +9,26 @@
 
 // 1.MAVLinkInspectorController ()
 //  - ά QmlObjectListModel _systems ӵ˻ϵͳ
-//  - ͨ _receiveMessage ԭʼMAVLinkϢ
+//  - MAVLinkInspectorStore ڽ߳м¼ϢƵʡͼֶ
+//  - ͨ _discoverMessages ʾƵʴ MAVLinkInspectorStore ȡ³ֵϢ
 //  -  QGCMAVLinkSystem::append() 洢Ϣ
 
 // 2.QGCMAVLinkSystem (ϵͳ)
 //  - ͨ _messages б洢QGCMAVLinkMessage
-//  - ʹ findMessage(uint32_t id, uint8_t cid) ضϢ
+//  - ʹ findMessage(uint32_t id, uint8_t cid) ͨϣضϢ
+//  - ϢĴ bytesPerSecond
 //  - ͨ compIDs ԹͬIDĹ
 
 // 3.QGCMAVLinkMessage (Ϣ)
 //  -  mavlink_message_t ṹ
 //  - ͨ _fields б洢QGCMAVLinkMessageFieldֶ
-//  -  updateFreq() ϢƵ
+//  -  update() ʾƵʴ MAVLinkInspectorStore ˢ, ֻѡʱʽֶ
+//  -  updateFreq() ȡ̼߳ϢƵʺʹ
 
 // 4.QGCMAVLinkMessageField (ֶδ)
 //  - ͨ addSeries() MAVLinkChartController
-//  - ά QList<QPointF> _values 洢ʱ
-//  -  valueChanged źŸͼʾ
+//  -  MAVLinkInspectorStore  MAVLinkFieldSeries ȡʱ
+//  -  valueChanged źŸֶʾ
 
 // 5.MAVLinkChartController (ͼ)
 //  - ͨ addSeries(QGCMAVLinkMessageField*, QAbstractSeries*) Դ
@@ -40,12 +43,15 @@
 #pragma once
 
 #include "MAVLinkProtocol.h"
+#include "MAVLinkInspectorStore.h"
 #include "Vehicle.h"
 
 #include <QObject>
 #include <QString>
 #include <QDebug>
 #include <QVariantList>
+#include <QHash>
+#include <QSharedPointer>
 #include <QtCharts/QAbstractSeries>
 
 Q_DECLARE_LOGGING_CATEGORY(MAVLinkInspectorLog)
@@ -70,7 +76,7 @@ public:
     Q_PROPERTY(int              chartIndex  READ chartIndex CONSTANT)
     Q_PROPERTY(QAbstractSeries* series      READ series     NOTIFY seriesChanged)
 
-    QGCMAVLinkMessageField(QGCMAVLinkMessage* parent, QString name, QString type);
+    QGCMAVLinkMessageField(QGCMAVLinkMessage* parent, int index, QString name, QString type);
 
     QString         name            () { return _name;  }
     QString         label           ();
@@ -79,13 +85,12 @@ public:
     bool            selectable      () const{ return _selectable; }
     bool            selected        () { return _pSeries != nullptr; }
     QAbstractSeries*series          () { return _pSeries; }
-    QList<QPointF>* values          () { return &_values;}
     qreal           rangeMin        () const{ return _rangeMin; }
     qreal           rangeMax        () const{ return _rangeMax; }
     int             chartIndex      ();
 
     void            setSelectable   (bool sel);
-    void            updateValue     (QString newValue, qreal v);
+    void            updateValue     (QString newValue);
 
     void            addSeries       (MAVLinkChartController* chart, QAbstractSeries* series);
     void            delSeries       ();
@@ -101,14 +106,15 @@ private:
     QString     _name;
     QString     _value;
     bool        _selectable = true;
-    int         _dataIndex  = 0;
+    int         _index      = 0;            ///< Field index within the message
     qreal       _rangeMin   = 0;
     qreal       _rangeMax   = 0;
 
     QAbstractSeries*    _pSeries = nullptr;
     QGCMAVLinkMessage*  _msg     = nullptr;
     MAVLinkChartController*      _chart   = nullptr;
-    QList<QPointF>      _values;
+    MAVLinkFieldSeries* _series  = nullptr;     ///< Samples recorded on the decode thread while charted
+    quint64             _seriesSequence = 0;    ///< Next sample to add to the chart
 };
 
 //-----------------------------------------------------------------------------
@@ -120,26 +126,28 @@ public:
     Q_PROPERTY(quint32              cid             READ cid            CONSTANT)
     Q_PROPERTY(QString              name            READ name           CONSTANT)
     Q_PROPERTY(qreal                messageHz       READ messageHz      NOTIFY freqChanged)
+    Q_PROPERTY(qreal                bytesPerSecond  READ bytesPerSecond NOTIFY freqChanged)
     Q_PROPERTY(quint64              count           READ count          NOTIFY countChanged)
     Q_PROPERTY(QmlObjectListModel*  fields          READ fields         CONSTANT)
     Q_PROPERTY(bool                 fieldSelected   READ fieldSelected  NOTIFY fieldSelectedChanged)
     Q_PROPERTY(bool                 selected        READ selected       NOTIFY selectedChanged)
 
-    QGCMAVLinkMessage   (QObject* parent, mavlink_message_t* message);
+    QGCMAVLinkMessage   (QObject* parent, MAVLinkInspectorStore::Entry* entry);
     ~QGCMAVLinkMessage  ();
 
-    quint32             id              () const{ return _message.msgid;  }
-    quint8              cid             () const{ return _message.compid; }
+    quint32             id              () const{ return _entry->msgid();  }
+    quint8              cid             () const{ return _entry->compid(); }
     QString             name            () { return _name;  }
     qreal               messageHz       () const{ return _messageHz; }
+    qreal               bytesPerSecond  () const{ return _bytesPerSecond; }
     quint64             count           () const{ return _count; }
-    quint64             lastCount       () const{ return _lastCount; }
     QmlObjectListModel* fields          () { return &_fields; }
     bool                fieldSelected   () const{ return _fieldSelected; }
     bool                selected        () const{ return _selected; }
+    MAVLinkInspectorStore::Entry* entry () { return _entry; }
 
     void                updateFieldSelection();
-    void                update          (mavlink_message_t* message);
+    void                update          ();
     void                updateFreq      ();
     void                setSelected     (bool sel);
 
@@ -155,9 +163,10 @@ private:
     QmlObjectListModel  _fields;
     QString             _name;
     qreal               _messageHz      = 0.0;
-    uint64_t            _count          = 1;
-    uint64_t            _lastCount      = 0;
-    mavlink_message_t   _message;
+    qreal               _bytesPerSecond = 0.0;
+    uint64_t            _count          = 0;
+    MAVLinkInspectorStore::Entry* _entry;
+    mavlink_message_t   _message;           ///< Copy of the latest message, only taken while selected
     bool                _fieldSelected  = false;
     bool                _selected       = false;
 };
@@ -172,6 +181,7 @@ public:
     Q_PROPERTY(QList<int>           compIDs         READ compIDs                            NOTIFY compIDsChanged)
     Q_PROPERTY(QStringList          compIDsStr      READ compIDsStr                         NOTIFY compIDsChanged)
     Q_PROPERTY(int                  selected        READ selected       WRITE setSelected   NOTIFY selectedChanged)
+    Q_PROPERTY(qreal                bytesPerSecond  READ bytesPerSecond                     NOTIFY bytesPerSecondChanged)
 
     QGCMAVLinkSystem   (QObject* parent, quint8 id);
     ~QGCMAVLinkSystem  ();
@@ -181,15 +191,19 @@ public:
     QList<int>          compIDs         () { return _compIDs; }
     QStringList         compIDsStr      () { return _compIDsStr; }
     int                 selected        () const{ return _selected; }
+    qreal               bytesPerSecond  () const{ return _bytesPerSecond; }
 
     void                setSelected     (int sel);
     QGCMAVLinkMessage*  findMessage     (uint32_t id, uint8_t cid);
     int                 findMessage     (QGCMAVLinkMessage* message);
     void                append          (QGCMAVLinkMessage* message);
+    void                clearMessages   ();
+    void                updateFreq      ();
 
 signals:
     void compIDsChanged                 ();
     void selectedChanged                ();
+    void bytesPerSecondChanged          ();
 
 private:
     void _checkCompID                   (QGCMAVLinkMessage *message);
@@ -200,7 +214,9 @@ private:
     QList<int>          _compIDs;
     QStringList         _compIDsStr;
     QmlObjectListModel  _messages;      //-- List of QGCMAVLinkMessage
+    QHash<quint32, QGCMAVLinkMessage*> _messageIndex;  ///< Keyed by compid and msgid
     int                 _selected = 0;
+    qreal               _bytesPerSecond = 0.0;
 };
 
 //-----------------------------------------------------------------------------
@@ -269,6 +285,9 @@ private:
 class MAVLinkInspectorController : public QObject
 {
     Q_OBJECT
+
+    friend class MAVLinkInspectorControllerTest;
+
 public:
     MAVLinkInspectorController();
     ~MAVLinkInspectorController();
@@ -316,14 +335,16 @@ signals:
     void rangeListChanged   ();
 
 private slots:
-    void _receiveMessage    (LinkInterface* link, mavlink_message_t message);
     void _vehicleAdded      (Vehicle* vehicle);
     void _vehicleRemoved    (Vehicle* vehicle);
     void _setActiveVehicle  (Vehicle* vehicle);
     void _refreshFrequency  ();
+    void _refreshMessages   ();
 
 private:
-    QGCMAVLinkSystem* _findVehicle (uint8_t id);
+    QGCMAVLinkSystem* _findVehicle      (uint8_t id);
+    void              _discoverMessages (void);
+    void              _addMessage       (MAVLinkInspectorStore::Entry* entry, bool createSystem);
 
 private:
 
@@ -333,8 +354,13 @@ private:
     QStringList         _rangeList;
     QGCMAVLinkSystem*   _activeSystem           = nullptr;
     QTimer              _updateFrequencyTimer;
+    QTimer              _refreshMessagesTimer;
+    QSharedPointer<MAVLinkInspectorStore> _store;          ///< Fed from the link decode threads
     QStringList         _systemNames;
     QmlObjectListModel  _systems;                           ///< List of QGCMAVLinkSystem
+    QHash<quint8, QGCMAVLinkSystem*> _systemIndex;          ///< _systems by system id
+    int                 _knownEntries           = 0;        ///< Store entries which have been looked at
+    bool                _rescanEntries          = false;    ///< Known entries need to be added again, a system was cleared out
     QmlObjectListModel  _charts;                            ///< List of MAVLinkCharts
     QList<TimeScale_st*>_timeScaleSt;
     QList<Range_st*>    _rangeSt;
@@ -0,0 +1,110 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkInspectorControllerTest.h"
+#include "MAVLinkInspectorController.h"
+
+#include <QSignalSpy>
+
+static mavlink_message_t _heartbeat(uint8_t sysid, uint8_t compid)
+{
+    mavlink_message_t message;
+    mavlink_msg_heartbeat_pack(sysid, compid, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_PX4, 0, 0, MAV_STATE_ACTIVE);
+    return message;
+}
+
+void MAVLinkInspectorControllerTest::_discoverMessagesTest(void)
+{
+    MAVLinkInspectorController  controller;
+    MAVLinkInspectorStore*      store = controller._store.data();
+    QSignalSpy                  systemsSpy(&controller, &MAVLinkInspectorController::systemsChanged);
+
+    store->messageDecoded(nullptr, _heartbeat(1, 1));
+    store->messageDecoded(nullptr, _heartbeat(1, 2));
+    store->messageDecoded(nullptr, _heartbeat(2, 1));
+    controller._discoverMessages();
+    QCOMPARE(controller._knownEntries, 3);
+    QCOMPARE(controller.systems()->count(), 2);
+    QCOMPARE(controller.systemNames(), QStringList({ QStringLiteral("System 1"), QStringLiteral("System 2") }));
+    QCOMPARE(systemsSpy.count(), 2);
+    QVERIFY(controller.activeSystem());
+    QCOMPARE(controller.activeSystem()->id(), static_cast<quint8>(1));
+
+    QGCMAVLinkSystem* system1 = controller._findVehicle(1);
+    QVERIFY(system1);
+    QCOMPARE(system1->messages()->count(), 2);
+    QVERIFY(system1->findMessage(MAVLINK_MSG_ID_HEARTBEAT, 1));
+    QVERIFY(system1->findMessage(MAVLINK_MSG_ID_HEARTBEAT, 2));
+    QCOMPARE(controller._findVehicle(2)->messages()->count(), 1);
+
+    // Messages which are already known change nothing
+    store->messageDecoded(nullptr, _heartbeat(1, 1));
+    controller._discoverMessages();
+    QCOMPARE(controller._knownEntries, 3);
+    QCOMPARE(system1->messages()->count(), 2);
+    QCOMPARE(systemsSpy.count(), 2);
+
+    // An entry which is counted but not yet published by its decode thread is picked up on the next pass
+    store->messageDecoded(nullptr, _heartbeat(1, 3));
+    MAVLinkInspectorStore::Entry* pending = store->_entries[3].exchange(nullptr);
+    QVERIFY(pending);
+    controller._discoverMessages();
+    QCOMPARE(controller._knownEntries, 3);
+    QCOMPARE(system1->messages()->count(), 2);
+    store->_entries[3].store(pending);
+    controller._discoverMessages();
+    QCOMPARE(controller._knownEntries, 4);
+    QCOMPARE(system1->messages()->count(), 3);
+    QVERIFY(system1->findMessage(MAVLINK_MSG_ID_HEARTBEAT, 3));
+}
+
+void MAVLinkInspectorControllerTest::_rescanEntriesTest(void)
+{
+    MAVLinkInspectorController  controller;
+    MAVLinkInspectorStore*      store = controller._store.data();
+
+    store->messageDecoded(nullptr, _heartbeat(1, 1));
+    store->messageDecoded(nullptr, _heartbeat(1, 2));
+    store->messageDecoded(nullptr, _heartbeat(2, 1));
+    controller._discoverMessages();
+    QGCMAVLinkSystem* system1 = controller._findVehicle(1);
+    QGCMAVLinkSystem* system2 = controller._findVehicle(2);
+    QVERIFY(system1 && system2);
+
+    // A vehicle coming back clears out its system and asks for the entries the store already has, as _vehicleAdded does
+    system1->clearMessages();
+    controller._rescanEntries = true;
+    controller._discoverMessages();
+    QVERIFY(!controller._rescanEntries);
+    QCOMPARE(controller._knownEntries, 3);
+    QCOMPARE(system1->messages()->count(), 2);
+    QCOMPARE(system2->messages()->count(), 1);
+
+    // Systems which were removed are not brought back by a rescan, as _vehicleRemoved does
+    controller._systems.removeOne(system2);
+    controller._systemIndex.remove(2);
+    controller._systemNames.removeOne(QStringLiteral("System 2"));
+    system2->deleteLater();
+    controller._rescanEntries = true;
+    controller._discoverMessages();
+    QVERIFY(!controller._findVehicle(2));
+    QCOMPARE(controller.systems()->count(), 1);
+
+    // Only messages seen for the first time create one again
+    store->messageDecoded(nullptr, _heartbeat(2, 1));
+    controller._discoverMessages();
+    QVERIFY(!controller._findVehicle(2));
+    store->messageDecoded(nullptr, _heartbeat(2, 5));
+    controller._discoverMessages();
+    QCOMPARE(controller._knownEntries, 4);
+    system2 = controller._findVehicle(2);
+    QVERIFY(system2);
+    QCOMPARE(system2->messages()->count(), 1);
+    QVERIFY(system2->findMessage(MAVLINK_MSG_ID_HEARTBEAT, 5));
+}
@@ -158,6 +158,14 @@ AnalyzePage {
                         QGCLabel {
                             text:       curMessage ? curMessage.count : ""
                         }
+                        QGCLabel {
+                            text:       qsTr("Bandwidth:")
+                        }
+                        QGCLabel {
+                            text:       curMessage && curSystem ? qsTr("%1 B/s (%2% of %3 B/s)").arg(curMessage.bytesPerSecond.toFixed(0))
+                                                                                               .arg(curSystem.bytesPerSecond > 0 ? (100 * curMessage.bytesPerSecond / curSystem.bytesPerSecond).toFixed(1) : 0)
+                                                                                               .arg(curSystem.bytesPerSecond.toFixed(0)) : ""
+                        }
                     }
                     Item { height: ScreenTools.defaultFontPixelHeight; width: 1 }
                     //---------------------------------------------------------
@@ -0,0 +1,364 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkInspectorStore.h"
+#include "QGC.h"
+
+#include <cmath>
+#include <cstring>
+
+QGC_LOGGING_CATEGORY(MAVLinkInspectorStoreLog, "MAVLinkInspectorStoreLog")
+
+//-----------------------------------------------------------------------------
+MAVLinkFieldSeries::MAVLinkFieldSeries(void)
+    : _times    (capacity)
+    , _values   (capacity)
+{
+
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkFieldSeries::append(qint64 time, double value)
+{
+    const quint64 head  = _head.load(std::memory_order_relaxed);
+    const int     index = static_cast<int>(head & (capacity - 1));
+    _times.data()[index]    = time;
+    _values.data()[index]   = value;
+    _head.store(head + 1, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+quint64
+MAVLinkFieldSeries::read(quint64 sequence, QList<QPointF>& points) const
+{
+    const quint64 head = _head.load(std::memory_order_acquire);
+    if (head - sequence > static_cast<quint64>(capacity)) {
+        sequence = head - capacity;
+    }
+
+    const int firstPoint = points.count();
+    for (quint64 i = sequence; i < head; i++) {
+        const int index = static_cast<int>(i & (capacity - 1));
+        points.append(QPointF(_times[index], _values[index]));
+    }
+
+    // The producer may have lapped the oldest of the samples while they were being copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const int overwritten = _overwritten(sequence, head, _head.load(std::memory_order_relaxed));
+    if (overwritten) {
+        points.erase(points.begin() + firstPoint, points.begin() + firstPoint + overwritten);
+    }
+
+    return head;
+}
+
+//-----------------------------------------------------------------------------
+int
+MAVLinkFieldSeries::_overwritten(quint64 sequence, quint64 head, quint64 newHead)
+{
+    // Samples up to newHead - capacity have been replaced, and the producer may be part way through writing
+    // over the one after them
+    if (newHead - sequence < static_cast<quint64>(capacity)) {
+        return 0;
+    }
+    return static_cast<int>(qMin(newHead - sequence - capacity + 1, head - sequence));
+}
+
+//-----------------------------------------------------------------------------
+MAVLinkInspectorStore::Entry::Entry(const mavlink_message_t& message, const mavlink_message_info_t* info)
+    : _sysid        (message.sysid)
+    , _compid       (message.compid)
+    , _msgid        (message.msgid)
+    , _info         (info)
+    , _message      (message)
+    , _fieldCount   (info ? static_cast<int>(info->num_fields) : 0)
+    , _series       (new std::atomic<MAVLinkFieldSeries*>[qMax(_fieldCount, 1)])
+{
+    for (int i = 0; i < _fieldCount; i++) {
+        _series[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+//-----------------------------------------------------------------------------
+MAVLinkInspectorStore::Entry::~Entry()
+{
+    for (int i = 0; i < _fieldCount; i++) {
+        delete _series[i].load(std::memory_order_relaxed);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkInspectorStore::Entry::latest(mavlink_message_t& message) const
+{
+    while (true) {
+        const quint32 sequence = _sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+        memcpy(&message, &_message, sizeof(message));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_sequence.load(std::memory_order_relaxed) == sequence) {
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+MAVLinkFieldSeries*
+MAVLinkInspectorStore::Entry::enableSeries(int fieldIndex)
+{
+    if (fieldIndex < 0 || fieldIndex >= _fieldCount) {
+        return nullptr;
+    }
+    MAVLinkFieldSeries* series = _series[fieldIndex].load(std::memory_order_acquire);
+    if (!series) {
+        series = new MAVLinkFieldSeries;
+        _series[fieldIndex].store(series, std::memory_order_release);
+    }
+    series->enabled.store(true, std::memory_order_release);
+    return series;
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkInspectorStore::Entry::disableSeries(int fieldIndex)
+{
+    if (fieldIndex >= 0 && fieldIndex < _fieldCount) {
+        MAVLinkFieldSeries* series = _series[fieldIndex].load(std::memory_order_acquire);
+        if (series) {
+            series->enabled.store(false, std::memory_order_release);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkInspectorStore::Entry::_update(const mavlink_message_t& message, qint64 time)
+{
+    _count.fetch_add(1, std::memory_order_relaxed);
+
+    // The same message can arrive on more than one link at the same time. Whoever gets here second skips
+    // the update rather than waiting, which also keeps each series single producer.
+    quint32 sequence = _sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1) || !_sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+        return;
+    }
+    memcpy(&_message, &message, sizeof(message));
+    _updateRates(message, time);
+    for (int i = 0; i < _fieldCount; i++) {
+        MAVLinkFieldSeries* series = _series[i].load(std::memory_order_acquire);
+        if (series && series->enabled.load(std::memory_order_relaxed)) {
+            series->append(time, fieldValue(message, _info->fields[i]));
+        }
+    }
+    _sequence.store(sequence + 2, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkInspectorStore::Entry::_updateRates(const mavlink_message_t& message, qint64 time)
+{
+    const int       length      = wireLength(message);
+    const qint64    lastTime    = _lastTime.exchange(time, std::memory_order_relaxed);
+
+    if (lastTime == 0) {
+        _length.store(length, std::memory_order_relaxed);
+        return;
+    }
+
+    // Weighting by the time since the last message makes the smoothing cover the same span of time
+    // whether the message comes at 200Hz or once every few seconds
+    const double delta      = qMax(static_cast<double>(time - lastTime), 0.1);
+    const double interval   = _interval.load(std::memory_order_relaxed);
+    if (interval == 0) {
+        _interval.store(delta, std::memory_order_relaxed);
+    } else {
+        const double alpha = 1.0 - std::exp(-delta / rateTimeConstantMSecs);
+        _interval.store(interval + (alpha * (delta - interval)), std::memory_order_relaxed);
+        const double averageLength = _length.load(std::memory_order_relaxed);
+        _length.store(averageLength + (alpha * (length - averageLength)), std::memory_order_relaxed);
+    }
+}
+
+//-----------------------------------------------------------------------------
+double
+MAVLinkInspectorStore::Entry::rate(qint64 now) const
+{
+    const double interval = _interval.load(std::memory_order_relaxed);
+    if (interval <= 0) {
+        return 0;
+    }
+    // A message which slowed down or stopped is bounded by the time since it was last seen
+    const double sinceLast = static_cast<double>(now - _lastTime.load(std::memory_order_relaxed));
+    return 1000.0 / qMax(interval, sinceLast);
+}
+
+//-----------------------------------------------------------------------------
+double
+MAVLinkInspectorStore::Entry::bandwidth(qint64 now) const
+{
+    return rate(now) * _length.load(std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+MAVLinkInspectorStore::MAVLinkInspectorStore(void)
+    : _table    (new std::atomic<Entry*>[tableSize])
+    , _entries  (new std::atomic<Entry*>[tableSize])
+{
+    for (int i = 0; i < tableSize; i++) {
+        _table[i].store(nullptr, std::memory_order_relaxed);
+        _entries[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+//-----------------------------------------------------------------------------
+MAVLinkInspectorStore::~MAVLinkInspectorStore()
+{
+    for (int i = 0; i < tableSize; i++) {
+        delete _table[i].load(std::memory_order_relaxed);
+    }
+}
+
+//-----------------------------------------------------------------------------
+quint64
+MAVLinkInspectorStore::_key(uint8_t sysid, uint8_t compid, uint32_t msgid)
+{
+    return (static_cast<quint64>(sysid) << 32) | (static_cast<quint64>(compid) << 24) | (msgid & 0xffffff);
+}
+
+//-----------------------------------------------------------------------------
+int
+MAVLinkInspectorStore::_bucket(quint64 key)
+{
+    // Fibonacci hashing spreads the few distinct sysid/compid values over the table
+    return static_cast<int>((key * Q_UINT64_C(0x9E3779B97F4A7C15)) >> 52) & (tableSize - 1);
+}
+
+//-----------------------------------------------------------------------------
+MAVLinkInspectorStore::Entry*
+MAVLinkInspectorStore::entry(uint8_t sysid, uint8_t compid, uint32_t msgid) const
+{
+    const quint64 key = _key(sysid, compid, msgid);
+    int bucket = _bucket(key);
+    for (int probe = 0; probe < tableSize; probe++) {
+        Entry* entry = _table[bucket].load(std::memory_order_acquire);
+        if (!entry) {
+            return nullptr;
+        }
+        if (_key(entry->sysid(), entry->compid(), entry->msgid()) == key) {
+            return entry;
+        }
+        bucket = (bucket + 1) & (tableSize - 1);
+    }
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void
+MAVLinkInspectorStore::messageDecoded(LinkInterface* /*link*/, const mavlink_message_t& message)
+{
+    const qint64 time = static_cast<qint64>(QGC::bootTimeMilliseconds());
+
+    Entry* entry = this->entry(message.sysid, message.compid, message.msgid);
+    if (!entry) {
+        // First sighting. Entries are only ever added, so a slot claimed by another thread is simply skipped.
+        const quint64   key         = _key(message.sysid, message.compid, message.msgid);
+        Entry*          newEntry    = new Entry(message, mavlink_get_message_info(&message));
+        int             bucket      = _bucket(key);
+        for (int probe = 0; probe < tableSize && !entry; probe++) {
+            Entry* expected = nullptr;
+            if (_table[bucket].compare_exchange_strong(expected, newEntry, std::memory_order_acq_rel)) {
+                entry = newEntry;
+                _entries[_entryCount.fetch_add(1, std::memory_order_acq_rel)].store(newEntry, std::memory_order_release);
+            } else if (_key(expected->sysid(), expected->compid(), expected->msgid()) == key) {
+                delete newEntry;
+                entry = expected;
+            }
+            bucket = (bucket + 1) & (tableSize - 1);
+        }
+        if (!entry) {
+            delete newEntry;
+            if (!_fullWarned.exchange(true)) {
+                qCWarning(MAVLinkInspectorStoreLog) << "Message table full, new messages are not inspected";
+            }
+            return;
+        }
+    }
+
+    entry->_update(message, time);
+}
+
+//-----------------------------------------------------------------------------
+int
+MAVLinkInspectorStore::wireLength(const mavlink_message_t& message)
+{
+    if (message.magic == MAVLINK_STX_MAVLINK1) {
+        return message.len + MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_NUM_CHECKSUM_BYTES;
+    }
+    const int signatureLength = (message.incompat_flags & MAVLINK_IFLAG_SIGNED) ? MAVLINK_SIGNATURE_BLOCK_LEN : 0;
+    return message.len + MAVLINK_NUM_NON_PAYLOAD_BYTES + signatureLength;
+}
+
+//-----------------------------------------------------------------------------
+double
+MAVLinkInspectorStore::fieldValue(const mavlink_message_t& message, const mavlink_field_info_t& field)
+{
+    const char* data = reinterpret_cast<const char*>(&message.payload64[0]) + field.wire_offset;
+
+    switch (field.type) {
+    case MAVLINK_TYPE_UINT8_T:
+        return static_cast<uint8_t>(*data);
+    case MAVLINK_TYPE_INT8_T:
+        return static_cast<int8_t>(*data);
+    case MAVLINK_TYPE_UINT16_T: {
+        uint16_t v;
+        memcpy(&v, data, sizeof(v));
+        return v;
+    }
+    case MAVLINK_TYPE_INT16_T: {
+        int16_t v;
+        memcpy(&v, data, sizeof(v));
+        return v;
+    }
+    case MAVLINK_TYPE_UINT32_T: {
+        uint32_t v;
+        memcpy(&v, data, sizeof(v));
+        return v;
+    }
+    case MAVLINK_TYPE_INT32_T: {
+        int32_t v;
+        memcpy(&v, data, sizeof(v));
+        return v;
+    }
+    case MAVLINK_TYPE_FLOAT: {
+        float v;
+        memcpy(&v, data, sizeof(v));
+        return static_cast<double>(v);
+    }
+    case MAVLINK_TYPE_DOUBLE: {
+        double v;
+        memcpy(&v, data, sizeof(v));
+        return v;
+    }
+    case MAVLINK_TYPE_UINT64_T: {
+        uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        return static_cast<double>(v);
+    }
+    case MAVLINK_TYPE_INT64_T: {
+        int64_t v;
+        memcpy(&v, data, sizeof(v));
+        return static_cast<double>(v);
+    }
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,144 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "MAVLinkDecoder.h"
+#include "QGCLoggingCategory.h"
+
+#include <QList>
+#include <QPointF>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+Q_DECLARE_LOGGING_CATEGORY(MAVLinkInspectorStoreLog)
+
+/// Time series of a single message field. Written by the decode thread which owns the message and read from the
+/// GUI thread without locking. Times and values are kept in separate columns of a fixed size ring.
+class MAVLinkFieldSeries
+{
+public:
+    MAVLinkFieldSeries(void);
+
+    /// Producer: records a sample, overwriting the oldest once the ring is full
+    void append(qint64 time, double value);
+
+    /// Consumer: appends the samples recorded since sequence to points. Samples which have already been
+    /// overwritten are skipped.
+    ///     @return Sequence to pass on the next call
+    quint64 read(quint64 sequence, QList<QPointF>& points) const;
+
+    /// @return Sequence of the next sample to be recorded
+    quint64 sequence(void) const { return _head.load(std::memory_order_acquire); }
+
+    std::atomic<bool> enabled { false };
+
+    static const int capacity = 16384;  ///< Over a minute at 200Hz, power of two
+
+private:
+    friend class MAVLinkInspectorStoreTest;
+
+    /// @return Number of samples from sequence on which the producer may have overwritten, given the head seen
+    ///         before (head) and after (newHead) copying them
+    static int _overwritten(quint64 sequence, quint64 head, quint64 newHead);
+
+    QVector<qint64>         _times;
+    QVector<double>         _values;
+    std::atomic<quint64>    _head { 0 };    ///< Number of samples ever recorded
+};
+
+/// Latest contents, rates and charted field values of every (sysid, compid, msgid) seen on any link, kept up to date
+/// from the decode threads. The GUI thread pulls from it at display rate instead of handling every message.
+class MAVLinkInspectorStore : public MAVLinkDecodeObserver
+{
+public:
+    class Entry
+    {
+    public:
+        Entry(const mavlink_message_t& message, const mavlink_message_info_t* info);
+        ~Entry();
+
+        uint8_t                         sysid   (void) const { return _sysid; }
+        uint8_t                         compid  (void) const { return _compid; }
+        uint32_t                        msgid   (void) const { return _msgid; }
+        const mavlink_message_info_t*   info    (void) const { return _info; }
+        quint64                         count   (void) const { return _count.load(std::memory_order_relaxed); }
+
+        /// @return Messages per second, smoothed over about rateTimeConstantMSecs. Falls off once the message stops.
+        double rate     (qint64 now) const;
+
+        /// @return Bytes per second on the wire, including framing and signature
+        double bandwidth(qint64 now) const;
+
+        /// Copies out the most recent message
+        void latest(mavlink_message_t& message) const;
+
+        /// Starts recording the field, GUI thread only. Series are kept for the life of the store once created.
+        MAVLinkFieldSeries* enableSeries(int fieldIndex);
+        void                disableSeries(int fieldIndex);
+
+    private:
+        friend class MAVLinkInspectorStore;
+        friend class MAVLinkInspectorStoreTest;
+
+        void _update        (const mavlink_message_t& message, qint64 time);
+        void _updateRates   (const mavlink_message_t& message, qint64 time);
+
+        const uint8_t                                       _sysid;
+        const uint8_t                                       _compid;
+        const uint32_t                                      _msgid;
+        const mavlink_message_info_t*                       _info;
+        std::atomic<quint64>                                _count      { 0 };
+        std::atomic<quint32>                                _sequence   { 0 };  ///< Seqlock over _message, odd while being written
+        std::atomic<qint64>                                 _lastTime   { 0 };
+        std::atomic<double>                                 _interval   { 0 };  ///< Smoothed msecs between messages, 0 until the second one
+        std::atomic<double>                                 _length     { 0 };  ///< Smoothed bytes per message
+        mavlink_message_t                                   _message;
+        int                                                 _fieldCount;
+        std::unique_ptr<std::atomic<MAVLinkFieldSeries*>[]> _series;
+    };
+
+    MAVLinkInspectorStore(void);
+    ~MAVLinkInspectorStore();
+
+    /// @return Entry for the message, nullptr if it has not been seen yet
+    Entry* entry(uint8_t sysid, uint8_t compid, uint32_t msgid) const;
+
+    /// Entries in the order they were first seen, so new messages can be picked up without a scan
+    ///     @return Number of entries, entryAt may still return nullptr for the last few while they are being added
+    int     entryCount  (void) const { return _entryCount.load(std::memory_order_acquire); }
+    Entry*  entryAt     (int index) const { return _entries[index].load(std::memory_order_acquire); }
+
+    /// @return Bytes the message took up on the link
+    static int wireLength(const mavlink_message_t& message);
+
+    /// Reads the first element of a field as a double
+    static double fieldValue(const mavlink_message_t& message, const mavlink_field_info_t& field);
+
+    // Overrides from MAVLinkDecodeObserver
+    void messageDecoded(LinkInterface* link, const mavlink_message_t& message) override;
+
+    static const int tableSize = 4096;  ///< Maximum number of distinct messages, power of two
+
+    static constexpr double rateTimeConstantMSecs = 1000;
+
+private:
+    friend class MAVLinkInspectorStoreTest;
+    friend class MAVLinkInspectorControllerTest;
+
+    static quint64  _key    (uint8_t sysid, uint8_t compid, uint32_t msgid);
+    static int      _bucket (quint64 key);
+
+    std::unique_ptr<std::atomic<Entry*>[]>  _table;
+    std::unique_ptr<std::atomic<Entry*>[]>  _entries;
+    std::atomic<int>                        _entryCount { 0 };
+    std::atomic<bool>                       _fullWarned { false };
+};
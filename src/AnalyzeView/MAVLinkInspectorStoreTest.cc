@@ -0,0 +1,413 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkInspectorStoreTest.h"
+#include "MAVLinkInspectorStore.h"
+
+#include <QThread>
+
+#include <cmath>
+
+namespace {
+
+mavlink_message_t attitude(uint32_t timeBootMs, float angle)
+{
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(1, MAV_COMP_ID_AUTOPILOT1, &message, timeBootMs, angle, angle, angle, 0, 0, 0);
+    return message;
+}
+
+/// Every field is non zero so the MAVLink 2 payload is not trimmed
+mavlink_message_t fullAttitude(void)
+{
+    mavlink_message_t message;
+    mavlink_msg_attitude_pack(1, MAV_COMP_ID_AUTOPILOT1, &message, 1234, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f);
+    return message;
+}
+
+mavlink_message_t heartbeat(uint8_t sysid, uint8_t compid)
+{
+    mavlink_message_t message;
+    mavlink_msg_heartbeat_pack(sysid, compid, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_PX4, 0, 0, MAV_STATE_ACTIVE);
+    return message;
+}
+
+int fieldIndex(const mavlink_message_info_t* info, const char* name)
+{
+    for (unsigned i = 0; i < info->num_fields; i++) {
+        if (qstrcmp(info->fields[i].name, name) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+}
+
+void MAVLinkInspectorStoreTest::_seriesLapTest(void)
+{
+    const int           capacity = MAVLinkFieldSeries::capacity;
+    MAVLinkFieldSeries  series;
+    QList<QPointF>      points;
+
+    for (int i = 0; i < 100; i++) {
+        series.append(i, i * 2.0);
+    }
+    QCOMPARE(series.read(0, points), 100ull);
+    QCOMPARE(points.count(), 100);
+    for (int i = 0; i < points.count(); i++) {
+        QCOMPARE(points[i], QPointF(i, i * 2.0));
+    }
+    points.clear();
+    QCOMPARE(series.read(100, points), 100ull);
+    QVERIFY(points.isEmpty());
+
+    // Lap the first ten samples
+    for (int i = 100; i < capacity + 10; i++) {
+        series.append(i, i * 2.0);
+    }
+    QCOMPARE(series.sequence(), static_cast<quint64>(capacity + 10));
+
+    // A reader which is still within the ring gets everything since its sequence
+    QCOMPARE(series.read(100, points), static_cast<quint64>(capacity + 10));
+    QCOMPARE(points.count(), capacity - 90);
+    QCOMPARE(points.first(), QPointF(100, 200));
+    QCOMPARE(points.last(), QPointF(capacity + 9, (capacity + 9) * 2.0));
+
+    // One which fell behind loses the ten lapped samples, plus sample 10 which shares its slot with the next one
+    // to be written
+    points.clear();
+    QCOMPARE(series.read(0, points), static_cast<quint64>(capacity + 10));
+    QCOMPARE(points.count(), capacity - 1);
+    QCOMPARE(points.first(), QPointF(11, 22));
+    QCOMPARE(points.last(), QPointF(capacity + 9, (capacity + 9) * 2.0));
+
+    // Samples the producer lapped while they were being copied: sequence, head before and head after the copy
+    QCOMPARE(MAVLinkFieldSeries::_overwritten(0, 100, 100), 0);
+    QCOMPARE(MAVLinkFieldSeries::_overwritten(0, capacity - 1, capacity - 1), 0);
+    QCOMPARE(MAVLinkFieldSeries::_overwritten(0, capacity, capacity), 1);
+    QCOMPARE(MAVLinkFieldSeries::_overwritten(0, capacity - 1, capacity + 3), 4);
+    QCOMPARE(MAVLinkFieldSeries::_overwritten(50, capacity, capacity + 100), 51);
+    QCOMPARE(MAVLinkFieldSeries::_overwritten(0, 10, 2 * capacity), 10);
+}
+
+void MAVLinkInspectorStoreTest::_seriesConcurrentTest(void)
+{
+    const quint64       sampleCount = 20 * MAVLinkFieldSeries::capacity;
+    MAVLinkFieldSeries  series;
+
+    QThread* producer = QThread::create([&]() {
+        for (quint64 i = 0; i < sampleCount; i++) {
+            series.append(static_cast<qint64>(i), i * 2.0);
+        }
+    });
+    producer->start();
+
+    // Whatever is returned must be a run of whole samples ending just before the returned sequence
+    quint64 sequence    = 0;
+    int     badReads    = 0;
+    while (true) {
+        const bool      finished    = producer->isFinished();
+        QList<QPointF>  points;
+        const quint64   next        = series.read(sequence, points);
+        for (int i = 0; i < points.count(); i++) {
+            if (points[i].y() != points[i].x() * 2 || (i > 0 && points[i].x() != points[i - 1].x() + 1)) {
+                badReads++;
+                break;
+            }
+        }
+        if (!points.isEmpty() && (points.first().x() < sequence || points.last().x() != next - 1)) {
+            badReads++;
+        }
+        sequence = next;
+        if (finished) {
+            break;
+        }
+    }
+    producer->wait();
+    delete producer;
+
+    QCOMPARE(badReads, 0);
+    QCOMPARE(sequence, sampleCount);
+}
+
+void MAVLinkInspectorStoreTest::_seriesEnableTest(void)
+{
+    const mavlink_message_t         message = attitude(1000, 0.5f);
+    const mavlink_message_info_t*   info    = mavlink_get_message_info(&message);
+    QVERIFY(info);
+    const int roll = fieldIndex(info, "roll");
+    QVERIFY(roll >= 0);
+
+    MAVLinkInspectorStore::Entry entry(message, info);
+    QVERIFY(!entry.enableSeries(-1));
+    QVERIFY(!entry.enableSeries(static_cast<int>(info->num_fields)));
+    entry.disableSeries(roll);
+    QVERIFY(!entry._series[roll].load());
+
+    // Nothing is recorded until the series is enabled
+    entry._update(message, 1000);
+    MAVLinkFieldSeries* series = entry.enableSeries(roll);
+    QVERIFY(series);
+    QVERIFY(series->enabled);
+    QCOMPARE(series->sequence(), 0ull);
+
+    entry._update(attitude(1100, 1.5f), 1100);
+    entry._update(attitude(1200, 2.5f), 1200);
+    QList<QPointF> points;
+    QCOMPARE(series->read(0, points), 2ull);
+    QCOMPARE(points, QList<QPointF>({ QPointF(1100, 1.5), QPointF(1200, 2.5) }));
+
+    // Disabled series keep their samples and stop recording
+    entry.disableSeries(roll);
+    QVERIFY(!series->enabled);
+    entry._update(attitude(1300, 3.5f), 1300);
+    QCOMPARE(series->sequence(), 2ull);
+
+    // Enabling again picks up the same series where it left off
+    QCOMPARE(entry.enableSeries(roll), series);
+    entry._update(attitude(1400, 4.5f), 1400);
+    points.clear();
+    QCOMPARE(series->read(2, points), 3ull);
+    QCOMPARE(points, QList<QPointF>({ QPointF(1400, 4.5) }));
+
+    // Other fields are left alone
+    const int pitch = fieldIndex(info, "pitch");
+    QVERIFY(!entry._series[pitch].load());
+}
+
+void MAVLinkInspectorStoreTest::_seqlockTest(void)
+{
+    const mavlink_message_t         first   = attitude(1, 1.0f);
+    const mavlink_message_t         second  = attitude(2, 2.0f);
+    const mavlink_message_info_t*   info    = mavlink_get_message_info(&first);
+    MAVLinkInspectorStore::Entry    entry(first, info);
+
+    mavlink_message_t       message;
+    mavlink_attitude_t      decoded;
+    entry._update(second, 100);
+    entry.latest(message);
+    mavlink_msg_attitude_decode(&message, &decoded);
+    QCOMPARE(decoded.time_boot_ms, 2u);
+    QCOMPARE(entry.count(), 1ull);
+    QCOMPARE(entry._sequence.load(), 2u);
+
+    // While another producer holds the entry an update is counted but otherwise skipped
+    entry._sequence.store(3);
+    entry._update(first, 200);
+    QCOMPARE(entry.count(), 2ull);
+    QCOMPARE(entry._sequence.load(), 3u);
+    QCOMPARE(entry._lastTime.load(), 100ll);
+    entry._sequence.store(4);
+    entry.latest(message);
+    mavlink_msg_attitude_decode(&message, &decoded);
+    QCOMPARE(decoded.time_boot_ms, 2u);
+
+    // Concurrent reads only ever see one whole message or the other
+    const int updateCount = 200000;
+    QThread* producer = QThread::create([&]() {
+        for (int i = 0; i < updateCount; i++) {
+            entry._update((i & 1) ? second : first, 1000 + i);
+        }
+    });
+    producer->start();
+
+    int tornReads = 0;
+    while (!producer->isFinished()) {
+        entry.latest(message);
+        mavlink_msg_attitude_decode(&message, &decoded);
+        const float expected = static_cast<float>(decoded.time_boot_ms);
+        if (decoded.roll != expected || decoded.pitch != expected || decoded.yaw != expected) {
+            tornReads++;
+        }
+    }
+    producer->wait();
+    delete producer;
+
+    QCOMPARE(tornReads, 0);
+    QCOMPARE(entry.count(), static_cast<quint64>(updateCount + 2));
+    QCOMPARE(entry._sequence.load() & 1, 0u);
+}
+
+void MAVLinkInspectorStoreTest::_twoProducersTest(void)
+{
+    const int               compCount   = 8;
+    const int               rounds      = 5000;
+    MAVLinkInspectorStore   store;
+
+    QList<mavlink_message_t> messages;
+    for (int compid = 1; compid <= compCount; compid++) {
+        messages.append(heartbeat(1, static_cast<uint8_t>(compid)));
+    }
+
+    // Both links deliver the same messages, racing to add each entry
+    std::atomic<bool> go { false };
+    auto produce = [&]() {
+        while (!go.load()) { }
+        for (int i = 0; i < rounds; i++) {
+            for (const mavlink_message_t& message: messages) {
+                store.messageDecoded(nullptr, message);
+            }
+        }
+    };
+    QThread* producer1 = QThread::create(produce);
+    QThread* producer2 = QThread::create(produce);
+    producer1->start();
+    producer2->start();
+    go.store(true);
+    producer1->wait();
+    producer2->wait();
+    delete producer1;
+    delete producer2;
+
+    QCOMPARE(store.entryCount(), compCount);
+    QList<MAVLinkInspectorStore::Entry*> entries;
+    for (int i = 0; i < store.entryCount(); i++) {
+        MAVLinkInspectorStore::Entry* entry = store.entryAt(i);
+        QVERIFY(entry);
+        QVERIFY(!entries.contains(entry));
+        QCOMPARE(store.entry(entry->sysid(), entry->compid(), entry->msgid()), entry);
+        QCOMPARE(entry->count(), static_cast<quint64>(2 * rounds));
+        QCOMPARE(entry->_sequence.load() & 1, 0u);
+        entries.append(entry);
+    }
+    for (int compid = 1; compid <= compCount; compid++) {
+        QVERIFY(store.entry(1, static_cast<uint8_t>(compid), MAVLINK_MSG_ID_HEARTBEAT));
+    }
+    QVERIFY(!store.entry(2, 1, MAVLINK_MSG_ID_HEARTBEAT));
+}
+
+void MAVLinkInspectorStoreTest::_tableFullTest(void)
+{
+    const int               tableSize = MAVLinkInspectorStore::tableSize;
+    MAVLinkInspectorStore   store;
+
+    // 256 system ids by 16 component ids fill the table exactly
+    for (int sysid = 0; sysid < 256; sysid++) {
+        for (int compid = 0; compid < tableSize / 256; compid++) {
+            store.messageDecoded(nullptr, heartbeat(static_cast<uint8_t>(sysid), static_cast<uint8_t>(compid)));
+        }
+    }
+    QCOMPARE(store.entryCount(), tableSize);
+    QVERIFY(!store._fullWarned);
+
+    // New messages are dropped, known ones are still found and updated
+    QVERIFY(!store.entry(0, 16, MAVLINK_MSG_ID_HEARTBEAT));
+    store.messageDecoded(nullptr, heartbeat(0, 16));
+    QVERIFY(!store.entry(0, 16, MAVLINK_MSG_ID_HEARTBEAT));
+    QCOMPARE(store.entryCount(), tableSize);
+    QVERIFY(store._fullWarned);
+
+    MAVLinkInspectorStore::Entry* entry = store.entry(255, 15, MAVLINK_MSG_ID_HEARTBEAT);
+    QVERIFY(entry);
+    QCOMPARE(entry->count(), 1ull);
+    store.messageDecoded(nullptr, heartbeat(255, 15));
+    QCOMPARE(entry->count(), 2ull);
+}
+
+void MAVLinkInspectorStoreTest::_rateTest(void)
+{
+    const double                    timeConstant    = MAVLinkInspectorStore::rateTimeConstantMSecs;
+    const mavlink_message_t         message         = fullAttitude();
+    const mavlink_message_info_t*   info            = mavlink_get_message_info(&message);
+
+    // No rate until there is an interval to go on
+    MAVLinkInspectorStore::Entry entry(message, info);
+    entry._update(message, 1000);
+    QCOMPARE(entry.rate(1000), 0.0);
+    entry._update(message, 1100);
+    QCOMPARE(entry.rate(1100), 10.0);
+    for (qint64 time = 1200; time <= 3000; time += 100) {
+        entry._update(message, time);
+    }
+    QCOMPARE(entry.rate(3000), 10.0);
+
+    // Once the message stops the rate is bounded by the time since it was last seen
+    QCOMPARE(entry.rate(3050), 10.0);
+    QCOMPARE(entry.rate(4000), 1.0);
+    QCOMPARE(entry.rate(7000), 0.25);
+
+    // Half a second of messages moves the average the same share of the way to the new interval whether they
+    // come at 100Hz or at 20Hz
+    MAVLinkInspectorStore::Entry fast(message, info);
+    MAVLinkInspectorStore::Entry slow(message, info);
+    for (qint64 time = 1000; time <= 2000; time += 100) {
+        fast._update(message, time);
+        slow._update(message, time);
+    }
+    for (qint64 time = 2010; time <= 2500; time += 10) {
+        fast._update(message, time);
+    }
+    for (qint64 time = 2050; time <= 2500; time += 50) {
+        slow._update(message, time);
+    }
+    const double decay = std::exp(-500 / timeConstant);
+    QCOMPARE(fast._interval.load(), 10 + (90 * decay));
+    QCOMPARE(slow._interval.load(), 50 + (50 * decay));
+    QCOMPARE(fast.rate(2500), 1000 / (10 + (90 * decay)));
+    QCOMPARE(slow.rate(2500), 1000 / (50 + (50 * decay)));
+
+    // Messages with the same timestamp count as a tenth of a millisecond apart
+    MAVLinkInspectorStore::Entry burst(message, info);
+    burst._update(message, 1000);
+    burst._update(message, 1000);
+    QCOMPARE(burst.rate(1000), 10000.0);
+}
+
+void MAVLinkInspectorStoreTest::_bandwidthTest(void)
+{
+    const double                    timeConstant    = MAVLinkInspectorStore::rateTimeConstantMSecs;
+    const mavlink_message_t         message         = fullAttitude();
+    mavlink_message_t               signedMessage   = message;
+    signedMessage.incompat_flags |= MAVLINK_IFLAG_SIGNED;
+    const double                    length          = MAVLinkInspectorStore::wireLength(message);
+
+    MAVLinkInspectorStore::Entry entry(message, mavlink_get_message_info(&message));
+    entry._update(message, 1000);
+    QCOMPARE(entry.bandwidth(1000), 0.0);
+    QCOMPARE(entry._length.load(), length);
+    entry._update(message, 1100);
+    QCOMPARE(entry.bandwidth(1100), 10 * length);
+
+    // Length is smoothed over time like the interval
+    entry._update(signedMessage, 1200);
+    const double averageLength = length + ((1 - std::exp(-100 / timeConstant)) * MAVLINK_SIGNATURE_BLOCK_LEN);
+    QCOMPARE(entry._length.load(), averageLength);
+    QCOMPARE(entry.bandwidth(1200), 10 * averageLength);
+
+    // And falls off with the rate once the message stops
+    QCOMPARE(entry.bandwidth(2200), averageLength);
+    QCOMPARE(entry.bandwidth(11200), averageLength / 10);
+}
+
+void MAVLinkInspectorStoreTest::_wireLengthTest(void)
+{
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+
+    const mavlink_message_t v2 = fullAttitude();
+    QCOMPARE(static_cast<int>(v2.len), MAVLINK_MSG_ID_ATTITUDE_LEN);
+    QCOMPARE(MAVLinkInspectorStore::wireLength(v2), 40);
+    QCOMPARE(MAVLinkInspectorStore::wireLength(v2), static_cast<int>(mavlink_msg_to_send_buffer(buffer, &v2)));
+
+    mavlink_message_t v1 = v2;
+    v1.magic = MAVLINK_STX_MAVLINK1;
+    QCOMPARE(MAVLinkInspectorStore::wireLength(v1), 36);
+    QCOMPARE(MAVLinkInspectorStore::wireLength(v1), static_cast<int>(mavlink_msg_to_send_buffer(buffer, &v1)));
+
+    mavlink_message_t signedMessage = v2;
+    signedMessage.incompat_flags |= MAVLINK_IFLAG_SIGNED;
+    QCOMPARE(MAVLinkInspectorStore::wireLength(signedMessage), 53);
+    QCOMPARE(MAVLinkInspectorStore::wireLength(signedMessage), static_cast<int>(mavlink_msg_to_send_buffer(buffer, &signedMessage)));
+
+    // MAVLink 2 leaves trailing zeros of the payload off the wire
+    const mavlink_message_t trimmed = attitude(1, 0);
+    QVERIFY(trimmed.len < MAVLINK_MSG_ID_ATTITUDE_LEN);
+    QCOMPARE(MAVLinkInspectorStore::wireLength(trimmed), trimmed.len + 12);
+    QCOMPARE(MAVLinkInspectorStore::wireLength(trimmed), static_cast<int>(mavlink_msg_to_send_buffer(buffer, &trimmed)));
+}
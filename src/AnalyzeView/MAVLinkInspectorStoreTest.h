@@ -0,0 +1,28 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+
+class MAVLinkInspectorStoreTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _seriesLapTest         (void);
+    void _seriesConcurrentTest  (void);
+    void _seriesEnableTest      (void);
+    void _seqlockTest           (void);
+    void _twoProducersTest      (void);
+    void _tableFullTest         (void);
+    void _rateTest              (void);
+    void _bandwidthTest         (void);
+    void _wireLengthTest        (void);
+};
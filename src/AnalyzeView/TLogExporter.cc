@@ -0,0 +1,282 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TLogExporter.h"
+#include "QGCApplication.h"
+#include "LinkManager.h"
+#include "LogReplayLink.h"
+#include "MultiVehicleManager.h"
+#include "Vehicle.h"
+#include "Fact.h"
+#include "QGCLoggingCategory.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+QGC_LOGGING_CATEGORY(TLogExporterLog, "TLogExporterLog")
+
+const char* TLogExporter::logOption     = "--tlog-export";
+const char* TLogExporter::dirOption     = "--tlog-export-dir";
+const char* TLogExporter::factsOption   = "--tlog-export-facts";
+const char* TLogExporter::hzOption      = "--tlog-export-hz";
+
+TLogExporter::TLogExporter(const QString& logFilename, const QString& outputDir, const QStringList& factPatterns, double sampleHz, QObject* parent)
+    : QObject               (parent)
+    , _logFilename          (logFilename)
+    , _outputDir            (outputDir.isEmpty() ? QFileInfo(logFilename).absolutePath() : outputDir)
+    , _sampleIntervalMSecs  (static_cast<quint32>(qMax(1.0, 1000.0 / (sampleHz > 0 ? sampleHz : 10.0))))
+{
+    for (QString pattern: factPatterns) {
+        pattern = pattern.trimmed();
+        if (pattern.startsWith(QStringLiteral("vehicle."))) {
+            pattern.remove(0, 8);
+        }
+        if (!pattern.isEmpty()) {
+            _factPatterns.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern)));
+        }
+    }
+
+    _drainTimer.setInterval(250);
+    connect(&_drainTimer, &QTimer::timeout, this, &TLogExporter::_checkDrained);
+}
+
+bool TLogExporter::start(void)
+{
+    if (!QFileInfo(_logFilename).isReadable()) {
+        qCWarning(TLogExporterLog) << "Unable to read log file" << _logFilename;
+        return false;
+    }
+    if (!QDir().mkpath(_outputDir)) {
+        qCWarning(TLogExporterLog) << "Unable to create output directory" << _outputDir;
+        return false;
+    }
+
+    QGCToolbox* toolbox = qgcApp()->toolbox();
+    connect(toolbox->multiVehicleManager(), &MultiVehicleManager::vehicleAdded, this, &TLogExporter::_vehicleAdded);
+
+    _link = toolbox->linkManager()->startLogReplay(_logFilename);
+    if (!_link) {
+        qCWarning(TLogExporterLog) << "Unable to start replay of" << _logFilename;
+        return false;
+    }
+
+    // No point pacing the replay, the whole log is processed as fast as it can be decoded
+    _link->setFastReplay(true);
+    connect(_link.data(), &LogReplayLink::playbackAtEnd,    this, &TLogExporter::_playbackAtEnd);
+    connect(_link.data(), &LogReplayLink::disconnected,     this, [this]() { _finish(-1); });
+
+    qCDebug(TLogExporterLog) << "Exporting" << _logFilename << "to" << _outputDir << "every" << _sampleIntervalMSecs << "msecs";
+    return true;
+}
+
+void TLogExporter::_vehicleAdded(Vehicle* vehicle)
+{
+    int vehicleId = vehicle->id();
+
+    VehicleExport_t& vehicleExport = _vehicleExports[vehicleId];
+    vehicleExport.vehicle           = vehicle;
+    vehicleExport.columnsDirty      = true;
+    vehicleExport.lastBootMSecs     = 0;
+    vehicleExport.nextSampleMSecs   = 0;
+
+    // Fact groups can be added part way through, for example when a new battery shows up
+    connect(vehicle, &FactGroup::factGroupNamesChanged, this, [this, vehicleId]() { _vehicleExports[vehicleId].columnsDirty = true; });
+
+    // Emitted after the vehicle has processed the message, so facts are up to date
+    connect(vehicle, &Vehicle::mavlinkMessageReceived, this, [this, vehicleId](const mavlink_message_t& message) {
+        _messageReceived(_vehicleExports[vehicleId], message);
+    });
+}
+
+bool TLogExporter::_matchesPatterns(const QString& factName) const
+{
+    if (_factPatterns.isEmpty()) {
+        return true;
+    }
+    for (const QRegularExpression& pattern: _factPatterns) {
+        if (pattern.match(factName).hasMatch()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TLogExporter::_updateColumns(VehicleExport_t& vehicleExport)
+{
+    Vehicle* vehicle = vehicleExport.vehicle;
+    if (!vehicle) {
+        return;
+    }
+
+    QHash<QString, int> existingColumns;
+    for (int i = 0; i < vehicleExport.columns.count(); i++) {
+        existingColumns[vehicleExport.columns[i].name] = i;
+    }
+
+    auto addColumn = [&](const QString& name, Fact* fact) {
+        if (existingColumns.contains(name) || !_matchesPatterns(name)) {
+            return;
+        }
+        Column_t column;
+        column.name = name;
+        column.fact = fact;
+        // Pad so the new column lines up with the rows already sampled
+        for (int i = 0; i < vehicleExport.timestamps.count(); i++) {
+            column.values.append(QString());
+        }
+        vehicleExport.columns.append(column);
+    };
+
+    for (const QString& factName: vehicle->factNames()) {
+        addColumn(factName, vehicle->getFact(factName));
+    }
+    for (const QString& groupName: vehicle->factGroupNames()) {
+        FactGroup* factGroup = vehicle->getFactGroup(groupName);
+        for (const QString& factName: factGroup->factNames()) {
+            addColumn(QStringLiteral("%1.%2").arg(groupName, factName), factGroup->getFact(factName));
+        }
+    }
+
+    vehicleExport.columnsDirty = false;
+}
+
+/// @return Wire offset of the time_boot_ms field for the message, -1 if it doesn't have one
+int TLogExporter::_timeBootOffset(const mavlink_message_t& message)
+{
+    auto it = _timeBootOffsets.constFind(message.msgid);
+    if (it != _timeBootOffsets.constEnd()) {
+        return *it;
+    }
+
+    int offset = -1;
+    const mavlink_message_info_t* info = mavlink_get_message_info(&message);
+    if (info) {
+        for (unsigned i = 0; i < info->num_fields; i++) {
+            if (info->fields[i].type == MAVLINK_TYPE_UINT32_T && strcmp(info->fields[i].name, "time_boot_ms") == 0) {
+                offset = static_cast<int>(info->fields[i].wire_offset);
+                break;
+            }
+        }
+    }
+    _timeBootOffsets[message.msgid] = offset;
+
+    return offset;
+}
+
+void TLogExporter::_messageReceived(VehicleExport_t& vehicleExport, const mavlink_message_t& message)
+{
+    _messageCount++;
+
+    int offset = _timeBootOffset(message);
+    if (offset < 0) {
+        return;
+    }
+    quint32 bootMSecs = _MAV_RETURN_uint32_t(&message, offset);
+
+    if (bootMSecs + 1000 < vehicleExport.lastBootMSecs) {
+        // Vehicle rebooted, start sampling again from the new boot time
+        qCDebug(TLogExporterLog) << "Vehicle reboot detected" << vehicleExport.lastBootMSecs << bootMSecs;
+        vehicleExport.nextSampleMSecs = 0;
+    }
+    vehicleExport.lastBootMSecs = bootMSecs;
+
+    if (bootMSecs >= vehicleExport.nextSampleMSecs) {
+        _addSample(vehicleExport, bootMSecs);
+        vehicleExport.nextSampleMSecs = ((bootMSecs / _sampleIntervalMSecs) + 1) * _sampleIntervalMSecs;
+    }
+}
+
+void TLogExporter::_addSample(VehicleExport_t& vehicleExport, quint32 bootMSecs)
+{
+    if (vehicleExport.columnsDirty) {
+        _updateColumns(vehicleExport);
+    }
+
+    vehicleExport.timestamps.append(bootMSecs);
+    for (Column_t& column: vehicleExport.columns) {
+        column.values.append(column.fact ? column.fact->rawValueString() : QString());
+    }
+}
+
+bool TLogExporter::_writeCsv(int vehicleId, const VehicleExport_t& vehicleExport)
+{
+    QString fileName    = QStringLiteral("%1.vehicle%2.csv").arg(QFileInfo(_logFilename).completeBaseName()).arg(vehicleId);
+    QFile   csvFile(QDir(_outputDir).absoluteFilePath(fileName));
+
+    if (!csvFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        qCWarning(TLogExporterLog) << "Unable to open" << csvFile.fileName() << csvFile.errorString();
+        return false;
+    }
+
+    QTextStream stream(&csvFile);
+
+    stream << "timeBootMSecs";
+    for (const Column_t& column: vehicleExport.columns) {
+        stream << "," << column.name;
+    }
+    stream << "\n";
+
+    for (int row = 0; row < vehicleExport.timestamps.count(); row++) {
+        stream << vehicleExport.timestamps[row];
+        for (const Column_t& column: vehicleExport.columns) {
+            stream << "," << column.values[row];
+        }
+        stream << "\n";
+    }
+
+    stream.flush();
+    if (stream.status() != QTextStream::Ok) {
+        qCWarning(TLogExporterLog) << "Write failed" << csvFile.fileName();
+        return false;
+    }
+
+    qCDebug(TLogExporterLog) << "Wrote" << csvFile.fileName() << "rows:columns" << vehicleExport.timestamps.count() << vehicleExport.columns.count();
+    return true;
+}
+
+void TLogExporter::_playbackAtEnd(void)
+{
+    // Replay has handed everything to the decoder, wait for the rest of the pipeline to catch up
+    _lastDrainCount = _messageCount;
+    _drainTimer.start();
+}
+
+void TLogExporter::_checkDrained(void)
+{
+    if ((_link && _link->receiveBacklog() > 0) || _messageCount != _lastDrainCount) {
+        _lastDrainCount = _messageCount;
+        return;
+    }
+    _drainTimer.stop();
+
+    bool success = !_vehicleExports.isEmpty();
+    if (!success) {
+        qCWarning(TLogExporterLog) << "No vehicles found in" << _logFilename;
+    }
+    for (auto it = _vehicleExports.constBegin(); it != _vehicleExports.constEnd(); ++it) {
+        success &= _writeCsv(it.key(), it.value());
+    }
+
+    _finish(success ? 0 : -1);
+}
+
+void TLogExporter::_finish(int exitCode)
+{
+    _drainTimer.stop();
+    if (_link) {
+        disconnect(_link.data(), nullptr, this, nullptr);
+        _link->disconnect();
+        _link = nullptr;
+    }
+
+    _exitCode = exitCode;
+    emit finished(exitCode);
+}
@@ -0,0 +1,100 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QMap>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QLoggingCategory>
+
+#include "QGCMAVLink.h"
+
+Q_DECLARE_LOGGING_CATEGORY(TLogExporterLog)
+
+class Fact;
+class Vehicle;
+class LogReplayLink;
+
+/// Headless telemetry log export. Replays a tlog as fast as possible through the normal link, decoder and
+/// Vehicle/FactGroup pipeline and samples the selected Facts into one CSV file per vehicle. Samples are
+/// taken on the vehicle's boot time (time_boot_ms from the incoming messages) at a fixed rate.
+///
+/// Command line usage (one log per process, run one process per core for batch processing):
+///     --tlog-export:<log file> [--tlog-export-dir:<dir>] [--tlog-export-facts:<pattern,...>] [--tlog-export-hz:<rate>]
+///
+/// Fact patterns are wildcards against Vehicle fact names as used by the CSV telemetry logger, for
+/// example "gps.*,battery*.voltage,altitudeRelative". A leading "vehicle." is optional.
+class TLogExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    TLogExporter(const QString& logFilename, const QString& outputDir, const QStringList& factPatterns, double sampleHz, QObject* parent = nullptr);
+
+    /// Starts replay of the log
+    ///     @return false: Replay could not be started
+    bool start(void);
+
+    /// @return Exit code for the application
+    int exitCode(void) const { return _exitCode; }
+
+    static const char* logOption;
+    static const char* dirOption;
+    static const char* factsOption;
+    static const char* hzOption;
+
+signals:
+    void finished(int exitCode);
+
+private slots:
+    void _vehicleAdded      (Vehicle* vehicle);
+    void _playbackAtEnd     (void);
+    void _checkDrained      (void);
+
+private:
+    /// Facts are stored column-wise since columns can show up part way through the log (batteries for example)
+    typedef struct {
+        QString         name;
+        QPointer<Fact>  fact;
+        QStringList     values;
+    } Column_t;
+
+    typedef struct {
+        QPointer<Vehicle>   vehicle;
+        QList<Column_t>     columns;
+        QVector<quint32>    timestamps;
+        bool                columnsDirty;
+        quint32             lastBootMSecs;
+        quint32             nextSampleMSecs;
+    } VehicleExport_t;
+
+    void _messageReceived   (VehicleExport_t& vehicleExport, const mavlink_message_t& message);
+    void _updateColumns     (VehicleExport_t& vehicleExport);
+    void _addSample         (VehicleExport_t& vehicleExport, quint32 bootMSecs);
+    bool _matchesPatterns   (const QString& factName) const;
+    int  _timeBootOffset    (const mavlink_message_t& message);
+    bool _writeCsv          (int vehicleId, const VehicleExport_t& vehicleExport);
+    void _finish            (int exitCode);
+
+    QString                         _logFilename;
+    QString                         _outputDir;
+    QList<QRegularExpression>       _factPatterns;
+    quint32                         _sampleIntervalMSecs;
+    QPointer<LogReplayLink>         _link;
+    QMap<int, VehicleExport_t>      _vehicleExports;
+    QHash<uint32_t, int>            _timeBootOffsets;           ///< msgid to wire offset of time_boot_ms, -1 for none
+    QTimer                          _drainTimer;
+    quint64                         _messageCount       = 0;
+    quint64                         _lastDrainCount     = 0;
+    int                             _exitCode           = 0;
+};
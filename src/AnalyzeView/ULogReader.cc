@@ -0,0 +1,264 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ULogReader.h"
+
+#include <limits>
+
+QGC_LOGGING_CATEGORY(ULogReaderLog, "ULogReaderLog")
+
+static const char kULogMagic[] = { 'U', 'L', 'o', 'g', 0x01, 0x12, 0x35 };
+
+bool ULogReader::open(const QString& fileName, QString& errorMessage)
+{
+    close();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        errorMessage = tr("Unable to open log file: %1").arg(_file.errorString());
+        return false;
+    }
+
+    _size = _file.size();
+    _data = reinterpret_cast<const char*>(_file.map(0, _size));
+    if (!_data) {
+        // Not all file systems support mapping
+        if (_size > std::numeric_limits<int>::max()) {
+            errorMessage = tr("Log file too large to read");
+            close();
+            return false;
+        }
+        _log    = _file.readAll();
+        _data   = _log.constData();
+        _size   = _log.size();
+    }
+
+    if (!_index(errorMessage)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ULogReader::open(const QByteArray& log, QString& errorMessage)
+{
+    close();
+
+    _log    = log;
+    _data   = _log.constData();
+    _size   = _log.size();
+
+    if (!_index(errorMessage)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ULogReader::close(void)
+{
+    _formats.clear();
+    _topics.clear();
+    _msgIdTopicIndices.clear();
+    _log.clear();
+    _data = nullptr;
+    _size = 0;
+    // Closing the file also unmaps it
+    _file.close();
+}
+
+bool ULogReader::_index(QString& errorMessage)
+{
+    errorMessage.clear();
+
+    if (_size < fileHeaderSize || memcmp(_data, kULogMagic, sizeof(kULogMagic)) != 0) {
+        errorMessage = tr("Could not detect ULog file header magic");
+        return false;
+    }
+
+    _msgIdTopicIndices.fill(-1, std::numeric_limits<uint16_t>::max() + 1);
+
+    qint64 index = fileHeaderSize;
+    while (index + messageHeaderSize <= _size) {
+        const char*     message     = _data + index;
+        const int       size        = messageSize(message);
+        const char*     payload     = message + messageHeaderSize;
+        const int       payloadSize = size - messageHeaderSize;
+
+        if (index + size > _size) {
+            // Logs cut off by a crash or power loss end in a partial message
+            qCDebug(ULogReaderLog) << "Truncated message at" << index;
+            break;
+        }
+
+        switch (static_cast<uint8_t>(message[2])) {
+        case DATA:
+            if (payloadSize >= 2) {
+                const uint16_t  msgId       = value<uint16_t>(payload, 0);
+                const int       topicIndex  = _msgIdTopicIndices[msgId];
+                if (topicIndex >= 0) {
+                    _topics[topicIndex].offsets.append(index + _dataMessageHeaderSize);
+                }
+            }
+            break;
+
+        case FORMAT:
+        {
+            // name:type field;type field;...
+            const QString   definition  = QString::fromLatin1(payload, static_cast<int>(strnlen(payload, static_cast<size_t>(payloadSize))));
+            const int       separator   = definition.indexOf(':');
+            if (separator > 0) {
+                Format_t format;
+                format.name         = definition.left(separator);
+                format.definition   = definition.mid(separator + 1);
+                format.resolved     = false;
+                format.size         = 0;
+                format.paddedSize   = 0;
+                _formats[format.name] = format;
+            }
+            break;
+        }
+
+        case ADD_LOGGED_MSG:
+            if (payloadSize > 3) {
+                Topic_t topic;
+                topic.multiId   = static_cast<uint8_t>(payload[0]);
+                topic.msgId     = value<uint16_t>(payload, 1);
+                topic.name      = QString::fromLatin1(payload + 3, static_cast<int>(strnlen(payload + 3, static_cast<size_t>(payloadSize - 3))));
+                _msgIdTopicIndices[topic.msgId] = _topics.count();
+                _topics.append(topic);
+            }
+            break;
+
+        case REMOVE_LOGGED_MSG:
+            if (payloadSize >= 2) {
+                _msgIdTopicIndices[value<uint16_t>(payload, 0)] = -1;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        index += size;
+    }
+
+    qCDebug(ULogReaderLog) << "Indexed" << _size << "bytes" << _formats.count() << "formats" << _topics.count() << "topics";
+
+    return true;
+}
+
+const ULogReader::Topic_t* ULogReader::topic(const QString& name, uint8_t multiId) const
+{
+    // Searched from the end, a topic which is removed and added again has its latest subscription used
+    for (int i=_topics.count() - 1; i>=0; i--) {
+        if (_topics[i].multiId == multiId && _topics[i].name == name) {
+            return &_topics[i];
+        }
+    }
+    return nullptr;
+}
+
+const ULogReader::Topic_t* ULogReader::topic(uint16_t msgId) const
+{
+    const int topicIndex = _msgIdTopicIndices.isEmpty() ? -1 : _msgIdTopicIndices[msgId];
+    return topicIndex >= 0 ? &_topics[topicIndex] : nullptr;
+}
+
+const ULogReader::Format_t* ULogReader::format(const QString& name)
+{
+    auto it = _formats.find(name);
+    if (it == _formats.end() || !_resolveFormat(*it, 0)) {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+int ULogReader::fieldOffset(const QString& formatName, const QString& fieldName)
+{
+    const Format_t* fieldFormat = format(formatName);
+    if (!fieldFormat) {
+        return -1;
+    }
+    const int fieldIndex = fieldFormat->fieldIndices.value(fieldName, -1);
+    return fieldIndex >= 0 ? fieldFormat->fields[fieldIndex].offset : -1;
+}
+
+/// Computes field offsets the first time a format is used. Field types can be other formats.
+bool ULogReader::_resolveFormat(Format_t& format, int depth)
+{
+    if (format.resolved) {
+        return true;
+    }
+    if (depth > _maxNestingDepth) {
+        qCWarning(ULogReaderLog) << "Format nesting too deep" << format.name;
+        return false;
+    }
+
+    int offset          = 0;
+    int loggedSize      = 0;
+    const QStringList fieldDefinitions = format.definition.split(';', Qt::SkipEmptyParts);
+    for (const QString& fieldDefinition: fieldDefinitions) {
+        const int spacePos = fieldDefinition.indexOf(' ');
+        if (spacePos == -1) {
+            continue;
+        }
+
+        Field_t field;
+        field.name      = fieldDefinition.mid(spacePos + 1);
+        field.typeName  = fieldDefinition.left(spacePos);
+        field.arraySize = 1;
+
+        const int arrayStart = field.typeName.indexOf('[');
+        if (arrayStart != -1) {
+            field.arraySize = field.typeName.midRef(arrayStart + 1, field.typeName.indexOf(']') - arrayStart - 1).toInt();
+            field.typeName  = field.typeName.left(arrayStart);
+        }
+
+        int elementSize = _typeSize(field.typeName);
+        if (elementSize == 0) {
+            auto nested = _formats.find(field.typeName);
+            if (nested == _formats.end() || !_resolveFormat(*nested, depth + 1)) {
+                qCWarning(ULogReaderLog) << "Unknown type in ULog:" << field.typeName;
+                return false;
+            }
+            elementSize = nested->paddedSize;
+        }
+
+        field.offset    = offset;
+        field.size      = elementSize * field.arraySize;
+        offset          += field.size;
+
+        // Padding at the end of a message is not logged
+        if (!field.name.startsWith(QLatin1String("_padding"))) {
+            loggedSize = offset;
+            format.fieldIndices[field.name] = format.fields.count();
+        }
+        format.fields.append(field);
+    }
+
+    format.size         = loggedSize;
+    format.paddedSize   = offset;
+    format.resolved     = true;
+    return true;
+}
+
+int ULogReader::_typeSize(const QString& typeName)
+{
+    if (typeName == QLatin1String("int8_t") || typeName == QLatin1String("uint8_t") || typeName == QLatin1String("char") || typeName == QLatin1String("bool")) {
+        return 1;
+    } else if (typeName == QLatin1String("int16_t") || typeName == QLatin1String("uint16_t")) {
+        return 2;
+    } else if (typeName == QLatin1String("int32_t") || typeName == QLatin1String("uint32_t") || typeName == QLatin1String("float")) {
+        return 4;
+    } else if (typeName == QLatin1String("int64_t") || typeName == QLatin1String("uint64_t") || typeName == QLatin1String("double")) {
+        return 8;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGCLoggingCategory.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <cstring>
+
+Q_DECLARE_LOGGING_CATEGORY(ULogReaderLog)
+
+/// General purpose reader for PX4 ULog files.
+///
+/// The log is memory mapped and indexed in a single pass: message formats, subscriptions (msg_id -> topic) and the
+/// offset of every data message of each subscription. Data messages are never copied, callers get a pointer to a
+/// message's data within the log and read fields out of it with the offsets from the format. Indexing a 1GB log
+/// only touches each message header once.
+///
+/// Usage:
+///     ULogReader reader;
+///     reader.open(fileName, errorMessage);
+///     const ULogReader::Topic_t* topic = reader.topic("camera_capture");
+///     const int latOffset = reader.fieldOffset("camera_capture", "lat");
+///     for (int i=0; i<topic->offsets.count(); i++) {
+///         double lat = ULogReader::value<double>(reader.messageData(*topic, i), latOffset);
+///     }
+class ULogReader
+{
+    Q_DECLARE_TR_FUNCTIONS(ULogReader)
+
+public:
+    typedef struct {
+        QString name;
+        QString typeName;       ///< Element type, without the array size
+        int     offset;         ///< Byte offset within message data
+        int     size;           ///< Byte size of the whole field
+        int     arraySize;      ///< 1 for non-array fields
+    } Field_t;
+
+    typedef struct {
+        QString             name;
+        QString             definition;     ///< Unparsed field list from the FORMAT message
+        bool                resolved;       ///< Field layout has been computed
+        int                 size;           ///< Bytes of logged data, trailing padding is not logged
+        int                 paddedSize;     ///< Bytes including trailing padding, the size when nested in another format
+        QVector<Field_t>    fields;
+        QHash<QString, int> fieldIndices;   ///< Field name to index in fields
+    } Format_t;
+
+    typedef struct {
+        QString         name;       ///< Format name
+        uint16_t        msgId;
+        uint8_t         multiId;    ///< Instance when the same topic is logged more than once
+        QVector<qint64> offsets;    ///< Offset within the log of each data message's data
+    } Topic_t;
+
+    ULogReader(void) = default;
+
+    /// Maps and indexes the log file
+    bool open(const QString& fileName, QString& errorMessage);
+
+    /// Indexes a log which is already in memory. The data is not copied and must outlive the reader.
+    bool open(const QByteArray& log, QString& errorMessage);
+
+    void close(void);
+
+    /// @return Subscription of the named topic, nullptr if not logged
+    const Topic_t*  topic       (const QString& name, uint8_t multiId = 0) const;
+    const Topic_t*  topic       (uint16_t msgId) const;
+    const QVector<Topic_t>& topics(void) const { return _topics; }
+
+    const Format_t* format      (const QString& name);
+
+    /// @return Offset of the field within the message data, -1 if there is no such field
+    int fieldOffset(const QString& formatName, const QString& fieldName);
+
+    /// @return Data of the index'th message of the topic, points into the log
+    const char* messageData(const Topic_t& topic, int index) const { return _data + topic.offsets[index]; }
+
+    /// @return Bytes of data in the index'th message of the topic. Check against the format size before reading
+    ///         fields from logs which may be corrupt.
+    int messageDataSize(const Topic_t& topic, int index) const { return messageSize(messageData(topic, index) - _dataMessageHeaderSize) - _dataMessageHeaderSize; }
+
+    /// Reads a field value out of message data, a default value for unknown fields (offset -1)
+    template<typename T>
+    static T value(const char* messageData, int offset)
+    {
+        T fieldValue{};
+        if (offset >= 0) {
+            memcpy(&fieldValue, messageData + offset, sizeof(T));
+        }
+        return fieldValue;
+    }
+
+    /// @return Total bytes of the ULog message starting at message, including its header
+    static int messageSize(const char* message) { return (static_cast<uint8_t>(message[0]) | (static_cast<uint8_t>(message[1]) << 8)) + messageHeaderSize; }
+
+    static const int fileHeaderSize     = 16;
+    static const int messageHeaderSize  = 3;    ///< uint16_t msg_size, uint8_t msg_type
+
+private:
+    enum ULogMessageType : uint8_t {
+        FORMAT              = 'F',
+        DATA                = 'D',
+        INFO                = 'I',
+        PARAMETER           = 'P',
+        ADD_LOGGED_MSG      = 'A',
+        REMOVE_LOGGED_MSG   = 'R',
+        SYNC                = 'S',
+        DROPOUT             = 'O',
+        LOGGING             = 'L',
+    };
+
+    bool        _index          (QString& errorMessage);
+    bool        _resolveFormat  (Format_t& format, int depth);
+    static int  _typeSize       (const QString& typeName);
+
+    QFile                       _file;
+    QByteArray                  _log;       ///< Whole log, raw data over the mapping when mapped
+    const char*                 _data = nullptr;
+    qint64                      _size = 0;
+    QHash<QString, Format_t>    _formats;
+    QVector<Topic_t>            _topics;
+    QVector<int>                _msgIdTopicIndices;     ///< Index into _topics for each msg_id, -1 for none
+
+    static const int _maxNestingDepth       = 16;
+    static const int _dataMessageHeaderSize = messageHeaderSize + 2;    ///< Message header plus msg_id
+};
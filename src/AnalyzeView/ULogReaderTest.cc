@@ -0,0 +1,183 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ULogReaderTest.h"
+#include "ULogReader.h"
+#include "ULogParser.h"
+#include "QGCLoggingCategory.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+
+QGC_LOGGING_CATEGORY(ULogReaderTestLog, "ULogReaderTestLog")
+
+static const uint16_t kCameraCaptureMsgId   = 3;
+static const uint16_t kNestedMsgId          = 7;
+
+QByteArray ULogReaderTest::_logHeader(void)
+{
+    // Magic, version, timestamp
+    QByteArray header("ULog\x01\x12\x35", 7);
+    header.append(static_cast<char>(1));
+    header.append(8, 0);
+    return header;
+}
+
+void ULogReaderTest::_appendMessage(QByteArray& log, char msgType, const QByteArray& payload)
+{
+    const uint16_t size = static_cast<uint16_t>(payload.size());
+    log.append(static_cast<char>(size & 0xFF));
+    log.append(static_cast<char>(size >> 8));
+    log.append(msgType);
+    log.append(payload);
+}
+
+void ULogReaderTest::_appendDefinitions(QByteArray& log)
+{
+    _appendMessage(log, 'F', "camera_capture:uint64_t timestamp;uint32_t seq;double lat;double lon;float alt;uint8_t result;uint8_t[3] _padding0;");
+    _appendMessage(log, 'F', "point:float x;float y;uint8_t valid;uint8_t[3] _padding0;");
+    _appendMessage(log, 'F', "nested:uint64_t timestamp;point[2] points;uint16_t flags;");
+
+    QByteArray addLogged;
+    addLogged.append(static_cast<char>(0));     // multi_id
+    addLogged.append(reinterpret_cast<const char*>(&kCameraCaptureMsgId), 2);
+    addLogged.append("camera_capture");
+    _appendMessage(log, 'A', addLogged);
+
+    addLogged.clear();
+    addLogged.append(static_cast<char>(0));
+    addLogged.append(reinterpret_cast<const char*>(&kNestedMsgId), 2);
+    addLogged.append("nested");
+    _appendMessage(log, 'A', addLogged);
+}
+
+void ULogReaderTest::_appendCameraCapture(QByteArray& log, uint32_t seq, double lat, double lon)
+{
+    const uint64_t  timestamp   = seq * 1000000ull;
+    const float     alt         = 100;
+    const uint8_t   result      = 1;
+
+    QByteArray data(reinterpret_cast<const char*>(&kCameraCaptureMsgId), 2);
+    data.append(reinterpret_cast<const char*>(&timestamp), 8);
+    data.append(reinterpret_cast<const char*>(&seq), 4);
+    data.append(reinterpret_cast<const char*>(&lat), 8);
+    data.append(reinterpret_cast<const char*>(&lon), 8);
+    data.append(reinterpret_cast<const char*>(&alt), 4);
+    data.append(reinterpret_cast<const char*>(&result), 1);
+    _appendMessage(log, 'D', data);
+}
+
+void ULogReaderTest::_indexTest(void)
+{
+    QByteArray log = _logHeader();
+    _appendDefinitions(log);
+    for (uint32_t seq=0; seq<10; seq++) {
+        _appendCameraCapture(log, seq, 47.0 + seq, 8.0 + seq);
+        _appendMessage(log, 'I', "ignored");
+    }
+    // Log cut off part way through a message
+    log.append("\x40\x00\x44", 3);
+
+    QString     errorMessage;
+    ULogReader  reader;
+    QVERIFY2(reader.open(log, errorMessage), qPrintable(errorMessage));
+
+    const ULogReader::Topic_t* topic = reader.topic(QStringLiteral("camera_capture"));
+    QVERIFY(topic);
+    QCOMPARE(reader.topic(kCameraCaptureMsgId), topic);
+    QCOMPARE(topic->offsets.count(), 10);
+    QCOMPARE(reader.topic(QStringLiteral("nested"))->offsets.count(), 0);
+
+    // Trailing padding is not logged, padding in nested formats is
+    QCOMPARE(reader.format(QStringLiteral("camera_capture"))->size, 33);
+    QCOMPARE(reader.format(QStringLiteral("nested"))->size, 8 + (2 * 12) + 2);
+    QCOMPARE(reader.fieldOffset(QStringLiteral("nested"), QStringLiteral("flags")), 32);
+    QCOMPARE(reader.fieldOffset(QStringLiteral("nested"), QStringLiteral("missing")), -1);
+
+    const int latOffset = reader.fieldOffset(QStringLiteral("camera_capture"), QStringLiteral("lat"));
+    const int seqOffset = reader.fieldOffset(QStringLiteral("camera_capture"), QStringLiteral("seq"));
+    for (int i=0; i<topic->offsets.count(); i++) {
+        const char* data = reader.messageData(*topic, i);
+        QCOMPARE(reader.messageDataSize(*topic, i), 33);
+        QCOMPARE(ULogReader::value<uint32_t>(data, seqOffset), static_cast<uint32_t>(i));
+        QCOMPARE(ULogReader::value<double>(data, latOffset), 47.0 + i);
+    }
+
+    QVERIFY(!reader.open(QByteArray("not a log at all"), errorMessage));
+    QVERIFY(!errorMessage.isEmpty());
+}
+
+void ULogReaderTest::_geoTagTest(void)
+{
+    QByteArray log = _logHeader();
+    _appendDefinitions(log);
+    for (uint32_t seq=0; seq<5; seq++) {
+        _appendCameraCapture(log, seq, -35.0 - seq, 149.0 + seq);
+    }
+
+    QString                                     errorMessage;
+    QList<GeoTagWorker::cameraFeedbackPacket>   cameraFeedback;
+    ULogParser                                  parser;
+    QVERIFY2(parser.getTagsFromLog(log, cameraFeedback, errorMessage), qPrintable(errorMessage));
+    QCOMPARE(cameraFeedback.count(), 5);
+    for (int i=0; i<cameraFeedback.count(); i++) {
+        QCOMPARE(cameraFeedback[i].imageSequence, static_cast<uint32_t>(i));
+        QCOMPARE(cameraFeedback[i].timestamp, static_cast<double>(i));
+        QCOMPARE(cameraFeedback[i].latitude, -35.0 - i);
+        QCOMPARE(cameraFeedback[i].longitude, 149.0 + i);
+        QCOMPARE(cameraFeedback[i].altitude, 100.0f);
+    }
+}
+
+/// Indexes a log from disk. Runs on a 1MB log by default, set QGC_ULOG_BENCHMARK_MB=1024 to benchmark a 1GB log.
+void ULogReaderTest::_benchmark(void)
+{
+    int megabytes = qEnvironmentVariableIntValue("QGC_ULOG_BENCHMARK_MB");
+    if (megabytes <= 0) {
+        megabytes = 1;
+    }
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+
+    QByteArray log = _logHeader();
+    _appendDefinitions(log);
+    file.write(log);
+
+    QByteArray chunk;
+    for (uint32_t seq=0; seq<1000; seq++) {
+        _appendCameraCapture(chunk, seq, 47.0, 8.0);
+    }
+    const int chunkCount = static_cast<int>((static_cast<qint64>(megabytes) * 1024 * 1024) / chunk.size());
+    for (int i=0; i<chunkCount; i++) {
+        QCOMPARE(file.write(chunk), static_cast<qint64>(chunk.size()));
+    }
+    file.flush();
+
+    QString         errorMessage;
+    ULogReader      reader;
+    QElapsedTimer   timer;
+    timer.start();
+    QVERIFY2(reader.open(file.fileName(), errorMessage), qPrintable(errorMessage));
+    const qint64 indexMSecs = timer.restart();
+
+    const ULogReader::Topic_t*  topic       = reader.topic(QStringLiteral("camera_capture"));
+    const int                   latOffset   = reader.fieldOffset(QStringLiteral("camera_capture"), QStringLiteral("lat"));
+    QVERIFY(topic);
+    QCOMPARE(topic->offsets.count(), chunkCount * 1000);
+    double latSum = 0;
+    for (int i=0; i<topic->offsets.count(); i++) {
+        latSum += ULogReader::value<double>(reader.messageData(*topic, i), latOffset);
+    }
+    const qint64 readMSecs = timer.elapsed();
+    QCOMPARE(latSum, 47.0 * topic->offsets.count());
+
+    qCDebug(ULogReaderTestLog) << "ULogReader" << file.size() / (1024 * 1024) << "MB" << topic->offsets.count() << "messages"
+                               << "index" << indexMSecs << "ms" << "read field" << readMSecs << "ms";
+}
@@ -0,0 +1,28 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+
+class ULogReaderTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _indexTest     (void);
+    void _geoTagTest    (void);
+    void _benchmark     (void);
+
+private:
+    static QByteArray   _logHeader      (void);
+    static void         _appendMessage  (QByteArray& log, char msgType, const QByteArray& payload);
+    static void         _appendDefinitions(QByteArray& log);
+    static void         _appendCameraCapture(QByteArray& log, uint32_t seq, double lat, double lon);
+};
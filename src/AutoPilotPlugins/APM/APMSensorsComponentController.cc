@@ -106,7 +106,7 @@ void APMSensorsComponentController::_startLogCalibration(void)
     }
     _cancelButton->setEnabled(_calTypeInProgress == CalTypeOnboardCompass);
 
-    connect(qgcApp()->toolbox()->mavlinkProtocol(), &MAVLinkProtocol::messageReceived, this, &APMSensorsComponentController::_mavlinkMessageReceived);
+    _subscribeMessages();
 }
 
 void APMSensorsComponentController::_startVisualCalibration(void)
@@ -119,7 +119,7 @@ void APMSensorsComponentController::_startVisualCalibration(void)
     
     _progressBar->setProperty("value", 0);
 
-    connect(qgcApp()->toolbox()->mavlinkProtocol(), &MAVLinkProtocol::messageReceived, this, &APMSensorsComponentController::_mavlinkMessageReceived);
+    _subscribeMessages();
 }
 
 void APMSensorsComponentController::_resetInternalState(void)
@@ -150,7 +150,7 @@ void APMSensorsComponentController::_resetInternalState(void)
 
 void APMSensorsComponentController::_stopCalibration(APMSensorsComponentController::StopCalibrationCode code)
 {
-    disconnect(qgcApp()->toolbox()->mavlinkProtocol(), &MAVLinkProtocol::messageReceived, this, &APMSensorsComponentController::_mavlinkMessageReceived);
+    _unsubscribeMessages();
     _vehicle->vehicleLinkManager()->setCommunicationLostEnabled(true);
 
     disconnect(_vehicle, &Vehicle::textMessageReceived, this, &APMSensorsComponentController::_handleUASTextMessage);
@@ -686,27 +686,51 @@ void APMSensorsComponentController::_handleCommandLong(mavlink_message_t& messag
     }
 }
 
-void APMSensorsComponentController::_mavlinkMessageReceived(LinkInterface* link, mavlink_message_t message)
+void APMSensorsComponentController::_subscribeMessages(void)
 {
-    Q_UNUSED(link);
+    if (_messageSubscriptionId == -1) {
+        QList<uint32_t> msgIds = { MAVLINK_MSG_ID_COMMAND_ACK, MAVLINK_MSG_ID_MAG_CAL_PROGRESS, MAVLINK_MSG_ID_MAG_CAL_REPORT, MAVLINK_MSG_ID_COMMAND_LONG };
+        _messageSubscriptionId = qgcApp()->toolbox()->mavlinkProtocol()->subscribeMessages(this, msgIds,
+                                                                                           std::bind(&APMSensorsComponentController::_mavlinkMessagesReceived, this, std::placeholders::_1, std::placeholders::_2));
+    }
+}
 
-    if (message.sysid != _vehicle->id()) {
-        return;
+void APMSensorsComponentController::_unsubscribeMessages(void)
+{
+    if (_messageSubscriptionId != -1) {
+        qgcApp()->toolbox()->mavlinkProtocol()->unsubscribeMessages(_messageSubscriptionId);
+        _messageSubscriptionId = -1;
     }
+}
 
-    switch (message.msgid) {
-    case MAVLINK_MSG_ID_COMMAND_ACK:
-        _handleCommandAck(message);
-        break;
-    case MAVLINK_MSG_ID_MAG_CAL_PROGRESS:
-        _handleMagCalProgress(message);
-        break;
-    case MAVLINK_MSG_ID_MAG_CAL_REPORT:
-        _handleMagCalReport(message);
-        break;
-    case MAVLINK_MSG_ID_COMMAND_LONG:
-        _handleCommandLong(message);
-        break;
+void APMSensorsComponentController::_mavlinkMessagesReceived(LinkInterface* link, const QVector<const mavlink_message_t*>& messages)
+{
+    Q_UNUSED(link);
+
+    for (const mavlink_message_t* receivedMessage: messages) {
+        if (_messageSubscriptionId == -1) {
+            // Calibration was stopped by a previous message in the batch
+            break;
+        }
+        if (receivedMessage->sysid != _vehicle->id()) {
+            continue;
+        }
+
+        mavlink_message_t message = *receivedMessage;
+        switch (message.msgid) {
+        case MAVLINK_MSG_ID_COMMAND_ACK:
+            _handleCommandAck(message);
+            break;
+        case MAVLINK_MSG_ID_MAG_CAL_PROGRESS:
+            _handleMagCalProgress(message);
+            break;
+        case MAVLINK_MSG_ID_MAG_CAL_REPORT:
+            _handleMagCalReport(message);
+            break;
+        case MAVLINK_MSG_ID_COMMAND_LONG:
+            _handleCommandLong(message);
+            break;
+        }
     }
 }
 
@@ -133,7 +133,6 @@ signals:
 
 private slots:
     void _handleUASTextMessage  (int uasId, int compId, int severity, QString text);
-    void _mavlinkMessageReceived(LinkInterface* link, mavlink_message_t message);
     void _mavCommandResult      (int vehicleId, int component, int command, int result, bool noReponseFromVehicle);
 
 private:
@@ -148,6 +147,9 @@ private:
     void _handleMagCalReport                (mavlink_message_t& message);
     void _handleCommandLong                 (mavlink_message_t& message);
     void _restorePreviousCompassCalFitness  (void);
+    void _subscribeMessages                 (void);
+    void _unsubscribeMessages               (void);
+    void _mavlinkMessagesReceived           (LinkInterface* link, const QVector<const mavlink_message_t*>& messages);
 
     enum StopCalibrationCode {
         StopCalibrationSuccess,
@@ -206,6 +208,8 @@ private:
     
     bool _waitingForCancel;
 
+    int _messageSubscriptionId = -1;
+
     bool _restoreCompassCalFitness;
     float _previousCompassCalFitness;
     static const char* _compassCalFitnessParam;
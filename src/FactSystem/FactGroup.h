@@ -56,6 +56,10 @@ public:
     /// Allows a FactGroup to parse incoming messages and fill in values
     virtual void handleMessage(Vehicle* vehicle, mavlink_message_t& message);
 
+    /// @return Message ids handleMessage is interested in. Vehicle uses this to only route those messages to the group.
+    /// The default empty list routes all messages to the group.
+    virtual QList<uint32_t> handledMessageIds(void) const { return QList<uint32_t>(); }
+
 signals:
     void factNamesChanged           (void);
     void factGroupNamesChanged      (void);
@@ -0,0 +1,342 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ParameterCache.h"
+#include "QGC.h"
+
+#include <cstddef>
+#include <cstring>
+
+QGC_LOGGING_CATEGORY(ParameterCacheLog, "ParameterCacheLog")
+
+ParameterCache::ParameterCache(const QString& fileName)
+    : _file(fileName)
+{
+
+}
+
+bool ParameterCache::_open(bool create)
+{
+    if (_file.isOpen()) {
+        return true;
+    }
+    if (!create && !_file.exists()) {
+        return false;
+    }
+    if (!_file.open(QFile::ReadWrite)) {
+        qCWarning(ParameterCacheLog) << "Unable to open" << _file.fileName() << _file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ParameterCache::_readHeader(Header_t& header)
+{
+    if (!_open(false)) {
+        return false;
+    }
+
+    if (!_file.seek(0) || _file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) ||
+            header.magic != _magic || header.version != _version || header.count > 0xFFFF ||
+            _file.size() < _entryOffset(static_cast<int>(header.count))) {
+        // Truncated, or a cache from an older version
+        qCDebug(ParameterCacheLog) << "Invalid cache header" << _file.fileName();
+        return false;
+    }
+
+    _count      = static_cast<int>(header.count);
+    _hashValid  = header.hashValid != 0;
+    return true;
+}
+
+bool ParameterCache::write(const QVector<Param_t>& params, int count, quint32 hash)
+{
+    if (!_open(true)) {
+        return false;
+    }
+
+    Header_t header = { _magic, _version, static_cast<quint32>(count), 0, 0, 0 };
+
+    QByteArray entries(count * static_cast<int>(sizeof(Entry_t)), 0);
+    for (const Param_t& param: params) {
+        Entry_t entry;
+        if (param.index >= 0 && param.index < count && _fillEntry(param, entry)) {
+            memcpy(entries.data() + (param.index * sizeof(Entry_t)), &entry, sizeof(entry));
+        } else {
+            qCDebug(ParameterCacheLog) << "Not caching" << param.name << param.index;
+        }
+    }
+
+    // The hash is only marked valid once all the entries are down
+    if (!_file.resize(0) ||
+            !_file.seek(0) ||
+            _file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header) ||
+            _file.write(entries) != entries.size() ||
+            !_file.flush()) {
+        qCWarning(ParameterCacheLog) << "Unable to write" << _file.fileName() << _file.errorString();
+        _count = -1;
+        return false;
+    }
+
+    _count = count;
+    return setHash(hash);
+}
+
+bool ParameterCache::update(const Param_t& param)
+{
+    Header_t header;
+    if (_count < 0 && !_readHeader(header)) {
+        return false;
+    }
+
+    Entry_t entry;
+    if (param.index < 0 || param.index >= _count || !_fillEntry(param, entry)) {
+        return false;
+    }
+
+    const quint32 hashValid = 0;
+    if (!_file.seek(_entryOffset(param.index)) ||
+            _file.write(reinterpret_cast<const char*>(&entry), sizeof(entry)) != sizeof(entry) ||
+            (_hashValid && (!_file.seek(offsetof(Header_t, hashValid)) || _file.write(reinterpret_cast<const char*>(&hashValid), sizeof(hashValid)) != sizeof(hashValid))) ||
+            !_file.flush()) {
+        qCWarning(ParameterCacheLog) << "Unable to update" << param.name << _file.fileName() << _file.errorString();
+        return false;
+    }
+
+    _hashValid = false;
+    return true;
+}
+
+bool ParameterCache::hash(quint32& hash)
+{
+    Header_t header;
+    if (!_readHeader(header) || !header.hashValid) {
+        return false;
+    }
+    hash = header.hash;
+    return true;
+}
+
+bool ParameterCache::setHash(quint32 hash)
+{
+    Header_t header;
+    if (_count < 0 && !_readHeader(header)) {
+        return false;
+    }
+
+    const quint32 hashFields[2] = { 1, hash };  // hashValid, hash
+    if (!_file.seek(offsetof(Header_t, hashValid)) ||
+            _file.write(reinterpret_cast<const char*>(hashFields), sizeof(hashFields)) != sizeof(hashFields) ||
+            !_file.flush()) {
+        qCWarning(ParameterCacheLog) << "Unable to write hash" << _file.fileName() << _file.errorString();
+        return false;
+    }
+
+    _hashValid = true;
+    return true;
+}
+
+bool ParameterCache::load(QVector<Param_t>& params)
+{
+    params.clear();
+
+    Header_t header;
+    if (!_readHeader(header)) {
+        return false;
+    }
+
+    const qint64        entryBytes  = _count * static_cast<qint64>(sizeof(Entry_t));
+    const QByteArray    bytes       = _file.read(entryBytes);
+    if (bytes.size() != entryBytes) {
+        qCWarning(ParameterCacheLog) << "Unable to read" << _file.fileName() << _file.errorString();
+        return false;
+    }
+
+    params.reserve(_count);
+    for (int index=0; index<_count; index++) {
+        Entry_t entry;
+        memcpy(&entry, bytes.constData() + (index * sizeof(Entry_t)), sizeof(entry));
+
+        if (entry.name[0] == 0) {
+            qCDebug(ParameterCacheLog) << "Cache is missing index" << index << _file.fileName();
+            params.clear();
+            return false;
+        }
+        if (_entryChecksum(entry) != entry.checksum) {
+            qCWarning(ParameterCacheLog) << "Corrupt entry" << index << _file.fileName();
+            params.clear();
+            return false;
+        }
+
+        params.append({ index,
+                        QString::fromLatin1(entry.name, static_cast<int>(qstrnlen(entry.name, maxNameLength))),
+                        static_cast<FactMetaData::ValueType_t>(entry.type),
+                        _entryValue(entry) });
+    }
+
+    return true;
+}
+
+bool ParameterCache::_fillEntry(const Param_t& param, Entry_t& entry)
+{
+    const QByteArray name = param.name.toLatin1();
+
+    memset(&entry, 0, sizeof(entry));
+    if (name.isEmpty() || name.size() > maxNameLength || !valueBytes(param.type, param.value, entry.value)) {
+        return false;
+    }
+
+    memcpy(entry.name, name.constData(), static_cast<size_t>(name.size()));
+    entry.type      = static_cast<quint32>(param.type);
+    entry.checksum  = _entryChecksum(entry);
+    return true;
+}
+
+quint32 ParameterCache::_entryChecksum(const Entry_t& entry)
+{
+    return QGC::crc32(reinterpret_cast<const quint8*>(&entry), offsetof(Entry_t, checksum), 0);
+}
+
+bool ParameterCache::valueBytes(FactMetaData::ValueType_t type, const QVariant& value, quint8* bytes)
+{
+    memset(bytes, 0, maxValueSize);
+
+    switch (type) {
+    case FactMetaData::valueTypeUint8:
+    {
+        const quint8 typedValue = static_cast<quint8>(value.toUInt());
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeInt8:
+    {
+        const qint8 typedValue = static_cast<qint8>(value.toInt());
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeUint16:
+    {
+        const quint16 typedValue = static_cast<quint16>(value.toUInt());
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeInt16:
+    {
+        const qint16 typedValue = static_cast<qint16>(value.toInt());
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeUint32:
+    {
+        const quint32 typedValue = value.toUInt();
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeInt32:
+    {
+        const qint32 typedValue = value.toInt();
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeUint64:
+    {
+        const quint64 typedValue = value.toULongLong();
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeInt64:
+    {
+        const qint64 typedValue = value.toLongLong();
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeFloat:
+    {
+        const float typedValue = value.toFloat();
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    case FactMetaData::valueTypeDouble:
+    {
+        const double typedValue = value.toDouble();
+        memcpy(bytes, &typedValue, sizeof(typedValue));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+QVariant ParameterCache::_entryValue(const Entry_t& entry)
+{
+    switch (static_cast<FactMetaData::ValueType_t>(entry.type)) {
+    case FactMetaData::valueTypeUint8:
+    {
+        quint8 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<uint>(typedValue));
+    }
+    case FactMetaData::valueTypeInt8:
+    {
+        qint8 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<int>(typedValue));
+    }
+    case FactMetaData::valueTypeUint16:
+    {
+        quint16 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<uint>(typedValue));
+    }
+    case FactMetaData::valueTypeInt16:
+    {
+        qint16 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<int>(typedValue));
+    }
+    case FactMetaData::valueTypeUint32:
+    {
+        quint32 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<uint>(typedValue));
+    }
+    case FactMetaData::valueTypeInt32:
+    {
+        qint32 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<int>(typedValue));
+    }
+    case FactMetaData::valueTypeUint64:
+    {
+        quint64 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<qulonglong>(typedValue));
+    }
+    case FactMetaData::valueTypeInt64:
+    {
+        qint64 typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(static_cast<qlonglong>(typedValue));
+    }
+    case FactMetaData::valueTypeFloat:
+    {
+        float typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(typedValue);
+    }
+    case FactMetaData::valueTypeDouble:
+    {
+        double typedValue;
+        memcpy(&typedValue, entry.value, sizeof(typedValue));
+        return QVariant(typedValue);
+    }
+    default:
+        return QVariant();
+    }
+}
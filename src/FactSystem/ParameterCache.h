@@ -0,0 +1,99 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "FactMetaData.h"
+#include "QGCLoggingCategory.h"
+
+#include <QFile>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+Q_DECLARE_LOGGING_CATEGORY(ParameterCacheLog)
+
+/// On disk cache of one component's parameters, indexed by parameter index.
+///
+/// File layout:
+///     Header_t
+///     Entry_t[count]  Entry for each parameter index, fixed size so a single parameter can be rewritten in place
+///
+/// Each entry carries its own checksum so a torn or corrupt entry is caught on load. The header holds the parameter set
+/// hash as the vehicle computes it, so validating the cache against the vehicle's _HASH_CHECK only reads the header.
+/// Single parameter updates invalidate the stored hash, it is recomputed on the next load.
+class ParameterCache
+{
+public:
+    typedef struct {
+        int                         index;
+        QString                     name;
+        FactMetaData::ValueType_t   type;
+        QVariant                    value;
+    } Param_t;
+
+    ParameterCache(const QString& fileName);
+
+    /// Replaces the whole cache
+    ///     @param count Number of parameters in the component, params which are not included leave empty entries
+    ///     @param hash Parameter set hash of params
+    bool write(const QVector<Param_t>& params, int count, quint32 hash);
+
+    /// Rewrites the entry for a single parameter
+    ///     @return false: index is not in the cache or the write failed
+    bool update(const Param_t& param);
+
+    /// @return true: the cache exists and holds a valid hash
+    bool hash(quint32& hash);
+
+    /// Stores a hash computed from the loaded parameters
+    bool setHash(quint32 hash);
+
+    /// Loads all parameters, ordered by index
+    ///     @return false: no cache, or the cache is incomplete or corrupt
+    bool load(QVector<Param_t>& params);
+
+    /// Raw value of a parameter as the vehicle stores it, zero padded to maxValueSize
+    ///     @return false: type is too large to cache
+    static bool valueBytes(FactMetaData::ValueType_t type, const QVariant& value, quint8* bytes);
+
+    static const int maxNameLength  = 16;
+    static const int maxValueSize   = 8;
+
+private:
+    typedef struct {
+        quint32 magic;
+        quint32 version;
+        quint32 count;
+        quint32 hashValid;
+        quint32 hash;
+        quint32 reserved;
+    } Header_t;
+
+    typedef struct {
+        char    name[maxNameLength];    ///< Not null terminated if the name fills it, all zero for an empty entry
+        quint32 type;                   ///< FactMetaData::ValueType_t
+        quint8  value[maxValueSize];
+        quint32 checksum;               ///< crc32 of the fields above
+    } Entry_t;
+
+    bool                _open           (bool create);
+    bool                _readHeader     (Header_t& header);
+    static bool         _fillEntry      (const Param_t& param, Entry_t& entry);
+    static quint32      _entryChecksum  (const Entry_t& entry);
+    static QVariant     _entryValue     (const Entry_t& entry);
+    static qint64       _entryOffset    (int index) { return static_cast<qint64>(sizeof(Header_t)) + (index * static_cast<qint64>(sizeof(Entry_t))); }
+
+    QFile   _file;
+    int     _count      = -1;       ///< Entries in the file, -1 until the header has been read
+    bool    _hashValid  = false;
+
+    static const quint32 _magic     = 0x50434751;
+    static const quint32 _version   = 1;
+};
@@ -24,6 +24,7 @@
 #include <QDebug>
 #include <QVariantAnimation>
 #include <QJsonArray>
+#include <QtEndian>
 
 QGC_LOGGING_CATEGORY(ParameterManagerVerbose1Log,           "ParameterManagerVerbose1Log")
 QGC_LOGGING_CATEGORY(ParameterManagerVerbose2Log,           "ParameterManagerVerbose2Log")
@@ -85,7 +86,8 @@ ParameterManager::ParameterManager(Vehicle* vehicle)
     , _disableAllRetries                (false)
     , _indexBatchQueueActive            (false)
     , _totalParamCount                  (0)
-    , _tryftp                           (vehicle->apmFirmware())
+    , _ftpParamFile                     (vehicle->firmwarePlugin()->ftpParameterFile(vehicle))
+    , _tryftp                           (!_ftpParamFile.isEmpty())
 {
     if (_vehicle->isOfflineEditingVehicle()) {
         _loadOfflineEditingParams();
@@ -102,6 +104,10 @@ ParameterManager::ParameterManager(Vehicle* vehicle)
     _waitingParamTimeoutTimer.setInterval(3000);
     connect(&_waitingParamTimeoutTimer, &QTimer::timeout, this, &ParameterManager::_waitingParamTimeout);
 
+    _indexBatchTimer.setSingleShot(true);
+    connect(&_indexBatchTimer, &QTimer::timeout, this, &ParameterManager::_indexBatchTimeout);
+    _indexBatchElapsed.start();
+
     // Ensure the cache directory exists
     QFileInfo(QSettings().fileName()).dir().mkdir("ParamCache");
 }
@@ -113,7 +119,15 @@ void ParameterManager::_updateProgressBar(void)
     int waitingWriteParamCount = 0;
 
     for (int compId: _waitingReadParamIndexMap.keys()) {
-        waitingReadParamIndexCount += _waitingReadParamIndexMap[compId].count();
+        const int waitingCount  = _waitingReadParamIndexMap[compId].count();
+        const int paramCount    = _paramCountMap.value(compId, 0);
+        waitingReadParamIndexCount += waitingCount;
+
+        const double componentProgress = paramCount ? static_cast<double>(paramCount - waitingCount) / paramCount : 1.0;
+        if (!_componentLoadProgressMap.contains(compId) || _componentLoadProgressMap[compId] != componentProgress) {
+            _componentLoadProgressMap[compId] = componentProgress;
+            emit componentLoadProgressChanged(compId, componentProgress);
+        }
     }
     for(int compId: _waitingReadParamNameMap.keys()) {
         waitingReadParamNameCount += _waitingReadParamNameMap[compId].count();
@@ -287,6 +301,9 @@ void ParameterManager::_handleParamValue(int componentId, QString parameterName,
         _paramCountMap[componentId] = parameterCount;
         _totalParamCount += parameterCount;
     }
+    if (parameterIndex >= 0 && parameterIndex < parameterCount) {
+        _paramIndexMap[componentId][parameterName] = parameterIndex;
+    }
 
     // If we've never seen this component id before, setup the index wait lists.
     if (!_waitingReadParamIndexMap.contains(componentId)) {
@@ -311,8 +328,8 @@ void ParameterManager::_handleParamValue(int componentId, QString parameterName,
 
     // Remove this parameter from the waiting lists
     if (_waitingReadParamIndexMap[componentId].contains(parameterIndex)) {
+        _indexBatchResponse(componentId, parameterIndex);
         _waitingReadParamIndexMap[componentId].remove(parameterIndex);
-        _indexBatchQueue.removeOne(parameterIndex);
         _fillIndexBatchQueue(false /* waitingParamTimeout */);
     }
     _waitingReadParamNameMap[componentId].remove(parameterName);
@@ -395,10 +412,13 @@ void ParameterManager::_handleParamValue(int componentId, QString parameterName,
     // Update param cache. The param cache is only used on PX4 Firmware since ArduPilot and Solo have volatile params
     // which invalidate the cache. The Solo also streams param updates in flight for things like gimbal values
     // which in turn causes a perf problem with all the param cache updates.
-    if (!_logReplay && _vehicle->px4Firmware()) {
+    if (!_logReplay && !_loadingFromCache && _vehicle->px4Firmware()) {
         if (_prevWaitingReadParamIndexCount + _prevWaitingReadParamNameCount != 0 && readWaitingParamCount == 0) {
             // All reads just finished, update the cache
             _writeLocalParamCache(_vehicle->id(), componentId);
+        } else if (_initialLoadComplete && readWaitingParamCount == 0) {
+            // Single parameter update, only its entry is rewritten
+            _updateLocalParamCache(componentId, fact);
         }
     }
 
@@ -526,7 +546,7 @@ void ParameterManager::refreshAllParameters(uint8_t componentId)
         FTPManager* ftpManager = _vehicle->ftpManager();
         connect(ftpManager, &FTPManager::downloadComplete, this, &ParameterManager::_ftpDownloadComplete);
         _waitingParamTimeoutTimer.stop();
-        if (ftpManager->download(MAV_COMP_ID_AUTOPILOT1, "@PARAM/param.pck",
+        if (ftpManager->download(MAV_COMP_ID_AUTOPILOT1, _ftpParamFile,
                                  QStandardPaths::writableLocation(QStandardPaths::TempLocation),
                                  "", false /* No filesize check */)) {
             connect(ftpManager, &FTPManager::commandProgress, this, &ParameterManager::_ftpDownloadProgress);
@@ -647,7 +667,8 @@ QStringList ParameterManager::parameterNames(int componentId)
     return names;
 }
 
-/// Requests missing index based parameters from the vehicle.
+/// Requests missing index based parameters from the vehicle, keeping up to the current window of requests in flight.
+/// Requests which have been outstanding for longer than the timeout are considered lost and sent again.
 ///     @param waitingParamTimeout: true: being called due to timeout, false: being called to re-fill the batch queue
 /// return true: Parameters were requested, false: No more requests needed
 bool ParameterManager::_fillIndexBatchQueue(bool waitingParamTimeout)
@@ -656,30 +677,53 @@ bool ParameterManager::_fillIndexBatchQueue(bool waitingParamTimeout)
         return false;
     }
 
-    const int maxBatchSize = 10;
+    const qint64    now     = _indexBatchElapsed.elapsed();
+    const int       timeout = _indexBatchTimeoutMsecs();
 
     if (waitingParamTimeout) {
-        // We timed out, clear the queue and try again
         qCDebug(ParameterManagerLog) << "Refilling index based batch queue due to timeout";
-        _indexBatchQueue.clear();
     } else {
-        qCDebug(ParameterManagerLog) << "Refilling index based batch queue due to received parameter";
+        qCDebug(ParameterManagerVerbose1Log) << "Refilling index based batch queue due to received parameter";
     }
 
+    bool lost = false;
+    for (auto it = _indexBatchQueue.begin(); it != _indexBatchQueue.end(); ) {
+        if (now - it.value() >= timeout) {
+            it = _indexBatchQueue.erase(it);
+            lost = true;
+        } else {
+            ++it;
+        }
+    }
+    if (lost && (_indexBatchLastDecrease < 0 || now - _indexBatchLastDecrease >= _indexBatchSrtt)) {
+        // Only back off once per round trip, everything sent in the same window was lost to the same congestion
+        _indexBatchWindow           = qMax(_indexBatchWindow / 2.0, static_cast<double>(_minIndexBatchWindow));
+        _indexBatchSlowStartWindow  = _indexBatchWindow;
+        _indexBatchLastDecrease     = now;
+        qCDebug(ParameterManagerLog) << "Index based requests lost - window:timeout" << _indexBatchWindow << timeout;
+    }
+    if (lost && timeout < _maxIndexBatchTimeoutMsecs) {
+        // Back off the timeout on every loss, the link may have dropped out rather than be congested
+        _indexBatchBackoff *= 2;
+    }
+
+    const int window = static_cast<int>(_indexBatchWindow);
+
     for(int componentId: _waitingReadParamIndexMap.keys()) {
         if (_waitingReadParamIndexMap[componentId].count()) {
-            qCDebug(ParameterManagerLog) << _logVehiclePrefix(componentId) << "_waitingReadParamIndexMap count" << _waitingReadParamIndexMap[componentId].count();
-            qCDebug(ParameterManagerVerbose1Log) << _logVehiclePrefix(componentId) << "_waitingReadParamIndexMap" << _waitingReadParamIndexMap[componentId];
+            qCDebug(ParameterManagerVerbose1Log) << _logVehiclePrefix(componentId) << "_waitingReadParamIndexMap count" << _waitingReadParamIndexMap[componentId].count();
+            qCDebug(ParameterManagerVerbose2Log) << _logVehiclePrefix(componentId) << "_waitingReadParamIndexMap" << _waitingReadParamIndexMap[componentId];
         }
 
         for(int paramIndex: _waitingReadParamIndexMap[componentId].keys()) {
-            if (_indexBatchQueue.contains(paramIndex)) {
-                // Don't add more than once
-                continue;
+            if (_indexBatchQueue.count() >= window) {
+                break;
             }
 
-            if (_indexBatchQueue.count() > maxBatchSize) {
-                break;
+            const quint32 key = _indexBatchKey(componentId, paramIndex);
+            if (_indexBatchQueue.contains(key)) {
+                // Don't add more than once
+                continue;
             }
 
             _waitingReadParamIndexMap[componentId][paramIndex]++;   // Bump retry count
@@ -690,16 +734,76 @@ bool ParameterManager::_fillIndexBatchQueue(bool waitingParamTimeout)
                 _waitingReadParamIndexMap[componentId].remove(paramIndex);
             } else {
                 // Retry again
-                _indexBatchQueue.append(paramIndex);
+                _indexBatchQueue[key] = now;
                 _readParameterRaw(componentId, "", paramIndex);
-                qCDebug(ParameterManagerLog) << _logVehiclePrefix(componentId) << "Read re-request for (paramIndex:" << paramIndex << "retryCount:" << _waitingReadParamIndexMap[componentId][paramIndex] << ")";
+                qCDebug(ParameterManagerVerbose1Log) << _logVehiclePrefix(componentId) << "Read re-request for (paramIndex:" << paramIndex << "retryCount:" << _waitingReadParamIndexMap[componentId][paramIndex] << ")";
             }
         }
     }
 
+    if (_indexBatchQueue.count()) {
+        _indexBatchTimer.start(_indexBatchTimeoutMsecs());
+    } else {
+        _indexBatchTimer.stop();
+    }
+
     return _indexBatchQueue.count() != 0;
 }
 
+/// Called when an index based parameter we may have re-requested comes in. Updates the round trip time and opens up the window.
+void ParameterManager::_indexBatchResponse(int componentId, int paramIndex)
+{
+    auto it = _indexBatchQueue.find(_indexBatchKey(componentId, paramIndex));
+    if (it == _indexBatchQueue.end()) {
+        return;
+    }
+
+    // Only requests which were sent once give a round trip sample, a response to a resend can't be matched to its request
+    if (_waitingReadParamIndexMap[componentId][paramIndex] == 1) {
+        const double rtt = _indexBatchElapsed.elapsed() - it.value();
+        if (_indexBatchSrtt == 0) {
+            _indexBatchSrtt     = rtt;
+            _indexBatchRttVar   = rtt / 2.0;
+        } else {
+            _indexBatchRttVar   = (0.75 * _indexBatchRttVar) + (0.25 * qAbs(_indexBatchSrtt - rtt));
+            _indexBatchSrtt     = (0.875 * _indexBatchSrtt) + (0.125 * rtt);
+        }
+        _indexBatchBackoff = 1;
+    }
+    _indexBatchQueue.erase(it);
+
+    // Don't push harder on a link which is already dropping messages
+    if (_primaryLinkLossPercent() <= _indexBatchLossThresholdPercent) {
+        _indexBatchWindow += _indexBatchWindow < _indexBatchSlowStartWindow ? 1.0 : 1.0 / _indexBatchWindow;
+        _indexBatchWindow = qMin(_indexBatchWindow, static_cast<double>(_maxIndexBatchWindow));
+    }
+
+    qCDebug(ParameterManagerVerbose1Log) << _logVehiclePrefix(componentId) << "Index batch response - window:srtt:rttvar" << _indexBatchWindow << _indexBatchSrtt << _indexBatchRttVar;
+}
+
+void ParameterManager::_indexBatchTimeout(void)
+{
+    _fillIndexBatchQueue(true /* waitingParamTimeout */);
+    _updateProgressBar();
+    _checkInitialLoadComplete();
+}
+
+/// @return Msecs to wait for a re-requested parameter before sending the request again
+int ParameterManager::_indexBatchTimeoutMsecs(void) const
+{
+    if (_indexBatchSrtt == 0) {
+        return _maxIndexBatchTimeoutMsecs;
+    }
+    const double rto = qMax(static_cast<double>(_minIndexBatchTimeoutMsecs), _indexBatchSrtt + (4.0 * _indexBatchRttVar));
+    return static_cast<int>(qMin(rto * _indexBatchBackoff, static_cast<double>(_maxIndexBatchTimeoutMsecs)));
+}
+
+float ParameterManager::_primaryLinkLossPercent(void)
+{
+    SharedLinkInterfacePtr sharedLink = _vehicle->vehicleLinkManager()->primaryLink().lock();
+    return sharedLink && _mavlink ? _mavlink->runningLossPercent(sharedLink.get()) : 0.0f;
+}
+
 void ParameterManager::_waitingParamTimeout(void)
 {
     if (_logReplay) {
@@ -869,18 +973,50 @@ void ParameterManager::_sendParamSetToVehicle(int componentId, const QString& pa
 
 void ParameterManager::_writeLocalParamCache(int vehicleId, int componentId)
 {
-    CacheMapName2ParamTypeVal cacheMap;
+    QVector<ParameterCache::Param_t> params;
 
     for (const QString& paramName: _mapCompId2FactMap[componentId].keys()) {
         const Fact *fact = _mapCompId2FactMap[componentId][paramName];
-        cacheMap[paramName] = ParamTypeVal(fact->type(), fact->rawValue());
+        params.append({ _paramIndexMap[componentId].value(paramName, -1), paramName, fact->type(), fact->rawValue() });
     }
 
-    QFile cacheFile(parameterCacheFile(vehicleId, componentId));
-    cacheFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    ParameterCache cache(parameterCacheFile(vehicleId, componentId));
+    cache.write(params, _paramCountMap.value(componentId, params.count()), _paramCacheHash(params));
+}
 
-    QDataStream ds(&cacheFile);
-    ds << cacheMap;
+void ParameterManager::_updateLocalParamCache(int componentId, const Fact* fact)
+{
+    // PARAM_VALUE acks for a PARAM_SET carry index 65535, the cache slot comes from the index seen on load
+    const int       paramIndex = _paramIndexMap[componentId].value(fact->name(), -1);
+    ParameterCache  cache(parameterCacheFile(_vehicle->id(), componentId));
+    if (!cache.update({ paramIndex, fact->name(), fact->type(), fact->rawValue() })) {
+        qCDebug(ParameterManagerVerbose1Log) << _logVehiclePrefix(componentId) << "Parameter not in cache" << fact->name() << paramIndex;
+    }
+}
+
+/// Computes the parameter set hash the same way the vehicle computes _HASH_CHECK: crc32 over the name and value of each
+/// non-volatile parameter, in name order.
+quint32 ParameterManager::_paramCacheHash(const QVector<ParameterCache::Param_t>& params)
+{
+    QMap<QString, const ParameterCache::Param_t*> sortedParams;
+    for (const ParameterCache::Param_t& param: params) {
+        sortedParams[param.name] = &param;
+    }
+
+    uint32_t crc32_value = 0;
+    for (const ParameterCache::Param_t* param: sortedParams) {
+        if (_vehicle->compInfoManager()->compInfoParam(MAV_COMP_ID_AUTOPILOT1)->factMetaDataForName(param->name, param->type)->volatileValue()) {
+            // Does not take part in CRC
+            qCDebug(ParameterManagerLog) << "Volatile parameter" << param->name;
+        } else {
+            quint8 vdat[ParameterCache::maxValueSize];
+            ParameterCache::valueBytes(param->type, param->value, vdat);
+            crc32_value = QGC::crc32((const uint8_t *)qPrintable(param->name), param->name.length(), crc32_value);
+            crc32_value = QGC::crc32(vdat, FactMetaData::typeToSize(param->type), crc32_value);
+        }
+    }
+
+    return crc32_value;
 }
 
 QDir ParameterManager::parameterCacheDir()
@@ -891,56 +1027,37 @@ QDir ParameterManager::parameterCacheDir()
 
 QString ParameterManager::parameterCacheFile(int vehicleId, int componentId)
 {
-    return parameterCacheDir().filePath(QString("%1_%2.v2").arg(vehicleId).arg(componentId));
+    return parameterCacheDir().filePath(QString("%1_%2.v3").arg(vehicleId).arg(componentId));
 }
 
 void ParameterManager::_tryCacheHashLoad(int vehicleId, int componentId, QVariant hash_value)
 {
     qCInfo(ParameterManagerLog) << "Attemping load from cache";
 
-    uint32_t crc32_value = 0;
-    /* The datastructure of the cache table */
-    CacheMapName2ParamTypeVal cacheMap;
-    QFile cacheFile(parameterCacheFile(vehicleId, componentId));
-    if (!cacheFile.exists()) {
-        /* no local cache, just wait for them to come in*/
-        return;
-    }
-    cacheFile.open(QIODevice::ReadOnly);
-
-    /* Deserialize the parameter cache table */
-    QDataStream ds(&cacheFile);
-    ds >> cacheMap;
-
-    /* compute the crc of the local cache to check against the remote */
+    const QString                       cacheFile = parameterCacheFile(vehicleId, componentId);
+    ParameterCache                      cache(cacheFile);
+    QVector<ParameterCache::Param_t>    params;
+    uint32_t                            crc32_value = 0;
 
-    for (const QString& name: cacheMap.keys()) {
-        const ParamTypeVal&             paramTypeVal    = cacheMap[name];
-        const FactMetaData::ValueType_t fact_type       = static_cast<FactMetaData::ValueType_t>(paramTypeVal.first);
-
-        if (_vehicle->compInfoManager()->compInfoParam(MAV_COMP_ID_AUTOPILOT1)->factMetaDataForName(name, fact_type)->volatileValue()) {
-            // Does not take part in CRC
-            qCDebug(ParameterManagerLog) << "Volatile parameter" << name;
-        } else {
-            const void *vdat = paramTypeVal.second.constData();
-            const FactMetaData::ValueType_t fact_type = static_cast<FactMetaData::ValueType_t>(paramTypeVal.first);
-            crc32_value = QGC::crc32((const uint8_t *)qPrintable(name), name.length(),  crc32_value);
-            crc32_value = QGC::crc32((const uint8_t *)vdat, FactMetaData::typeToSize(fact_type), crc32_value);
+    if (!cache.hash(crc32_value)) {
+        // Single parameter updates leave the hash to be worked out here, once, from the entries
+        if (!cache.load(params)) {
+            /* no usable local cache, just wait for them to come in*/
+            return;
         }
+        crc32_value = _paramCacheHash(params);
+        cache.setHash(crc32_value);
     }
 
     /* if the two param set hashes match, just load from the disk */
-    if (crc32_value == hash_value.toUInt()) {
+    if (crc32_value == hash_value.toUInt() && (params.count() || cache.load(params))) {
         qCInfo(ParameterManagerLog) << "Parameters loaded from cache" << qPrintable(QFileInfo(cacheFile).absoluteFilePath());
 
-        int count = cacheMap.count();
-        int index = 0;
-        for (const QString& name: cacheMap.keys()) {
-            const ParamTypeVal& paramTypeVal = cacheMap[name];
-            const FactMetaData::ValueType_t fact_type = static_cast<FactMetaData::ValueType_t>(paramTypeVal.first);
-            const MAV_PARAM_TYPE mavParamType = factTypeToMavType(fact_type);
-            _handleParamValue(componentId, name, count, index++, mavParamType, paramTypeVal.second);
+        _loadingFromCache = true;
+        for (const ParameterCache::Param_t& param: params) {
+            _handleParamValue(componentId, param.name, params.count(), param.index, factTypeToMavType(param.type), param.value);
         }
+        _loadingFromCache = false;
 
         WeakLinkInterfacePtr weakLink = _vehicle->vehicleLinkManager()->primaryLink();
 
@@ -987,11 +1104,11 @@ void ParameterManager::_tryCacheHashLoad(int vehicleId, int componentId, QVarian
         ani->start(QAbstractAnimation::DeleteWhenStopped);
     } else {
         qCInfo(ParameterManagerLog) << "Parameters cache match failed" << qPrintable(QFileInfo(cacheFile).absoluteFilePath());
-        if (ParameterManagerDebugCacheFailureLog().isDebugEnabled()) {
+        if (ParameterManagerDebugCacheFailureLog().isDebugEnabled() && (params.count() || cache.load(params))) {
             _debugCacheCRC[componentId] = true;
-            _debugCacheMap[componentId] = cacheMap;
-            for (const QString& name: cacheMap.keys()) {
-                _debugCacheParamSeen[componentId][name] = false;
+            for (const ParameterCache::Param_t& param: params) {
+                _debugCacheMap[componentId][param.name] = ParamTypeVal(param.type, param.value);
+                _debugCacheParamSeen[componentId][param.name] = false;
             }
             qgcApp()->showAppMessage(tr("Parameter cache CRC match failed"));
         }
@@ -1425,17 +1542,76 @@ bool ParameterManager::pendingWrites(void)
 
 
 /* Parse the binary parameter file and inject the parameters in the qgc
- * fact system.
+ * fact system. The whole file is decoded before any fact is touched, so a
+ * bad file leaves the parameters as they were.
+ */
+bool ParameterManager::_parseParamFile(const QString& filename)
+{
+    const int componentId = MAV_COMP_ID_AUTOPILOT1; /* Only main autopilot for the moment */
+
+    qCDebug(ParameterManagerLog) << "_parseParamFile: " << filename;
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCDebug(ParameterManagerLog) << "_parseParamFile: Error: Could not open downloaded parameter file.";
+        return false;
+    }
+
+    QVector<ParameterCache::Param_t> params;
+    if (!_decodeParamFile(file.readAll(), params)) {
+        return false;
+    }
+    file.close();
+
+    for (const ParameterCache::Param_t& param: params) {
+        Fact* fact = nullptr;
+        if (_mapCompId2FactMap.contains(componentId) && _mapCompId2FactMap[componentId].contains(param.name)) {
+            fact = _mapCompId2FactMap[componentId][param.name];
+        } else {
+            qCDebug(ParameterManagerVerbose1Log) << _logVehiclePrefix(componentId) << "Adding new fact" << param.name;
+
+            fact = new Fact(componentId, param.name, param.type, this);
+            FactMetaData* factMetaData = _vehicle->compInfoManager()->compInfoParam(componentId)->factMetaDataForName(param.name, fact->type());
+            fact->setMetaData(factMetaData);
+
+            _mapCompId2FactMap[componentId][param.name] = fact;
+
+            // We need to know when the fact value changes so we can update the vehicle
+            connect(fact, &Fact::_containerRawValueChanged, this, &ParameterManager::_factRawValueUpdated);
+
+            emit factAdded(componentId, fact);
+        }
+        fact->_containerSetRawValue(param.value);
+    }
+
+    /* Create empty waiting lists as we have all parameters */
+    if (!_paramCountMap.contains(componentId)) {
+        _totalParamCount += params.count();
+    }
+    _paramCountMap[componentId] = params.count();
+    _waitingReadParamIndexMap[componentId] = QMap<int, int>();
+    _waitingReadParamNameMap[componentId] = QMap<QString, int>();
+    _waitingWriteParamNameMap[componentId] = QMap<QString, int>();
+    _checkInitialLoadComplete();
+    _setLoadProgress(0.0);
+    return true;
+}
+
+/* Decode a packed parameter file in the format of ArduPilot's @PARAM/param.pck.
  *
  * See: https://github.com/ArduPilot/ardupilot/tree/master/libraries/AP_Filesystem
  *
+ *  uint16_t magic, num_params, total_params
+ *  Each parameter, after any zero padding:
+ *      uint8_t type:4, flags:4
+ *      uint8_t common_len:4, name_len:4    Name is the first common_len chars of the previous name followed by name_len + 1 new chars
+ *      char    name[name_len + 1]
+ *      value, followed by its default value if flags bit 0 is set
  */
-bool ParameterManager::_parseParamFile(const QString& filename)
+bool ParameterManager::_decodeParamFile(const QByteArray& bytes, QVector<ParameterCache::Param_t>& params)
 {
     const quint16 magic_standard = 0x671B;
     const quint16 magic_withdefaults = 0x671C;
-    quint32 no_of_parameters_found = 0;
-    const int componentId = MAV_COMP_ID_AUTOPILOT1; /* Only main autopilot for the moment */
+    const int headerSize = 6;
     enum ap_var_type {
         AP_PARAM_NONE    = 0,
         AP_PARAM_INT8,
@@ -1446,179 +1622,140 @@ bool ParameterManager::_parseParamFile(const QString& filename)
         AP_PARAM_GROUP
     };
 
-    qCDebug(ParameterManagerLog) << "_parseParamFile: " << filename;
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qCDebug(ParameterManagerLog) << "_parseParamFile: Error: Could not open downloaded parameter file.";
-        return false;
-    }
-    QDataStream in(&file);
-    in.setByteOrder(QDataStream::LittleEndian);
+    params.clear();
 
-    quint16 magic, num_params, total_params;
-    in >> magic;
-    in >> num_params;
-    in >> total_params;
+    const uchar*    data = reinterpret_cast<const uchar*>(bytes.constData());
+    const int       size = bytes.size();
 
-    if (in.status() != QDataStream::Ok) {
-        qCDebug(ParameterManagerLog) << "_parseParamFile: Error: Could not read Header";
-        goto Error;
+    if (size < headerSize) {
+        qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: Could not read Header";
+        return false;
     }
 
-    qCDebug(ParameterManagerVerbose2Log) << "_parseParamFile: magic: 0x" << Qt::hex << magic;
-    qCDebug(ParameterManagerVerbose2Log) << "_parseParamFile: num_params:" << num_params
+    const quint16 magic         = qFromLittleEndian<quint16>(data);
+    const quint16 num_params    = qFromLittleEndian<quint16>(data + 2);
+    const quint16 total_params  = qFromLittleEndian<quint16>(data + 4);
+
+    qCDebug(ParameterManagerVerbose2Log) << "_decodeParamFile: magic: 0x" << Qt::hex << magic;
+    qCDebug(ParameterManagerVerbose2Log) << "_decodeParamFile: num_params:" << num_params
                                  << " total_params:" << total_params;
 
     if ((magic != magic_standard) && (magic != magic_withdefaults)) {
-        qCDebug(ParameterManagerLog) << "_parseParamFile: Error: File does not start with Magic";
-        goto Error;
-    }
-    if (num_params > total_params) {
-        qCDebug(ParameterManagerLog) << "_parseParamFile: Error: total_params > num_params";
-        goto Error;
+        qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: File does not start with Magic";
+        return false;
     }
     if (num_params != total_params) {
         /* We requested all parameters, so this is an error here */
-        qCDebug(ParameterManagerLog) << "_parseParamFile: Error: total_params != num_params";
-        goto Error;
-    }
-
-    while (in.status() == QDataStream::Ok) {
-        quint8 byte = 0;
-        quint8 flags = 0;
-        quint8 ptype = 0;
-        quint8 name_len = 0;
-        quint8 common_len = 0;
-        bool withdefault = false;
-        int no_read = 0;
-        char name_buffer[17];
-
-        while (byte == 0x0) { // Eat padding bytes
-            in >> byte;
-            if (in.status() != QDataStream::Ok) {
-                if (no_of_parameters_found == num_params)
-                    goto Success;
-                else {
-                    qCDebug(ParameterManagerLog) << "_parseParamFile: Error: unexpected EOF"
-                                                 << "number of parameters expected:" << num_params
-                                                 << "actual:" << no_of_parameters_found;
-                    goto Error;
-                }
-            }
+        qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: total_params != num_params";
+        return false;
+    }
+
+    params.reserve(num_params);
+
+    char    name_buffer[ParameterCache::maxNameLength + 1] = {};
+    int     offset = headerSize;
+
+    while (true) {
+        while (offset < size && data[offset] == 0) { // Eat padding bytes
+            offset++;
         }
-        ptype = byte & 0x0F;
-        flags = (byte >> 4) & 0x0F;
-        withdefault = (flags & 0x01) == 0x01;
-        in >> byte;
-        if (in.status() != QDataStream::Ok) {
-            qCritical(ParameterManagerLog) << "_parseParamFile: Error: Unexpected EOF while reading flags";
-            goto Error;
+        if (offset == size) {
+            break;
+        }
+        if (params.count() == num_params) {
+            qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: more parameters in file than expected."
+                                         << "Expected:" << num_params;
+            return false;
+        }
+        if (offset + 2 > size) {
+            qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: Unexpected EOF while reading flags";
+            return false;
         }
-        name_len = ((byte >> 4) & 0x0F) + 1;
-        common_len = byte & 0x0F;
-        if ((name_len + common_len) > 16) {
-            qCritical(ParameterManagerLog) << "_parseParamFile: Error: common_len + name_len > 16 "
+
+        const quint8    ptype       = data[offset] & 0x0F;
+        const quint8    flags       = (data[offset] >> 4) & 0x0F;
+        const bool      withdefault = (flags & 0x01) == 0x01;
+        const int       name_len    = ((data[offset + 1] >> 4) & 0x0F) + 1;
+        const int       common_len  = data[offset + 1] & 0x0F;
+        offset += 2;
+
+        if ((name_len + common_len) > ParameterCache::maxNameLength || common_len > static_cast<int>(qstrnlen(name_buffer, sizeof(name_buffer)))) {
+            qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: invalid name"
                                          << "name_len" << name_len
                                          << "common_len" << common_len;
-            goto Error;
+            return false;
         }
-        no_read = in.readRawData(&name_buffer[common_len], (int) name_len);
-        if (no_read != name_len) {
-            qCritical(ParameterManagerLog) << "_parseParamFile: Error: Unexpected EOF while reading parameterName"
-                                         << "Expected:" << name_len
-                                         << "Actual:" << no_read;
-            goto Error;
+        if (offset + name_len > size) {
+            qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: Unexpected EOF while reading parameterName";
+            return false;
         }
+        memcpy(&name_buffer[common_len], data + offset, static_cast<size_t>(name_len));
         name_buffer[common_len + name_len] = '\0';
-        QString parameterName(name_buffer);
-        qCDebug(ParameterManagerVerbose2Log) << "_parseParamFile: parameter" << parameterName
-                                     << "name_len" << name_len
-                                     << "common_len" << common_len
-                                     << "ptype" << ptype
-                                     << "flags" << flags;
-
-        QVariant parameterValue = 0;
-        switch ((enum ap_var_type) ptype) {
-        qint8 data8;
-        qint16 data16;
-        qint32 data32;
-        float dfloat;
+        offset += name_len;
+
+        ParameterCache::Param_t param;
+        param.index = params.count();
+        param.name  = QString::fromLatin1(name_buffer);
+
+        int valueSize = 0;
+        switch (static_cast<ap_var_type>(ptype)) {
         case AP_PARAM_INT8:
-            in >> data8;
-            parameterValue = data8;
-            if (withdefault)
-                in >> data8;
+            param.type  = FactMetaData::valueTypeInt8;
+            valueSize   = 1;
             break;
         case AP_PARAM_INT16:
-            in >> data16;
-            parameterValue = data16;
-            if (withdefault)
-                in >> data16;
+            param.type  = FactMetaData::valueTypeInt16;
+            valueSize   = 2;
             break;
         case AP_PARAM_INT32:
-            in >> data32;
-            parameterValue = data32;
-            if (withdefault)
-                in >> data32;
+            param.type  = FactMetaData::valueTypeInt32;
+            valueSize   = 4;
             break;
         case AP_PARAM_FLOAT:
-            in >> data32;
-            memcpy(&dfloat, &data32, 4);
-            parameterValue = dfloat;
-            if (withdefault)
-                in >> data32;
+            param.type  = FactMetaData::valueTypeFloat;
+            valueSize   = 4;
             break;
         default:
-            qCDebug(ParameterManagerLog) << "_parseParamFile: Error: type is out of range" << ptype;
-            goto Error;
-            break;
+            qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: type is out of range" << ptype;
+            return false;
         }
-        qCDebug(ParameterManagerVerbose2Log) << "paramValue" << parameterValue;
 
-        if (++no_of_parameters_found > num_params){
-            qCDebug(ParameterManagerLog) << "_parseParamFile: Error: more parameters in file than expected."
-                                         << "Expected:" << num_params
-                                         << "Actual:" << no_of_parameters_found;
-            goto Error;
+        if (offset + (withdefault ? 2 * valueSize : valueSize) > size) {
+            qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: Unexpected EOF while reading value of" << param.name;
+            return false;
         }
 
-        FactMetaData::ValueType_t factType = (ptype == AP_PARAM_INT8  ? FactMetaData::valueTypeInt8  :
-                                              ptype == AP_PARAM_INT16 ? FactMetaData::valueTypeInt16 :
-                                              ptype == AP_PARAM_INT32 ? FactMetaData::valueTypeInt32 :
-                                              FactMetaData::valueTypeFloat);
-
-        Fact* fact = nullptr;
-        if (_mapCompId2FactMap.contains(componentId) && _mapCompId2FactMap[componentId].contains(parameterName)) {
-            fact = _mapCompId2FactMap[componentId][parameterName];
-        } else {
-            qCDebug(ParameterManagerVerbose1Log) << _logVehiclePrefix(componentId) << "Adding new fact" << parameterName;
-
-            fact = new Fact(componentId, parameterName, factType, this);
-            FactMetaData* factMetaData = _vehicle->compInfoManager()->compInfoParam(componentId)->factMetaDataForName(parameterName, fact->type());
-            fact->setMetaData(factMetaData);
-
-            _mapCompId2FactMap[componentId][parameterName] = fact;
+        switch (static_cast<ap_var_type>(ptype)) {
+        case AP_PARAM_INT8:
+            param.value = static_cast<int>(static_cast<qint8>(data[offset]));
+            break;
+        case AP_PARAM_INT16:
+            param.value = static_cast<int>(qFromLittleEndian<qint16>(data + offset));
+            break;
+        case AP_PARAM_INT32:
+            param.value = static_cast<int>(qFromLittleEndian<qint32>(data + offset));
+            break;
+        default:
+        {
+            const quint32   data32 = qFromLittleEndian<quint32>(data + offset);
+            float           dfloat;
+            memcpy(&dfloat, &data32, sizeof(dfloat));
+            param.value = dfloat;
+            break;
+        }
+        }
+        offset += withdefault ? 2 * valueSize : valueSize;
 
-            // We need to know when the fact value changes so we can update the vehicle
-            connect(fact, &Fact::_containerRawValueChanged, this, &ParameterManager::_factRawValueUpdated);
+        qCDebug(ParameterManagerVerbose2Log) << "_decodeParamFile: parameter" << param.name << "ptype" << ptype << "flags" << flags << "value" << param.value;
+        params.append(param);
+    }
 
-            emit factAdded(componentId, fact);
-        }
-        fact->_containerSetRawValue(parameterValue);
+    if (params.count() != num_params) {
+        qCDebug(ParameterManagerLog) << "_decodeParamFile: Error: unexpected EOF"
+                                     << "number of parameters expected:" << num_params
+                                     << "actual:" << params.count();
+        return false;
     }
-Success:
-    file.close();
-    /* Create empty waiting lists as we have all parameters */
-    _paramCountMap[componentId] = num_params;
-    _totalParamCount += num_params;
-    _waitingReadParamIndexMap[componentId] = QMap<int, int>();
-    _waitingReadParamNameMap[componentId] = QMap<QString, int>();
-    _waitingWriteParamNameMap[componentId] = QMap<QString, int>();
-    _checkInitialLoadComplete();
-    _setLoadProgress(0.0);
-    return true;
 
-Error:
-    file.close();
-    return false;
+    return true;
 }
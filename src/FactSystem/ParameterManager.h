@@ -11,13 +11,16 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QXmlStreamReader>
 #include <QLoggingCategory>
 #include <QMutex>
 #include <QDir>
 #include <QJsonObject>
+#include <QElapsedTimer>
 
 #include "FactSystem.h"
+#include "ParameterCache.h"
 #include "MAVLinkProtocol.h"
 #include "AutoPilotPlugin.h"
 #include "QGCMAVLink.h"
@@ -35,6 +38,7 @@ class ParameterManager : public QObject
     Q_OBJECT
 
     friend class ParameterEditorController;
+    friend class ParameterManagerTest;
 
 public:
     /// @param uas Uas which this set of facts is associated with
@@ -49,6 +53,9 @@ public:
     bool missingParameters  (void) const { return _missingParameters; }
     double loadProgress     (void) const { return _loadProgress; }
 
+    /// @return Initial load progress of a single component, [0.0,1.0]. 0 for components which have not been seen yet.
+    Q_INVOKABLE double componentLoadProgress(int componentId) const { return _componentLoadProgressMap.value(componentId, 0.0); }
+
     /// @return Directory of parameter caches
     static QDir parameterCacheDir();
 
@@ -101,6 +108,7 @@ signals:
     void parametersReadyChanged     (bool parametersReady);
     void missingParametersChanged   (bool missingParameters);
     void loadProgressChanged        (float value);
+    void componentLoadProgressChanged(int componentId, double progress);
     void pendingWritesChanged       (bool pendingWrites);
     void factAdded                  (int componentId, Fact* fact);
 
@@ -117,6 +125,8 @@ private:
     void    _readParameterRaw                   (int componentId, const QString& paramName, int paramIndex);
     void    _sendParamSetToVehicle              (int componentId, const QString& paramName, FactMetaData::ValueType_t valueType, const QVariant& value);
     void    _writeLocalParamCache               (int vehicleId, int componentId);
+    void    _updateLocalParamCache              (int componentId, const Fact* fact);
+    quint32 _paramCacheHash                     (const QVector<ParameterCache::Param_t>& params);
     void    _tryCacheHashLoad                   (int vehicleId, int componentId, QVariant hash_value);
     void    _loadMetaData                       (void);
     void    _clearMetaData                      (void);
@@ -125,12 +135,18 @@ private:
     QString _logVehiclePrefix                   (int componentId);
     void    _setLoadProgress                    (double loadProgress);
     bool    _fillIndexBatchQueue                (bool waitingParamTimeout);
+    void    _indexBatchResponse                 (int componentId, int paramIndex);
+    void    _indexBatchTimeout                  (void);
+    int     _indexBatchTimeoutMsecs             (void) const;
+    float   _primaryLinkLossPercent             (void);
     void    _updateProgressBar                  (void);
     void    _checkInitialLoadComplete           (void);
     void    _ftpDownloadComplete                (const QString& fileName, const QString& errorMsg);
     void    _ftpDownloadProgress                (float progress);
     bool    _parseParamFile                     (const QString& filename);
 
+    static bool _decodeParamFile(const QByteArray& bytes, QVector<ParameterCache::Param_t>& params);
+
     static QVariant _stringToTypedVariant(const QString& string, FactMetaData::ValueType_t type, bool failOk = false);
 
     Vehicle*            _vehicle;
@@ -146,6 +162,7 @@ private:
     bool        _saveRequired;                  ///< true: _saveToEEPROM should be called
     bool        _metaDataAddedToFacts;          ///< true: FactMetaData has been adde to the default component facts
     bool        _logReplay;                     ///< true: running with log replay link
+    bool        _loadingFromCache = false;      ///< true: parameters are being handled from the cache, which is already up to date
 
     typedef QPair<int /* FactMetaData::ValueType_t */, QVariant /* Fact::rawValue */> ParamTypeVal;
     typedef QMap<QString /* parameter name */, ParamTypeVal> CacheMapName2ParamTypeVal;
@@ -170,23 +187,48 @@ private:
     bool                _disableAllRetries;                     ///< true: Don't retry any requests (used for testing)
 
     bool        _indexBatchQueueActive; ///< true: we are actively batching re-requests for missing index base params, false: index based re-request has not yet started
-    QList<int>  _indexBatchQueue;       ///< The current queue of index re-requests
+
+    static quint32 _indexBatchKey(int componentId, int paramIndex) { return (static_cast<quint32>(componentId) << 16) | static_cast<quint16>(paramIndex); }
+
+    // Index re-requests are sent in a sliding window sized like a TCP congestion window: it grows as responses come
+    // back while the link is not dropping messages and halves when requests time out. The timeout follows the
+    // measured round trip time and doubles with each loss, so a short link dropout doesn't use up the retries.
+    static const int        _initialIndexBatchWindow        = 10;
+    static const int        _minIndexBatchWindow            = 2;
+    static const int        _maxIndexBatchWindow            = 64;
+    static const int        _minIndexBatchTimeoutMsecs      = 100;
+    static const int        _maxIndexBatchTimeoutMsecs      = 3000;
+    static constexpr float  _indexBatchLossThresholdPercent = 10;   ///< Window does not grow while link loss is above this
+
+    QHash<quint32, qint64>  _indexBatchQueue;                                   ///< Index re-requests in flight, Key: _indexBatchKey, Value: msecs sent
+    QElapsedTimer           _indexBatchElapsed;
+    QTimer                  _indexBatchTimer;                                   ///< Fires when nothing has come back within the timeout
+    double                  _indexBatchWindow           = _initialIndexBatchWindow;
+    double                  _indexBatchSlowStartWindow  = _maxIndexBatchWindow; ///< Window grows by one per response below this, by one per window above it
+    double                  _indexBatchSrtt             = 0;                    ///< Smoothed round trip msecs, 0 until the first sample
+    double                  _indexBatchRttVar           = 0;
+    qint64                  _indexBatchLastDecrease     = -1;                   ///< Msecs of the last window decrease, at most one per round trip
+    int                     _indexBatchBackoff          = 1;                    ///< Timeout multiplier, doubled on loss and reset by a new round trip sample
 
     QMap<int, int>                  _paramCountMap;             ///< Key: Component id, Value: count of parameters in this component
     QMap<int, QMap<int, int> >      _waitingReadParamIndexMap;  ///< Key: Component id, Value: Map { Key: parameter index still waiting for, Value: retry count }
     QMap<int, QMap<QString, int> >  _waitingReadParamNameMap;   ///< Key: Component id, Value: Map { Key: parameter name still waiting for, Value: retry count }
     QMap<int, QMap<QString, int> >  _waitingWriteParamNameMap;  ///< Key: Component id, Value: Map { Key: parameter name still waiting for, Value: retry count }
     QMap<int, QList<int> >          _failedReadParamIndexMap;   ///< Key: Component id, Value: failed parameter index
+    QMap<int, QHash<QString, int> > _paramIndexMap;             ///< Key: Component id, Value: Map { Key: parameter name, Value: parameter index on the vehicle }
 
     int _totalParamCount;                       ///< Number of parameters across all components
     int _waitingWriteParamBatchCount = 0;       ///< Number of parameters which are batched up waiting on write responses
     int _waitingReadParamNameBatchCount = 0;    ///< Number of parameters which are batched up waiting on read responses
 
+    QMap<int, double> _componentLoadProgressMap;    ///< Key: Component id, Value: initial load progress
+
     QTimer _initialRequestTimeoutTimer;
     QTimer _waitingParamTimeoutTimer;
 
     Fact _defaultFact;   ///< Used to return default fact, when parameter not found
 
     /* MavFTP */
+    QString            _ftpParamFile;   ///< Packed parameter file the firmware serves over FTP, empty for none
     bool               _tryftp;
 };
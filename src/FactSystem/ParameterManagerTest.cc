@@ -12,6 +12,11 @@
 #include "MultiVehicleManager.h"
 #include "QGCApplication.h"
 #include "ParameterManager.h"
+#include "ParameterCache.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QtEndian>
 
 /// Test failure modes which should still lead to param load success
 void ParameterManagerTest::_noFailureWorker(MockConfiguration::FailureMode_t failureMode)
@@ -180,6 +185,317 @@ void ParameterManagerTest::_FTPnoFailure()
     QCOMPARE(arguments.at(0).toFloat(), 0.0f);
 }
 
+/// Loads the full parameter set over a simulated telemetry radio, missing parameters are recovered through the index
+/// re-request window. Reports the load time so changes to the retry logic can be compared. Takes several seconds so
+/// it only runs with QGC_PARAMETER_BENCHMARK set.
+void ParameterManagerTest::_lossyLinkBenchmark(void)
+{
+    if (!qEnvironmentVariableIsSet("QGC_PARAMETER_BENCHMARK")) {
+        QSKIP("Set QGC_PARAMETER_BENCHMARK to run");
+    }
+
+    Q_ASSERT(!_mockLink);
+    _mockLink = MockLink::startPX4MockLink(false);
+    _mockLink->setSimulatedLatency(50);
+    _mockLink->setSimulatedDropPercent(5, 42 /* seed */);   // Same drops each run, so the timing is comparable
+
+    QElapsedTimer loadTime;
+    loadTime.start();
+
+    MultiVehicleManager* vehicleMgr = qgcApp()->toolbox()->multiVehicleManager();
+    QVERIFY(vehicleMgr);
+
+    QSignalSpy spyVehicle(vehicleMgr, SIGNAL(activeVehicleAvailableChanged(bool)));
+    QSignalSpy spyParamsReady(vehicleMgr, SIGNAL(parameterReadyVehicleAvailableChanged(bool)));
+    QCOMPARE(spyVehicle.wait(10000), true);
+    Vehicle* vehicle = vehicleMgr->activeVehicle();
+    QVERIFY(vehicle);
+
+    if (spyParamsReady.count() == 0) {
+        QCOMPARE(spyParamsReady.wait(60000), true);
+    }
+
+    ParameterManager* paramMgr = vehicle->parameterManager();
+    QCOMPARE(paramMgr->missingParameters(), false);
+    for (int componentId: paramMgr->componentIds()) {
+        QCOMPARE(paramMgr->componentLoadProgress(componentId), 1.0);
+    }
+
+    qCDebug(ParameterManagerLog) << "Parameter load over 50ms/5% loss link took msecs:" << loadTime.elapsed();
+}
+
+/// Header of an ArduPilot packed parameter file
+static QByteArray _paramFileHeader(quint16 magic, quint16 numParams, quint16 totalParams)
+{
+    QByteArray  bytes(6, 0);
+    uchar*      data = reinterpret_cast<uchar*>(bytes.data());
+    qToLittleEndian<quint16>(magic,         data);
+    qToLittleEndian<quint16>(numParams,     data + 2);
+    qToLittleEndian<quint16>(totalParams,   data + 4);
+    return bytes;
+}
+
+/// Appends a packed parameter: type/flags, common_len/name_len, the new name chars and the value bytes
+static void _appendPackedParam(QByteArray& bytes, quint8 type, quint8 flags, int commonLen, const QByteArray& newChars, const QByteArray& value)
+{
+    bytes.append(static_cast<char>(type | (flags << 4)));
+    bytes.append(static_cast<char>(((newChars.size() - 1) << 4) | commonLen));
+    bytes.append(newChars);
+    bytes.append(value);
+}
+
+template<typename T>
+static QByteArray _littleEndian(T value)
+{
+    QByteArray bytes(sizeof(T), 0);
+    qToLittleEndian<T>(value, reinterpret_cast<uchar*>(bytes.data()));
+    return bytes;
+}
+
+static QByteArray _littleEndianFloat(float value)
+{
+    quint32 data32;
+    memcpy(&data32, &value, sizeof(data32));
+    return _littleEndian<quint32>(data32);
+}
+
+/// Decodes handcrafted @PARAM/param.pck files
+void ParameterManagerTest::_decodeParamFile(void)
+{
+    const quint16   magicStandard       = 0x671B;
+    const quint16   magicWithDefaults   = 0x671C;
+    const quint8    typeInt8            = 1;
+    const quint8    typeInt16           = 2;
+    const quint8    typeInt32           = 3;
+    const quint8    typeFloat           = 4;
+    QVector<ParameterCache::Param_t> params;
+
+    // Padding between and after entries, and names sharing a prefix with the one before
+    QByteArray bytes = _paramFileHeader(magicStandard, 4, 4);
+    _appendPackedParam(bytes, typeInt16, 0, 0, "ARMING_CHECK", _littleEndian<qint16>(-2));
+    bytes.append(3, 0);
+    _appendPackedParam(bytes, typeFloat, 0, 0, "BATT_AMP_PERVLT", _littleEndianFloat(17.5f));
+    _appendPackedParam(bytes, typeInt32, 0, 5, "CAPACITY", _littleEndian<qint32>(3300));
+    _appendPackedParam(bytes, typeInt8,  0, 5, "MONITOR", QByteArray(1, static_cast<char>(-4)));
+    bytes.append(2, 0);
+    QVERIFY(ParameterManager::_decodeParamFile(bytes, params));
+    QCOMPARE(params.count(), 4);
+    QCOMPARE(params[0].name, QStringLiteral("ARMING_CHECK"));
+    QCOMPARE(params[0].type, FactMetaData::valueTypeInt16);
+    QCOMPARE(params[0].value.toInt(), -2);
+    QCOMPARE(params[1].name, QStringLiteral("BATT_AMP_PERVLT"));
+    QCOMPARE(params[1].type, FactMetaData::valueTypeFloat);
+    QCOMPARE(params[1].value.toFloat(), 17.5f);
+    QCOMPARE(params[2].name, QStringLiteral("BATT_CAPACITY"));
+    QCOMPARE(params[2].type, FactMetaData::valueTypeInt32);
+    QCOMPARE(params[2].value.toInt(), 3300);
+    QCOMPARE(params[3].name, QStringLiteral("BATT_MONITOR"));
+    QCOMPARE(params[3].type, FactMetaData::valueTypeInt8);
+    QCOMPARE(params[3].value.toInt(), -4);
+    for (int i = 0; i < params.count(); i++) {
+        QCOMPARE(params[i].index, i);
+    }
+
+    // With defaults, entries flagged in bit 0 are followed by their default value which is skipped
+    bytes = _paramFileHeader(magicWithDefaults, 3, 3);
+    _appendPackedParam(bytes, typeInt32, 1, 0, "BATT_CAPACITY", _littleEndian<qint32>(5000) + _littleEndian<qint32>(3300));
+    _appendPackedParam(bytes, typeInt8,  1, 5, "MONITOR", QByteArray(1, 4) + QByteArray(1, 0));
+    _appendPackedParam(bytes, typeFloat, 0, 5, "SERIAL_NUM", _littleEndianFloat(-1.0f));
+    QVERIFY(ParameterManager::_decodeParamFile(bytes, params));
+    QCOMPARE(params.count(), 3);
+    QCOMPARE(params[0].name, QStringLiteral("BATT_CAPACITY"));
+    QCOMPARE(params[0].value.toInt(), 5000);
+    QCOMPARE(params[1].name, QStringLiteral("BATT_MONITOR"));
+    QCOMPARE(params[1].value.toInt(), 4);
+    QCOMPARE(params[2].name, QStringLiteral("BATT_SERIAL_NUM"));
+    QCOMPARE(params[2].value.toFloat(), -1.0f);
+
+    // Truncated value, and truncated default value
+    bytes = _paramFileHeader(magicStandard, 1, 1);
+    _appendPackedParam(bytes, typeFloat, 0, 0, "BATT_CAPACITY", _littleEndianFloat(1.0f).left(2));
+    QVERIFY(!ParameterManager::_decodeParamFile(bytes, params));
+    bytes = _paramFileHeader(magicWithDefaults, 1, 1);
+    _appendPackedParam(bytes, typeInt16, 1, 0, "BATT_CAPACITY", _littleEndian<qint16>(1) + QByteArray(1, 1));
+    QVERIFY(!ParameterManager::_decodeParamFile(bytes, params));
+
+    // More entries than num_params, and fewer
+    bytes = _paramFileHeader(magicStandard, 1, 1);
+    _appendPackedParam(bytes, typeInt8, 0, 0, "BATT_MONITOR", QByteArray(1, 4));
+    _appendPackedParam(bytes, typeInt8, 0, 5, "MONITOR2", QByteArray(1, 4));
+    QVERIFY(!ParameterManager::_decodeParamFile(bytes, params));
+    bytes = _paramFileHeader(magicStandard, 2, 2);
+    _appendPackedParam(bytes, typeInt8, 0, 0, "BATT_MONITOR", QByteArray(1, 4));
+    QVERIFY(!ParameterManager::_decodeParamFile(bytes, params));
+
+    // Bad magic, a partial parameter list and a shared prefix longer than the previous name
+    bytes = _paramFileHeader(0x671A, 1, 1);
+    _appendPackedParam(bytes, typeInt8, 0, 0, "BATT_MONITOR", QByteArray(1, 4));
+    QVERIFY(!ParameterManager::_decodeParamFile(bytes, params));
+    bytes = _paramFileHeader(magicStandard, 1, 2);
+    _appendPackedParam(bytes, typeInt8, 0, 0, "BATT_MONITOR", QByteArray(1, 4));
+    QVERIFY(!ParameterManager::_decodeParamFile(bytes, params));
+    bytes = _paramFileHeader(magicStandard, 2, 2);
+    _appendPackedParam(bytes, typeInt8, 0, 0, "ARMING", QByteArray(1, 1));
+    _appendPackedParam(bytes, typeInt8, 0, 7, "X", QByteArray(1, 1));
+    QVERIFY(!ParameterManager::_decodeParamFile(bytes, params));
+}
+
+/// Moves the index re-requests in flight back in time, as if msecs had gone by without a response
+void ParameterManagerTest::_ageIndexBatchQueue(ParameterManager* paramMgr, qint64 msecs)
+{
+    for (auto it = paramMgr->_indexBatchQueue.begin(); it != paramMgr->_indexBatchQueue.end(); ++it) {
+        it.value() -= msecs;
+    }
+}
+
+/// Steps the index re-request window through responses and losses without waiting on the clock
+void ParameterManagerTest::_indexBatchWindow(void)
+{
+    Q_ASSERT(!_mockLink);
+    _mockLink = MockLink::startPX4MockLink(false);
+
+    MultiVehicleManager* vehicleMgr = qgcApp()->toolbox()->multiVehicleManager();
+    QSignalSpy spyVehicle(vehicleMgr, SIGNAL(activeVehicleAvailableChanged(bool)));
+    QSignalSpy spyParamsReady(vehicleMgr, SIGNAL(parameterReadyVehicleAvailableChanged(bool)));
+    QCOMPARE(spyVehicle.wait(5000), true);
+    Vehicle* vehicle = vehicleMgr->activeVehicle();
+    QVERIFY(vehicle);
+    if (spyParamsReady.count() == 0) {
+        QCOMPARE(spyParamsReady.wait(10000), true);
+    }
+
+    // Start over from the state of a fresh load with twenty parameters missing
+    ParameterManager*   paramMgr    = vehicle->parameterManager();
+    const int           compId      = vehicle->defaultComponentId();
+    paramMgr->_indexBatchQueueActive        = true;
+    paramMgr->_indexBatchQueue.clear();
+    paramMgr->_indexBatchWindow             = ParameterManager::_initialIndexBatchWindow;
+    paramMgr->_indexBatchSlowStartWindow    = ParameterManager::_maxIndexBatchWindow;
+    paramMgr->_indexBatchSrtt               = 0;
+    paramMgr->_indexBatchRttVar             = 0;
+    paramMgr->_indexBatchLastDecrease       = -1;
+    paramMgr->_indexBatchBackoff            = 1;
+    for (int paramIndex = 0; paramIndex < 20; paramIndex++) {
+        paramMgr->_waitingReadParamIndexMap[compId][paramIndex] = 0;
+    }
+    const int maxTimeout = ParameterManager::_maxIndexBatchTimeoutMsecs;
+
+    // Without a round trip sample the timeout is the longest allowed
+    QCOMPARE(paramMgr->_indexBatchTimeoutMsecs(), maxTimeout);
+    QVERIFY(paramMgr->_fillIndexBatchQueue(false));
+    QCOMPARE(paramMgr->_indexBatchQueue.count(), 10);
+
+    // Responses to first requests give round trip samples and grow the window by one each
+    _ageIndexBatchQueue(paramMgr, 200);
+    for (int paramIndex = 0; paramIndex < 2; paramIndex++) {
+        paramMgr->_indexBatchResponse(compId, paramIndex);
+        paramMgr->_waitingReadParamIndexMap[compId].remove(paramIndex);
+    }
+    QVERIFY(paramMgr->_indexBatchSrtt >= 200 && paramMgr->_indexBatchSrtt < 250);
+    QVERIFY(paramMgr->_indexBatchRttVar >= 75 && paramMgr->_indexBatchRttVar < 125);
+    QCOMPARE(paramMgr->_indexBatchWindow, 12.0);
+    QCOMPARE(paramMgr->_indexBatchQueue.count(), 8);
+    const int rto = paramMgr->_indexBatchTimeoutMsecs();
+    QVERIFY(rto < maxTimeout / 4);
+
+    // A loss halves the window, ends slow start and doubles the timeout
+    _ageIndexBatchQueue(paramMgr, 1000);
+    QVERIFY(paramMgr->_fillIndexBatchQueue(true));
+    QCOMPARE(paramMgr->_indexBatchWindow, 6.0);
+    QCOMPARE(paramMgr->_indexBatchSlowStartWindow, 6.0);
+    QCOMPARE(paramMgr->_indexBatchBackoff, 2);
+    QCOMPARE(paramMgr->_indexBatchQueue.count(), 6);
+    QVERIFY(qAbs(paramMgr->_indexBatchTimeoutMsecs() - (2 * rto)) <= 1);
+
+    // More losses within the same round trip leave the window alone, the timeout still backs off
+    _ageIndexBatchQueue(paramMgr, 2 * maxTimeout / 3);
+    QVERIFY(paramMgr->_fillIndexBatchQueue(true));
+    QCOMPARE(paramMgr->_indexBatchWindow, 6.0);
+    QCOMPARE(paramMgr->_indexBatchBackoff, 4);
+    QCOMPARE(paramMgr->_indexBatchQueue.count(), 6);
+
+    // A round trip later the window halves again
+    _ageIndexBatchQueue(paramMgr, maxTimeout);
+    paramMgr->_indexBatchLastDecrease -= 300;
+    QVERIFY(paramMgr->_fillIndexBatchQueue(true));
+    QCOMPARE(paramMgr->_indexBatchWindow, 3.0);
+    QCOMPARE(paramMgr->_indexBatchBackoff, 8);
+    QCOMPARE(paramMgr->_indexBatchQueue.count(), 3);
+    QCOMPARE(paramMgr->_indexBatchTimeoutMsecs(), maxTimeout);
+
+    // The window bottoms out and the backoff stops once the timeout is at its maximum
+    _ageIndexBatchQueue(paramMgr, maxTimeout);
+    paramMgr->_indexBatchLastDecrease -= 300;
+    QVERIFY(paramMgr->_fillIndexBatchQueue(true));
+    QCOMPARE(paramMgr->_indexBatchWindow, static_cast<double>(ParameterManager::_minIndexBatchWindow));
+    QCOMPARE(paramMgr->_indexBatchBackoff, 8);
+    QCOMPARE(paramMgr->_indexBatchQueue.count(), 2);
+
+    // A response to a resent request can't be timed, it opens the window by congestion avoidance only
+    const double srtt = paramMgr->_indexBatchSrtt;
+    QCOMPARE(paramMgr->_waitingReadParamIndexMap[compId][2], 5);
+    paramMgr->_indexBatchResponse(compId, 2);
+    QCOMPARE(paramMgr->_indexBatchSrtt, srtt);
+    QCOMPARE(paramMgr->_indexBatchBackoff, 8);
+    QCOMPARE(paramMgr->_indexBatchWindow, 2.5);
+
+    // The resent requests all come in, a fresh sample from the next one resets the backoff
+    paramMgr->_indexBatchQueue.clear();
+    for (int paramIndex = 2; paramIndex < 10; paramIndex++) {
+        paramMgr->_waitingReadParamIndexMap[compId].remove(paramIndex);
+    }
+    QVERIFY(paramMgr->_fillIndexBatchQueue(false));
+    QCOMPARE(paramMgr->_indexBatchQueue.count(), 2);
+    QCOMPARE(paramMgr->_waitingReadParamIndexMap[compId][10], 1);
+    _ageIndexBatchQueue(paramMgr, 100);
+    paramMgr->_indexBatchResponse(compId, 10);
+    QCOMPARE(paramMgr->_indexBatchBackoff, 1);
+    QVERIFY(paramMgr->_indexBatchSrtt < srtt);
+    QVERIFY(paramMgr->_indexBatchTimeoutMsecs() < maxTimeout);
+
+    paramMgr->_indexBatchQueue.clear();
+    paramMgr->_indexBatchTimer.stop();
+    paramMgr->_waitingReadParamIndexMap[compId].clear();
+}
+
+void ParameterManagerTest::_cacheUpdate(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    const QString fileName = tempDir.filePath("ParameterManagerTest.v3");
+
+    QVector<ParameterCache::Param_t> params = {
+        { 0, "BAT_N_CELLS",     FactMetaData::valueTypeInt32, QVariant(3) },
+        { 1, "MPC_XY_VEL_MAX",  FactMetaData::valueTypeFloat, QVariant(12.0f) },
+    };
+    QVERIFY(ParameterCache(fileName).write(params, params.count(), 1234));
+
+    ParameterCache cache(fileName);
+    quint32 hash = 0;
+    QVERIFY(cache.hash(hash));
+    QCOMPARE(hash, 1234u);
+
+    // Single parameter updates are written in place and leave the hash to be recomputed
+    QVERIFY(cache.update({ 1, "MPC_XY_VEL_MAX", FactMetaData::valueTypeFloat, QVariant(8.0f) }));
+    QVERIFY(!cache.update({ 2, "MPC_Z_VEL_MAX_UP", FactMetaData::valueTypeFloat, QVariant(3.0f) }));
+    QVERIFY(!cache.hash(hash));
+
+    QVector<ParameterCache::Param_t> loaded;
+    QVERIFY(cache.load(loaded));
+    QCOMPARE(loaded.count(), 2);
+    QCOMPARE(loaded[0].name, QStringLiteral("BAT_N_CELLS"));
+    QCOMPARE(loaded[0].value.toInt(), 3);
+    QCOMPARE(loaded[1].value.toFloat(), 8.0f);
+
+    // A corrupt entry invalidates the whole cache
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadWrite));
+    QVERIFY(file.seek(file.size() - 1));
+    QCOMPARE(file.write("x", 1), 1LL);
+    file.close();
+    QVERIFY(!ParameterCache(fileName).load(loaded));
+}
+
 void ParameterManagerTest::_FTPChangeParam()
 {
     Q_ASSERT(!_mockLink);
@@ -16,6 +16,8 @@
 #include "MultiSignalSpy.h"
 #include "MockLink.h"
 
+class ParameterManager;
+
 class ParameterManagerTest : public UnitTest
 {
     Q_OBJECT
@@ -27,10 +29,15 @@ private slots:
     void _requestListMissingParamFail(void);
     void _FTPnoFailure(void);
     void _FTPChangeParam(void);
+    void _lossyLinkBenchmark(void);
+    void _indexBatchWindow(void);
+    void _cacheUpdate(void);
+    void _decodeParamFile(void);
 
 
 private:
     void _noFailureWorker(MockConfiguration::FailureMode_t failureMode);
+    void _ageIndexBatchQueue(ParameterManager* paramMgr, qint64 msecs);
 };
 
 #endif
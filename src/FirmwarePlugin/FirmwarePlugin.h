@@ -280,6 +280,11 @@ public:
     /// Return the resource file which contains the set of params loaded for offline editing.
     virtual QString offlineEditingParamFile(Vehicle* /*vehicle*/) { return QString(); }
 
+    /// Return the MAVLink FTP path of a packed parameter file (ArduPilot @PARAM/param.pck format) served by the autopilot.
+    /// The initial parameter load burst downloads and decodes this file instead of streaming the parameters with
+    /// PARAM_REQUEST_LIST, falling back to streaming if the vehicle doesn't have it. Empty to always stream.
+    virtual QString ftpParameterFile(Vehicle* /*vehicle*/) { return QString(); }
+
     /// Return the resource file which contains the brand image for the vehicle for Indoor theme.
     virtual QString brandImageIndoor(const Vehicle* /*vehicle*/) const { return QString(); }
 
@@ -261,10 +261,15 @@ FlightMap {
         z:          QGroundControl.zOrderTrajectoryLines
         visible:    !pipMode
 
+        // Full path is only loaded when needed, simplified for the current zoom. New points are appended incrementally.
+        function reloadPath() {
+            trajectoryPolyline.path = _activeVehicle ? _activeVehicle.trajectoryPoints.list(Math.floor(_root.zoomLevel)) : []
+        }
+
         Connections {
             target:                 QGroundControl.multiVehicleManager
             function onActiveVehicleChanged(activeVehicle) {
-                trajectoryPolyline.path = _activeVehicle ? _activeVehicle.trajectoryPoints.list() : []
+                trajectoryPolyline.reloadPath()
             }
         }
 
@@ -273,6 +278,19 @@ FlightMap {
             onPointAdded:           trajectoryPolyline.addCoordinate(coordinate)
             onUpdateLastPoint:      trajectoryPolyline.replaceCoordinate(trajectoryPolyline.pathLength() - 1, coordinate)
             onPointsCleared:        trajectoryPolyline.path = []
+            onPointsDecimated:      trajectoryPolyline.reloadPath()
+        }
+
+        Connections {
+            target:                 _root
+            onZoomLevelChanged:     trajectoryReloadTimer.restart()
+        }
+
+        // Wait for zooming to settle before switching level of detail
+        Timer {
+            id:                     trajectoryReloadTimer
+            interval:               500
+            onTriggered:            trajectoryPolyline.reloadPath()
         }
     }
 
@@ -32,6 +32,7 @@
 #include "QGCCorePlugin.h"
 #include "TakeoffMissionItem.h"
 #include "PlanViewSettings.h"
+#include "TerrainQuery.h"
 
 #define UPDATE_TIMEOUT 5000 ///< How often we check for bounding box changes
 
@@ -2617,6 +2618,10 @@ void MissionController::_updateTimeout()
         _travelBoundingCube = boundingCube;
         emit missionBoundingCubeChanged();
         qCDebug(MissionControllerLog) << "Bounding cube:" << _travelBoundingCube.pointNW << _travelBoundingCube.pointSE;
+        if (_travelBoundingCube.isValid()) {
+            // Pull the terrain under the plan onto disk so terrain checks keep working offline
+            TerrainAtCoordinateQuery::prefetchArea(QGeoRectangle(_travelBoundingCube.pointNW, _travelBoundingCube.pointSE));
+        }
     }
 }
 
@@ -70,9 +70,17 @@ Rectangle {
                 ListElement { text: "2x";   value: 2 }
                 ListElement { text: "5x";   value: 5 }
                 ListElement { text: "10x";  value: 10 }
+                ListElement { text: "Max";  value: 0 }
             }
 
-            onActivated: controller.playbackSpeed = model.get(currentIndex).value
+            onActivated: {
+                // Max replays as fast as the log can be decoded, with no real time pacing
+                var value = model.get(currentIndex).value
+                controller.fastReplay = value === 0
+                if (value !== 0) {
+                    controller.playbackSpeed = value
+                }
+            }
         }
 
         QGCLabel { text: controller.playheadTime }
@@ -165,6 +165,7 @@ QGCMapEngine::init()
     } else {
         qCritical() << "Could not find suitable map cache directory.";
     }
+    _memoryCache.setMaxBytes(tileMemCacheBytes(getMaxMemCache()));
     QGCMapTask* task = new QGCMapTask(QGCMapTask::taskInit);
     _worker.enqueueTask(task);
 }
@@ -195,6 +196,9 @@ QGCMapEngine::_wipeDirectory(const QString& dirPath)
 void
 QGCMapEngine::addTask(QGCMapTask* task)
 {
+    if(task->type() == QGCMapTask::taskReset) {
+        _memoryCache.clear();
+    }
     _worker.enqueueTask(task);
 }
 
@@ -308,6 +312,23 @@ QGCMapEngine::setMaxMemCache(quint32 size)
     QSettings settings;
     settings.setValue(kMaxMemCacheKey, size);
     _maxMemCache = size;
+    _memoryCache.setMaxBytes(tileMemCacheBytes(size));
+}
+
+//-----------------------------------------------------------------------------
+quint64
+QGCMapEngine::qtMemCacheBytes(quint32 sizeMB)
+{
+    //-- Qt's cache answers first and is what the map renders from. It gets half the
+    //   budget, the rest keeps tiles Qt evicted out of the database round trip.
+    return static_cast<quint64>(sizeMB) * 1024 * 1024 / 2;
+}
+
+//-----------------------------------------------------------------------------
+quint64
+QGCMapEngine::tileMemCacheBytes(quint32 sizeMB)
+{
+    return static_cast<quint64>(sizeMB) * 1024 * 1024 - qtMemCacheBytes(sizeMB);
 }
 
 //-----------------------------------------------------------------------------
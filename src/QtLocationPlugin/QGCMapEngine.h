@@ -24,6 +24,7 @@
 #include "QGCMapUrlEngine.h"
 #include "QGCMapEngineData.h"
 #include "QGCTileCacheWorker.h"
+#include "QGCMemoryTileCache.h"
 
 
 //-----------------------------------------------------------------------------
@@ -47,6 +48,10 @@ public:
     void                        setMaxDiskCache     (quint32 size);
     quint32                     getMaxMemCache      ();
     void                        setMaxMemCache      (quint32 size);
+    /// getMaxMemCache() is one budget shared by Qt's QGeoFileTileCache and our QGCMemoryTileCache.
+    /// These return each side's share in bytes.
+    static quint64              qtMemCacheBytes     (quint32 sizeMB);
+    static quint64              tileMemCacheBytes   (quint32 sizeMB);
     const QString               getCachePath        () { return _cachePath; }
     const QString               getCacheFilename    () { return _cacheFile; }
     void                        testInternet        ();
@@ -54,6 +59,7 @@ public:
     bool                        isInternetActive    () const{ return _isInternetActive; }
 
     UrlFactory*                 urlFactory          () { return _urlFactory; }
+    QGCMemoryTileCache*         memoryCache         () { return &_memoryCache; }
 
     //-- Tile Math
     static QGCTileSet           getTileCount        (int zoom, double topleftLon, double topleftLat, double bottomRightLon, double bottomRightLat, const QString& mapType);
@@ -80,6 +86,7 @@ private:
 
 private:
     QGCCacheWorker          _worker;
+    QGCMemoryTileCache      _memoryCache;
     QString                 _cachePath;
     QString                 _cacheFile;
     UrlFactory*             _urlFactory;
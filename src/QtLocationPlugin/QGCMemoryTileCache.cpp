@@ -0,0 +1,123 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief In memory map tile cache
+ *
+ */
+
+#include "QGCMemoryTileCache.h"
+
+#include <QMutexLocker>
+
+//-----------------------------------------------------------------------------
+QGCMemoryTileCache::QGCMemoryTileCache()
+    : _hits(0)
+    , _misses(0)
+    , _evictions(0)
+{
+    //-- Disabled until a size is set
+    setMaxBytes(0);
+}
+
+//-----------------------------------------------------------------------------
+QGCMemoryTileCache::Shard&
+QGCMemoryTileCache::_shard(const TileKey& key)
+{
+    //-- Use the high bits, QHash inside the shard uses the low ones
+    return _shards[(qHash(key) >> 24) % kShards];
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCMemoryTileCache::find(int mapId, int x, int y, int z, QByteArray& image, QString& format)
+{
+    TileKey key = { mapId, x, y, z };
+    Shard& shard = _shard(key);
+    QMutexLocker lock(&shard.mutex);
+    //-- QCache::object() also moves the entry to the front of the LRU
+    TileEntry* entry = shard.tiles.object(key);
+    if(!entry) {
+        _misses++;
+        return false;
+    }
+    image   = entry->image;
+    format  = entry->format;
+    _hits++;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCMemoryTileCache::insert(int mapId, int x, int y, int z, const QByteArray& image, const QString& format)
+{
+    TileKey key = { mapId, x, y, z };
+    Shard& shard = _shard(key);
+    QMutexLocker lock(&shard.mutex);
+    if(shard.tiles.maxCost() == 0) {
+        return;
+    }
+    int  before    = shard.tiles.count();
+    bool replacing = shard.tiles.contains(key);
+    //-- Cost is the size in bytes. The cache takes ownership of the entry.
+    bool inserted  = shard.tiles.insert(key, new TileEntry{ image, format }, image.size());
+    int  evicted   = before - (replacing ? 1 : 0) + (inserted ? 1 : 0) - shard.tiles.count();
+    if(evicted > 0) {
+        _evictions += static_cast<quint64>(evicted);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCMemoryTileCache::clear()
+{
+    for(Shard& shard: _shards) {
+        QMutexLocker lock(&shard.mutex);
+        shard.tiles.clear();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCMemoryTileCache::setMaxBytes(quint64 maxBytes)
+{
+    int shardBytes = static_cast<int>(qMin<quint64>(maxBytes / kShards, INT_MAX));
+    for(Shard& shard: _shards) {
+        QMutexLocker lock(&shard.mutex);
+        int before = shard.tiles.count();
+        shard.tiles.setMaxCost(shardBytes);
+        _evictions += static_cast<quint64>(before - shard.tiles.count());
+    }
+}
+
+//-----------------------------------------------------------------------------
+quint64
+QGCMemoryTileCache::bytes()
+{
+    quint64 total = 0;
+    for(Shard& shard: _shards) {
+        QMutexLocker lock(&shard.mutex);
+        total += static_cast<quint64>(shard.tiles.totalCost());
+    }
+    return total;
+}
+
+//-----------------------------------------------------------------------------
+int
+QGCMemoryTileCache::count()
+{
+    int total = 0;
+    for(Shard& shard: _shards) {
+        QMutexLocker lock(&shard.mutex);
+        total += shard.tiles.count();
+    }
+    return total;
+}
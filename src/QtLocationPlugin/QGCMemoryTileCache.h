@@ -0,0 +1,83 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief In memory map tile cache
+ *
+ */
+
+#ifndef QGC_MEMORY_TILE_CACHE_H
+#define QGC_MEMORY_TILE_CACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+
+//-----------------------------------------------------------------------------
+/// Size bounded LRU of tile image data sitting in front of the cache database.
+/// Revisited tiles are served from here without a round trip through the
+/// worker threads. The cache is split into independently locked shards so
+/// concurrent lookups rarely contend.
+class QGCMemoryTileCache
+{
+public:
+    QGCMemoryTileCache      ();
+
+    bool    find            (int mapId, int x, int y, int z, QByteArray& image, QString& format);
+    void    insert          (int mapId, int x, int y, int z, const QByteArray& image, const QString& format);
+    void    clear           ();
+
+    /// Sets the total size of the cache in bytes, evicting as needed
+    void    setMaxBytes     (quint64 maxBytes);
+
+    quint64 hits            () const { return _hits; }
+    quint64 misses          () const { return _misses; }
+    quint64 evictions       () const { return _evictions; }
+    quint64 bytes           ();
+    int     count           ();
+
+    static const int kShards = 16;
+
+private:
+    friend class QGCMemoryTileCacheTest;
+
+    struct TileKey {
+        int mapId;
+        int x;
+        int y;
+        int z;
+        bool operator==(const TileKey& other) const { return mapId == other.mapId && x == other.x && y == other.y && z == other.z; }
+        friend uint qHash(const TileKey& key, uint seed = 0) { return qHashBits(&key, sizeof(key), seed); }
+    };
+
+    struct TileEntry {
+        QByteArray  image;
+        QString     format;
+    };
+
+    struct Shard {
+        QMutex                      mutex;
+        QCache<TileKey, TileEntry>  tiles;
+    };
+
+    Shard&  _shard          (const TileKey& key);
+
+    Shard                   _shards[kShards];
+    std::atomic<quint64>    _hits;
+    std::atomic<quint64>    _misses;
+    std::atomic<quint64>    _evictions;
+};
+
+#endif // QGC_MEMORY_TILE_CACHE_H
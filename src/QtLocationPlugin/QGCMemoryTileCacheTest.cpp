@@ -0,0 +1,111 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "QGCMemoryTileCacheTest.h"
+#include "QGCMemoryTileCache.h"
+
+static const QString kFormat = QStringLiteral("png");
+
+void QGCMemoryTileCacheTest::_byteAccountingTest(void)
+{
+    QGCMemoryTileCache cache;
+    QByteArray  image;
+    QString     format;
+
+    // Nothing is kept until a budget is set
+    cache.insert(1, 0, 0, 10, QByteArray(100, 'a'), kFormat);
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.bytes(), 0ull);
+
+    // Ten 100 byte tiles fit even if they all land in one 1000 byte shard
+    cache.setMaxBytes(QGCMemoryTileCache::kShards * 1000);
+    for (int i = 0; i < 10; i++) {
+        cache.insert(1, i, 0, 10, QByteArray(100, static_cast<char>('a' + i)), kFormat);
+    }
+    QCOMPARE(cache.count(), 10);
+    QCOMPARE(cache.bytes(), 1000ull);
+    QCOMPARE(cache.evictions(), 0ull);
+
+    // Replacing a tile charges the new size only
+    cache.insert(1, 3, 0, 10, QByteArray(50, 'z'), QStringLiteral("jpg"));
+    QCOMPARE(cache.count(), 10);
+    QCOMPARE(cache.bytes(), 950ull);
+    QCOMPARE(cache.evictions(), 0ull);
+
+    QVERIFY(cache.find(1, 3, 0, 10, image, format));
+    QCOMPARE(image, QByteArray(50, 'z'));
+    QCOMPARE(format, QStringLiteral("jpg"));
+    QVERIFY(cache.find(1, 4, 0, 10, image, format));
+    QCOMPARE(image, QByteArray(100, 'e'));
+    // Map id and zoom are part of the key
+    QVERIFY(!cache.find(2, 4, 0, 10, image, format));
+    QVERIFY(!cache.find(1, 4, 0, 11, image, format));
+    QCOMPARE(cache.hits(), 2ull);
+    QCOMPARE(cache.misses(), 2ull);
+
+    // A tile larger than a whole shard is refused rather than emptying the shard
+    cache.insert(1, 99, 0, 10, QByteArray(1001, 'x'), kFormat);
+    QVERIFY(!cache.find(1, 99, 0, 10, image, format));
+    QCOMPARE(cache.count(), 10);
+    QCOMPARE(cache.bytes(), 950ull);
+
+    cache.clear();
+    QCOMPARE(cache.count(), 0);
+    QCOMPARE(cache.bytes(), 0ull);
+}
+
+void QGCMemoryTileCacheTest::_lruEvictionTest(void)
+{
+    QGCMemoryTileCache cache;
+    cache.setMaxBytes(QGCMemoryTileCache::kShards * 300);
+
+    // Find four tiles which share a shard so the LRU order within it is observable
+    const QGCMemoryTileCache::TileKey first = { 1, 0, 0, 12 };
+    QGCMemoryTileCache::Shard* shard = &cache._shard(first);
+    QList<QGCMemoryTileCache::TileKey> keys = { first };
+    for (int x = 1; keys.count() < 4 && x < 100000; x++) {
+        QGCMemoryTileCache::TileKey key = { 1, x, 0, 12 };
+        if (&cache._shard(key) == shard) {
+            keys.append(key);
+        }
+    }
+    QCOMPARE(keys.count(), 4);
+
+    QByteArray  image;
+    QString     format;
+    for (int i = 0; i < 3; i++) {
+        cache.insert(keys[i].mapId, keys[i].x, keys[i].y, keys[i].z, QByteArray(100, 'a'), kFormat);
+    }
+    QCOMPARE(cache.bytes(), 300ull);
+
+    // Touch the oldest, the next oldest is then the one to go
+    QVERIFY(cache.find(keys[0].mapId, keys[0].x, keys[0].y, keys[0].z, image, format));
+    cache.insert(keys[3].mapId, keys[3].x, keys[3].y, keys[3].z, QByteArray(100, 'a'), kFormat);
+    QCOMPARE(cache.evictions(), 1ull);
+    QCOMPARE(cache.count(), 3);
+    QCOMPARE(cache.bytes(), 300ull);
+    QVERIFY(!cache.find(keys[1].mapId, keys[1].x, keys[1].y, keys[1].z, image, format));
+    QVERIFY(cache.find(keys[0].mapId, keys[0].x, keys[0].y, keys[0].z, image, format));
+    QVERIFY(cache.find(keys[2].mapId, keys[2].x, keys[2].y, keys[2].z, image, format));
+    QVERIFY(cache.find(keys[3].mapId, keys[3].x, keys[3].y, keys[3].z, image, format));
+
+    // A 200 byte tile needs two slots, both least recently used tiles go
+    cache.insert(keys[1].mapId, keys[1].x, keys[1].y, keys[1].z, QByteArray(200, 'b'), kFormat);
+    QCOMPARE(cache.evictions(), 3ull);
+    QCOMPARE(cache.count(), 2);
+    QCOMPARE(cache.bytes(), 300ull);
+    QVERIFY(cache.find(keys[3].mapId, keys[3].x, keys[3].y, keys[3].z, image, format));
+
+    // Shrinking the budget evicts down to it and is counted
+    cache.setMaxBytes(QGCMemoryTileCache::kShards * 100);
+    QCOMPARE(cache.evictions(), 4ull);
+    QCOMPARE(cache.count(), 1);
+    QCOMPARE(cache.bytes(), 100ull);
+    QVERIFY(cache.find(keys[3].mapId, keys[3].x, keys[3].y, keys[3].z, image, format));
+}
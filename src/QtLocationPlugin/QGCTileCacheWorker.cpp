@@ -33,6 +33,8 @@
 static const char*      kDefaultSet     = "Default Tile Set";
 static const QString    kSession        = QStringLiteral("QGeoTileWorkerSession");
 static const QString    kExportSession  = QStringLiteral("QGeoTileExportSession");
+static const QString    kReadSession    = QStringLiteral("QGeoTileReadSession%1");
+static const char*      kGetTileQuery   = "SELECT tile, format, type FROM Tiles WHERE hash = ?";
 
 QGC_LOGGING_CATEGORY(QGCTileCacheLog, "QGCTileCacheLog")
 
@@ -54,12 +56,20 @@ QGCCacheWorker::QGCCacheWorker()
     , _lastUpdate(0)
     , _updateTimeout(SHORT_TIMEOUT)
     , _hostLookupID(0)
+    , _readersRunning(false)
+    , _readersStop(false)
+    , _readersSuspended(false)
 {
+    for(int i = 0; i < kReadConnections; i++) {
+        _readers.append(new QGCCacheReader(this, i));
+    }
 }
 
 //-----------------------------------------------------------------------------
 QGCCacheWorker::~QGCCacheWorker()
 {
+    _stopReaders();
+    qDeleteAll(_readers);
 }
 
 //-----------------------------------------------------------------------------
@@ -77,14 +87,24 @@ QGCCacheWorker::quit()
         QHostInfo::abortHostLookup(_hostLookupID);
     }
     QMutexLocker lock(&_taskQueueMutex);
+    //-- Fail pending tasks through their error path so nobody waits on them forever
     while(_taskQueue.count()) {
         QGCMapTask* task = _taskQueue.dequeue();
-        delete task;
+        task->setError("Cache Worker Stopped");
+        task->deleteLater();
     }
     lock.unlock(); // don't need the lock any more
     if(this->isRunning()) {
         _waitc.wakeAll();
     }
+    QMutexLocker readLock(&_readQueueMutex);
+    while(_readQueue.count()) {
+        QGCMapTask* task = _readQueue.dequeue();
+        task->setError("Cache Worker Stopped");
+        task->deleteLater();
+    }
+    readLock.unlock();
+    _stopReaders();
 }
 
 //-----------------------------------------------------------------------------
@@ -97,6 +117,14 @@ QGCCacheWorker::enqueueTask(QGCMapTask* task)
         task->deleteLater();
         return false;
     }
+    //-- Tile fetches go to the read connection pool
+    if(task->type() == QGCMapTask::taskFetchTile) {
+        QMutexLocker readLock(&_readQueueMutex);
+        _readQueue.enqueue(task);
+        _startReaders();
+        _readWaitc.wakeOne();
+        return true;
+    }
     QMutexLocker lock(&_taskQueueMutex);
     _taskQueue.enqueue(task);
     lock.unlock(); // don't need to hold the mutex any more
@@ -117,19 +145,32 @@ QGCCacheWorker::run()
     }
     if(_valid) {
         _connectDB();
+        _prepareQueries();
     }
     _deleteBingNoTileTiles();
     QMutexLocker lock(&_taskQueueMutex);
     while(true) {
-        QGCMapTask* task;
         if(_taskQueue.count()) {
-            task = _taskQueue.dequeue();
+            QList<QGCMapTask*> tasks;
+            tasks.append(_taskQueue.dequeue());
+            //-- Coalesce queued tile saves so they go to disk in a single transaction
+            if(tasks.first()->type() == QGCMapTask::taskCacheTile) {
+                while(tasks.count() < kMaxSaveBatch && _taskQueue.count() && _taskQueue.head()->type() == QGCMapTask::taskCacheTile) {
+                    tasks.append(_taskQueue.dequeue());
+                }
+            }
 
             // Don't need the lock while running the task.
             lock.unlock();
-            _runTask(task);
+            if(tasks.first()->type() == QGCMapTask::taskCacheTile) {
+                _saveTiles(tasks);
+            } else {
+                _runTask(tasks.first());
+            }
             lock.relock();
-            task->deleteLater();
+            for(QGCMapTask* task: tasks) {
+                task->deleteLater();
+            }
             //-- Check for update timeout
             size_t count = static_cast<size_t>(_taskQueue.count());
             if(count > 100) {
@@ -171,8 +212,13 @@ QGCCacheWorker::_runTask(QGCMapTask *task)
             _saveTile(task);
             return;
         case QGCMapTask::taskFetchTile:
-            _getTile(task);
+        {
+            //-- Normally serviced by the readers
+            QSqlQuery query(*_db);
+            query.prepare(kGetTileQuery);
+            _getTile(query, task);
             return;
+        }
         case QGCMapTask::taskFetchTileSets:
             _getTileSets(task);
             return;
@@ -284,14 +330,28 @@ QGCCacheWorker::_getDefaultTileSet()
     return 1L;
 }
 
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_saveTiles(const QList<QGCMapTask*>& tasks)
+{
+    //-- One transaction (and one sync of the WAL) per batch instead of per tile
+    bool transaction = _valid && tasks.count() > 1 && _db->transaction();
+    for(QGCMapTask* task: tasks) {
+        _saveTile(task);
+    }
+    if(transaction && !_db->commit()) {
+        qWarning() << "Map Cache SQL error (commit saved tiles):" << _db->lastError().text();
+        _db->rollback();
+    }
+}
+
 //-----------------------------------------------------------------------------
 void
 QGCCacheWorker::_saveTile(QGCMapTask *mtask)
 {
-    if(_valid) {
+    if(_valid && _saveTileQuery) {
         QGCSaveTileTask* task = static_cast<QGCSaveTileTask*>(mtask);
-        QSqlQuery query(*_db);
-        query.prepare("INSERT INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)");
+        QSqlQuery& query = *_saveTileQuery;
         query.addBindValue(task->tile()->hash());
         query.addBindValue(task->tile()->format());
         query.addBindValue(task->tile()->img());
@@ -301,10 +361,10 @@ QGCCacheWorker::_saveTile(QGCMapTask *mtask)
         if(query.exec()) {
             quint64 tileID = query.lastInsertId().toULongLong();
             quint64 setID = task->tile()->set() == UINT64_MAX ? _getDefaultTileSet() : task->tile()->set();
-            QString s = QString("INSERT INTO SetTiles(tileID, setID) VALUES(%1, %2)").arg(tileID).arg(setID);
-            query.prepare(s);
-            if(!query.exec()) {
-                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << query.lastError().text();
+            _saveSetTileQuery->addBindValue(tileID);
+            _saveSetTileQuery->addBindValue(setID);
+            if(!_saveSetTileQuery->exec()) {
+                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << _saveSetTileQuery->lastError().text();
             }
             qCDebug(QGCTileCacheLog) << "_saveTile() HASH:" << task->tile()->hash();
         } else {
@@ -318,16 +378,15 @@ QGCCacheWorker::_saveTile(QGCMapTask *mtask)
 
 //-----------------------------------------------------------------------------
 void
-QGCCacheWorker::_getTile(QGCMapTask* mtask)
+QGCCacheWorker::_getTile(QSqlQuery& query, QGCMapTask* mtask)
 {
     if(!_testTask(mtask)) {
         return;
     }
     bool found = false;
     QGCFetchTileTask* task = static_cast<QGCFetchTileTask*>(mtask);
-    QSqlQuery query(*_db);
-    QString s = QString("SELECT tile, format, type FROM Tiles WHERE hash = \"%1\"").arg(task->hash());
-    if(query.exec(s)) {
+    query.addBindValue(task->hash());
+    if(query.exec()) {
         if(query.next()) {
             const QByteArray& arrray   = query.value(0).toByteArray();
             const QString& format  = query.value(1).toString();
@@ -337,6 +396,8 @@ QGCCacheWorker::_getTile(QGCMapTask* mtask)
             task->setTileFetched(tile);
             found = true;
         }
+        //-- Release the read snapshot so the WAL can be checkpointed
+        query.finish();
     }
     if(!found) {
         qCDebug(QGCTileCacheLog) << "_getTile() (NOT in DB) HASH:" << task->hash();
@@ -416,7 +477,7 @@ QGCCacheWorker::_updateSetTotals(QGCCachedTileSet* set)
             //-- Now figure out the count for tiles unique to this set
             quint32 ucount = 0;
             quint64 usize  = 0;
-            sq = QString("SELECT COUNT(size), SUM(size) FROM Tiles WHERE tileID IN (SELECT A.tileID FROM SetTiles A join SetTiles B on A.tileID = B.tileID WHERE B.setID = %1 GROUP by A.tileID HAVING COUNT(A.tileID) = 1)").arg(set->id());
+            sq = QString("SELECT COUNT(A.size), SUM(A.size) FROM SetTiles B INNER JOIN Tiles A ON A.tileID = B.tileID WHERE B.setID = %1 AND A.setCount = 1").arg(set->id());
             if(subquery.exec(sq)) {
                 if(subquery.next()) {
                     //-- This is only accurate when all tiles are downloaded
@@ -451,7 +512,7 @@ QGCCacheWorker::_updateTotals()
             _totalSize  = query.value(1).toULongLong();
         }
     }
-    s = QString("SELECT COUNT(size), SUM(size) FROM Tiles WHERE tileID IN (SELECT A.tileID FROM SetTiles A join SetTiles B on A.tileID = B.tileID WHERE B.setID = %1 GROUP by A.tileID HAVING COUNT(A.tileID) = 1)").arg(_getDefaultTileSet());
+    s = QString("SELECT COUNT(A.size), SUM(A.size) FROM SetTiles B INNER JOIN Tiles A ON A.tileID = B.tileID WHERE B.setID = %1 AND A.setCount = 1").arg(_getDefaultTileSet());
     qCDebug(QGCTileCacheLog) << "_updateTotals(): " << s;
     if(query.exec(s)) {
         if(query.next()) {
@@ -467,11 +528,13 @@ QGCCacheWorker::_updateTotals()
 quint64 QGCCacheWorker::_findTile(const QString hash)
 {
     quint64 tileID = 0;
-    QSqlQuery query(*_db);
-    QString s = QString("SELECT tileID FROM Tiles WHERE hash = \"%1\"").arg(hash);
-    if(query.exec(s)) {
-        if(query.next()) {
-            tileID = query.value(0).toULongLong();
+    if(_findTileQuery) {
+        _findTileQuery->addBindValue(hash);
+        if(_findTileQuery->exec()) {
+            if(_findTileQuery->next()) {
+                tileID = _findTileQuery->value(0).toULongLong();
+            }
+            _findTileQuery->finish();
         }
     }
     return tileID;
@@ -507,6 +570,8 @@ QGCCacheWorker::_createTileSet(QGCMapTask *mtask)
             quint64 setID = query.lastInsertId().toULongLong();
             task->tileSet()->setId(setID);
             //-- Prepare Download List
+            QSqlQuery downloadQuery(*_db);
+            downloadQuery.prepare("INSERT OR IGNORE INTO TilesDownload(setID, hash, type, x, y, z, state) VALUES(?, ?, ?, ?, ? ,? ,?)");
             _db->transaction();
             for(int z = task->tileSet()->minZoom(); z <= task->tileSet()->maxZoom(); z++) {
                 QGCTileSet set = QGCMapEngine::getTileCount(z,
@@ -520,26 +585,26 @@ QGCCacheWorker::_createTileSet(QGCMapTask *mtask)
                         quint64 tileID = _findTile(hash);
                         if(!tileID) {
                             //-- Set to download
-                            query.prepare("INSERT OR IGNORE INTO TilesDownload(setID, hash, type, x, y, z, state) VALUES(?, ?, ?, ?, ? ,? ,?)");
-                            query.addBindValue(setID);
-                            query.addBindValue(hash);
-                            query.addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(type));
-                            query.addBindValue(x);
-                            query.addBindValue(y);
-                            query.addBindValue(z);
-                            query.addBindValue(0);
-                            if(!query.exec()) {
-                                qWarning() << "Map Cache SQL error (add tile into TilesDownload):" << query.lastError().text();
+                            downloadQuery.addBindValue(setID);
+                            downloadQuery.addBindValue(hash);
+                            downloadQuery.addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(type));
+                            downloadQuery.addBindValue(x);
+                            downloadQuery.addBindValue(y);
+                            downloadQuery.addBindValue(z);
+                            downloadQuery.addBindValue(0);
+                            if(!downloadQuery.exec()) {
+                                qWarning() << "Map Cache SQL error (add tile into TilesDownload):" << downloadQuery.lastError().text();
+                                _db->rollback();
                                 mtask->setError("Error creating tile set download list");
                                 return;
                             } else
                                 actual_count++;
                         } else {
                             //-- Tile already in the database. No need to dowload.
-                            QString s = QString("INSERT OR IGNORE INTO SetTiles(tileID, setID) VALUES(%1, %2)").arg(tileID).arg(setID);
-                            query.prepare(s);
-                            if(!query.exec()) {
-                                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << query.lastError().text();
+                            _saveSetTileQuery->addBindValue(tileID);
+                            _saveSetTileQuery->addBindValue(setID);
+                            if(!_saveSetTileQuery->exec()) {
+                                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << _saveSetTileQuery->lastError().text();
                             }
                             qCDebug(QGCTileCacheLog) << "_createTileSet() Already Cached HASH:" << hash;
                         }
@@ -619,26 +684,8 @@ QGCCacheWorker::_pruneCache(QGCMapTask* mtask)
         return;
     }
     QGCPruneCacheTask* task = static_cast<QGCPruneCacheTask*>(mtask);
-    QSqlQuery query(*_db);
-    QString s;
-    //-- Select tiles in default set only, sorted by oldest.
-    s = QString("SELECT tileID, size, hash FROM Tiles WHERE tileID IN (SELECT A.tileID FROM SetTiles A join SetTiles B on A.tileID = B.tileID WHERE B.setID = %1 GROUP by A.tileID HAVING COUNT(A.tileID) = 1) ORDER BY DATE ASC LIMIT 128").arg(_getDefaultTileSet());
-    qint64 amount = (qint64)task->amount();
-    QList<quint64> tlist;
-    if(query.exec(s)) {
-        while(query.next() && amount >= 0) {
-            tlist << query.value(0).toULongLong();
-            amount -= query.value(1).toULongLong();
-            qCDebug(QGCTileCacheLog) << "_pruneCache() HASH:" << query.value(2).toString();
-        }
-        while(tlist.count()) {
-            s = QString("DELETE FROM Tiles WHERE tileID = %1").arg(tlist[0]);
-            tlist.removeFirst();
-            if(!query.exec(s))
-                break;
-        }
-        task->setPruned();
-    }
+    pruneTiles(*_db, _getDefaultTileSet(), task->amount());
+    task->setPruned();
 }
 
 //-----------------------------------------------------------------------------
@@ -657,17 +704,7 @@ QGCCacheWorker::_deleteTileSet(QGCMapTask* mtask)
 void
 QGCCacheWorker::_deleteTileSet(qulonglong id)
 {
-    QSqlQuery query(*_db);
-    QString s;
-    //-- Only delete tiles unique to this set
-    s = QString("DELETE FROM Tiles WHERE tileID IN (SELECT A.tileID FROM SetTiles A JOIN SetTiles B ON A.tileID = B.tileID WHERE B.setID = %1 GROUP BY A.tileID HAVING COUNT(A.tileID) = 1)").arg(id);
-    query.exec(s);
-    s = QString("DELETE FROM TilesDownload WHERE setID = %1").arg(id);
-    query.exec(s);
-    s = QString("DELETE FROM TileSets WHERE setID = %1").arg(id);
-    query.exec(s);
-    s = QString("DELETE FROM SetTiles WHERE setID = %1").arg(id);
-    query.exec(s);
+    deleteTileSet(*_db, id);
     _updateTotals();
 }
 
@@ -695,6 +732,8 @@ QGCCacheWorker::_resetCacheDatabase(QGCMapTask* mtask)
         return;
     }
     QGCResetTask* task = static_cast<QGCResetTask*>(mtask);
+    //-- Close the read connections while the tables are dropped and recreated
+    _suspendReaders();
     QSqlQuery query(*_db);
     QString s;
     s = QString("DROP TABLE Tiles");
@@ -706,6 +745,8 @@ QGCCacheWorker::_resetCacheDatabase(QGCMapTask* mtask)
     s = QString("DROP TABLE TilesDownload");
     query.exec(s);
     _valid = _createDB(*_db);
+    _prepareQueries();
+    _resumeReaders();
     task->setResetCompleted();
 }
 
@@ -719,10 +760,13 @@ QGCCacheWorker::_importSets(QGCMapTask* mtask)
     QGCImportTileTask* task = static_cast<QGCImportTileTask*>(mtask);
     //-- If replacing, simply copy over it
     if(task->replace()) {
-        //-- Close and delete old database
+        //-- Close and delete old database. Readers stay down until the new file is in place.
+        _suspendReaders();
         _disconnectDB();
         QFile file(_databasePath);
         file.remove();
+        QFile::remove(_databasePath + "-wal");
+        QFile::remove(_databasePath + "-shm");
         //-- Copy given database
         QFile::copy(task->path(), _databasePath);
         task->setProgress(25);
@@ -730,7 +774,9 @@ QGCCacheWorker::_importSets(QGCMapTask* mtask)
         if(_valid) {
             task->setProgress(50);
             _connectDB();
+            _prepareQueries();
         }
+        _resumeReaders();
         task->setProgress(100);
     } else {
         //-- Open imported set
@@ -1039,74 +1085,105 @@ QGCCacheWorker::_connectDB()
 {
     _db.reset(new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", kSession)));
     _db->setDatabaseName(_databasePath);
-    _db->setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
+    //-- No shared cache: its table locks would serialize the readers behind the writer again
+    _db->setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
     _valid = _db->open();
+    if(_valid) {
+        //-- WAL lets the read connections run concurrently with writes. NORMAL sync is
+        //   durable across application crashes, which is all a tile cache needs.
+        QSqlQuery query(*_db);
+        if(!query.exec("PRAGMA journal_mode=WAL")) {
+            qWarning() << "Map Cache SQL error (enable WAL):" << query.lastError().text();
+        }
+        query.exec("PRAGMA synchronous=NORMAL");
+    }
     return _valid;
 }
 
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_prepareQueries()
+{
+    _saveTileQuery.reset(new QSqlQuery(*_db));
+    _saveTileQuery->prepare("INSERT INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)");
+    _saveSetTileQuery.reset(new QSqlQuery(*_db));
+    _saveSetTileQuery->prepare("INSERT OR IGNORE INTO SetTiles(tileID, setID) VALUES(?, ?)");
+    _findTileQuery.reset(new QSqlQuery(*_db));
+    _findTileQuery->prepare("SELECT tileID FROM Tiles WHERE hash = ?");
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_startReaders()
+{
+    //-- Called with _readQueueMutex held
+    if(!_readersRunning && !_readersSuspended) {
+        _readersRunning = true;
+        _readersStop    = false;
+        for(QGCCacheReader* reader: _readers) {
+            reader->start(QThread::HighPriority);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_stopReaders()
+{
+    QMutexLocker lock(&_readQueueMutex);
+    _readersStop = true;
+    _readWaitc.wakeAll();
+    lock.unlock();
+    for(QGCCacheReader* reader: _readers) {
+        reader->wait();
+    }
+    lock.relock();
+    _readersRunning = false;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_suspendReaders()
+{
+    //-- Fetches queued from now on wait in _readQueue until _resumeReaders()
+    QMutexLocker lock(&_readQueueMutex);
+    _readersSuspended = true;
+    lock.unlock();
+    _stopReaders();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_resumeReaders()
+{
+    //-- Restarted readers open fresh connections on the current database file
+    QMutexLocker lock(&_readQueueMutex);
+    _readersSuspended = false;
+    if(_readQueue.count()) {
+        _startReaders();
+    }
+}
+
+//-----------------------------------------------------------------------------
+QGCMapTask*
+QGCCacheWorker::_dequeueReadTask()
+{
+    QMutexLocker lock(&_readQueueMutex);
+    while(!_readersStop && _readQueue.isEmpty()) {
+        _readWaitc.wait(&_readQueueMutex);
+    }
+    if(_readersStop) {
+        return nullptr;
+    }
+    return _readQueue.dequeue();
+}
+
 //-----------------------------------------------------------------------------
 bool
 QGCCacheWorker::_createDB(QSqlDatabase& db, bool createDefault)
 {
-    bool res = false;
     QSqlQuery query(db);
-    if(!query.exec(
-        "CREATE TABLE IF NOT EXISTS Tiles ("
-        "tileID INTEGER PRIMARY KEY NOT NULL, "
-        "hash TEXT NOT NULL UNIQUE, "
-        "format TEXT NOT NULL, "
-        "tile BLOB NULL, "
-        "size INTEGER, "
-        "type INTEGER, "
-        "date INTEGER DEFAULT 0)"))
-    {
-        qWarning() << "Map Cache SQL error (create Tiles db):" << query.lastError().text();
-    } else {
-        query.exec("CREATE INDEX IF NOT EXISTS hash ON Tiles ( hash, size, type ) ");
-             
-        if(!query.exec(
-            "CREATE TABLE IF NOT EXISTS TileSets ("
-            "setID INTEGER PRIMARY KEY NOT NULL, "
-            "name TEXT NOT NULL UNIQUE, "
-            "typeStr TEXT, "
-            "topleftLat REAL DEFAULT 0.0, "
-            "topleftLon REAL DEFAULT 0.0, "
-            "bottomRightLat REAL DEFAULT 0.0, "
-            "bottomRightLon REAL DEFAULT 0.0, "
-            "minZoom INTEGER DEFAULT 3, "
-            "maxZoom INTEGER DEFAULT 3, "
-            "type INTEGER DEFAULT -1, "
-            "numTiles INTEGER DEFAULT 0, "
-            "defaultSet INTEGER DEFAULT 0, "
-            "date INTEGER DEFAULT 0)"))
-        {
-            qWarning() << "Map Cache SQL error (create TileSets db):" << query.lastError().text();
-        } else {
-            if(!query.exec(
-                "CREATE TABLE IF NOT EXISTS SetTiles ("
-                "setID INTEGER, "
-                "tileID INTEGER)"))
-            {
-                qWarning() << "Map Cache SQL error (create SetTiles db):" << query.lastError().text();
-            } else {
-                if(!query.exec(
-                    "CREATE TABLE IF NOT EXISTS TilesDownload ("
-                    "setID INTEGER, "
-                    "hash TEXT NOT NULL UNIQUE, "
-                    "type INTEGER, "
-                    "x INTEGER, "
-                    "y INTEGER, "
-                    "z INTEGER, "
-                    "state INTEGER DEFAULT 0)"))
-                {
-                    qWarning() << "Map Cache SQL error (create TilesDownload db):" << query.lastError().text();
-                } else {
-                    //-- Database it ready for use
-                    res = true;
-                }
-            }
-        }
-    }
+    bool res = createTables(db);
     //-- Create default tile set
     if(res && createDefault) {
         QString s = QString("SELECT name FROM TileSets WHERE name = \"%1\"").arg(kDefaultSet);
@@ -1132,11 +1209,185 @@ QGCCacheWorker::_createDB(QSqlDatabase& db, bool createDefault)
     return res;
 }
 
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::createTables(QSqlDatabase& db)
+{
+    QSqlQuery query(db);
+    if(!query.exec(
+        "CREATE TABLE IF NOT EXISTS Tiles ("
+        "tileID INTEGER PRIMARY KEY NOT NULL, "
+        "hash TEXT NOT NULL UNIQUE, "
+        "format TEXT NOT NULL, "
+        "tile BLOB NULL, "
+        "size INTEGER, "
+        "type INTEGER, "
+        "date INTEGER DEFAULT 0, "
+        "setCount INTEGER DEFAULT 0)"))
+    {
+        qWarning() << "Map Cache SQL error (create Tiles db):" << query.lastError().text();
+        return false;
+    }
+    query.exec("CREATE INDEX IF NOT EXISTS hash ON Tiles ( hash, size, type ) ");
+    if(!query.exec(
+        "CREATE TABLE IF NOT EXISTS TileSets ("
+        "setID INTEGER PRIMARY KEY NOT NULL, "
+        "name TEXT NOT NULL UNIQUE, "
+        "typeStr TEXT, "
+        "topleftLat REAL DEFAULT 0.0, "
+        "topleftLon REAL DEFAULT 0.0, "
+        "bottomRightLat REAL DEFAULT 0.0, "
+        "bottomRightLon REAL DEFAULT 0.0, "
+        "minZoom INTEGER DEFAULT 3, "
+        "maxZoom INTEGER DEFAULT 3, "
+        "type INTEGER DEFAULT -1, "
+        "numTiles INTEGER DEFAULT 0, "
+        "defaultSet INTEGER DEFAULT 0, "
+        "date INTEGER DEFAULT 0)"))
+    {
+        qWarning() << "Map Cache SQL error (create TileSets db):" << query.lastError().text();
+        return false;
+    }
+    if(!query.exec(
+        "CREATE TABLE IF NOT EXISTS SetTiles ("
+        "setID INTEGER, "
+        "tileID INTEGER)"))
+    {
+        qWarning() << "Map Cache SQL error (create SetTiles db):" << query.lastError().text();
+        return false;
+    }
+    if(!query.exec(
+        "CREATE TABLE IF NOT EXISTS TilesDownload ("
+        "setID INTEGER, "
+        "hash TEXT NOT NULL UNIQUE, "
+        "type INTEGER, "
+        "x INTEGER, "
+        "y INTEGER, "
+        "z INTEGER, "
+        "state INTEGER DEFAULT 0)"))
+    {
+        qWarning() << "Map Cache SQL error (create TilesDownload db):" << query.lastError().text();
+        return false;
+    }
+    //-- Databases created before tiles were reference counted need the column added and filled in
+    bool hasSetCount = false;
+    if(query.exec("PRAGMA table_info(Tiles)")) {
+        while(query.next()) {
+            if(query.value("name").toString() == QStringLiteral("setCount")) {
+                hasSetCount = true;
+            }
+        }
+    }
+    db.transaction();
+    if(!hasSetCount && !query.exec("ALTER TABLE Tiles ADD COLUMN setCount INTEGER DEFAULT 0")) {
+        qWarning() << "Map Cache SQL error (add setCount):" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    //-- Tiles.setCount is the number of sets referencing the tile. The triggers keep it current so
+    //   finding the tiles unique to a set is an index lookup instead of a GROUP BY over SetTiles.
+    static const char* statements[] = {
+        "CREATE INDEX IF NOT EXISTS SetTilesBySet ON SetTiles ( setID, tileID )",
+        "CREATE INDEX IF NOT EXISTS SetTilesByTile ON SetTiles ( tileID, setID )",
+        "CREATE INDEX IF NOT EXISTS TilesPrune ON Tiles ( setCount, date )",
+        "CREATE TRIGGER IF NOT EXISTS SetTilesInsert AFTER INSERT ON SetTiles BEGIN "
+            "UPDATE Tiles SET setCount = setCount + 1 WHERE tileID = NEW.tileID; END",
+        "CREATE TRIGGER IF NOT EXISTS SetTilesDelete AFTER DELETE ON SetTiles BEGIN "
+            "UPDATE Tiles SET setCount = setCount - 1 WHERE tileID = OLD.tileID; END",
+        "CREATE TRIGGER IF NOT EXISTS TilesDelete AFTER DELETE ON Tiles BEGIN "
+            "DELETE FROM SetTiles WHERE tileID = OLD.tileID; END",
+    };
+    for(const char* statement: statements) {
+        if(!query.exec(statement)) {
+            qWarning() << "Map Cache SQL error (create set reference counting):" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    if(!hasSetCount) {
+        //-- Older versions left SetTiles rows behind for deleted tiles
+        query.exec("DELETE FROM SetTiles WHERE tileID NOT IN (SELECT tileID FROM Tiles)");
+        query.exec("UPDATE Tiles SET setCount = (SELECT COUNT(*) FROM SetTiles WHERE SetTiles.tileID = Tiles.tileID)");
+        qCDebug(QGCTileCacheLog) << "Migrated tile set reference counts";
+    }
+    return db.commit();
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::deleteTileSet(QSqlDatabase& db, quint64 setID)
+{
+    static const char* statements[] = {
+        //-- Only delete tiles unique to this set. Their SetTiles rows go with them (trigger).
+        "DELETE FROM Tiles WHERE tileID IN (SELECT tileID FROM SetTiles WHERE setID = ?) AND setCount = 1",
+        "DELETE FROM TilesDownload WHERE setID = ?",
+        "DELETE FROM TileSets WHERE setID = ?",
+        //-- Releases this set's reference on the shared tiles that remain
+        "DELETE FROM SetTiles WHERE setID = ?",
+    };
+    db.transaction();
+    QSqlQuery query(db);
+    for(const char* statement: statements) {
+        query.prepare(statement);
+        query.addBindValue(setID);
+        if(!query.exec()) {
+            qWarning() << "Map Cache SQL error (delete tile set):" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::pruneTiles(QSqlDatabase& db, quint64 setID, quint64 amount)
+{
+    //-- Oldest first, walking the (setCount, date) index so there is no sort and the scan stops
+    //   as soon as enough has been found.
+    QSqlQuery query(db);
+    query.prepare("SELECT A.tileID, A.size FROM Tiles A WHERE A.setCount = 1 AND "
+                  "EXISTS (SELECT 1 FROM SetTiles B WHERE B.tileID = A.tileID AND B.setID = ?) ORDER BY A.date ASC");
+    query.addBindValue(setID);
+    if(!query.exec()) {
+        qWarning() << "Map Cache SQL error (select tiles to prune):" << query.lastError().text();
+        return false;
+    }
+    QVector<quint64> tileIDs;
+    quint64 found = 0;
+    while(found < amount && query.next()) {
+        tileIDs.append(query.value(0).toULongLong());
+        found += query.value(1).toULongLong();
+    }
+    query.finish();
+    qCDebug(QGCTileCacheLog) << "pruneTiles() tiles:bytes" << tileIDs.count() << found;
+    //-- Chunked transactions so tile saves and the readers aren't held off for the whole prune
+    query.prepare("DELETE FROM Tiles WHERE tileID = ?");
+    for(int i = 0; i < tileIDs.count(); i += kPruneChunk) {
+        db.transaction();
+        for(int j = i; j < qMin(i + kPruneChunk, tileIDs.count()); j++) {
+            query.addBindValue(tileIDs[j]);
+            if(!query.exec()) {
+                qWarning() << "Map Cache SQL error (prune tiles):" << query.lastError().text();
+                db.rollback();
+                return false;
+            }
+        }
+        if(!db.commit()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 void
 QGCCacheWorker::_disconnectDB()
 {
     if (_db) {
+        _saveTileQuery.reset();
+        _saveSetTileQuery.reset();
+        _findTileQuery.reset();
         _db.reset();
         QSqlDatabase::removeDatabase(kSession);
     }
@@ -1203,3 +1454,44 @@ QGCCacheWorker::_lookupReady(QHostInfo info)
     }
 #endif
 }
+
+//-----------------------------------------------------------------------------
+QGCCacheReader::QGCCacheReader(QGCCacheWorker* worker, int index)
+    : _worker(worker)
+    , _session(kReadSession.arg(index))
+{
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheReader::run()
+{
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", _session);
+        db.setDatabaseName(_worker->_databasePath);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=1000");
+        bool open = db.open();
+        if(!open) {
+            qWarning() << "Map Cache SQL error (open read connection):" << db.lastError();
+        }
+        QSqlQuery query(db);
+        bool prepared = false;
+        while(QGCMapTask* task = _worker->_dequeueReadTask()) {
+            //-- The file may not exist yet when the reader starts (first run, import in progress)
+            if(!open) {
+                open = db.open();
+            }
+            //-- Prepared lazily, the tables may not exist yet when the reader starts
+            if(open && !prepared) {
+                prepared = query.prepare(kGetTileQuery);
+            }
+            if(prepared) {
+                _worker->_getTile(query, task);
+            } else {
+                task->setError("No Cache Database");
+            }
+            task->deleteLater();
+        }
+    }
+    QSqlDatabase::removeDatabase(_session);
+}
@@ -26,6 +26,7 @@
 #include <QWaitCondition>
 #include <QMutexLocker>
 #include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
 #include <QHostInfo>
 
 #include "QGCLoggingCategory.h"
@@ -34,6 +35,25 @@ Q_DECLARE_LOGGING_CATEGORY(QGCTileCacheLog)
 
 class QGCMapTask;
 class QGCCachedTileSet;
+class QGCCacheWorker;
+
+//-----------------------------------------------------------------------------
+/// Serves tile fetches from its own read only connection so map panning doesn't
+/// wait behind writes (bulk offline downloads) on the worker thread. With the
+/// database in WAL mode readers never block on, or get blocked by, the writer.
+class QGCCacheReader : public QThread
+{
+    Q_OBJECT
+public:
+    QGCCacheReader  (QGCCacheWorker* worker, int index);
+
+protected:
+    void    run             ();
+
+private:
+    QGCCacheWorker* _worker;
+    QString         _session;
+};
 
 //-----------------------------------------------------------------------------
 class QGCCacheWorker : public QThread
@@ -47,6 +67,18 @@ public:
     bool    enqueueTask     (QGCMapTask* task);
     void    setDatabaseFile (const QString& path);
 
+    static const int kReadConnections   = 2;    ///< Size of the read connection pool
+    static const int kMaxSaveBatch      = 256;  ///< Maximum tile saves coalesced into one transaction
+    static const int kPruneChunk        = 1000; ///< Tiles deleted per transaction when pruning
+
+    /// Creates the tables, indexes and the triggers maintaining Tiles.setCount (the number of sets
+    /// referencing a tile). Older databases are migrated.
+    static bool createTables    (QSqlDatabase& db);
+    /// Deletes the tiles referenced only by the set, then the set itself
+    static bool deleteTileSet   (QSqlDatabase& db, quint64 setID);
+    /// Deletes the oldest tiles referenced only by the set until at least amount bytes are freed
+    static bool pruneTiles      (QSqlDatabase& db, quint64 setID, quint64 amount);
+
 protected:
     void    run             ();
 
@@ -54,10 +86,13 @@ private slots:
     void        _lookupReady            (QHostInfo info);
 
 private:
+    friend class QGCCacheReader;
+
     void        _runTask                (QGCMapTask* task);
 
+    void        _saveTiles              (const QList<QGCMapTask*>& tasks);
     void        _saveTile               (QGCMapTask* mtask);
-    void        _getTile                (QGCMapTask* mtask);
+    void        _getTile                (QSqlQuery& query, QGCMapTask* mtask);
     void        _getTileSets            (QGCMapTask* mtask);
     void        _createTileSet          (QGCMapTask* mtask);
     void        _getTileDownloadList    (QGCMapTask* mtask);
@@ -77,6 +112,12 @@ private:
     void        _updateSetTotals        (QGCCachedTileSet* set);
     bool        _init                   ();
     bool        _connectDB              ();
+    void        _prepareQueries         ();
+    void        _startReaders           ();
+    void        _stopReaders            ();
+    void        _suspendReaders         ();
+    void        _resumeReaders          ();
+    QGCMapTask* _dequeueReadTask        ();
     bool        _createDB               (QSqlDatabase& db, bool createDefault = true);
     void        _disconnectDB           ();
     quint64     _getDefaultTileSet      ();
@@ -93,6 +134,16 @@ private:
     QWaitCondition                  _waitc;
     QString                         _databasePath;
     QScopedPointer<QSqlDatabase>    _db;
+    QScopedPointer<QSqlQuery>       _saveTileQuery;         ///< Prepared once per connection
+    QScopedPointer<QSqlQuery>       _saveSetTileQuery;
+    QScopedPointer<QSqlQuery>       _findTileQuery;
+    QQueue<QGCMapTask*>             _readQueue;             ///< Tile fetches, serviced by the readers
+    QMutex                          _readQueueMutex;
+    QWaitCondition                  _readWaitc;
+    QList<QGCCacheReader*>          _readers;
+    bool                            _readersRunning;
+    bool                            _readersStop;
+    bool                            _readersSuspended;      ///< Set while the database file is replaced or reset
     std::atomic_bool                _valid;
     bool                            _failed;
     quint64                         _defaultSet;
@@ -0,0 +1,108 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "QGCTileCacheWorkerTest.h"
+#include "QGCTileCacheWorker.h"
+#include "QGCLoggingCategory.h"
+
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QtSql/QSqlQuery>
+
+QGC_LOGGING_CATEGORY(QGCTileCacheWorkerTestLog, "QGCTileCacheWorkerTestLog")
+
+static const QString kTestSession = QStringLiteral("QGCTileCacheWorkerTest");
+
+static quint64 _queryCount(QSqlDatabase& db, const QString& sql)
+{
+    QSqlQuery query(db);
+    if (query.exec(sql) && query.next()) {
+        return query.value(0).toULongLong();
+    }
+    return UINT64_MAX;
+}
+
+/// Builds a synthetic cache with a default set and a second set which overlap by a quarter of the tiles, then
+/// prunes the default set and deletes the second one. Runs on a small database by default, set
+/// QGC_TILE_CACHE_BENCHMARK_TILES=1000000 to benchmark against a large cache.
+void QGCTileCacheWorkerTest::_pruneAndDeleteTest(void)
+{
+    int tileCount = qEnvironmentVariableIntValue("QGC_TILE_CACHE_BENCHMARK_TILES");
+    if (tileCount <= 0) {
+        tileCount = 20000;
+    }
+    tileCount &= ~3;
+    const int       tileSize        = 100;
+    const quint64   defaultSetID    = 1;
+    const quint64   otherSetID      = 2;
+
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kTestSession);
+        db.setDatabaseName(tempDir.filePath("cache.db"));
+        QVERIFY(db.open());
+        QVERIFY(QGCCacheWorker::createTables(db));
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // Default set holds the first three quarters of the tiles, the other set the last half
+        QSqlQuery query(db);
+        QVERIFY(query.exec(QStringLiteral("INSERT INTO TileSets(setID, name, defaultSet) VALUES(%1, 'Default', 1)").arg(defaultSetID)));
+        QVERIFY(query.exec(QStringLiteral("INSERT INTO TileSets(setID, name, defaultSet) VALUES(%1, 'Other', 0)").arg(otherSetID)));
+        QSqlQuery tileQuery(db);
+        QVERIFY(tileQuery.prepare("INSERT INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)"));
+        QSqlQuery setTileQuery(db);
+        QVERIFY(setTileQuery.prepare("INSERT INTO SetTiles(tileID, setID) VALUES(?, ?)"));
+        QByteArray tile(tileSize, 'x');
+        QVERIFY(db.transaction());
+        for (int i = 0; i < tileCount; i++) {
+            tileQuery.addBindValue(QString::number(i));
+            tileQuery.addBindValue(QStringLiteral("png"));
+            tileQuery.addBindValue(tile);
+            tileQuery.addBindValue(tileSize);
+            tileQuery.addBindValue(1);
+            tileQuery.addBindValue(i);
+            QVERIFY(tileQuery.exec());
+            quint64 tileID = tileQuery.lastInsertId().toULongLong();
+            if (i < (tileCount / 4) * 3) {
+                setTileQuery.addBindValue(tileID);
+                setTileQuery.addBindValue(defaultSetID);
+                QVERIFY(setTileQuery.exec());
+            }
+            if (i >= tileCount / 2) {
+                setTileQuery.addBindValue(tileID);
+                setTileQuery.addBindValue(otherSetID);
+                QVERIFY(setTileQuery.exec());
+            }
+        }
+        QVERIFY(db.commit());
+        qCDebug(QGCTileCacheWorkerTestLog) << "Built" << tileCount << "tiles msecs" << timer.restart();
+
+        QCOMPARE(_queryCount(db, "SELECT COUNT(*) FROM Tiles WHERE setCount = 2"), static_cast<quint64>(tileCount / 4));
+
+        // Prune a quarter of the cache, which has to come from the oldest tiles unique to the default set
+        QVERIFY(QGCCacheWorker::pruneTiles(db, defaultSetID, static_cast<quint64>(tileCount / 4) * tileSize));
+        qCDebug(QGCTileCacheWorkerTestLog) << "Pruned msecs" << timer.restart();
+        QCOMPARE(_queryCount(db, "SELECT COUNT(*) FROM Tiles"), static_cast<quint64>((tileCount / 4) * 3));
+        QCOMPARE(_queryCount(db, "SELECT MIN(date) FROM Tiles"), static_cast<quint64>(tileCount / 4));
+        QCOMPARE(_queryCount(db, QStringLiteral("SELECT COUNT(*) FROM SetTiles WHERE setID = %1").arg(defaultSetID)), static_cast<quint64>(tileCount / 2));
+
+        // Deleting the other set only removes the tiles it doesn't share
+        QVERIFY(QGCCacheWorker::deleteTileSet(db, otherSetID));
+        qCDebug(QGCTileCacheWorkerTestLog) << "Deleted set msecs" << timer.restart();
+        QCOMPARE(_queryCount(db, "SELECT COUNT(*) FROM Tiles"), static_cast<quint64>(tileCount / 2));
+        QCOMPARE(_queryCount(db, "SELECT COUNT(*) FROM Tiles WHERE setCount <> 1"), static_cast<quint64>(0));
+        QCOMPARE(_queryCount(db, "SELECT COUNT(*) FROM SetTiles"), static_cast<quint64>(tileCount / 2));
+        QCOMPARE(_queryCount(db, "SELECT COUNT(*) FROM TileSets"), static_cast<quint64>(1));
+    }
+    QSqlDatabase::removeDatabase(kTestSession);
+}
@@ -80,10 +80,21 @@ QGeoTiledMapReplyQGC::QGeoTiledMapReplyQGC(QNetworkAccessManager *networkManager
         setFinished(true);
         setCached(false);
     } else {
-        QGCFetchTileTask* task = getQGCMapEngine()->createFetchTileTask(getQGCMapEngine()->urlFactory()->getTypeFromId(spec.mapId()), spec.x(), spec.y(), spec.zoom());
-        connect(task, &QGCFetchTileTask::tileFetched, this, &QGeoTiledMapReplyQGC::cacheReply);
-        connect(task, &QGCMapTask::error, this, &QGeoTiledMapReplyQGC::cacheError);
-        getQGCMapEngine()->addTask(task);
+        QByteArray  image;
+        QString     format;
+        //-- Elevation tiles report back through terrainDone, which nobody is connected to yet
+        if(!getQGCMapEngine()->urlFactory()->isElevation(spec.mapId()) &&
+                getQGCMapEngine()->memoryCache()->find(spec.mapId(), spec.x(), spec.y(), spec.zoom(), image, format)) {
+            setMapImageData(image);
+            setMapImageFormat(format);
+            setFinished(true);
+            setCached(true);
+        } else {
+            QGCFetchTileTask* task = getQGCMapEngine()->createFetchTileTask(getQGCMapEngine()->urlFactory()->getTypeFromId(spec.mapId()), spec.x(), spec.y(), spec.zoom());
+            connect(task, &QGCFetchTileTask::tileFetched, this, &QGeoTiledMapReplyQGC::cacheReply);
+            connect(task, &QGCMapTask::error, this, &QGeoTiledMapReplyQGC::cacheError);
+            getQGCMapEngine()->addTask(task);
+        }
     }
 }
 
@@ -133,14 +144,8 @@ QGeoTiledMapReplyQGC::networkReplyFinished()
     QString format = urlFactory->getImageFormat(tileSpec().mapId(), a);
     //-- Test for a specialized, elevation data (not map tile)
     if( getQGCMapEngine()->urlFactory()->isElevation(tileSpec().mapId())){
+        //-- Not cached here, TerrainTileManager keeps the tiles it fetches in its own terrain tile store
         a = TerrainTile::serializeFromAirMapJson(a);
-        //-- Cache it if valid
-        if(!a.isEmpty()) {
-            getQGCMapEngine()->cacheTile(
-                getQGCMapEngine()->urlFactory()->getTypeFromId(
-                    tileSpec().mapId()),
-                tileSpec().x(), tileSpec().y(), tileSpec().zoom(), a, format);
-        }
         emit terrainDone(a, QNetworkReply::NoError);
     } else {
         MapProvider* mapProvider = urlFactory->getMapProviderFromId(tileSpec().mapId());
@@ -156,6 +161,7 @@ QGeoTiledMapReplyQGC::networkReplyFinished()
             if(!format.isEmpty()) {
                 setMapImageFormat(format);
                 getQGCMapEngine()->cacheTile(getQGCMapEngine()->urlFactory()->getTypeFromId(tileSpec().mapId()), tileSpec().x(), tileSpec().y(), tileSpec().zoom(), a, format);
+                getQGCMapEngine()->memoryCache()->insert(tileSpec().mapId(), tileSpec().x(), tileSpec().y(), tileSpec().zoom(), a, format);
             }
         }
         setFinished(true);
@@ -234,6 +240,7 @@ QGeoTiledMapReplyQGC::cacheReply(QGCCacheTile* tile)
         emit terrainDone(tile->img(), QNetworkReply::NoError);
     } else {
         //-- Regular map tile
+        getQGCMapEngine()->memoryCache()->insert(tileSpec().mapId(), tileSpec().x(), tileSpec().y(), tileSpec().zoom(), tile->img(), tile->format());
         setMapImageData(tile->img());
         setMapImageFormat(tile->format());
         setFinished(true);
@@ -151,8 +151,8 @@ QGeoTiledMappingManagerEngineQGC::_setCache(const QVariantMap &parameters)
     }
     if(!memLimit)
     {
-        //-- Value saved in MB
-        memLimit = getQGCMapEngine()->getMaxMemCache() * (1024 * 1024);
+        //-- Value saved in MB, shared with QGCMapEngine's own memory cache
+        memLimit = static_cast<uint32_t>(QGCMapEngine::qtMemCacheBytes(getQGCMapEngine()->getMaxMemCache()));
     }
     //-- It won't work with less than 1M of memory cache
     if(memLimit < 1024 * 1024)
@@ -253,6 +253,7 @@ void
 QGCMapEngineManager::setMaxMemCache(quint32 size)
 {
     getQGCMapEngine()->setMaxMemCache(size);
+    emit memCacheStatsChanged();
 }
 
 //-----------------------------------------------------------------------------
@@ -384,6 +385,8 @@ QGCMapEngineManager::taskError(QGCMapTask::TaskType type, QString error)
 void
 QGCMapEngineManager::_updateTotals(quint32 totaltiles, quint64 totalsize, quint32 defaulttiles, quint64 defaultsize)
 {
+    //-- Piggyback on the database totals for a periodic refresh
+    emit memCacheStatsChanged();
     for(int i = 0; i < _tileSets.count(); i++ ) {
         QGCCachedTileSet* set = qobject_cast<QGCCachedTileSet*>(_tileSets.get(i));
         if (set && set->defaultSet()) {
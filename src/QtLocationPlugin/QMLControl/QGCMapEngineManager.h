@@ -46,6 +46,11 @@ public:
     Q_PROPERTY(QStringList          mapProviderList READ    mapProviderList CONSTANT)
     Q_PROPERTY(quint32              maxMemCache     READ    maxMemCache     WRITE   setMaxMemCache  NOTIFY  maxMemCacheChanged)
     Q_PROPERTY(quint32              maxDiskCache    READ    maxDiskCache    WRITE   setMaxDiskCache NOTIFY  maxDiskCacheChanged)
+    //-- In memory tile cache statistics
+    Q_PROPERTY(quint64              memCacheHits        READ memCacheHits       NOTIFY memCacheStatsChanged)
+    Q_PROPERTY(quint64              memCacheMisses      READ memCacheMisses     NOTIFY memCacheStatsChanged)
+    Q_PROPERTY(quint64              memCacheEvictions   READ memCacheEvictions  NOTIFY memCacheStatsChanged)
+    Q_PROPERTY(quint64              memCacheSize        READ memCacheSize       NOTIFY memCacheStatsChanged)
     Q_PROPERTY(QString              errorMessage    READ    errorMessage    NOTIFY  errorMessageChanged)
     Q_PROPERTY(bool                 fetchElevation  READ    fetchElevation  WRITE   setFetchElevation   NOTIFY  fetchElevationChanged)
     //-- Disk Space in MB
@@ -83,6 +88,10 @@ public:
     QmlObjectListModel*             tileSets                () { return &_tileSets; }
     quint32                         maxMemCache             ();
     quint32                         maxDiskCache            ();
+    quint64                         memCacheHits            () { return getQGCMapEngine()->memoryCache()->hits(); }
+    quint64                         memCacheMisses          () { return getQGCMapEngine()->memoryCache()->misses(); }
+    quint64                         memCacheEvictions       () { return getQGCMapEngine()->memoryCache()->evictions(); }
+    quint64                         memCacheSize            () { return getQGCMapEngine()->memoryCache()->bytes(); }
     QString                         errorMessage            () { return _errorMessage; }
     bool                            fetchElevation          () const{ return _fetchElevation; }
     quint64                         freeDiskSpace           () const{ return _freeDiskSpace; }
@@ -108,6 +117,7 @@ signals:
     void tileSetsChanged        ();
     void maxMemCacheChanged     ();
     void maxDiskCacheChanged    ();
+    void memCacheStatsChanged   ();
     void errorMessageChanged    ();
     void fetchElevationChanged  ();
     void freeDiskSpaceChanged   ();
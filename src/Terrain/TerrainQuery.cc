@@ -23,6 +23,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QTimer>
+#include <QDir>
 #include <QtLocation/private/qgeotilespec_p.h>
 
 #include <cmath>
@@ -310,11 +311,13 @@ void TerrainOfflineAirMapQuery::requestCarpetHeights(const QGeoCoordinate& swCoo
         return;
     }
 
-    // TODO
-    Q_UNUSED(swCoord);
-    Q_UNUSED(neCoord);
-    Q_UNUSED(statsOnly);
-    qWarning() << "Carpet queries are currently not supported from offline air map data";
+    if (swCoord.longitude() > neCoord.longitude() || swCoord.latitude() > neCoord.latitude()) {
+        qCWarning(TerrainQueryLog) << "TerrainOfflineAirMapQuery::requestCarpetHeights: Internal Error - bad carpet coords";
+        _signalCarpetHeights(false, qQNaN(), qQNaN(), QList<QList<double>>());
+        return;
+    }
+
+    _terrainTileManager->addCarpetQuery(this, swCoord, neCoord, statsOnly);
 }
 
 void TerrainOfflineAirMapQuery::_signalCoordinateHeights(bool success, QList<double> heights)
@@ -334,7 +337,16 @@ void TerrainOfflineAirMapQuery::_signalCarpetHeights(bool success, double minHei
 
 TerrainTileManager::TerrainTileManager(void)
 {
+    _tiles.setMaxCost(_maxTileCacheBytes);
 
+    _prefetchTimer.setSingleShot(true);
+    _prefetchTimer.setInterval(_prefetchDelayMsecs);
+    connect(&_prefetchTimer, &QTimer::timeout, this, &TerrainTileManager::_prefetchTimeout);
+
+    QString cachePath = getQGCMapEngine()->getCachePath();
+    if (!cachePath.isEmpty()) {
+        _store.setDirectory(QDir(cachePath).filePath(QStringLiteral("Terrain")));
+    }
 }
 
 void TerrainTileManager::addCoordinateQuery(TerrainOfflineAirMapQuery* terrainQueryInterface, const QList<QGeoCoordinate>& coordinates)
@@ -342,24 +354,8 @@ void TerrainTileManager::addCoordinateQuery(TerrainOfflineAirMapQuery* terrainQu
     qCDebug(TerrainQueryLog) << "TerrainTileManager::addCoordinateQuery count" << coordinates.count();
 
     if (coordinates.length() > 0) {
-        bool error;
-        QList<double> altitudes;
-
-        if (!getAltitudesForCoordinates(coordinates, altitudes, error)) {
-            qCDebug(TerrainQueryLog) << "TerrainTileManager::addPathQuery queue count" << _requestQueue.count();
-            QueuedRequestInfo_t queuedRequestInfo = { terrainQueryInterface, QueryMode::QueryModeCoordinates, 0, 0, coordinates };
-            _requestQueue.append(queuedRequestInfo);
-            return;
-        }
-
-        if (error) {
-            QList<double> noAltitudes;
-            qCWarning(TerrainQueryLog) << "addCoordinateQuery: signalling failure due to internal error";
-            terrainQueryInterface->_signalCoordinateHeights(false, noAltitudes);
-        } else {
-            qCDebug(TerrainQueryLog) << "addCoordinateQuery: All altitudes taken from cached data";
-            terrainQueryInterface->_signalCoordinateHeights(coordinates.count() == altitudes.count(), altitudes);
-        }
+        QueuedRequestInfo_t requestInfo = { { terrainQueryInterface }, QueryMode::QueryModeCoordinates, 0, 0, coordinates, 0, false, {} };
+        _addRequest(requestInfo);
     }
 }
 
@@ -396,180 +392,624 @@ QList<QGeoCoordinate> TerrainTileManager::pathQueryToCoords(const QGeoCoordinate
 }
 
 void TerrainTileManager::addPathQuery(TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate &startPoint, const QGeoCoordinate &endPoint)
+{
+    // Path queries are held as their end points, the samples are generated when the heights are looked up
+    QueuedRequestInfo_t requestInfo = { { terrainQueryInterface }, QueryMode::QueryModePath, 0, 0, { startPoint, endPoint }, 0, false, {} };
+    _addRequest(requestInfo);
+}
+
+/// Generates the path samples straight into latitude/longitude arrays, with the same spacing as pathQueryToCoords
+void TerrainTileManager::_pathSamples(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, QVector<double>& lats, QVector<double>& lons, double& distanceBetween, double& finalDistanceBetween)
+{
+    const double    lat     = fromCoord.latitude();
+    const double    lon     = fromCoord.longitude();
+    const double    latDiff = toCoord.latitude() - lat;
+    const double    lonDiff = toCoord.longitude() - lon;
+    const int       steps   = qCeil(toCoord.distanceTo(fromCoord) / TerrainTile::tileValueSpacingMeters);
+
+    if (steps == 0) {
+        lats = { lat, toCoord.latitude() };
+        lons = { lon, toCoord.longitude() };
+        distanceBetween = finalDistanceBetween = fromCoord.distanceTo(toCoord);
+        return;
+    }
+
+    lats.resize(steps + 1);
+    lons.resize(steps + 1);
+    for (int i = 0; i <= steps; i++) {
+        lats[i] = lat + latDiff * i / steps;
+        lons[i] = lon + lonDiff * i / steps;
+    }
+    // The last sample is always exactly the end point
+    lats[steps] = toCoord.latitude();
+    lons[steps] = toCoord.longitude();
+
+    distanceBetween         = fromCoord.distanceTo(QGeoCoordinate(lats[1], lons[1]));
+    finalDistanceBetween    = QGeoCoordinate(lats[steps - 1], lons[steps - 1]).distanceTo(toCoord);
+}
+
+/// Path version of getAltitudesForCoordinates. Heights are bilinearly interpolated and no coordinate list is built.
+///     @param[out] distanceBetween Distance between each returned height
+///     @param[out] finalDistanceBetween Distance between the last two heights
+bool TerrainTileManager::getAltitudesForPath(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, QList<double>& altitudes, double& distanceBetween, double& finalDistanceBetween, bool& error, QSet<quint64>* missingTiles)
+{
+    QVector<double> lats;
+    QVector<double> lons;
+    _pathSamples(fromCoord, toCoord, lats, lons, distanceBetween, finalDistanceBetween);
+
+    qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForPath fromCoord:toCoord:distanceBetween:finalDisanceBetween:sampleCount" << fromCoord << toCoord << distanceBetween << finalDistanceBetween << lats.count();
+
+    QVector<double> elevations(lats.count());
+    if (!_getAltitudes(lats.constData(), lons.constData(), lats.count(), true /* interpolate */, elevations.data(), error, missingTiles)) {
+        return false;
+    }
+
+    altitudes.reserve(altitudes.count() + elevations.count());
+    for (double elevation: elevations) {
+        altitudes.push_back(elevation);
+    }
+
+    return true;
+}
+
+/// Returns a row major grid of coordinates covering the requested area spaced according to the terrain tile value spacing
+QList<QGeoCoordinate> TerrainTileManager::carpetQueryToCoords(const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, int& rowCount, int& colCount)
 {
     QList<QGeoCoordinate> coordinates;
-    double distanceBetween;
-    double finalDistanceBetween;
 
-    coordinates = pathQueryToCoords(startPoint, endPoint, distanceBetween, finalDistanceBetween);
+    const double latDiff    = neCoord.latitude() - swCoord.latitude();
+    const double lonDiff    = neCoord.longitude() - swCoord.longitude();
+    const int    latSteps   = qMax(1, qCeil(latDiff / TerrainTile::tileValueSpacingDegrees));
+    const int    lonSteps   = qMax(1, qCeil(lonDiff / TerrainTile::tileValueSpacingDegrees));
 
-    bool error;
-    QList<double> altitudes;
-    if (!getAltitudesForCoordinates(coordinates, altitudes, error)) {
-        qCDebug(TerrainQueryLog) << "TerrainTileManager::addPathQuery queue count" << _requestQueue.count();
-        QueuedRequestInfo_t queuedRequestInfo = { terrainQueryInterface, QueryMode::QueryModePath, distanceBetween, finalDistanceBetween, coordinates };
-        _requestQueue.append(queuedRequestInfo);
+    rowCount = latSteps + 1;
+    colCount = lonSteps + 1;
+    if (static_cast<qint64>(rowCount) * colCount > _maxCarpetPoints) {
+        return coordinates;
+    }
+
+    // Row major so consecutive coordinates fall in the same tile
+    coordinates.reserve(rowCount * colCount);
+    for (int row = 0; row < rowCount; row++) {
+        const double lat = row == latSteps ? neCoord.latitude() : swCoord.latitude() + latDiff * row / latSteps;
+        for (int col = 0; col < colCount; col++) {
+            const double lon = col == lonSteps ? neCoord.longitude() : swCoord.longitude() + lonDiff * col / lonSteps;
+            coordinates.append(QGeoCoordinate(lat, lon));
+        }
+    }
+
+    qCDebug(TerrainQueryLog) << "TerrainTileManager::carpetQueryToCoords swCoord:neCoord:rows:cols" << swCoord << neCoord << rowCount << colCount;
+
+    return coordinates;
+}
+
+void TerrainTileManager::addCarpetQuery(TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly)
+{
+    int rowCount;
+    int colCount;
+    QList<QGeoCoordinate> coordinates = carpetQueryToCoords(swCoord, neCoord, rowCount, colCount);
+    if (coordinates.isEmpty()) {
+        qCWarning(TerrainQueryLog) << "addCarpetQuery: carpet too large" << rowCount << colCount;
+        terrainQueryInterface->_signalCarpetHeights(false, qQNaN(), qQNaN(), QList<QList<double>>());
+        return;
+    }
+
+    QueuedRequestInfo_t requestInfo = { { terrainQueryInterface }, QueryMode::QueryModeCarpet, 0, 0, coordinates, colCount, statsOnly, {} };
+    _addRequest(requestInfo);
+}
+
+/// Answers the request from cached tiles if possible, otherwise queues it against the tiles it is missing
+void TerrainTileManager::_addRequest(const QueuedRequestInfo_t& requestInfo)
+{
+    // Identical queries are common (the same transects re-queried while editing for example), they share the
+    // queued request and all get the result
+    for (QueuedRequestInfo_t& queuedRequestInfo: _requestQueue) {
+        if (queuedRequestInfo.queryMode == requestInfo.queryMode && queuedRequestInfo.carpetStatsOnly == requestInfo.carpetStatsOnly && queuedRequestInfo.coordinates == requestInfo.coordinates) {
+            qCDebug(TerrainQueryLog) << "TerrainTileManager::_addRequest joining queued request";
+            queuedRequestInfo.terrainQueryInterfaces.append(requestInfo.terrainQueryInterfaces);
+            return;
+        }
+    }
+
+    QueuedRequestInfo_t newRequestInfo = requestInfo;
+    if (_resolveRequest(newRequestInfo)) {
         return;
     }
 
+    const quint64 requestId = _nextRequestId++;
+    _queueRequest(requestId, newRequestInfo);
+    qCDebug(TerrainQueryLog) << "TerrainTileManager::_addRequest queue count:missing tiles" << _requestQueue.count() << newRequestInfo.missingTiles.count();
+}
+
+void TerrainTileManager::_queueRequest(quint64 requestId, const QueuedRequestInfo_t& requestInfo)
+{
+    for (quint64 key: requestInfo.missingTiles) {
+        _tileWaiters[key].append(requestId);
+    }
+    _requestQueue[requestId] = requestInfo;
+}
+
+/// Looks up the heights for the request and signals them
+///     @return false: Tiles are missing, requestInfo.missingTiles holds the ones being waited on
+bool TerrainTileManager::_resolveRequest(QueuedRequestInfo_t& requestInfo)
+{
+    bool            error;
+    QList<double>   altitudes;
+    bool            ready;
+
+    requestInfo.missingTiles.clear();
+    if (requestInfo.queryMode == QueryMode::QueryModePath) {
+        ready = getAltitudesForPath(requestInfo.coordinates[0], requestInfo.coordinates[1], altitudes, requestInfo.distanceBetween, requestInfo.finalDistanceBetween, error, &requestInfo.missingTiles);
+    } else {
+        ready = getAltitudesForCoordinates(requestInfo.coordinates, altitudes, error, &requestInfo.missingTiles);
+    }
+    if (!ready) {
+        return false;
+    }
+
     if (error) {
-        QList<double> noAltitudes;
-        qCWarning(TerrainQueryLog) << "addPathQuery: signalling failure due to internal error";
-        terrainQueryInterface->_signalPathHeights(false, distanceBetween, finalDistanceBetween, noAltitudes);
+        qCWarning(TerrainQueryLog) << "TerrainTileManager::_resolveRequest: signalling failure due to internal error";
     } else {
-        qCDebug(TerrainQueryLog) << "addPathQuery: All altitudes taken from cached data";
-        terrainQueryInterface->_signalPathHeights(coordinates.count() == altitudes.count(), distanceBetween, finalDistanceBetween, altitudes);
+        qCDebug(TerrainQueryLog) << "TerrainTileManager::_resolveRequest: All altitudes taken from cached data";
+    }
+    _signalResult(requestInfo, error, altitudes);
+
+    return true;
+}
+
+/// Fans the result out to everyone waiting on the request
+void TerrainTileManager::_signalResult(const QueuedRequestInfo_t& requestInfo, bool error, const QList<double>& altitudes)
+{
+    const QList<double> noAltitudes;
+
+    switch (requestInfo.queryMode) {
+    case QueryMode::QueryModeCoordinates:
+        for (TerrainOfflineAirMapQuery* terrainQueryInterface: requestInfo.terrainQueryInterfaces) {
+            terrainQueryInterface->_signalCoordinateHeights(!error && requestInfo.coordinates.count() == altitudes.count(), error ? noAltitudes : altitudes);
+        }
+        break;
+    case QueryMode::QueryModePath:
+        for (TerrainOfflineAirMapQuery* terrainQueryInterface: requestInfo.terrainQueryInterfaces) {
+            terrainQueryInterface->_signalPathHeights(!error && !altitudes.isEmpty(), requestInfo.distanceBetween, requestInfo.finalDistanceBetween, error ? noAltitudes : altitudes);
+        }
+        break;
+    case QueryMode::QueryModeCarpet:
+    {
+        double                  minHeight   = qQNaN();
+        double                  maxHeight   = qQNaN();
+        QList<QList<double>>    carpet;
+        const bool              success     = !error && !altitudes.isEmpty() && altitudes.count() == requestInfo.coordinates.count();
+        if (success) {
+            _buildCarpet(requestInfo, altitudes, minHeight, maxHeight, carpet);
+        }
+        for (TerrainOfflineAirMapQuery* terrainQueryInterface: requestInfo.terrainQueryInterfaces) {
+            terrainQueryInterface->_signalCarpetHeights(success, minHeight, maxHeight, carpet);
+        }
+        break;
+    }
+    }
+}
+
+/// Splits the carpet altitudes into rows, collecting min/max on the way through
+void TerrainTileManager::_buildCarpet(const QueuedRequestInfo_t& requestInfo, const QList<double>& altitudes, double& minHeight, double& maxHeight, QList<QList<double>>& carpet)
+{
+    minHeight = altitudes.first();
+    maxHeight = altitudes.first();
+
+    for (int rowStart = 0; rowStart < altitudes.count(); rowStart += requestInfo.carpetColCount) {
+        QList<double> row;
+        if (!requestInfo.carpetStatsOnly) {
+            row.reserve(requestInfo.carpetColCount);
+        }
+        for (int i = rowStart; i < rowStart + requestInfo.carpetColCount; i++) {
+            const double height = altitudes[i];
+            minHeight = qMin(minHeight, height);
+            maxHeight = qMax(maxHeight, height);
+            if (!requestInfo.carpetStatsOnly) {
+                row.append(height);
+            }
+        }
+        if (!requestInfo.carpetStatsOnly) {
+            carpet.append(row);
+        }
     }
 }
 
 /// Either returns altitudes from cache or queues database request
 ///     @param[out] error true: altitude not returned due to error, false: altitudes returned
 /// @return true: altitude returned (check error as well), false: database query queued (altitudes not returned)
-bool TerrainTileManager::getAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error)
+bool TerrainTileManager::getAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error, QSet<quint64>* missingTiles)
+{
+    const int       count = coordinates.count();
+    QVector<double> lats(count);
+    QVector<double> lons(count);
+    QVector<double> elevations(count);
+
+    for (int i = 0; i < count; i++) {
+        lats[i] = coordinates[i].latitude();
+        lons[i] = coordinates[i].longitude();
+    }
+
+    qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates count" << count;
+
+    if (!_getAltitudes(lats.constData(), lons.constData(), count, false /* interpolate */, elevations.data(), error, missingTiles)) {
+        return false;
+    }
+
+    altitudes.reserve(altitudes.count() + count);
+    for (double elevation: elevations) {
+        altitudes.push_back(elevation);
+    }
+
+    return true;
+}
+
+/// Resolves the elevations from the tile cache, requesting any missing tiles
+///     @param interpolate true: bilinear interpolation, false: nearest grid value
+///     @param[out] missingTiles Keys of the missing tiles, may be nullptr
+///     @return false: tiles are missing and have been requested
+bool TerrainTileManager::_getAltitudes(const double* lats, const double* lons, int count, bool interpolate, double* elevations, bool& error, QSet<quint64>* missingTiles)
 {
     error = false;
 
-    for (const QGeoCoordinate& coordinate: coordinates) {
-        QString tileHash = _getTileHash(coordinate);
-        qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates hash:coordinate" << tileHash << coordinate;
+    QVector<quint64> keys(count);
+    for (int i = 0; i < count; i++) {
+        keys[i] = _tileKey(lats[i], lons[i]);
+    }
+
+    QMutexLocker lock(&_tilesMutex);
+
+    // Path and carpet samples arrive in runs which fall in the same tile, so the walk moves from tile to tile
+    // along the path and each run is resolved in a single call
+    bool tilesMissing = false;
+    int runStart = 0;
+    while (runStart < count) {
+        const quint64 key = keys[runStart];
+        int runEnd = runStart + 1;
+        while (runEnd < count && keys[runEnd] == key) {
+            runEnd++;
+        }
 
-        _tilesMutex.lock();
-        if (_tiles.contains(tileHash)) {
-            double elevation = _tiles[tileHash].elevation(coordinate);
-            if (qIsNaN(elevation)) {
+        TerrainTile* tile = _cachedTile(key);
+        if (!tile) {
+            // Keep going so all the missing tiles are fetched together rather than one round trip per tile
+            _queueTile(key);
+            if (missingTiles) {
+                missingTiles->insert(key);
+            }
+            tilesMissing = true;
+        } else if (!tilesMissing) {
+            const int runCount = runEnd - runStart;
+            const bool inside = interpolate ?
+                        tile->interpolatedElevations(lats + runStart, lons + runStart, runCount, elevations + runStart) :
+                        tile->elevations(lats + runStart, lons + runStart, runCount, elevations + runStart);
+            if (!inside) {
                 error = true;
-                qCWarning(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates Internal Error: missing elevation in tile cache";
-            } else {
-                qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates returning elevation from tile cache" << elevation;
+                qCWarning(TerrainQueryLog) << "TerrainTileManager::_getAltitudes Internal Error: missing elevation in tile cache";
             }
-            altitudes.push_back(elevation);
+        }
+
+        runStart = runEnd;
+    }
+
+    if (!tilesMissing && interpolate && !_interpolateTileEdges(lats, lons, keys.constData(), count, elevations, error, missingTiles)) {
+        tilesMissing = true;
+    }
+
+    if (tilesMissing) {
+        error = false;
+        return false;
+    }
+
+    return true;
+}
+
+/// Redoes the interpolation for the samples within half a cell of a tile edge, whose surrounding grid values lie
+/// partly in the adjacent tiles. Without it the clamped per tile interpolation leaves a seam at every tile edge.
+/// Called with the tile lock held.
+///     @return false: adjacent tiles are missing and have been requested
+bool TerrainTileManager::_interpolateTileEdges(const double* lats, const double* lons, const quint64* keys, int count, double* elevations, bool& error, QSet<quint64>* missingTiles)
+{
+    typedef struct {
+        int     index;
+        double  cornerLats[2];
+        double  cornerLons[2];
+        double  latFrac;
+        double  lonFrac;
+    } EdgeSample_t;
+
+    // Tile pointers are only good until the next _cachedTile call, which may evict them. So the edge samples are
+    // all collected first and the adjacent tiles looked up one corner at a time after.
+    QVector<EdgeSample_t>   edgeSamples;
+    bool                    tilesMissing = false;
+    int                     runStart = 0;
+    while (runStart < count) {
+        const quint64 key = keys[runStart];
+        int runEnd = runStart + 1;
+        while (runEnd < count && keys[runEnd] == key) {
+            runEnd++;
+        }
+
+        const TerrainTile* tile = _cachedTile(key);
+        if (!tile) {
+            // Evicted while the other tiles were loaded
+            _queueTile(key);
+            if (missingTiles) {
+                missingTiles->insert(key);
+            }
+            tilesMissing = true;
         } else {
-            if (_state != State::Downloading) {
-                QNetworkRequest request = getQGCMapEngine()->urlFactory()->getTileURL(
-                    kMapType, getQGCMapEngine()->urlFactory()->long2tileX(kMapType, coordinate.longitude(), 1),
-                    getQGCMapEngine()->urlFactory()->lat2tileY(kMapType, coordinate.latitude(), 1),
-                    1,
-                    &_networkManager);
-                qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates query from database" << request.url();
-                QGeoTileSpec spec;
-                spec.setX(getQGCMapEngine()->urlFactory()->long2tileX(kMapType, coordinate.longitude(), 1));
-                spec.setY(getQGCMapEngine()->urlFactory()->lat2tileY(kMapType, coordinate.latitude(), 1));
-                spec.setZoom(1);
-                spec.setMapId(getQGCMapEngine()->urlFactory()->getIdFromType(kMapType));
-                QGeoTiledMapReplyQGC* reply = new QGeoTiledMapReplyQGC(&_networkManager, request, spec);
-                connect(reply, &QGeoTiledMapReplyQGC::terrainDone, this, &TerrainTileManager::_terrainDone);
-                _state = State::Downloading;
+            for (int i = runStart; i < runEnd; i++) {
+                EdgeSample_t sample;
+                sample.index = i;
+                if (!tile->neighbourhood(lats[i], lons[i], sample.cornerLats, sample.cornerLons, sample.latFrac, sample.lonFrac)) {
+                    edgeSamples.append(sample);
+                }
             }
-            _tilesMutex.unlock();
+        }
 
-            return false;
+        runStart = runEnd;
+    }
+
+    for (const EdgeSample_t& sample: edgeSamples) {
+        double corners[2][2] = {};
+        for (int row = 0; row < 2; row++) {
+            for (int col = 0; col < 2; col++) {
+                const quint64   cornerKey   = _tileKey(sample.cornerLats[row], sample.cornerLons[col]);
+                TerrainTile*    cornerTile  = _cachedTile(cornerKey);
+                if (!cornerTile) {
+                    _queueTile(cornerKey);
+                    if (missingTiles) {
+                        missingTiles->insert(cornerKey);
+                    }
+                    tilesMissing = true;
+                } else if (!cornerTile->elevations(&sample.cornerLats[row], &sample.cornerLons[col], 1, &corners[row][col])) {
+                    error = true;
+                }
+            }
+        }
+        if (!tilesMissing) {
+            const double south = corners[0][0] + (corners[0][1] - corners[0][0]) * sample.lonFrac;
+            const double north = corners[1][0] + (corners[1][1] - corners[1][0]) * sample.lonFrac;
+            elevations[sample.index] = south + (north - south) * sample.latFrac;
         }
-        _tilesMutex.unlock();
     }
 
-    return true;
+    return !tilesMissing;
 }
 
-void TerrainTileManager::_tileFailed(void)
+/// @return Tile from the memory cache, falling back to the on disk store. nullptr if neither has it.
+TerrainTile* TerrainTileManager::_cachedTile(quint64 key)
 {
-    QList<double> noAltitudes;
+    TerrainTile* tile = _tiles.object(key);
+    if (tile) {
+        return tile;
+    }
 
-    for (const QueuedRequestInfo_t& requestInfo: _requestQueue) {
-        if (requestInfo.queryMode == QueryMode::QueryModeCoordinates) {
-            requestInfo.terrainQueryInterface->_signalCoordinateHeights(false, noAltitudes);
-        } else if (requestInfo.queryMode == QueryMode::QueryModePath) {
-            requestInfo.terrainQueryInterface->_signalPathHeights(false, requestInfo.distanceBetween, requestInfo.finalDistanceBetween, noAltitudes);
+    const QByteArray bytes = _store.load(static_cast<int>(static_cast<quint32>(key)), static_cast<int>(static_cast<quint32>(key >> 32)));
+    if (bytes.isEmpty()) {
+        return nullptr;
+    }
+    tile = new TerrainTile(bytes);
+    if (!tile->isValid()) {
+        qCWarning(TerrainQueryLog) << "Invalid tile in terrain store" << key;
+        delete tile;
+        return nullptr;
+    }
+    _tiles.insert(key, tile, tile->byteCount());
+
+    return _tiles.object(key);
+}
+
+void TerrainTileManager::prefetchArea(const QGeoRectangle& area)
+{
+    if (!area.isValid()) {
+        return;
+    }
+
+    // The plan bounds change with every edit, while an item is dragged for example. Only the area they settle on
+    // is worth fetching.
+    _prefetchArea = area;
+    _prefetchTimer.start();
+}
+
+void TerrainTileManager::_prefetchTimeout(void)
+{
+    _queuePrefetch(_prefetchArea);
+}
+
+void TerrainTileManager::_queuePrefetch(const QGeoRectangle& area)
+{
+    const int x0 = static_cast<int>(std::floor((area.topLeft().longitude() + 180.0) / TerrainTile::tileSizeDegrees));
+    const int x1 = static_cast<int>(std::floor((area.bottomRight().longitude() + 180.0) / TerrainTile::tileSizeDegrees));
+    const int y0 = static_cast<int>(std::floor((area.bottomRight().latitude() + 90.0) / TerrainTile::tileSizeDegrees));
+    const int y1 = static_cast<int>(std::floor((area.topLeft().latitude() + 90.0) / TerrainTile::tileSizeDegrees));
+
+    const qint64 tileCount = static_cast<qint64>(x1 - x0 + 1) * (y1 - y0 + 1);
+    if (tileCount > _maxPrefetchTiles) {
+        qCWarning(TerrainQueryLog) << "TerrainTileManager::_queuePrefetch area too large" << area << tileCount;
+        return;
+    }
+
+    QMutexLocker lock(&_tilesMutex);
+
+    // Replaces anything still waiting from an earlier area, only the latest one is of interest
+    _prefetchQueue.clear();
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (!_store.contains(x, y)) {
+                _prefetchQueue.append(_tileKey(x, y));
+            }
         }
     }
-    _requestQueue.clear();
+    qCDebug(TerrainQueryLog) << "TerrainTileManager::_queuePrefetch" << area << "tiles:missing" << tileCount << _prefetchQueue.count();
+
+    _requestNextTiles();
+}
+
+void TerrainTileManager::requestPolyPathTiles(const QList<QGeoCoordinate>& polyPath)
+{
+    QMutexLocker lock(&_tilesMutex);
+
+    for (int i = 0; i < polyPath.count() - 1; i++) {
+        QVector<double> lats;
+        QVector<double> lons;
+        double          distanceBetween;
+        double          finalDistanceBetween;
+        _pathSamples(polyPath[i], polyPath[i + 1], lats, lons, distanceBetween, finalDistanceBetween);
+
+        quint64 lastKey = 0;
+        for (int j = 0; j < lats.count(); j++) {
+            const quint64 key = _tileKey(lats[j], lons[j]);
+            if ((j == 0 || key != lastKey) && !_tiles.contains(key) && !_store.contains(static_cast<int>(static_cast<quint32>(key)), static_cast<int>(static_cast<quint32>(key >> 32)))) {
+                _queueTile(key);
+            }
+            lastKey = key;
+        }
+    }
+}
+
+/// Fetches the tile, or queues it if the maximum number of fetches are already in flight
+void TerrainTileManager::_queueTile(quint64 key)
+{
+    if (_pendingTiles.contains(key) || _tileQueue.contains(key)) {
+        return;
+    }
+    if (_pendingTiles.count() < _maxPendingTiles) {
+        _requestTile(key);
+    } else {
+        _tileQueue.append(key);
+    }
+}
+
+/// Tops up the tile fetches in flight, tiles needed by queries first then prefetching once no queries are waiting
+void TerrainTileManager::_requestNextTiles(void)
+{
+    while (_pendingTiles.count() < _maxPendingTiles) {
+        quint64 key;
+        if (!_tileQueue.isEmpty()) {
+            key = _tileQueue.takeFirst();
+        } else if (_requestQueue.isEmpty() && !_prefetchQueue.isEmpty()) {
+            key = _prefetchQueue.takeFirst();
+        } else {
+            break;
+        }
+        if (!_pendingTiles.contains(key) && !_tiles.contains(key) && !_store.contains(static_cast<int>(static_cast<quint32>(key)), static_cast<int>(static_cast<quint32>(key >> 32)))) {
+            _requestTile(key);
+        }
+    }
+}
+
+void TerrainTileManager::_requestTile(quint64 key)
+{
+    _pendingTiles.insert(key);
+    _fetchTile(key);
+}
+
+void TerrainTileManager::_fetchTile(quint64 key)
+{
+    UrlFactory* urlFactory  = getQGCMapEngine()->urlFactory();
+    const int   x           = static_cast<int>(static_cast<quint32>(key));
+    const int   y           = static_cast<int>(static_cast<quint32>(key >> 32));
+
+    QNetworkRequest request = urlFactory->getTileURL(kMapType, x, y, 1, &_networkManager);
+    qCDebug(TerrainQueryLog) << "TerrainTileManager::_requestTile query from database" << request.url();
+    QGeoTileSpec spec;
+    spec.setX(x);
+    spec.setY(y);
+    spec.setZoom(1);
+    spec.setMapId(urlFactory->getIdFromType(kMapType));
+    QGeoTiledMapReplyQGC* reply = new QGeoTiledMapReplyQGC(&_networkManager, request, spec);
+    connect(reply, &QGeoTiledMapReplyQGC::terrainDone, this, &TerrainTileManager::_terrainDone);
 }
 
 void TerrainTileManager::_terrainDone(QByteArray responseBytes, QNetworkReply::NetworkError error)
 {
     QGeoTiledMapReplyQGC* reply = qobject_cast<QGeoTiledMapReplyQGC*>(QObject::sender());
-    _state = State::Idle;
 
     if (!reply) {
         qCWarning(TerrainQueryLog) << "Elevation tile fetched but invalid reply data type.";
         return;
     }
+    reply->deleteLater();
+
+    const QGeoTileSpec spec = reply->tileSpec();
+    _tileDone(_tileKey(spec.x(), spec.y()), responseBytes, error);
+}
+
+/// Stores the fetched tile and resolves the requests which were waiting on it
+void TerrainTileManager::_tileDone(quint64 key, const QByteArray& responseBytes, QNetworkReply::NetworkError error)
+{
+    const int x = static_cast<int>(static_cast<quint32>(key));
+    const int y = static_cast<int>(static_cast<quint32>(key >> 32));
 
     // remove from download queue
-    QGeoTileSpec spec = reply->tileSpec();
-    QString hash = QGCMapEngine::getTileHash(kMapType, spec.x(), spec.y(), spec.zoom());
+    _pendingTiles.remove(key);
 
     // handle potential errors
+    bool tileValid = false;
     if (error != QNetworkReply::NoError) {
         qCWarning(TerrainQueryLog) << "Elevation tile fetching returned error (" << error << ")";
-        _tileFailed();
-        reply->deleteLater();
-        return;
-    }
-    if (responseBytes.isEmpty()) {
+    } else if (responseBytes.isEmpty()) {
         qCWarning(TerrainQueryLog) << "Error in fetching elevation tile. Empty response.";
-        _tileFailed();
-        reply->deleteLater();
-        return;
-    }
-
-    qCDebug(TerrainQueryLog) << "Received some bytes of terrain data: " << responseBytes.size();
-
-    TerrainTile* terrainTile = new TerrainTile(responseBytes);
-    if (terrainTile->isValid()) {
-        _tilesMutex.lock();
-        if (!_tiles.contains(hash)) {
-            _tiles.insert(hash, *terrainTile);
+    } else {
+        qCDebug(TerrainQueryLog) << "Received some bytes of terrain data: " << responseBytes.size();
+
+        TerrainTile* terrainTile = new TerrainTile(responseBytes);
+        if (terrainTile->isValid()) {
+            _tilesMutex.lock();
+            _store.save(x, y, responseBytes);
+            if (!_tiles.contains(key)) {
+                // Takes ownership, oldest tiles are evicted once the cache is over budget
+                _tiles.insert(key, terrainTile, terrainTile->byteCount());
+            } else {
+                delete terrainTile;
+            }
+            _tilesMutex.unlock();
+            tileValid = true;
         } else {
             delete terrainTile;
+            qCWarning(TerrainQueryLog) << "Received invalid tile";
         }
-        _tilesMutex.unlock();
-    } else {
-        delete terrainTile;
-        qCWarning(TerrainQueryLog) << "Received invalid tile";
     }
-    reply->deleteLater();
 
-    // now try to query the data again
-    for (int i = _requestQueue.count() - 1; i >= 0; i--) {
-        bool error;
-        QList<double> altitudes;
-        QueuedRequestInfo_t& requestInfo = _requestQueue[i];
-
-        if (getAltitudesForCoordinates(requestInfo.coordinates, altitudes, error)) {
-            if (requestInfo.queryMode == QueryMode::QueryModeCoordinates) {
-                if (error) {
-                    QList<double> noAltitudes;
-                    qCWarning(TerrainQueryLog) << "_terrainDone(coordinateQuery): signalling failure due to internal error";
-                    requestInfo.terrainQueryInterface->_signalCoordinateHeights(false, noAltitudes);
-                } else {
-                    qCDebug(TerrainQueryLog) << "_terrainDone(coordinateQuery): All altitudes taken from cached data";
-                    requestInfo.terrainQueryInterface->_signalCoordinateHeights(requestInfo.coordinates.count() == altitudes.count(), altitudes);
-                }
-            } else if (requestInfo.queryMode == QueryMode::QueryModePath) {
-                if (error) {
-                    QList<double> noAltitudes;
-                    qCWarning(TerrainQueryLog) << "_terrainDone(coordinateQuery): signalling failure due to internal error";
-                    requestInfo.terrainQueryInterface->_signalPathHeights(false, requestInfo.distanceBetween, requestInfo.finalDistanceBetween, noAltitudes);
-                } else {
-                    qCDebug(TerrainQueryLog) << "_terrainDone(coordinateQuery): All altitudes taken from cached data";
-                    requestInfo.terrainQueryInterface->_signalPathHeights(requestInfo.coordinates.count() == altitudes.count(), requestInfo.distanceBetween, requestInfo.finalDistanceBetween, altitudes);
-                }
+    // Only the requests waiting on this tile are looked at again, and only once they have all their tiles
+    for (quint64 requestId: _tileWaiters.take(key)) {
+        auto it = _requestQueue.find(requestId);
+        if (it == _requestQueue.end()) {
+            // Already failed through another tile
+            continue;
+        }
+
+        if (!tileValid) {
+            // Out of the queue before signalling, receivers may queue new requests
+            QueuedRequestInfo_t requestInfo = *it;
+            _requestQueue.erase(it);
+            _signalResult(requestInfo, true /* error */, QList<double>());
+            continue;
+        }
+
+        it->missingTiles.remove(key);
+        if (it->missingTiles.isEmpty()) {
+            QueuedRequestInfo_t requestInfo = *it;
+            _requestQueue.erase(it);
+            if (!_resolveRequest(requestInfo)) {
+                // Tiles were evicted from the cache in the meantime, wait for them again
+                _queueRequest(requestId, requestInfo);
             }
-            _requestQueue.removeAt(i);
         }
     }
+
+    _tilesMutex.lock();
+    _requestNextTiles();
+    _tilesMutex.unlock();
 }
 
-QString TerrainTileManager::_getTileHash(const QGeoCoordinate& coordinate)
+quint64 TerrainTileManager::_tileKey(double latitude, double longitude)
 {
-    QString ret = QGCMapEngine::getTileHash(
-        kMapType,
-        getQGCMapEngine()->urlFactory()->long2tileX(kMapType, coordinate.longitude(), 1),
-        getQGCMapEngine()->urlFactory()->lat2tileY(kMapType, coordinate.latitude(), 1),
-        1);
-    qCDebug(TerrainQueryVerboseLog) << "Computing unique tile hash for " << coordinate << ret;
-
-    return ret;
+    // Same tiling as the elevation provider's long2tileX/lat2tileY
+    return _tileKey(static_cast<int>(std::floor((longitude + 180.0) / TerrainTile::tileSizeDegrees)),
+                    static_cast<int>(std::floor((latitude + 90.0) / TerrainTile::tileSizeDegrees)));
 }
 
 TerrainAtCoordinateBatchManager::TerrainAtCoordinateBatchManager(void)
@@ -723,9 +1163,24 @@ void TerrainAtCoordinateQuery::requestData(const QList<QGeoCoordinate>& coordina
 
 bool TerrainAtCoordinateQuery::getAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error)
 {
+    if (qgcApp()->runningUnitTests()) {
+        altitudes = UnitTestTerrainQuery::coordinateHeights(coordinates);
+        error = altitudes.count() != coordinates.count();
+        return true;
+    }
+
     return _terrainTileManager->getAltitudesForCoordinates(coordinates, altitudes, error);
 }
 
+void TerrainAtCoordinateQuery::prefetchArea(const QGeoRectangle& area)
+{
+    if (qgcApp()->runningUnitTests()) {
+        return;
+    }
+
+    _terrainTileManager->prefetchArea(area);
+}
+
 void TerrainAtCoordinateQuery::_signalTerrainData(bool success, QList<double>& heights)
 {
     emit terrainDataReceived(success, heights);
@@ -780,6 +1235,11 @@ void TerrainPolyPathQuery::requestData(const QList<QGeoCoordinate>& polyPath)
 {
     qCDebug(TerrainQueryLog) << "TerrainPolyPathQuery::requestData count" << polyPath.count();
 
+    // The segments are queried one after the other, get the tiles for all of them on the way at once
+    if (!qgcApp()->runningUnitTests()) {
+        _terrainTileManager->requestPolyPathTiles(polyPath);
+    }
+
     // Kick off first request
     _rgCoords = polyPath;
     _curIndex = 0;
@@ -847,7 +1307,7 @@ UnitTestTerrainQuery::UnitTestTerrainQuery(TerrainQueryInterface* parent)
 }
 
 void UnitTestTerrainQuery::requestCoordinateHeights(const QList<QGeoCoordinate>& coordinates) {
-    QList<double> result = _requestCoordinateHeights(coordinates);
+    QList<double> result = coordinateHeights(coordinates);
     emit qobject_cast<TerrainQueryInterface*>(parent())->coordinateHeightsReceived(result.size() == coordinates.size(), result);
 }
 
@@ -895,12 +1355,12 @@ UnitTestTerrainQuery::PathHeightInfo_t UnitTestTerrainQuery::_requestPathHeights
     PathHeightInfo_t   pathHeights;
 
     pathHeights.rgCoords    = TerrainTileManager::pathQueryToCoords(fromCoord, toCoord, pathHeights.distanceBetween, pathHeights.finalDistanceBetween);
-    pathHeights.rgHeights   = _requestCoordinateHeights(pathHeights.rgCoords);
+    pathHeights.rgHeights   = coordinateHeights(pathHeights.rgCoords);
 
     return pathHeights;
 }
 
-QList<double> UnitTestTerrainQuery::_requestCoordinateHeights(const QList<QGeoCoordinate>& coordinates)
+QList<double> UnitTestTerrainQuery::coordinateHeights(const QList<QGeoCoordinate>& coordinates)
 {
     QList<double> result;
 
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "TerrainTile.h"
+#include "TerrainTileStore.h"
 #include "QGCMapEngineData.h"
 #include "QGCLoggingCategory.h"
 
@@ -19,6 +20,12 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QTimer>
+#include <QCache>
+#include <QMutex>
+#include <QSet>
+#include <QMap>
+#include <QHash>
+#include <QVector>
 #include <QtLocation/private/qgeotiledmapreply_p.h>
 
 Q_DECLARE_LOGGING_CATEGORY(TerrainQueryLog)
@@ -113,24 +120,36 @@ public:
 class TerrainTileManager : public QObject {
     Q_OBJECT
 
+    friend class TerrainQueryTest;
+
 public:
     TerrainTileManager(void);
 
     void addCoordinateQuery         (TerrainOfflineAirMapQuery* terrainQueryInterface, const QList<QGeoCoordinate>& coordinates);
     void addPathQuery               (TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate& startPoint, const QGeoCoordinate& endPoint);
-    bool getAltitudesForCoordinates (const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error);
+    void addCarpetQuery             (TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly);
+    bool getAltitudesForCoordinates (const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error, QSet<quint64>* missingTiles = nullptr);
+    bool getAltitudesForPath        (const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, QList<double>& altitudes, double& distanceBetween, double& finalDistanceBetween, bool& error, QSet<quint64>* missingTiles = nullptr);
+
+    /// Fetches all the tiles covering the area into the on disk terrain store in the background, once the area
+    /// has stopped changing for _prefetchDelayMsecs
+    void prefetchArea               (const QGeoRectangle& area);
+
+    /// Fetches the tiles along all the segments of the path ahead of the segments being queried
+    void requestPolyPathTiles       (const QList<QGeoCoordinate>& polyPath);
 
     static QList<QGeoCoordinate> pathQueryToCoords(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, double& distanceBetween, double& finalDistanceBetween);
 
+    /// Returns a row major grid of coordinates covering the area, spaced according to the terrain tile value spacing
+    ///     @param[out] rowCount Number of rows (latitude steps) in the grid
+    ///     @param[out] colCount Number of columns (longitude steps) in the grid
+    static QList<QGeoCoordinate> carpetQueryToCoords(const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, int& rowCount, int& colCount);
+
 private slots:
     void _terrainDone(QByteArray responseBytes, QNetworkReply::NetworkError error);
+    void _prefetchTimeout(void);
 
 private:
-    enum class State {
-        Idle,
-        Downloading,
-    };
-
     enum QueryMode {
         QueryModeCoordinates,
         QueryModePath,
@@ -138,22 +157,58 @@ private:
     };
 
     typedef struct {
-        TerrainOfflineAirMapQuery*  terrainQueryInterface;
-        QueryMode                   queryMode;
-        double                      distanceBetween;        // Distance between each returned height
-        double                      finalDistanceBetween;   // Distance between for final height
-        QList<QGeoCoordinate>       coordinates;
+        QList<TerrainOfflineAirMapQuery*>   terrainQueryInterfaces; // Everyone waiting on an identical query
+        QueryMode                           queryMode;
+        double                              distanceBetween;        // Distance between each returned height
+        double                              finalDistanceBetween;   // Distance between for final height
+        QList<QGeoCoordinate>               coordinates;            // Path queries: start and end point
+        int                                 carpetColCount;         // Number of columns in each carpet row
+        bool                                carpetStatsOnly;        // true: Only min/max are returned for the carpet
+        QSet<quint64>                       missingTiles;           // Tiles the query is waiting on
     } QueuedRequestInfo_t;
 
-    void    _tileFailed                         (void);
-    QString _getTileHash                        (const QGeoCoordinate& coordinate);
-
-    QList<QueuedRequestInfo_t>  _requestQueue;
-    State                       _state = State::Idle;
+    void    _addRequest                         (const QueuedRequestInfo_t& requestInfo);
+    void    _queueRequest                       (quint64 requestId, const QueuedRequestInfo_t& requestInfo);
+    bool    _resolveRequest                     (QueuedRequestInfo_t& requestInfo);
+    void    _signalResult                       (const QueuedRequestInfo_t& requestInfo, bool error, const QList<double>& altitudes);
+    void    _queueTile                          (quint64 key);
+    void    _requestTile                        (quint64 key);
+    void    _tileDone                           (quint64 key, const QByteArray& responseBytes, QNetworkReply::NetworkError error);
+    void    _requestNextTiles                   (void);
+    void    _queuePrefetch                      (const QGeoRectangle& area);
+    TerrainTile* _cachedTile                    (quint64 key);
+    bool    _getAltitudes                       (const double* lats, const double* lons, int count, bool interpolate, double* elevations, bool& error, QSet<quint64>* missingTiles);
+    bool    _interpolateTileEdges               (const double* lats, const double* lons, const quint64* keys, int count, double* elevations, bool& error, QSet<quint64>* missingTiles);
+
+    /// Starts the download of the tile, which completes through _tileDone. Virtual so unit tests can stub the tile source.
+    virtual void _fetchTile                     (quint64 key);
+
+    static void _pathSamples(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, QVector<double>& lats, QVector<double>& lons, double& distanceBetween, double& finalDistanceBetween);
+    static void _buildCarpet(const QueuedRequestInfo_t& requestInfo, const QList<double>& altitudes, double& minHeight, double& maxHeight, QList<QList<double>>& carpet);
+
+    /// Tiles are keyed by their integer x/y tile indices rather than a string hash
+    static quint64 _tileKey(int x, int y) { return (static_cast<quint64>(static_cast<quint32>(y)) << 32) | static_cast<quint32>(x); }
+    static quint64 _tileKey(double latitude, double longitude);
+
+    QMap<quint64, QueuedRequestInfo_t>  _requestQueue;          ///< Queries waiting on tiles, by request id in arrival order
+    quint64                             _nextRequestId = 0;
+    QHash<quint64, QList<quint64>>      _tileWaiters;           ///< Tile key to the ids of the requests waiting on it
+    QSet<quint64>                       _pendingTiles;          ///< Tiles currently being fetched
+    QList<quint64>                      _tileQueue;             ///< Tiles needed by queries, waiting for a free fetch slot
+    QList<quint64>                      _prefetchQueue;         ///< Tiles waiting to be prefetched, only fetched while no queries are queued
+    QGeoRectangle                       _prefetchArea;
+    QTimer                              _prefetchTimer;
     QNetworkAccessManager       _networkManager;
 
-    QMutex                      _tilesMutex;
-    QHash<QString, TerrainTile> _tiles;
+    QMutex                          _tilesMutex;
+    TerrainTileStore                _store;
+    QCache<quint64, TerrainTile>    _tiles;                 ///< LRU of decoded tiles, cost is the tile size in bytes
+
+    static const int _maxTileCacheBytes = 32 * 1024 * 1024;
+    static const int _maxPendingTiles   = 16;               ///< Tile fetches in flight at once, the cache database serves them in parallel
+    static const int _maxCarpetPoints   = 1000000;
+    static const int _maxPrefetchTiles  = 40000;            ///< About four square degrees
+    static const int _prefetchDelayMsecs = 2000;
 };
 
 /// Used internally by TerrainAtCoordinateQuery to batch coordinate requests together
@@ -226,6 +281,9 @@ public:
     /// @return true: altitude returned (check error as well), false: database query queued (altitudes not returned)
     static bool getAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error);
 
+    /// Fetches the terrain for the area into the on disk terrain store so later queries are answered offline
+    static void prefetchArea(const QGeoRectangle& area);
+
     // Internal method
     void _signalTerrainData(bool success, QList<double>& heights);
 
@@ -359,6 +417,10 @@ public:
     void requestPathHeights         (const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord) override;
     void requestCarpetHeights       (const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly) override;
 
+    /// Synchronous version of requestCoordinateHeights
+    /// @return Heights for the coordinates, empty list if any coordinate is outside of the test regions
+    static QList<double> coordinateHeights(const QList<QGeoCoordinate>& coordinates);
+
 private:
     typedef struct {
         QList<QGeoCoordinate>   rgCoords;
@@ -367,7 +429,6 @@ private:
         double                  finalDistanceBetween;
     } PathHeightInfo_t;
 
-    QList<double> _requestCoordinateHeights(const QList<QGeoCoordinate>& coordinates);
     PathHeightInfo_t _requestPathHeights(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord);
 };
 
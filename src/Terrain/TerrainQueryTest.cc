@@ -0,0 +1,481 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainQueryTest.h"
+#include "TerrainQuery.h"
+#include "TerrainTile.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+#include <functional>
+
+namespace {
+
+/// Records the fetches instead of going to the network, the test completes them through _tileDone
+class StubTerrainTileManager : public TerrainTileManager
+{
+public:
+    QList<quint64> fetched;
+
+private:
+    void _fetchTile(quint64 key) final { fetched.append(key); }
+};
+
+/// Collects the coordinate results signalled to a query
+struct CoordinateResults
+{
+    CoordinateResults(TerrainOfflineAirMapQuery* query)
+    {
+        QObject::connect(query, &TerrainQueryInterface::coordinateHeightsReceived, [this](bool success, QList<double> heights) {
+            successes.append(success);
+            this->heights.append(heights);
+        });
+    }
+
+    QList<bool>             successes;
+    QList<QList<double>>    heights;
+};
+
+const int kTileX    = 18854;    // Tile holding 47.395N 8.545E
+const int kTileY    = 13739;
+const int kGridSize = 4;
+
+/// Coordinate at fractional tile indices
+QGeoCoordinate tileCoordinate(double x, double y)
+{
+    return QGeoCoordinate(y * TerrainTile::tileSizeDegrees - 90.0, x * TerrainTile::tileSizeDegrees - 180.0);
+}
+
+QGeoCoordinate tileCenter(int x, int y)
+{
+    return tileCoordinate(x + 0.5, y + 0.5);
+}
+
+/// Serializes a kGridSize square tile, height() is sampled at the grid cell centers
+QByteArray tileBytes(int x, int y, const std::function<double(double lat, double lon)>& height)
+{
+    const double swLat      = y * TerrainTile::tileSizeDegrees - 90.0;
+    const double swLon      = x * TerrainTile::tileSizeDegrees - 180.0;
+    const double cellSize   = TerrainTile::tileSizeDegrees / kGridSize;
+
+    QJsonArray carpet;
+    for (int row = 0; row < kGridSize; row++) {
+        QJsonArray rowValues;
+        for (int col = 0; col < kGridSize; col++) {
+            rowValues.append(height(swLat + (row + 0.5) * cellSize, swLon + (col + 0.5) * cellSize));
+        }
+        carpet.append(rowValues);
+    }
+
+    QJsonObject bounds;
+    bounds["sw"] = QJsonArray({ swLat, swLon });
+    bounds["ne"] = QJsonArray({ swLat + TerrainTile::tileSizeDegrees, swLon + TerrainTile::tileSizeDegrees });
+    QJsonObject stats;
+    stats["min"] = -1000;
+    stats["max"] = 10000;
+    stats["avg"] = 0;
+    QJsonObject data;
+    data["bounds"] = bounds;
+    data["stats"]  = stats;
+    data["carpet"] = carpet;
+    QJsonObject root;
+    root["status"] = "success";
+    root["data"]   = data;
+
+    return TerrainTile::serializeFromAirMapJson(QJsonDocument(root).toJson());
+}
+
+QByteArray flatTileBytes(int x, int y, double elevation)
+{
+    return tileBytes(x, y, [elevation](double, double) { return elevation; });
+}
+
+QByteArray flatTileBytes(quint64 key, double elevation)
+{
+    return flatTileBytes(static_cast<int>(static_cast<quint32>(key)), static_cast<int>(static_cast<quint32>(key >> 32)), elevation);
+}
+
+/// Plane rising 10m per grid cell north and 3m per grid cell east, whole meters at every cell center from the
+/// south west corner of kTileX/kTileY on. Bilinear interpolation reproduces it exactly.
+double slope(double lat, double lon)
+{
+    const double cellSize   = TerrainTile::tileSizeDegrees / kGridSize;
+    const double baseLat    = kTileY * TerrainTile::tileSizeDegrees - 90.0;
+    const double baseLon    = kTileX * TerrainTile::tileSizeDegrees - 180.0;
+
+    return 100.0 + 10.0 * ((lat - baseLat) / cellSize - 0.5) + 3.0 * ((lon - baseLon) / cellSize - 0.5);
+}
+
+QByteArray slopeTileBytes(int x, int y)
+{
+    return tileBytes(x, y, [](double lat, double lon) { return qRound(slope(lat, lon)); });
+}
+
+}
+
+void TerrainQueryTest::_mergeIdenticalRequestsTest(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    StubTerrainTileManager  stub;
+    TerrainTileManager&     manager = stub;
+    manager._store.setDirectory(tempDir.path());
+
+    TerrainOfflineAirMapQuery   query1;
+    TerrainOfflineAirMapQuery   query2;
+    CoordinateResults           results1(&query1);
+    CoordinateResults           results2(&query2);
+    const QList<QGeoCoordinate> coordinates = { tileCenter(kTileX, kTileY) };
+    const quint64               key         = TerrainTileManager::_tileKey(kTileX, kTileY);
+
+    // The second query joins the first rather than queueing and fetching again
+    manager.addCoordinateQuery(&query1, coordinates);
+    manager.addCoordinateQuery(&query2, coordinates);
+    QCOMPARE(stub.fetched, QList<quint64>({ key }));
+    QCOMPARE(manager._requestQueue.count(), 1);
+    QCOMPARE(manager._requestQueue.first().terrainQueryInterfaces.count(), 2);
+    QCOMPARE(manager._tileWaiters.value(key).count(), 1);
+
+    manager._tileDone(key, flatTileBytes(kTileX, kTileY, 42), QNetworkReply::NoError);
+    for (const CoordinateResults* results: { &results1, &results2 }) {
+        QCOMPARE(results->successes, QList<bool>({ true }));
+        QCOMPARE(results->heights, QList<QList<double>>({ { 42.0 } }));
+    }
+    QVERIFY(manager._requestQueue.isEmpty());
+    QVERIFY(manager._tileWaiters.isEmpty());
+    QVERIFY(manager._pendingTiles.isEmpty());
+
+    // With the tile cached the answer comes back straight away
+    TerrainOfflineAirMapQuery   query3;
+    CoordinateResults           results3(&query3);
+    manager.addCoordinateQuery(&query3, coordinates);
+    QCOMPARE(results3.heights, QList<QList<double>>({ { 42.0 } }));
+    QCOMPARE(stub.fetched.count(), 1);
+}
+
+void TerrainQueryTest::_tileWaitersFanoutTest(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    StubTerrainTileManager  stub;
+    TerrainTileManager&     manager = stub;
+    manager._store.setDirectory(tempDir.path());
+
+    const quint64 westKey   = TerrainTileManager::_tileKey(kTileX, kTileY);
+    const quint64 eastKey   = TerrainTileManager::_tileKey(kTileX + 1, kTileY);
+    const quint64 northKey  = TerrainTileManager::_tileKey(kTileX, kTileY + 1);
+
+    // Both queries need the east tile, only the first one the west tile
+    TerrainOfflineAirMapQuery   bothQuery;
+    TerrainOfflineAirMapQuery   eastQuery;
+    TerrainOfflineAirMapQuery   failQuery;
+    CoordinateResults           bothResults(&bothQuery);
+    CoordinateResults           eastResults(&eastQuery);
+    CoordinateResults           failResults(&failQuery);
+    manager.addCoordinateQuery(&bothQuery, { tileCenter(kTileX, kTileY), tileCenter(kTileX + 1, kTileY) });
+    manager.addCoordinateQuery(&eastQuery, { tileCenter(kTileX + 1, kTileY) });
+    manager.addCoordinateQuery(&failQuery, { tileCenter(kTileX + 1, kTileY), tileCenter(kTileX, kTileY + 1) });
+    QCOMPARE(stub.fetched, QList<quint64>({ westKey, eastKey, northKey }));
+    QCOMPARE(manager._requestQueue.count(), 3);
+    QCOMPARE(manager._tileWaiters.value(westKey).count(), 1);
+    QCOMPARE(manager._tileWaiters.value(eastKey).count(), 3);
+    QCOMPARE(manager._tileWaiters.value(northKey).count(), 1);
+
+    // The east tile completes the query which only needed it, the others keep waiting
+    manager._tileDone(eastKey, flatTileBytes(kTileX + 1, kTileY, 20), QNetworkReply::NoError);
+    QCOMPARE(eastResults.heights, QList<QList<double>>({ { 20.0 } }));
+    QVERIFY(bothResults.successes.isEmpty());
+    QVERIFY(failResults.successes.isEmpty());
+    QCOMPARE(manager._requestQueue.count(), 2);
+    QVERIFY(!manager._tileWaiters.contains(eastKey));
+
+    manager._tileDone(westKey, flatTileBytes(kTileX, kTileY, 10), QNetworkReply::NoError);
+    QCOMPARE(bothResults.successes, QList<bool>({ true }));
+    QCOMPARE(bothResults.heights, QList<QList<double>>({ { 10.0, 20.0 } }));
+
+    // A failed fetch fails everyone waiting on the tile
+    manager._tileDone(northKey, QByteArray(), QNetworkReply::ContentNotFoundError);
+    QCOMPARE(failResults.successes, QList<bool>({ false }));
+    QCOMPARE(failResults.heights, QList<QList<double>>({ QList<double>() }));
+    QVERIFY(manager._requestQueue.isEmpty());
+    QVERIFY(manager._tileWaiters.isEmpty());
+    QCOMPARE(eastResults.successes.count(), 1);
+    QCOMPARE(bothResults.successes.count(), 1);
+}
+
+void TerrainQueryTest::_evictedTileRequeueTest(void)
+{
+    // No store, so a tile dropped from the memory cache is really gone
+    StubTerrainTileManager  stub;
+    TerrainTileManager&     manager = stub;
+    manager._store.setDirectory(QString());
+
+    TerrainOfflineAirMapQuery   query;
+    CoordinateResults           results(&query);
+    const quint64               westKey = TerrainTileManager::_tileKey(kTileX, kTileY);
+    const quint64               eastKey = TerrainTileManager::_tileKey(kTileX + 1, kTileY);
+
+    manager.addCoordinateQuery(&query, { tileCenter(kTileX, kTileY), tileCenter(kTileX + 1, kTileY) });
+    QCOMPARE(stub.fetched, QList<quint64>({ westKey, eastKey }));
+
+    // The west tile arrives and is evicted before the east one completes the request
+    manager._tileDone(westKey, flatTileBytes(kTileX, kTileY, 10), QNetworkReply::NoError);
+    QVERIFY(manager._tiles.remove(westKey));
+    manager._tileDone(eastKey, flatTileBytes(kTileX + 1, kTileY, 20), QNetworkReply::NoError);
+
+    // The request goes back to waiting on the evicted tile alone, which is fetched again
+    QVERIFY(results.successes.isEmpty());
+    QCOMPARE(stub.fetched, QList<quint64>({ westKey, eastKey, westKey }));
+    QCOMPARE(manager._requestQueue.count(), 1);
+    QCOMPARE(manager._requestQueue.first().missingTiles, QSet<quint64>({ westKey }));
+    QCOMPARE(manager._tileWaiters.value(westKey).count(), 1);
+    QVERIFY(!manager._tileWaiters.contains(eastKey));
+
+    manager._tileDone(westKey, flatTileBytes(kTileX, kTileY, 10), QNetworkReply::NoError);
+    QCOMPARE(results.successes, QList<bool>({ true }));
+    QCOMPARE(results.heights, QList<QList<double>>({ { 10.0, 20.0 } }));
+    QVERIFY(manager._requestQueue.isEmpty());
+}
+
+void TerrainQueryTest::_interpolationKernelTest(void)
+{
+    const TerrainTile   tile(slopeTileBytes(kTileX, kTileY));
+    const double        cellSize    = TerrainTile::tileSizeDegrees / kGridSize;
+    const double        swLat       = kTileY * TerrainTile::tileSizeDegrees - 90.0;
+    const double        swLon       = kTileX * TerrainTile::tileSizeDegrees - 180.0;
+    QVERIFY(tile.isValid());
+
+    // Between the cell centers the plane comes back exactly, at the centers the nearest value does as well
+    const QVector<double> lats = { swLat + 0.5 * cellSize, swLat + 1.25 * cellSize, swLat + 2.9 * cellSize, swLat + 3.5 * cellSize };
+    const QVector<double> lons = { swLon + 0.5 * cellSize, swLon + 3.1 * cellSize,  swLon + 1.5 * cellSize, swLon + 2.0 * cellSize };
+    QVector<double> elevations(lats.count());
+    QVERIFY(tile.interpolatedElevations(lats.constData(), lons.constData(), lats.count(), elevations.data()));
+    for (int i = 0; i < lats.count(); i++) {
+        QVERIFY(qAbs(elevations[i] - slope(lats[i], lons[i])) < 1e-6);
+    }
+    QVERIFY(tile.elevations(lats.constData(), lons.constData(), 1, elevations.data()));
+    QCOMPARE(elevations[0], 100.0);
+
+    // Within half a cell of the edge the kernel clamps to the edge cells, neighbourhood() hands those samples on
+    double cornerLats[2];
+    double cornerLons[2];
+    double latFrac;
+    double lonFrac;
+    const double edgeLat = swLat + 0.25 * cellSize;
+    const double edgeLon = swLon + 1.75 * cellSize;
+    QVERIFY(tile.interpolatedElevations(&edgeLat, &edgeLon, 1, elevations.data()));
+    QVERIFY(qAbs(elevations[0] - slope(swLat + 0.5 * cellSize, edgeLon)) < 1e-6);
+    QVERIFY(!tile.neighbourhood(edgeLat, edgeLon, cornerLats, cornerLons, latFrac, lonFrac));
+    QVERIFY(qAbs(cornerLats[0] - (swLat - 0.5 * cellSize)) < 1e-9);
+    QVERIFY(qAbs(cornerLats[1] - (swLat + 0.5 * cellSize)) < 1e-9);
+    QVERIFY(qAbs(cornerLons[0] - (swLon + 1.5 * cellSize)) < 1e-9);
+    QVERIFY(qAbs(latFrac - 0.75) < 1e-6);
+    QVERIFY(qAbs(lonFrac - 0.25) < 1e-6);
+    QVERIFY(tile.neighbourhood(lats[1], lons[2], cornerLats, cornerLons, latFrac, lonFrac));
+
+    // Outside the tile
+    const double outsideLat = swLat - cellSize;
+    QVERIFY(!tile.interpolatedElevations(&outsideLat, &edgeLon, 1, elevations.data()));
+    QVERIFY(qIsNaN(elevations[0]));
+}
+
+void TerrainQueryTest::_crossTileInterpolationTest(void)
+{
+    StubTerrainTileManager  stub;
+    TerrainTileManager&     manager = stub;
+    manager._store.setDirectory(QString());
+
+    // The path runs east across the seam between two tiles, close enough to their north edge that the samples
+    // also interpolate with the tiles to the north
+    const double            pathLat     = (kTileY + 0.9) * TerrainTile::tileSizeDegrees - 90.0;
+    const QGeoCoordinate    fromCoord(pathLat, (kTileX + 0.5) * TerrainTile::tileSizeDegrees - 180.0);
+    const QGeoCoordinate    toCoord(pathLat, (kTileX + 1.5) * TerrainTile::tileSizeDegrees - 180.0);
+    QList<double>   altitudes;
+    double          distanceBetween;
+    double          finalDistanceBetween;
+    bool            error;
+    QSet<quint64>   missingTiles;
+    const quint64   swKey   = TerrainTileManager::_tileKey(kTileX, kTileY);
+    const quint64   seKey   = TerrainTileManager::_tileKey(kTileX + 1, kTileY);
+    const quint64   nwKey   = TerrainTileManager::_tileKey(kTileX, kTileY + 1);
+    const quint64   neKey   = TerrainTileManager::_tileKey(kTileX + 1, kTileY + 1);
+    auto addTile = [&manager](int x, int y) {
+        TerrainTile* tile = new TerrainTile(slopeTileBytes(x, y));
+        manager._tiles.insert(TerrainTileManager::_tileKey(x, y), tile, tile->byteCount());
+    };
+
+    // The samples themselves only fall in the two southern tiles
+    QVERIFY(!manager.getAltitudesForPath(fromCoord, toCoord, altitudes, distanceBetween, finalDistanceBetween, error, &missingTiles));
+    QCOMPARE(missingTiles, QSet<quint64>({ swKey, seKey }));
+    addTile(kTileX, kTileY);
+    addTile(kTileX + 1, kTileY);
+
+    // Interpolating them also needs the two northern ones
+    missingTiles.clear();
+    QVERIFY(!manager.getAltitudesForPath(fromCoord, toCoord, altitudes, distanceBetween, finalDistanceBetween, error, &missingTiles));
+    QCOMPARE(missingTiles, QSet<quint64>({ nwKey, neKey }));
+    QCOMPARE(stub.fetched, QList<quint64>({ swKey, seKey, nwKey, neKey }));
+    addTile(kTileX, kTileY + 1);
+    addTile(kTileX + 1, kTileY + 1);
+
+    missingTiles.clear();
+    QVERIFY(manager.getAltitudesForPath(fromCoord, toCoord, altitudes, distanceBetween, finalDistanceBetween, error, &missingTiles));
+    QVERIFY(!error);
+    QVERIFY(missingTiles.isEmpty());
+
+    // Clamping at the tile edges would flatten the plane near the seams, across tiles it stays exact all the way
+    QVector<double> lats;
+    QVector<double> lons;
+    TerrainTileManager::_pathSamples(fromCoord, toCoord, lats, lons, distanceBetween, finalDistanceBetween);
+    QCOMPARE(altitudes.count(), lats.count());
+    for (int i = 0; i < lats.count(); i++) {
+        QVERIFY2(qAbs(altitudes[i] - slope(lats[i], lons[i])) < 1e-6, qPrintable(QStringLiteral("sample %1 %2 != %3").arg(i).arg(altitudes[i]).arg(slope(lats[i], lons[i]))));
+    }
+}
+
+void TerrainQueryTest::_carpetBuilderTest(void)
+{
+    const QGeoCoordinate swCoord(47.0, 8.0);
+    const QGeoCoordinate neCoord(47.0 + 1.5 * TerrainTile::tileValueSpacingDegrees, 8.0 + 2.5 * TerrainTile::tileValueSpacingDegrees);
+
+    // Row major from the south west corner, the last row and column land exactly on the north east corner
+    int rowCount;
+    int colCount;
+    const QList<QGeoCoordinate> coordinates = TerrainTileManager::carpetQueryToCoords(swCoord, neCoord, rowCount, colCount);
+    QCOMPARE(rowCount, 3);
+    QCOMPARE(colCount, 4);
+    QCOMPARE(coordinates.count(), 12);
+    QCOMPARE(coordinates.first(), swCoord);
+    QCOMPARE(coordinates.last(), neCoord);
+    QCOMPARE(coordinates[1].latitude(), swCoord.latitude());
+    QCOMPARE(coordinates[4].longitude(), swCoord.longitude());
+
+    TerrainTileManager::QueuedRequestInfo_t requestInfo = {};
+    requestInfo.queryMode       = TerrainTileManager::QueryModeCarpet;
+    requestInfo.coordinates     = coordinates;
+    requestInfo.carpetColCount  = colCount;
+    const QList<double> altitudes = { 5, 6, 7, 8, 9, -3, 11, 12, 13, 14, 40, 16 };
+
+    double                  minHeight;
+    double                  maxHeight;
+    QList<QList<double>>    carpet;
+    TerrainTileManager::_buildCarpet(requestInfo, altitudes, minHeight, maxHeight, carpet);
+    QCOMPARE(minHeight, -3.0);
+    QCOMPARE(maxHeight, 40.0);
+    QCOMPARE(carpet, QList<QList<double>>({ { 5, 6, 7, 8 }, { 9, -3, 11, 12 }, { 13, 14, 40, 16 } }));
+
+    // Stats only still scans every height
+    requestInfo.carpetStatsOnly = true;
+    carpet.clear();
+    TerrainTileManager::_buildCarpet(requestInfo, altitudes, minHeight, maxHeight, carpet);
+    QCOMPARE(minHeight, -3.0);
+    QCOMPARE(maxHeight, 40.0);
+    QVERIFY(carpet.isEmpty());
+
+    // Too many points is refused up front
+    const QGeoCoordinate farCoord(48.0, 9.0);
+    QVERIFY(TerrainTileManager::carpetQueryToCoords(swCoord, farCoord, rowCount, colCount).isEmpty());
+    QVERIFY(static_cast<qint64>(rowCount) * colCount > TerrainTileManager::_maxCarpetPoints);
+}
+
+void TerrainQueryTest::_polyPathTilesTest(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    StubTerrainTileManager  stub;
+    TerrainTileManager&     manager     = stub;
+    const int               maxPending  = TerrainTileManager::_maxPendingTiles;
+    manager._store.setDirectory(tempDir.path());
+    QVERIFY(manager._store.save(kTileX + 1, kTileY, flatTileBytes(kTileX + 1, kTileY, 10)));
+
+    // East across two tiles then north into a third. Each tile is fetched once, in path order, skipping the stored one.
+    manager.requestPolyPathTiles({ tileCenter(kTileX, kTileY), tileCenter(kTileX + 2, kTileY), tileCenter(kTileX + 2, kTileY + 1) });
+    QCOMPARE(stub.fetched, QList<quint64>({ TerrainTileManager::_tileKey(kTileX, kTileY), TerrainTileManager::_tileKey(kTileX + 2, kTileY), TerrainTileManager::_tileKey(kTileX + 2, kTileY + 1) }));
+    QVERIFY(manager._tileQueue.isEmpty());
+
+    // Past the fetches allowed in flight the tiles wait their turn
+    stub.fetched.clear();
+    manager.requestPolyPathTiles({ tileCenter(kTileX, kTileY + 5), tileCenter(kTileX + 19, kTileY + 5) });
+    QCOMPARE(stub.fetched.count(), maxPending - 3);
+    QCOMPARE(manager._tileQueue.count(), 20 - (maxPending - 3));
+    for (int i = 0; i < stub.fetched.count(); i++) {
+        QCOMPARE(stub.fetched[i], TerrainTileManager::_tileKey(kTileX + i, kTileY + 5));
+    }
+
+    // A completed fetch frees a slot for the next tile in line
+    const quint64 nextKey = manager._tileQueue.first();
+    manager._tileDone(TerrainTileManager::_tileKey(kTileX, kTileY), flatTileBytes(kTileX, kTileY, 10), QNetworkReply::NoError);
+    QCOMPARE(stub.fetched.last(), nextKey);
+    QCOMPARE(manager._tileQueue.count(), 20 - (maxPending - 3) - 1);
+}
+
+void TerrainQueryTest::_prefetchAreaTest(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    StubTerrainTileManager  stub;
+    TerrainTileManager&     manager = stub;
+    manager._store.setDirectory(tempDir.path());
+    QVERIFY(manager._store.save(kTileX + 1, kTileY, flatTileBytes(kTileX + 1, kTileY, 10)));
+
+    // Three by two tiles. Changes to the area only restart the wait.
+    const QGeoRectangle area(tileCoordinate(kTileX + 0.5, kTileY + 1.5), tileCoordinate(kTileX + 2.5, kTileY + 0.5));
+    manager.prefetchArea(QGeoRectangle(tileCoordinate(kTileX + 0.5, kTileY + 0.6), tileCoordinate(kTileX + 0.6, kTileY + 0.5)));
+    manager.prefetchArea(area);
+    QVERIFY(manager._prefetchTimer.isActive());
+    QVERIFY(stub.fetched.isEmpty());
+
+    // Everything but the stored tile, row by row from the south
+    manager._prefetchTimer.stop();
+    manager._prefetchTimeout();
+    QCOMPARE(stub.fetched, QList<quint64>({ TerrainTileManager::_tileKey(kTileX, kTileY), TerrainTileManager::_tileKey(kTileX + 2, kTileY),
+                                            TerrainTileManager::_tileKey(kTileX, kTileY + 1), TerrainTileManager::_tileKey(kTileX + 1, kTileY + 1), TerrainTileManager::_tileKey(kTileX + 2, kTileY + 1) }));
+    QVERIFY(manager._prefetchQueue.isEmpty());
+}
+
+void TerrainQueryTest::_prefetchLimitTest(void)
+{
+    StubTerrainTileManager  stub;
+    TerrainTileManager&     manager         = stub;
+    const int               maxPending      = TerrainTileManager::_maxPendingTiles;
+    const int               maxPrefetch     = TerrainTileManager::_maxPrefetchTiles;
+    manager._store.setDirectory(QString());
+    QCOMPARE(maxPrefetch, 200 * 200);
+
+    // 201 x 201 tiles is over the limit and nothing is fetched
+    manager._queuePrefetch(QGeoRectangle(tileCoordinate(kTileX + 0.5, kTileY + 200.5), tileCoordinate(kTileX + 200.5, kTileY + 0.5)));
+    QVERIFY(stub.fetched.isEmpty());
+    QVERIFY(manager._prefetchQueue.isEmpty());
+
+    // 200 x 200 is right at it
+    manager._queuePrefetch(QGeoRectangle(tileCoordinate(kTileX + 0.5, kTileY + 199.5), tileCoordinate(kTileX + 199.5, kTileY + 0.5)));
+    QCOMPARE(stub.fetched.count(), maxPending);
+    QCOMPARE(manager._prefetchQueue.count(), maxPrefetch - maxPending);
+
+    // A query jumps ahead of the prefetch, which then holds off until the query is answered
+    TerrainOfflineAirMapQuery   query;
+    CoordinateResults           results(&query);
+    const quint64               queryKey = TerrainTileManager::_tileKey(kTileX - 5, kTileY);
+    manager.addCoordinateQuery(&query, { tileCenter(kTileX - 5, kTileY) });
+    QCOMPARE(manager._tileQueue, QList<quint64>({ queryKey }));
+
+    manager._tileDone(stub.fetched[0], flatTileBytes(stub.fetched[0], 10), QNetworkReply::NoError);
+    QCOMPARE(stub.fetched.count(), maxPending + 1);
+    QCOMPARE(stub.fetched.last(), queryKey);
+    manager._tileDone(stub.fetched[1], flatTileBytes(stub.fetched[1], 10), QNetworkReply::NoError);
+    QCOMPARE(stub.fetched.count(), maxPending + 1);
+
+    manager._tileDone(queryKey, flatTileBytes(queryKey, 30), QNetworkReply::NoError);
+    QCOMPARE(results.heights, QList<QList<double>>({ { 30.0 } }));
+    QCOMPARE(stub.fetched.count(), maxPending + 3);
+    QCOMPARE(manager._prefetchQueue.count(), maxPrefetch - maxPending - 2);
+}
@@ -0,0 +1,29 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+
+/// Tests TerrainTileManager request scheduling against a stubbed tile source, and the height lookups
+class TerrainQueryTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _mergeIdenticalRequestsTest(void);
+    void _tileWaitersFanoutTest     (void);
+    void _evictedTileRequeueTest    (void);
+    void _interpolationKernelTest   (void);
+    void _crossTileInterpolationTest(void);
+    void _carpetBuilderTest         (void);
+    void _polyPathTilesTest         (void);
+    void _prefetchAreaTest          (void);
+    void _prefetchLimitTest         (void);
+};
@@ -0,0 +1,234 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainTileStore.h"
+
+#include <QDir>
+
+#include <limits>
+
+QGC_LOGGING_CATEGORY(TerrainTileStoreLog, "TerrainTileStoreLog")
+
+TerrainTileStore::~TerrainTileStore()
+{
+    _closeRegions();
+}
+
+void TerrainTileStore::setDirectory(const QString& directory)
+{
+    if (directory == _directory) {
+        return;
+    }
+    _closeRegions();
+    _directory = directory;
+    qCDebug(TerrainTileStoreLog) << "Terrain tile store in:" << _directory;
+}
+
+void TerrainTileStore::_closeRegions(void)
+{
+    // Closing the file also unmaps it
+    for (Region_t* region: _regions) {
+        if (region) {
+            delete region->file;
+            delete region;
+        }
+    }
+    _regions.clear();
+}
+
+int TerrainTileStore::_slotIndex(int x, int y)
+{
+    return (y % regionTiles) * regionTiles + (x % regionTiles);
+}
+
+TerrainTileStore::Region_t* TerrainTileStore::_region(int x, int y, bool create)
+{
+    if (_directory.isEmpty() || x < 0 || y < 0) {
+        return nullptr;
+    }
+
+    const int       regionX = x / regionTiles;
+    const int       regionY = y / regionTiles;
+    const quint64   key     = (static_cast<quint64>(regionY) << 32) | static_cast<quint32>(regionX);
+
+    auto it = _regions.find(key);
+    if (it != _regions.end() && (*it || !create)) {
+        return *it;
+    }
+
+    const QString filename = QDir(_directory).filePath(QStringLiteral("%1_%2.terrain").arg(regionY).arg(regionX));
+    if (!create && !QFile::exists(filename)) {
+        _regions[key] = nullptr;
+        return nullptr;
+    }
+    if (create && !QDir().mkpath(_directory)) {
+        qCWarning(TerrainTileStoreLog) << "Unable to create terrain tile store directory" << _directory;
+        return nullptr;
+    }
+
+    Region_t* region = new Region_t;
+    region->file    = new QFile(filename);
+    region->mappedEnd = 0;
+    if (!_openRegion(region)) {
+        delete region->file;
+        delete region;
+        _regions[key] = nullptr;
+        return nullptr;
+    }
+
+    _regions[key] = region;
+    return region;
+}
+
+bool TerrainTileStore::_openRegion(Region_t* region)
+{
+    QFile* file = region->file;
+    if (!file->open(QFile::ReadWrite)) {
+        qCWarning(TerrainTileStoreLog) << "Unable to open" << file->fileName() << file->errorString();
+        return false;
+    }
+
+    const int   slotCount   = regionTiles * regionTiles;
+    const int   slotBytes   = slotCount * static_cast<int>(sizeof(Slot_t));
+    const qint64 indexBytes = static_cast<qint64>(sizeof(Header_t)) + slotBytes;
+
+    region->slots.resize(slotCount);
+
+    Header_t header = { 0, 0 };
+    bool valid = file->size() >= indexBytes &&
+            file->read(reinterpret_cast<char*>(&header), sizeof(header)) == sizeof(header) &&
+            header.magic == _magic && header.version == _version &&
+            file->read(reinterpret_cast<char*>(region->slots.data()), slotBytes) == slotBytes;
+
+    if (!valid) {
+        // New file, or one from a different version. Start it over.
+        if (file->size() != 0) {
+            qCWarning(TerrainTileStoreLog) << "Discarding invalid region file" << file->fileName();
+        }
+        header = { _magic, _version };
+        region->slots.fill({ 0, 0 });
+        if (!file->resize(0) ||
+                file->write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header) ||
+                file->write(reinterpret_cast<const char*>(region->slots.constData()), slotBytes) != slotBytes ||
+                !file->flush()) {
+            qCWarning(TerrainTileStoreLog) << "Unable to initialize" << file->fileName() << file->errorString();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TerrainTileStore::contains(int x, int y)
+{
+    Region_t* region = _region(x, y, false);
+    return region && region->slots[_slotIndex(x, y)].size != 0;
+}
+
+QByteArray TerrainTileStore::load(int x, int y)
+{
+    Region_t* region = _region(x, y, false);
+    if (!region) {
+        return QByteArray();
+    }
+
+    const Slot_t& slot = region->slots[_slotIndex(x, y)];
+    if (slot.size == 0) {
+        return QByteArray();
+    }
+
+    const uchar* data = _mapped(region, slot.offset, slot.size);
+    if (data) {
+        return QByteArray(reinterpret_cast<const char*>(data), static_cast<int>(slot.size));
+    }
+
+    // Mapping is not available on all file systems, fall back to reading a copy
+    QByteArray bytes;
+    if (region->file->seek(slot.offset)) {
+        bytes = region->file->read(slot.size);
+    }
+    if (bytes.size() != static_cast<int>(slot.size)) {
+        qCWarning(TerrainTileStoreLog) << "Unable to read tile" << x << y << region->file->errorString();
+        return QByteArray();
+    }
+    return bytes;
+}
+
+/// @return Pointer to the bytes within the region mappings, nullptr if they cannot be mapped
+const uchar* TerrainTileStore::_mapped(Region_t* region, qint64 offset, qint64 size)
+{
+    const qint64 end = offset + size;
+    if (end > region->mappedEnd) {
+        const qint64 fileSize = region->file->size();
+        if (fileSize < end) {
+            return nullptr;
+        }
+        if (region->mappings.count() >= _maxMappings) {
+            // Nothing points into the mappings, load() hands out copies, so they can be merged into one
+            for (const Mapping_t& mapping: region->mappings) {
+                region->file->unmap(const_cast<uchar*>(mapping.data));
+            }
+            region->mappings.clear();
+            region->mappedEnd = 0;
+        }
+        // Only the part added since the last mapping. Tiles are appended past the end of the file, so a tile
+        // never straddles two mappings.
+        const uchar* data = region->file->map(region->mappedEnd, fileSize - region->mappedEnd);
+        if (!data) {
+            return nullptr;
+        }
+        region->mappings.append({ data, region->mappedEnd, fileSize - region->mappedEnd });
+        region->mappedEnd = fileSize;
+    }
+
+    for (const Mapping_t& mapping: region->mappings) {
+        if (offset >= mapping.offset && end <= mapping.offset + mapping.size) {
+            return mapping.data + (offset - mapping.offset);
+        }
+    }
+    return nullptr;
+}
+
+bool TerrainTileStore::save(int x, int y, const QByteArray& bytes)
+{
+    Region_t* region = _region(x, y, true);
+    if (!region || bytes.isEmpty()) {
+        return false;
+    }
+
+    const int slotIndex = _slotIndex(x, y);
+    if (region->slots[slotIndex].size != 0) {
+        return true;
+    }
+
+    QFile*          file        = region->file;
+    const qint64    fileSize    = file->size();
+    const qint64    offset      = (fileSize + 7) & ~static_cast<qint64>(7);
+    if (offset + bytes.size() > std::numeric_limits<quint32>::max()) {
+        qCWarning(TerrainTileStoreLog) << "Region file full" << file->fileName();
+        return false;
+    }
+
+    // Tile data goes down before the slot pointing at it, so an interrupted save just leaves unreferenced bytes
+    const Slot_t    slot        = { static_cast<quint32>(offset), static_cast<quint32>(bytes.size()) };
+    const qint64    slotOffset  = static_cast<qint64>(sizeof(Header_t)) + slotIndex * static_cast<qint64>(sizeof(Slot_t));
+    if (!file->seek(fileSize) ||
+            file->write(QByteArray(static_cast<int>(offset - fileSize), 0)) != offset - fileSize ||
+            file->write(bytes) != bytes.size() ||
+            !file->flush() ||
+            !file->seek(slotOffset) ||
+            file->write(reinterpret_cast<const char*>(&slot), sizeof(slot)) != sizeof(slot) ||
+            !file->flush()) {
+        qCWarning(TerrainTileStoreLog) << "Unable to save tile" << x << y << file->errorString();
+        return false;
+    }
+
+    region->slots[slotIndex] = slot;
+    return true;
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGCLoggingCategory.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+Q_DECLARE_LOGGING_CATEGORY(TerrainTileStoreLog)
+
+/// Persistent terrain tile store, separate from the map tile cache database. Tiles are kept in their serialized
+/// TerrainTile form in one file per region of regionTiles x regionTiles tiles (one degree square). Region files
+/// are memory mapped, so loading a tile is a copy out of the mapping rather than a seek and read.
+///
+/// Region file layout:
+///     Header_t
+///     Slot_t[regionTiles * regionTiles]   Offset/size of each tile within the file, zero size for not stored
+///     Tile data, each tile 8 byte aligned
+///
+/// Tiles are appended and never rewritten. As a region file grows only the new part is mapped, the mappings are
+/// released when the region is closed. load() returns a copy, so loaded tiles do not depend on the mappings.
+/// Not thread safe, TerrainTileManager calls it with its tile lock held.
+class TerrainTileStore
+{
+public:
+    TerrainTileStore(void) = default;
+    ~TerrainTileStore();
+
+    /// Sets the directory the region files live in, an empty directory disables the store
+    void setDirectory(const QString& directory);
+
+    /// @return Copy of the serialized tile, empty if the tile is not stored
+    QByteArray load(int x, int y);
+
+    bool contains(int x, int y);
+
+    /// Saves the serialized tile, does nothing if it is already stored
+    bool save(int x, int y, const QByteArray& bytes);
+
+    static const int regionTiles = 100;
+
+private:
+    typedef struct {
+        quint32 magic;
+        quint32 version;
+    } Header_t;
+
+    typedef struct {
+        quint32 offset;
+        quint32 size;
+    } Slot_t;
+
+    typedef struct {
+        const uchar*    data;
+        qint64          offset;
+        qint64          size;
+    } Mapping_t;
+
+    typedef struct {
+        QFile*              file;
+        QVector<Slot_t>     slots;
+        QVector<Mapping_t>  mappings;   ///< Consecutive, together they cover the file up to mappedEnd
+        qint64              mappedEnd;
+    } Region_t;
+
+    Region_t*   _region         (int x, int y, bool create);
+    bool        _openRegion     (Region_t* region);
+    const uchar* _mapped        (Region_t* region, qint64 offset, qint64 size);
+    void        _closeRegions   (void);
+    static int  _slotIndex      (int x, int y);
+
+    QString                     _directory;
+    QHash<quint64, Region_t*>   _regions;           ///< nullptr for regions known to not be on disk
+
+    static const quint32 _magic     = 0x51544552;
+    static const quint32 _version   = 1;
+    static const int     _maxMappings = 16;     ///< Past this the region is remapped as a whole
+};
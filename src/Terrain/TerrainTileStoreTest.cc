@@ -0,0 +1,183 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainTileStoreTest.h"
+#include "TerrainTileStore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+// Tiles 18854..18856 x 13739 all fall in the region file 137_188.terrain, slot (39 * 100 + 54) onwards
+static const int        kTileX          = 18854;
+static const int        kTileY          = 13739;
+static const char*      kRegionFile     = "137_188.terrain";
+
+// Version 1 layout: magic and version, then 100 * 100 offset/size slots, then the 8 byte aligned tile data
+static const quint32    kMagic          = 0x51544552;
+static const quint32    kVersion        = 1;
+static const qint64     kHeaderBytes    = 8;
+static const qint64     kIndexBytes     = kHeaderBytes + 100 * 100 * 8;
+
+static QByteArray _tileBytes(int size, char fill)
+{
+    QByteArray bytes(size, fill);
+    bytes[0] = static_cast<char>(size);
+    return bytes;
+}
+
+/// Reads the offset/size slot for a tile straight from the region file
+static bool _readSlot(QFile& file, int x, int y, quint32& offset, quint32& size)
+{
+    const qint64 slotOffset = kHeaderBytes + ((y % 100) * 100 + (x % 100)) * 8;
+    if (!file.seek(slotOffset)) {
+        return false;
+    }
+    const QByteArray slot = file.read(8);
+    if (slot.size() != 8) {
+        return false;
+    }
+    offset  = qFromLittleEndian<quint32>(slot.constData());
+    size    = qFromLittleEndian<quint32>(slot.constData() + 4);
+    return true;
+}
+
+void TerrainTileStoreTest::_roundTripTest(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    const QString       directory   = QDir(tempDir.path()).filePath("Terrain");
+    const QByteArray    tileA       = _tileBytes(37, 'a');
+    const QByteArray    tileB       = _tileBytes(100, 'b');
+
+    {
+        TerrainTileStore store;
+        store.setDirectory(directory);
+        QVERIFY(!store.contains(kTileX, kTileY));
+        QVERIFY(store.load(kTileX, kTileY).isEmpty());
+
+        QVERIFY(store.save(kTileX, kTileY, tileA));
+        QVERIFY(store.save(kTileX + 1, kTileY, tileB));
+        QVERIFY(store.contains(kTileX, kTileY));
+        QCOMPARE(store.load(kTileX, kTileY), tileA);
+        QCOMPARE(store.load(kTileX + 1, kTileY), tileB);
+
+        // Stored tiles are never rewritten
+        QVERIFY(store.save(kTileX, kTileY, _tileBytes(50, 'z')));
+        QCOMPARE(store.load(kTileX, kTileY), tileA);
+
+        // Loaded tiles are copies, they outlive the store closing its files
+        const QByteArray loaded = store.load(kTileX + 1, kTileY);
+        store.setDirectory(QString());
+        QCOMPARE(loaded, tileB);
+        QVERIFY(!store.contains(kTileX, kTileY));
+    }
+
+    // On disk layout
+    QFile file(QDir(directory).filePath(kRegionFile));
+    QVERIFY(file.open(QFile::ReadOnly));
+    const QByteArray header = file.read(kHeaderBytes);
+    QCOMPARE(header.size(), static_cast<int>(kHeaderBytes));
+    QCOMPARE(qFromLittleEndian<quint32>(header.constData()), kMagic);
+    QCOMPARE(qFromLittleEndian<quint32>(header.constData() + 4), kVersion);
+
+    quint32 offsetA, sizeA, offsetB, sizeB;
+    QVERIFY(_readSlot(file, kTileX, kTileY, offsetA, sizeA));
+    QVERIFY(_readSlot(file, kTileX + 1, kTileY, offsetB, sizeB));
+    QCOMPARE(sizeA, static_cast<quint32>(tileA.size()));
+    QCOMPARE(sizeB, static_cast<quint32>(tileB.size()));
+    QCOMPARE(offsetA, static_cast<quint32>(kIndexBytes));
+    QCOMPARE(offsetB % 8, 0u);
+    QVERIFY(offsetB >= offsetA + sizeA);
+    QCOMPARE(file.size(), static_cast<qint64>(offsetB + sizeB));
+    QVERIFY(file.seek(offsetA));
+    QCOMPARE(file.read(sizeA), tileA);
+    QVERIFY(file.seek(offsetB));
+    QCOMPARE(file.read(sizeB), tileB);
+    file.close();
+
+    // A new store reads back what the first one wrote
+    TerrainTileStore store;
+    store.setDirectory(directory);
+    QCOMPARE(store.load(kTileX, kTileY), tileA);
+    QCOMPARE(store.load(kTileX + 1, kTileY), tileB);
+    QVERIFY(!store.contains(kTileX + 2, kTileY));
+}
+
+void TerrainTileStoreTest::_growthTest(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    TerrainTileStore store;
+    store.setDirectory(tempDir.path());
+
+    // Every load after a save has to map the grown part of the file, well past the point where the mappings are
+    // merged back into one
+    QList<QByteArray> tiles;
+    for (int i = 0; i < 40; i++) {
+        tiles.append(_tileBytes(20 + i * 3, static_cast<char>('A' + i)));
+        QVERIFY(store.save(kTileX + i, kTileY, tiles[i]));
+        QCOMPARE(store.load(kTileX + i, kTileY), tiles[i]);
+        QCOMPARE(store.load(kTileX, kTileY), tiles[0]);
+    }
+    for (int i = 0; i < tiles.count(); i++) {
+        QCOMPARE(store.load(kTileX + i, kTileY), tiles[i]);
+    }
+}
+
+void TerrainTileStoreTest::_truncatedFileTest(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    const QString       filename    = QDir(tempDir.path()).filePath(kRegionFile);
+    const QByteArray    tileA       = _tileBytes(64, 'a');
+    const QByteArray    tileB       = _tileBytes(64, 'b');
+
+    {
+        TerrainTileStore store;
+        store.setDirectory(tempDir.path());
+        QVERIFY(store.save(kTileX, kTileY, tileA));
+        QVERIFY(store.save(kTileX + 1, kTileY, tileB));
+    }
+
+    // Cut into the last tile, as an interrupted copy of the file would
+    QFile file(filename);
+    QVERIFY(file.open(QFile::ReadWrite));
+    quint32 offsetB, sizeB;
+    QVERIFY(_readSlot(file, kTileX + 1, kTileY, offsetB, sizeB));
+    QVERIFY(file.resize(offsetB + sizeB / 2));
+    file.close();
+
+    {
+        // The slot is still there but the data is not, the tile is reported missing and the rest still loads
+        TerrainTileStore store;
+        store.setDirectory(tempDir.path());
+        QCOMPARE(store.load(kTileX, kTileY), tileA);
+        QVERIFY(store.load(kTileX + 1, kTileY).isEmpty());
+    }
+
+    // Cut into the slot table, the index can no longer be trusted
+    QVERIFY(file.open(QFile::ReadWrite));
+    QVERIFY(file.resize(kIndexBytes / 2));
+    file.close();
+
+    {
+        // The region is started over and works as a new one
+        TerrainTileStore store;
+        store.setDirectory(tempDir.path());
+        QVERIFY(!store.contains(kTileX, kTileY));
+        QVERIFY(store.load(kTileX, kTileY).isEmpty());
+        QVERIFY(store.save(kTileX + 1, kTileY, tileB));
+        QCOMPARE(store.load(kTileX + 1, kTileY), tileB);
+    }
+    QCOMPARE(QFileInfo(filename).size(), kIndexBytes + tileB.size());
+}
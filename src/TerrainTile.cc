@@ -18,6 +18,9 @@
 #include <QDataStream>
 #include <QtMath>
 
+#include <algorithm>
+#include <cmath>
+
 QGC_LOGGING_CATEGORY(TerrainTileLog, "TerrainTileLog");
 
 const char*  TerrainTile::_jsonStatusKey        = "status";
@@ -33,13 +36,20 @@ const char*  TerrainTile::_jsonCarpetKey        = "carpet";
 
 TerrainTile::TerrainTile(const QByteArray& byteArray)
 {
+    int cTileHeaderBytes = static_cast<int>(sizeof(TileInfo_t));
+    int cTileBytesAvailable = byteArray.size();
+
+    if (cTileBytesAvailable < cTileHeaderBytes) {
+        qCWarning(TerrainTileLog) << "Terrain tile binary data too small for TileInfo_s header";
+        return;
+    }
+
     // Copy tile info
     _tileInfo = *reinterpret_cast<const TileInfo_t*>(byteArray.constData());
 
     // Check feasibility
-    if ((_tileInfo.neLon - _tileInfo.swLon) < 0.0 || (_tileInfo.neLat - _tileInfo.swLat) < 0.0) {
+    if ((_tileInfo.neLon - _tileInfo.swLon) < 0.0 || (_tileInfo.neLat - _tileInfo.swLat) < 0.0 || _tileInfo.gridSizeLat <= 0 || _tileInfo.gridSizeLon <= 0) {
         qCWarning(TerrainTileLog) << this << "Tile extent is infeasible";
-        _isValid = false;
         return;
     }
 
@@ -52,52 +62,21 @@ TerrainTile::TerrainTile(const QByteArray& byteArray)
     qCDebug(TerrainTileLog) << this << "TileInfo: min, max, avg: " << _tileInfo.minElevation << _tileInfo.maxElevation << _tileInfo.avgElevation;
     qCDebug(TerrainTileLog) << this << "TileInfo: cell size:     " << _cellSizeLat << _cellSizeLon;
 
-    int cTileHeaderBytes = static_cast<int>(sizeof(TileInfo_t));
-    int cTileBytesAvailable = byteArray.size();
-
-    if (cTileBytesAvailable < cTileHeaderBytes) {
-        qCWarning(TerrainTileLog) << "Terrain tile binary data too small for TileInfo_s header";
-        return;
-    }
-
     int cTileDataBytes = static_cast<int>(sizeof(int16_t)) * _tileInfo.gridSizeLat * _tileInfo.gridSizeLon;
     if (cTileBytesAvailable < cTileHeaderBytes + cTileDataBytes) {
         qCWarning(TerrainTileLog) << "Terrain tile binary data too small for tile data";
         return;
     }
 
-    _data = new int16_t*[_tileInfo.gridSizeLat];
-    for (int k = 0; k < _tileInfo.gridSizeLat; k++) {
-        _data[k] = new int16_t[_tileInfo.gridSizeLon];
-    }
-
-    int valueIndex = 0;
-    const int16_t* pTileData = reinterpret_cast<const int16_t*>(&reinterpret_cast<const uint8_t*>(byteArray.constData())[cTileHeaderBytes]);
-    for (int i = 0; i < _tileInfo.gridSizeLat; i++) {
-        for (int j = 0; j < _tileInfo.gridSizeLon; j++) {
-            _data[i][j] = pTileData[valueIndex++];
-        }
-    }
-
+    // The grid follows the header as one contiguous row major block, it is read in place rather than copied.
+    // QByteArray is implicitly shared so copies of the tile share the same grid.
+    _bytes = byteArray;
     _isValid = true;
 }
 
-TerrainTile::~TerrainTile()
-{
-    if (!_data) {
-        return;
-    }
-
-    for (unsigned i = 0; i < static_cast<unsigned>(_tileInfo.gridSizeLat); i++) {
-        delete[] _data[i];
-    }
-
-    delete[] _data;
-}
-
 double TerrainTile::elevation(const QGeoCoordinate& coordinate) const
 {
-    if (!_isValid || !_data) {
+    if (!_isValid) {
         qCWarning(TerrainTileLog) << this << "Request for elevation, but tile is invalid.";
         return qQNaN();
     }
@@ -105,8 +84,8 @@ double TerrainTile::elevation(const QGeoCoordinate& coordinate) const
     const double latDeltaSw = coordinate.latitude() - _tileInfo.swLat;
     const double lonDeltaSw = coordinate.longitude() - _tileInfo.swLon;
 
-    const int16_t latIndex = qFloor(latDeltaSw / _cellSizeLat);
-    const int16_t lonIndex = qFloor(lonDeltaSw / _cellSizeLon);
+    const int latIndex = qFloor(latDeltaSw / _cellSizeLat);
+    const int lonIndex = qFloor(lonDeltaSw / _cellSizeLon);
 
     const bool latIndexInvalid = latIndex < 0 || latIndex > (_tileInfo.gridSizeLat - 1);
     const bool lonIndexInvalid = lonIndex < 0 || lonIndex > (_tileInfo.gridSizeLon - 1);
@@ -116,7 +95,7 @@ double TerrainTile::elevation(const QGeoCoordinate& coordinate) const
         return qQNaN();
     }
 
-    const auto elevation = _data[latIndex][lonIndex];
+    const auto elevation = _grid()[latIndex * _tileInfo.gridSizeLon + lonIndex];
 
     // Print warning if elevation is outside min/max of tile meta data
     if (elevation < _tileInfo.minElevation) {
@@ -133,6 +112,113 @@ double TerrainTile::elevation(const QGeoCoordinate& coordinate) const
     return static_cast<double>(elevation);
 }
 
+bool TerrainTile::elevations(const double* lats, const double* lons, int count, double* elevations) const
+{
+    if (!_isValid) {
+        qCWarning(TerrainTileLog) << this << "Request for elevations, but tile is invalid.";
+        std::fill(elevations, elevations + count, qQNaN());
+        return false;
+    }
+
+    const int16_t*  grid        = _grid();
+    const int       rows        = _tileInfo.gridSizeLat;
+    const int       cols        = _tileInfo.gridSizeLon;
+    const double    swLat       = _tileInfo.swLat;
+    const double    swLon       = _tileInfo.swLon;
+    const double    cellSizeLat = _cellSizeLat;
+    const double    cellSizeLon = _cellSizeLon;
+    const double    nan         = qQNaN();
+    bool            inside      = true;
+
+    // Branch free so the compiler can vectorize it. Out of bounds coordinates read cell 0 and are masked to NaN.
+    for (int i = 0; i < count; i++) {
+        const int   latIndex    = static_cast<int>(std::floor((lats[i] - swLat) / cellSizeLat));
+        const int   lonIndex    = static_cast<int>(std::floor((lons[i] - swLon) / cellSizeLon));
+        const bool  valid       = latIndex >= 0 && latIndex < rows && lonIndex >= 0 && lonIndex < cols;
+        const int   cellIndex   = valid ? latIndex * cols + lonIndex : 0;
+
+        elevations[i]   = valid ? static_cast<double>(grid[cellIndex]) : nan;
+        inside          &= valid;
+    }
+
+    if (!inside) {
+        qCWarning(TerrainTileLog) << this << "Internal error: coordinates outside tile bounds";
+    }
+
+    return inside;
+}
+
+bool TerrainTile::interpolatedElevations(const double* lats, const double* lons, int count, double* elevations) const
+{
+    if (!_isValid) {
+        qCWarning(TerrainTileLog) << this << "Request for elevations, but tile is invalid.";
+        std::fill(elevations, elevations + count, qQNaN());
+        return false;
+    }
+
+    const int16_t*  grid        = _grid();
+    const int       rows        = _tileInfo.gridSizeLat;
+    const int       cols        = _tileInfo.gridSizeLon;
+    const int       maxRow      = qMax(0, rows - 2);        // First row/col of the last 2x2 neighbourhood
+    const int       maxCol      = qMax(0, cols - 2);
+    const int       rowStep     = rows > 1 ? cols : 0;
+    const int       colStep     = cols > 1 ? 1 : 0;
+    const double    swLat       = _tileInfo.swLat;
+    const double    swLon       = _tileInfo.swLon;
+    const double    cellSizeLat = _cellSizeLat;
+    const double    cellSizeLon = _cellSizeLon;
+    const double    nan         = qQNaN();
+    bool            inside      = true;
+
+    // Same branch free layout as elevations(). Values sit at the cell centers, hence the half cell shift.
+    for (int i = 0; i < count; i++) {
+        const double    latPos      = (lats[i] - swLat) / cellSizeLat;
+        const double    lonPos      = (lons[i] - swLon) / cellSizeLon;
+        const bool      valid       = latPos >= 0 && latPos < rows && lonPos >= 0 && lonPos < cols;
+        const double    latCenter   = latPos - 0.5;
+        const double    lonCenter   = lonPos - 0.5;
+        const int       row         = qBound(0, static_cast<int>(std::floor(latCenter)), maxRow);
+        const int       col         = qBound(0, static_cast<int>(std::floor(lonCenter)), maxCol);
+        const double    latFrac     = qBound(0.0, latCenter - row, 1.0);
+        const double    lonFrac     = qBound(0.0, lonCenter - col, 1.0);
+        const int       cellIndex   = valid ? row * cols + col : 0;
+
+        const double    sw          = grid[cellIndex];
+        const double    se          = grid[cellIndex + colStep];
+        const double    nw          = grid[cellIndex + rowStep];
+        const double    ne          = grid[cellIndex + rowStep + colStep];
+        const double    south       = sw + (se - sw) * lonFrac;
+        const double    north       = nw + (ne - nw) * lonFrac;
+
+        elevations[i]   = valid ? south + (north - south) * latFrac : nan;
+        inside          &= valid;
+    }
+
+    if (!inside) {
+        qCWarning(TerrainTileLog) << this << "Internal error: coordinates outside tile bounds";
+    }
+
+    return inside;
+}
+
+bool TerrainTile::neighbourhood(double lat, double lon, double cornerLats[2], double cornerLons[2], double& latFrac, double& lonFrac) const
+{
+    // Same half cell shift as interpolatedElevations(), but without clamping to the tile
+    const double    latCenter   = (lat - _tileInfo.swLat) / _cellSizeLat - 0.5;
+    const double    lonCenter   = (lon - _tileInfo.swLon) / _cellSizeLon - 0.5;
+    const int       row         = static_cast<int>(std::floor(latCenter));
+    const int       col         = static_cast<int>(std::floor(lonCenter));
+
+    latFrac         = latCenter - row;
+    lonFrac         = lonCenter - col;
+    cornerLats[0]   = _tileInfo.swLat + (row + 0.5) * _cellSizeLat;
+    cornerLats[1]   = cornerLats[0] + _cellSizeLat;
+    cornerLons[0]   = _tileInfo.swLon + (col + 0.5) * _cellSizeLon;
+    cornerLons[1]   = cornerLons[0] + _cellSizeLon;
+
+    return row >= 0 && row + 1 < _tileInfo.gridSizeLat && col >= 0 && col + 1 < _tileInfo.gridSizeLon;
+}
+
 QByteArray TerrainTile::serializeFromAirMapJson(const QByteArray& input)
 {
     QJsonParseError parseError;
@@ -17,6 +17,7 @@
 #include "QGCLoggingCategory.h"
 
 #include <QGeoCoordinate>
+#include <QByteArray>
 
 Q_DECLARE_LOGGING_CATEGORY(TerrainTileLog)
 
@@ -30,10 +31,10 @@ class TerrainTile
 {
 public:
     TerrainTile() = default;
-    ~TerrainTile();
 
     /**
-    * Constructor from serialized elevation data (either from file or web)
+    * Constructor from serialized elevation data (either from file or web). The bytes are kept as is and the
+    * grid is read in place, so a tile can also wrap memory mapped data through QByteArray::fromRawData.
     *
     * @param document
     */
@@ -54,6 +55,50 @@ public:
     */
     double elevation(const QGeoCoordinate& coordinate) const;
 
+    /**
+    * Evaluates the elevations for a batch of coordinates which lie within the tile
+    *
+    * @param lats Latitudes of the coordinates
+    * @param lons Longitudes of the coordinates
+    * @param count Number of coordinates
+    * @param elevations Returned elevations, NaN for coordinates outside the tile
+    * @return false if any of the coordinates is outside the tile
+    */
+    bool elevations(const double* lats, const double* lons, int count, double* elevations) const;
+
+    /**
+    * Evaluates the bilinearly interpolated elevations for a batch of coordinates which lie within the tile.
+    * Interpolation is between grid cell centers and is clamped at the tile edges, within half a cell of the
+    * edge use neighbourhood() to interpolate with the values of the adjacent tiles.
+    *
+    * @param lats Latitudes of the coordinates
+    * @param lons Longitudes of the coordinates
+    * @param count Number of coordinates
+    * @param elevations Returned elevations, NaN for coordinates outside the tile
+    * @return false if any of the coordinates is outside the tile
+    */
+    bool interpolatedElevations(const double* lats, const double* lons, int count, double* elevations) const;
+
+    /**
+    * Finds the grid cell centers surrounding a coordinate within the tile, for interpolating across tile edges
+    *
+    * @param lat Latitude of the coordinate
+    * @param lon Longitude of the coordinate
+    * @param cornerLats Returned latitudes of the south and north cell centers
+    * @param cornerLons Returned longitudes of the west and east cell centers
+    * @param latFrac Returned position of the coordinate between the south and north centers, 0 to 1
+    * @param lonFrac Returned position of the coordinate between the west and east centers, 0 to 1
+    * @return false if any of the cell centers lies in an adjacent tile
+    */
+    bool neighbourhood(double lat, double lon, double cornerLats[2], double cornerLons[2], double& latFrac, double& lonFrac) const;
+
+    /**
+    * Accessor for the size of the tile data, used as the cost of the tile in caches
+    *
+    * @return size in bytes
+    */
+    int byteCount(void) const { return _bytes.size(); }
+
     /**
     * Accessor for the minimum elevation of the tile
     *
@@ -97,11 +142,13 @@ private:
         int16_t gridSizeLon;
     } TileInfo_t;
 
-    TileInfo_t          _tileInfo;
-    int16_t**           _data;                                          /// 2D elevation data array
-    double              _cellSizeLat;                                   /// data grid size in latitude direction
-    double              _cellSizeLon;                                   /// data grid size in longitude direction
-    bool                _isValid;                                       /// data loaded is valid
+    const int16_t* _grid(void) const { return reinterpret_cast<const int16_t*>(_bytes.constData() + sizeof(TileInfo_t)); }
+
+    TileInfo_t          _tileInfo       = {};
+    QByteArray          _bytes;                                         /// Serialized tile, header followed by the row major elevation grid
+    double              _cellSizeLat    = 0;                            /// data grid size in latitude direction
+    double              _cellSizeLon    = 0;                            /// data grid size in longitude direction
+    bool                _isValid        = false;                        /// data loaded is valid
 
     // Json keys
     static const char*  _jsonStatusKey;
@@ -10,6 +10,7 @@
 #include "MAVLinkLogManager.h"
 #include "QGCApplication.h"
 #include "SettingsManager.h"
+#include "ULogReader.h"
 
 #include <QQmlContext>
 #include <QQmlProperty>
@@ -222,13 +223,18 @@ MAVLinkLogProcessor::_writeUlogMessage(QByteArray& data)
 {
     //-- Write ulog data w/o integrity checking, assuming data starts with a
     //   valid ulog message. returns the remaining data at the end.
-    while(data.length() > 2) {
-        uint8_t* ptr = (uint8_t*)data.data();
-        int message_length = ptr[0] + (ptr[1] * 256) + 3; // 3 = ULog msg header
-        if(message_length > data.length())
+    //   All complete messages go out in one write and the buffer is only
+    //   trimmed once.
+    int length = 0;
+    while(data.length() - length > 2) {
+        int message_length = ULogReader::messageSize(data.constData() + length);
+        if(length + message_length > data.length())
             break;
-        _writeData(data.data(), message_length);
-        data.remove(0, message_length);
+        length += message_length;
+    }
+    if(length) {
+        _writeData(data.data(), length);
+        data.remove(0, length);
     }
     return data;
 }
@@ -10,6 +10,11 @@
 #include "TerrainProtocolHandler.h"
 #include "TerrainQuery.h"
 #include "QGCApplication.h"
+#ifndef NO_SERIAL_LINK
+#include "SerialLink.h"
+#endif
+
+#include <QtAlgorithms>
 
 QGC_LOGGING_CATEGORY(TerrainProtocolHandlerLog, "TerrainProtocolHandlerLog")
 
@@ -17,9 +22,10 @@ TerrainProtocolHandler::TerrainProtocolHandler(Vehicle* vehicle, TerrainFactGrou
     : QObject           (parent)
     , _vehicle          (vehicle)
     , _terrainFactGroup (terrainFactGroup)
+    , _gridCache        (_maxCachedGrids)
 {
     _terrainDataSendTimer.setSingleShot(false);
-    _terrainDataSendTimer.setInterval(1000.0/12.0);
+    _terrainDataSendTimer.setInterval(_sendIntervalMSecs);
     connect(&_terrainDataSendTimer, &QTimer::timeout, this, &TerrainProtocolHandler::_sendNextTerrainData);
 }
 
@@ -39,8 +45,26 @@ bool TerrainProtocolHandler::mavlinkMessageReceived(const mavlink_message_t mess
 
 void TerrainProtocolHandler::_handleTerrainRequest(const mavlink_message_t& message)
 {
-    _terrainRequestActive = true;
-    mavlink_msg_terrain_request_decode(&message, &_currentTerrainRequest);
+    mavlink_terrain_request_t terrainRequest;
+    mavlink_msg_terrain_request_decode(&message, &terrainRequest);
+
+    // The vehicle repeats requests for the same grid until it has all the blocks, heights loaded for earlier
+    // requests are reused from the grid cache.
+    const quint64   gridKey = _gridKey(terrainRequest);
+    Grid_t*         grid    = _gridCache.object(gridKey);
+    if (!grid || grid->gridSpacing != terrainRequest.grid_spacing) {
+        grid = new Grid_t;
+        grid->gridSpacing   = terrainRequest.grid_spacing;
+        grid->loadedMask    = 0;
+        _gridCache.insert(gridKey, grid);
+        _gridQueryActive    = false;
+    } else if (gridKey != _currentGridKey) {
+        _gridQueryActive    = false;
+    }
+
+    _currentTerrainRequest  = terrainRequest;
+    _currentGridKey         = gridKey;
+    _terrainRequestActive   = true;
     _sendNextTerrainData();
 }
 
@@ -67,91 +91,189 @@ void TerrainProtocolHandler::_handleTerrainReport(const mavlink_message_t& messa
     }
 }
 
-void TerrainProtocolHandler::_sendNextTerrainData(void)
+quint64 TerrainProtocolHandler::_gridKey(const mavlink_terrain_request_t& request)
 {
-    if (!_terrainRequestActive) {
-        return;
-    }
+    return (static_cast<quint64>(static_cast<quint32>(request.lat)) << 32) | static_cast<quint32>(request.lon);
+}
+
+/// Returns the 4x4 grid points of each block in blockMask, blocks in gridBit order and points row major within a block
+QList<QGeoCoordinate> TerrainProtocolHandler::_blockCoordinates(const mavlink_terrain_request_t& request, uint64_t blockMask)
+{
+    QGeoCoordinate  terrainRequestCoordSWCorner(static_cast<double>(request.lat) / 1e7, static_cast<double>(request.lon) / 1e7);
+    const int       spacingBetweenGrids = request.grid_spacing * 4;
 
-    QGeoCoordinate terrainRequestCoordSWCorner(static_cast<double>(_currentTerrainRequest.lat) / 1e7, static_cast<double>(_currentTerrainRequest.lon) / 1e7);
-    int spacingBetweenGrids = _currentTerrainRequest.grid_spacing * 4;
+    QList<QGeoCoordinate> coordinates;
+    coordinates.reserve(static_cast<int>(qPopulationCount(blockMask)) * _blockPoints);
 
-    // Each TERRAIN_DATA sent to vehicle contains a 4x4 grid of heights
-    // TERRAIN_REQUEST.mask has a bit for each entry in an 8x7 grid
     // gridBit = 0 refers to the the sw corner of the 8x7 grid
+    for (uint64_t mask = blockMask; mask; mask &= mask - 1) {
+        const int gridBit   = qCountTrailingZeroBits(mask);
+        const int rowIndex  = gridBit / _gridCols;
+        const int colIndex  = gridBit % _gridCols;
+
+        // Move east and then north to generate the coordinate for sw corner of the specific gridBit
+        QGeoCoordinate swCorner = terrainRequestCoordSWCorner.atDistanceAndAzimuth(spacingBetweenGrids * colIndex, 90);
+        swCorner = swCorner.atDistanceAndAzimuth(spacingBetweenGrids * rowIndex, 0);
 
-    bool bitFound = false;
-    for (int rowIndex=0; rowIndex<7; rowIndex++) {
-        for (int colIndex=0; colIndex<8; colIndex++) {
-            uint8_t gridBit = (rowIndex * 8) + colIndex;
-            uint64_t checkBit = 1ull << gridBit;
-            if (_currentTerrainRequest.mask & checkBit) {
-                // Move east and then north to generate the coordinate for sw corner of the specific gridBit
-                QGeoCoordinate swCorner = terrainRequestCoordSWCorner.atDistanceAndAzimuth(spacingBetweenGrids * colIndex, 90);
-                swCorner = swCorner.atDistanceAndAzimuth(spacingBetweenGrids * rowIndex, 0);
-                _sendTerrainData(swCorner, gridBit);
-                bitFound = true;
-                break;
+        for (int pointRow=0; pointRow<4; pointRow++) {
+            const QGeoCoordinate rowStart = swCorner.atDistanceAndAzimuth(request.grid_spacing * pointRow, 0);
+            for (int pointCol=0; pointCol<4; pointCol++) {
+                coordinates.append(rowStart.atDistanceAndAzimuth(request.grid_spacing * pointCol, 90));
             }
         }
-        if (bitFound) {
-            break;
-        }
     }
 
-    if (bitFound) {
-        // Kick timer to send next possible TERRAIN_DATA to vehicle
-        _terrainDataSendTimer.start();
-    } else {
-        _terrainRequestActive = false;
-    }
+    return coordinates;
 }
 
-void TerrainProtocolHandler::_sendTerrainData(const QGeoCoordinate& swCorner, uint8_t gridBit)
+/// Fills in the heights for all requested blocks which do not have them yet with a single terrain query
+void TerrainProtocolHandler::_loadGrid(void)
 {
-    QList<QGeoCoordinate> coordinates;
-    for (int rowIndex=0; rowIndex<4; rowIndex++) {
-        for (int colIndex=0; colIndex<4; colIndex++) {
-            // Move east and then north to generate the coordinate for grid point
-            QGeoCoordinate coord = swCorner.atDistanceAndAzimuth(_currentTerrainRequest.grid_spacing * colIndex, 90);
-            coord = coord.atDistanceAndAzimuth(_currentTerrainRequest.grid_spacing * rowIndex, 0);
-            coordinates.append(coord);
-        }
+    Grid_t* grid = _gridCache.object(_currentGridKey);
+    if (!grid || _gridQueryActive) {
+        return;
+    }
+
+    const uint64_t missingMask = _currentTerrainRequest.mask & ~grid->loadedMask;
+    if (!missingMask) {
+        return;
     }
 
     // Query terrain system for altitudes. If it has them available it will return them. If not they will be queued for download.
-    bool            error = false;
-    QList<double>   altitudes;
+    const QList<QGeoCoordinate> coordinates = _blockCoordinates(_currentTerrainRequest, missingMask);
+    bool                        error       = false;
+    QList<double>               altitudes;
     if (TerrainAtCoordinateQuery::getAltitudesForCoordinates(coordinates, altitudes, error)) {
         if (error) {
-            qCWarning(TerrainProtocolHandlerLog) << "_sendTerrainData TerrainAtCoordinateQuery::getAltitudesForCoordinates failed";
+            // Just let it try again on the next timer tick
+            qCWarning(TerrainProtocolHandlerLog) << "_loadGrid TerrainAtCoordinateQuery::getAltitudesForCoordinates failed";
         } else {
-            // Only clear the bit if the query succeeds. Otherwise just let it try again on the next timer tick
-            uint64_t removeBit = ~(1ull << gridBit);
-            _currentTerrainRequest.mask &= removeBit;
-            int altIndex = 0;
-            int16_t terrainData[16];
-            for (const double& altitude : altitudes) {
-                terrainData[altIndex++] = static_cast<int16_t>(altitude);
-            }
+            _gridHeightsReceived(_currentGridKey, grid->gridSpacing, missingMask, true, altitudes);
+        }
+        return;
+    }
 
-            WeakLinkInterfacePtr weakLink = _vehicle->vehicleLinkManager()->primaryLink();
-            if (!weakLink.expired()) {
-                mavlink_message_t       msg;
-                SharedLinkInterfacePtr  sharedLink = weakLink.lock();
-
-                mavlink_msg_terrain_data_pack_chan(
-                            qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
-                            qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
-                            sharedLink->mavlinkChannel(),
-                            &msg,
-                            _currentTerrainRequest.lat,
-                            _currentTerrainRequest.lon,
-                            _currentTerrainRequest.grid_spacing,
-                            gridBit,
-                            terrainData);
-                _vehicle->sendMessageOnLinkThreadSafe(sharedLink.get(), msg);
-            }
+    // Tiles are being downloaded, have the terrain system tell us when the heights are available instead of polling for them
+    const quint64   gridKey     = _currentGridKey;
+    const uint16_t  gridSpacing = grid->gridSpacing;
+    TerrainAtCoordinateQuery* query = new TerrainAtCoordinateQuery(true /* autoDelete */);
+    connect(query, &TerrainAtCoordinateQuery::terrainDataReceived, this, [this, gridKey, gridSpacing, missingMask](bool success, QList<double> heights) {
+        if (gridKey == _currentGridKey) {
+            _gridQueryActive = false;
+        }
+        _gridHeightsReceived(gridKey, gridSpacing, missingMask, success, heights);
+        _sendNextTerrainData();
+    });
+    _gridQueryActive = true;
+    query->requestData(coordinates);
+}
+
+void TerrainProtocolHandler::_gridHeightsReceived(quint64 gridKey, uint16_t gridSpacing, uint64_t blockMask, bool success, const QList<double>& heights)
+{
+    if (!success) {
+        qCDebug(TerrainProtocolHandlerLog) << "_gridHeightsReceived terrain query failed";
+        return;
+    }
+
+    // The grid may have been evicted or replaced while the query was outstanding
+    Grid_t* grid = _gridCache.object(gridKey);
+    if (!grid || grid->gridSpacing != gridSpacing || heights.count() != static_cast<int>(qPopulationCount(blockMask)) * _blockPoints) {
+        return;
+    }
+
+    int heightIndex = 0;
+    for (uint64_t mask = blockMask; mask; mask &= mask - 1) {
+        int16_t* blockHeights = grid->heights[qCountTrailingZeroBits(mask)];
+        for (int pointIndex=0; pointIndex<_blockPoints; pointIndex++) {
+            blockHeights[pointIndex] = static_cast<int16_t>(heights[heightIndex++]);
         }
     }
+    grid->loadedMask |= blockMask;
+}
+
+/// Returns the number of TERRAIN_DATA messages which fit in the link budget since the last call
+int TerrainProtocolHandler::_blocksThisTick(LinkInterface* link)
+{
+    double blocksPerSecond = _maxBlocksPerSecond;
+
+#ifndef NO_SERIAL_LINK
+    // Radio links are shared with telemetry, only use part of them. 10 bits on the wire for each byte.
+    SharedLinkConfigurationPtr  config          = link->linkConfiguration();
+    SerialConfiguration*        serialConfig    = qobject_cast<SerialConfiguration*>(config.get());
+    if (serialConfig && !serialConfig->usbDirect()) {
+        const double messageBytes = MAVLINK_MSG_ID_TERRAIN_DATA_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+        blocksPerSecond = qMin(blocksPerSecond, serialConfig->baud() / 10.0 * _serialLinkFraction / messageBytes);
+    }
+#else
+    Q_UNUSED(link);
+#endif
+
+    qint64 elapsedMSecs = _sendIntervalMSecs;
+    if (_sendClock.isValid()) {
+        elapsedMSecs = _sendClock.restart();
+    } else {
+        _sendClock.start();
+    }
+
+    _sendCredit = qMin(_sendCredit + (blocksPerSecond * elapsedMSecs / 1000.0), static_cast<double>(_maxBurstBlocks));
+    const int blocks = static_cast<int>(_sendCredit);
+    _sendCredit -= blocks;
+
+    return blocks;
+}
+
+void TerrainProtocolHandler::_sendNextTerrainData(void)
+{
+    if (!_terrainRequestActive) {
+        return;
+    }
+
+    // Each TERRAIN_DATA sent to vehicle contains a 4x4 grid of heights
+    // TERRAIN_REQUEST.mask has a bit for each entry in an 8x7 grid
+
+    Grid_t*                 grid        = _gridCache.object(_currentGridKey);
+    SharedLinkInterfacePtr  sharedLink  = _vehicle->vehicleLinkManager()->primaryLink().lock();
+    if (!grid || !sharedLink) {
+        _terrainRequestActive = false;
+        _terrainDataSendTimer.stop();
+        return;
+    }
+
+    _loadGrid();
+
+    // Blocks are only cleared from the mask once they are sent. Blocks still waiting on tiles go out on a later tick.
+    uint64_t readyMask = _currentTerrainRequest.mask & grid->loadedMask;
+    for (int blockCount = _blocksThisTick(sharedLink.get()); blockCount > 0 && readyMask; blockCount--) {
+        const uint8_t gridBit = static_cast<uint8_t>(qCountTrailingZeroBits(readyMask));
+        _sendTerrainData(sharedLink.get(), grid, gridBit);
+        _currentTerrainRequest.mask &= ~(1ull << gridBit);
+        readyMask &= readyMask - 1;
+    }
+
+    if (_currentTerrainRequest.mask) {
+        // Kick timer to send next possible TERRAIN_DATA to vehicle
+        if (!_terrainDataSendTimer.isActive()) {
+            _terrainDataSendTimer.start();
+        }
+    } else {
+        _terrainRequestActive = false;
+        _terrainDataSendTimer.stop();
+    }
+}
+
+void TerrainProtocolHandler::_sendTerrainData(LinkInterface* link, const Grid_t* grid, uint8_t gridBit)
+{
+    mavlink_message_t msg;
+
+    mavlink_msg_terrain_data_pack_chan(
+                qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
+                qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
+                link->mavlinkChannel(),
+                &msg,
+                _currentTerrainRequest.lat,
+                _currentTerrainRequest.lon,
+                _currentTerrainRequest.grid_spacing,
+                gridBit,
+                grid->heights[gridBit]);
+    _vehicle->sendMessageOnLinkThreadSafe(link, msg);
 }
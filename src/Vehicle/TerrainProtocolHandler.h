@@ -15,6 +15,9 @@
 
 #include <QObject>
 #include <QGeoCoordinate>
+#include <QCache>
+#include <QTimer>
+#include <QElapsedTimer>
 
 class TerrainFactGroup;
 
@@ -47,13 +50,42 @@ private slots:
     void _sendNextTerrainData(void);
 
 private:
-    void _handleTerrainRequest  (const mavlink_message_t& message);
-    void _handleTerrainReport   (const mavlink_message_t& message);
-    void _sendTerrainData       (const QGeoCoordinate& swCorner, uint8_t gridBit);
+    static const int _gridRows              = 7;
+    static const int _gridCols              = 8;
+    static const int _gridBlockCount        = _gridRows * _gridCols;    ///< One bit in TERRAIN_REQUEST.mask per block
+    static const int _blockPoints           = 4 * 4;                    ///< Heights in a single TERRAIN_DATA
+
+    /// Heights for all the blocks of a single TERRAIN_REQUEST grid, filled in as tiles become available
+    typedef struct {
+        uint16_t    gridSpacing;
+        uint64_t    loadedMask;                             ///< Blocks which have their heights filled in
+        int16_t     heights[_gridBlockCount][_blockPoints];
+    } Grid_t;
+
+    void    _handleTerrainRequest   (const mavlink_message_t& message);
+    void    _handleTerrainReport    (const mavlink_message_t& message);
+    void    _loadGrid               (void);
+    void    _gridHeightsReceived    (quint64 gridKey, uint16_t gridSpacing, uint64_t blockMask, bool success, const QList<double>& heights);
+    void    _sendTerrainData        (LinkInterface* link, const Grid_t* grid, uint8_t gridBit);
+    int     _blocksThisTick         (LinkInterface* link);
+
+    static quint64                  _gridKey        (const mavlink_terrain_request_t& request);
+    static QList<QGeoCoordinate>    _blockCoordinates(const mavlink_terrain_request_t& request, uint64_t blockMask);
 
     Vehicle*                    _vehicle;
     TerrainFactGroup*           _terrainFactGroup;
     bool                        _terrainRequestActive =             false;
+    bool                        _gridQueryActive =                  false;  ///< Async height query outstanding for the current grid
     mavlink_terrain_request_t   _currentTerrainRequest;
+    quint64                     _currentGridKey =                   0;
+    QCache<quint64, Grid_t>     _gridCache;
+    double                      _sendCredit =                       0;      ///< Fractional blocks carried over between ticks
+    QElapsedTimer               _sendClock;
     QTimer                      _terrainDataSendTimer;
+
+    static const int    _maxCachedGrids         = 16;
+    static const int    _sendIntervalMSecs      = 50;
+    static const int    _maxBlocksPerSecond     = 200;      ///< Upper bound on any link, a full grid in under a third of a second
+    static const int    _maxBurstBlocks         = 8;        ///< Most blocks sent in a single tick
+    static constexpr double _serialLinkFraction = 0.25;     ///< Share of a serial link terrain data may use, the rest is left for telemetry
 };
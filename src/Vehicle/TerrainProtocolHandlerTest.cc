@@ -0,0 +1,53 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainProtocolHandlerTest.h"
+#include "TerrainQuery.h"
+#include "MockLink.h"
+
+void TerrainProtocolHandlerTest::_fullGridTest(void)
+{
+    _connectMockLink(MAV_AUTOPILOT_ARDUPILOTMEGA);
+
+    // The whole 8x7 grid at 30m spacing is under 1km on each side, so it stays within the flat test region
+    _mockLink->clearReceivedTerrainData();
+    _mockLink->sendTerrainRequest(UnitTestTerrainQuery::flat10Region.center(), 30, _fullGridMask);
+    QVERIFY(QTest::qWaitFor([&]() { return _mockLink->receivedTerrainDataMask() == _fullGridMask; }, 5000));
+
+    // Each block is sent once, with the heights for the region
+    const QList<int16_t> heights = _mockLink->receivedTerrainDataHeights();
+    QCOMPARE(heights.count(), 8 * 7 * 16);
+    for (int16_t height: heights) {
+        QCOMPARE(static_cast<double>(height), UnitTestTerrainQuery::Flat10Region::amslElevation);
+    }
+
+    _disconnectMockLink();
+}
+
+void TerrainProtocolHandlerTest::_repeatRequestTest(void)
+{
+    _connectMockLink(MAV_AUTOPILOT_ARDUPILOTMEGA);
+
+    const QGeoCoordinate swCorner = UnitTestTerrainQuery::flat10Region.center();
+
+    _mockLink->clearReceivedTerrainData();
+    _mockLink->sendTerrainRequest(swCorner, 30, _fullGridMask);
+    QVERIFY(QTest::qWaitFor([&]() { return _mockLink->receivedTerrainDataMask() == _fullGridMask; }, 5000));
+
+    // The vehicle asks again for blocks it lost, only those are sent
+    const uint64_t repeatMask = (1ull << 3) | (1ull << 17) | (1ull << 55);
+    _mockLink->clearReceivedTerrainData();
+    _mockLink->sendTerrainRequest(swCorner, 30, repeatMask);
+    QVERIFY(QTest::qWaitFor([&]() { return _mockLink->receivedTerrainDataMask() == repeatMask; }, 5000));
+    QTest::qWait(500);
+    QCOMPARE(_mockLink->receivedTerrainDataMask(), repeatMask);
+    QCOMPARE(_mockLink->receivedTerrainDataHeights().count(), 3 * 16);
+
+    _disconnectMockLink();
+}
@@ -0,0 +1,25 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+
+/// Tests servicing of TERRAIN_REQUEST from the vehicle by TerrainProtocolHandler
+class TerrainProtocolHandlerTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _fullGridTest      (void);
+    void _repeatRequestTest (void);
+
+private:
+    static const uint64_t _fullGridMask = (1ull << (8 * 7)) - 1;
+};
@@ -10,6 +10,8 @@
 #include "TrajectoryPoints.h"
 #include "Vehicle.h"
 
+#include <QtMath>
+
 TrajectoryPoints::TrajectoryPoints(Vehicle* vehicle, QObject* parent)
     : QObject       (parent)
     , _vehicle      (vehicle)
@@ -33,20 +35,20 @@ void TrajectoryPoints::_vehicleCoordinateChanged(QGeoCoordinate coordinate)
                 // The new position IS NOT colinear with the last segment. Append the new position to the list.
                 _lastAzimuth = _lastPoint.azimuthTo(coordinate);
                 _lastPoint = coordinate;
-                _points.append(QVariant::fromValue(coordinate));
+                _append(coordinate);
                 emit pointAdded(coordinate);
             } else {
                 // The new position IS colinear with the last segment. Don't add a new point, just update
                 // the last point to be the new position.
                 _lastPoint = coordinate;
-                _points[_points.count() - 1] = QVariant::fromValue(coordinate);
+                _setLast(coordinate);
                 emit updateLastPoint(coordinate);
             }
         }
     } else {
         // Add the very first trajectory point to the list
         _lastPoint = coordinate;
-        _points.append(QVariant::fromValue(coordinate));
+        _append(coordinate);
         emit pointAdded(coordinate);
     }
 }
@@ -64,8 +66,186 @@ void TrajectoryPoints::stop(void)
 
 void TrajectoryPoints::clear(void)
 {
-    _points.clear();
+    _head = 0;
+    _count = 0;
+    _decimationTolerance = _minDecimationTolerance;
+    _levelsOfDetail.clear();
     _lastPoint = QGeoCoordinate();
     _lastAzimuth = qQNaN();
     emit pointsCleared();
 }
+
+QGeoCoordinate TrajectoryPoints::_coordinate(int logicalIndex) const
+{
+    const int index = _index(logicalIndex);
+    return QGeoCoordinate(_latitudes[index], _longitudes[index], static_cast<double>(_altitudes[index]));
+}
+
+void TrajectoryPoints::_append(const QGeoCoordinate& coordinate)
+{
+    if (_latitudes.isEmpty()) {
+        _latitudes.resize(_capacity);
+        _longitudes.resize(_capacity);
+        _altitudes.resize(_capacity);
+    }
+    if (_count == _capacity) {
+        _decimate();
+    }
+
+    const int index = _index(_count++);
+    _latitudes[index]   = coordinate.latitude();
+    _longitudes[index]  = coordinate.longitude();
+    _altitudes[index]   = static_cast<float>(coordinate.altitude());
+}
+
+void TrajectoryPoints::_setLast(const QGeoCoordinate& coordinate)
+{
+    // Level of detail views always keep the last point, so they stay valid
+    const int index = _index(_count - 1);
+    _latitudes[index]   = coordinate.latitude();
+    _longitudes[index]  = coordinate.longitude();
+    _altitudes[index]   = static_cast<float>(coordinate.altitude());
+}
+
+/// Makes room in a full buffer. The path is simplified with a tolerance which grows each time it is needed, so
+/// the whole flight stays visible at decreasing detail. Once the tolerance is used up the oldest points are dropped.
+void TrajectoryPoints::_decimate(void)
+{
+    const int   targetCount = _capacity * 3 / 4;
+    QVector<int> indices;
+
+    forever {
+        indices.clear();
+        _simplify(0, _count - 1, _decimationTolerance, indices);
+        if (indices.count() <= targetCount || _decimationTolerance >= _maxDecimationTolerance) {
+            break;
+        }
+        _decimationTolerance *= 2;
+    }
+
+    // Kept indices are ascending, so points can be moved down in place
+    for (int i=0; i<indices.count(); i++) {
+        const int from  = _index(indices[i]);
+        const int to    = _index(i);
+        _latitudes[to]  = _latitudes[from];
+        _longitudes[to] = _longitudes[from];
+        _altitudes[to]  = _altitudes[from];
+    }
+    _count = indices.count();
+
+    if (_count > targetCount) {
+        const int dropCount = _count - targetCount;
+        _head = _index(dropCount);
+        _count = targetCount;
+    }
+
+    qCDebug(VehicleLog) << "TrajectoryPoints decimated to" << _count << "points tolerance" << _decimationTolerance;
+
+    _levelsOfDetail.clear();
+    emit pointsDecimated();
+}
+
+/// Douglas-Peucker simplification of the points from first to last, using an explicit stack since trajectories can
+/// be long. Appends the logical indices of the points kept, both ends are always kept.
+///     @param tolerance Meters a dropped point may be from the simplified path
+void TrajectoryPoints::_simplify(int first, int last, double tolerance, QVector<int>& indices) const
+{
+    if (last < first) {
+        return;
+    }
+
+    // Distances are measured on a local flat projection, plenty accurate at trajectory scales
+    static const double metersPerDegree = 111319.5;
+    const double        lonScale        = qCos(qDegreesToRadians(_latitudes[_index(first)])) * metersPerDegree;
+
+    QVector<bool> keep(last - first + 1, false);
+    keep[0] = true;
+    keep[last - first] = true;
+
+    QVector<QPair<int, int>> segments;
+    segments.append(qMakePair(first, last));
+    while (!segments.isEmpty()) {
+        const QPair<int, int> segment = segments.takeLast();
+        if (segment.second - segment.first < 2) {
+            continue;
+        }
+
+        const int       startIndex  = _index(segment.first);
+        const int       endIndex    = _index(segment.second);
+        const double    startX      = _longitudes[startIndex] * lonScale;
+        const double    startY      = _latitudes[startIndex] * metersPerDegree;
+        const double    dx          = _longitudes[endIndex] * lonScale - startX;
+        const double    dy          = _latitudes[endIndex] * metersPerDegree - startY;
+        const double    lengthSq    = dx * dx + dy * dy;
+
+        double  maxDistanceSq   = -1;
+        int     maxLogicalIndex = segment.first;
+        for (int logicalIndex=segment.first + 1; logicalIndex<segment.second; logicalIndex++) {
+            const int       index   = _index(logicalIndex);
+            const double    px      = _longitudes[index] * lonScale - startX;
+            const double    py      = _latitudes[index] * metersPerDegree - startY;
+            const double    t       = lengthSq > 0 ? qBound(0.0, (px * dx + py * dy) / lengthSq, 1.0) : 0.0;
+            const double    ex      = px - t * dx;
+            const double    ey      = py - t * dy;
+            const double    distanceSq = ex * ex + ey * ey;
+            if (distanceSq > maxDistanceSq) {
+                maxDistanceSq   = distanceSq;
+                maxLogicalIndex = logicalIndex;
+            }
+        }
+
+        if (maxDistanceSq > tolerance * tolerance) {
+            keep[maxLogicalIndex - first] = true;
+            segments.append(qMakePair(segment.first, maxLogicalIndex));
+            segments.append(qMakePair(maxLogicalIndex, segment.second));
+        }
+    }
+
+    for (int i=0; i<keep.count(); i++) {
+        if (keep[i]) {
+            indices.append(first + i);
+        }
+    }
+}
+
+/// Returns the size in meters of a map pixel at the specified zoom level
+double TrajectoryPoints::_zoomTolerance(int zoomLevel, double latitude)
+{
+    return 156543.03392 * qCos(qDegreesToRadians(latitude)) / qPow(2.0, zoomLevel);
+}
+
+QVariantList TrajectoryPoints::list(int zoomLevel)
+{
+    QVariantList points;
+
+    if (zoomLevel < 0 || _count < 3) {
+        points.reserve(_count);
+        for (int i=0; i<_count; i++) {
+            points.append(QVariant::fromValue(_coordinate(i)));
+        }
+        return points;
+    }
+
+    // Views are extended with the points added since they were last used. Only the new stretch is simplified,
+    // starting from the last point the view kept.
+    LevelOfDetail_t& lod = _levelsOfDetail[zoomLevel];
+    if (lod.indices.isEmpty()) {
+        lod.pointCount = 0;
+    }
+    if (lod.pointCount < _count) {
+        const double tolerance = _zoomTolerance(zoomLevel, _latitudes[_index(0)]);
+        if (lod.indices.isEmpty()) {
+            _simplify(0, _count - 1, tolerance, lod.indices);
+        } else {
+            const int startIndex = lod.indices.takeLast();
+            _simplify(startIndex, _count - 1, tolerance, lod.indices);
+        }
+        lod.pointCount = _count;
+    }
+
+    points.reserve(lod.indices.count());
+    for (int index: lod.indices) {
+        points.append(QVariant::fromValue(_coordinate(index)));
+    }
+    return points;
+}
@@ -12,12 +12,14 @@
 #include "QmlObjectListModel.h"
 
 #include <QGeoCoordinate>
+#include <QHash>
+#include <QVector>
 
 class Vehicle;
 
 // TrajectoryPointsࣨ켣
 // 1. 켣ݴ洢
-//    - ʹ QVariantList _points ά켣꼯
+//    - ʹöʽλγ//߶ȣά켣㣬дʱDouglas-Peuckerϡɹ켣
 //    - ͨ QGeoCoordinate _lastPoint Ч
 // 2. Զ¼
 //    - ƶʱԶӹ켣
@@ -26,16 +28,23 @@ class Vehicle;
 //      - λݲ_azimuthTolerance=1.5ȣ
 // 3. ƽӿ
 // 4. QMLͬ
-//    - ͨ list() ¶켣㼯ϸQML
+//    - ͨ list(zoomLevel) ͼż¶ϡĹ켣㼯ϸQML
 //    - ֶ֧̬켣ӻ
 class TrajectoryPoints : public QObject
 {
     Q_OBJECT
 
+    friend class TrajectoryPointsTest;
+
 public:
     TrajectoryPoints(Vehicle* vehicle, QObject* parent = nullptr);
 
-    Q_INVOKABLE QVariantList list(void) const { return _points; }
+    /// Returns the trajectory for display
+    ///     @param zoomLevel Map zoom level, points which would be within a pixel of the simplified path at that zoom
+    ///                      are left out. -1 for all points.
+    Q_INVOKABLE QVariantList list(int zoomLevel = -1);
+
+    int count(void) const { return _count; }
 
     void start  (void);
     void stop   (void);
@@ -47,16 +56,45 @@ signals:
     void pointAdded     (QGeoCoordinate coordinate);
     void updateLastPoint(QGeoCoordinate coordinate);
     void pointsCleared  (void);
+    void pointsDecimated(void);     ///< Older points were thinned out to make room, views should reload list()
 
 private slots:
     void _vehicleCoordinateChanged(QGeoCoordinate coordinate);
 
 private:
+    /// Simplified view of the trajectory for one zoom level
+    typedef struct {
+        QVector<int>    indices;        ///< Logical indices of the points kept
+        int             pointCount;     ///< Number of trajectory points the view covers
+    } LevelOfDetail_t;
+
+    int             _index          (int logicalIndex) const { return (_head + logicalIndex) % _capacity; }
+    QGeoCoordinate  _coordinate     (int logicalIndex) const;
+    void            _append         (const QGeoCoordinate& coordinate);
+    void            _setLast        (const QGeoCoordinate& coordinate);
+    void            _decimate       (void);
+    void            _simplify       (int first, int last, double tolerance, QVector<int>& indices) const;
+
+    static double   _zoomTolerance  (int zoomLevel, double latitude);
+
     Vehicle*        _vehicle;
-    QVariantList    _points;
     QGeoCoordinate  _lastPoint;
     double          _lastAzimuth;
 
+    // Columnar ring buffer of trajectory points, oldest point at _head
+    QVector<double> _latitudes;
+    QVector<double> _longitudes;
+    QVector<float>  _altitudes;
+    int             _head =                 0;
+    int             _count =                0;
+
+    double                      _decimationTolerance =  _minDecimationTolerance;
+    QHash<int, LevelOfDetail_t> _levelsOfDetail;
+
     static constexpr double _distanceTolerance = 2.0;
     static constexpr double _azimuthTolerance = 1.5;
+
+    static const int        _capacity               = 20000;
+    static constexpr double _minDecimationTolerance = 1.0;  ///< Meters
+    static constexpr double _maxDecimationTolerance = 64.0; ///< Beyond this the oldest points are dropped instead
 };
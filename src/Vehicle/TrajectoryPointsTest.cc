@@ -0,0 +1,141 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TrajectoryPointsTest.h"
+#include "TrajectoryPoints.h"
+
+#include <QSignalSpy>
+
+namespace {
+
+// Same flat projection as TrajectoryPoints::_simplify, exact on the equator
+const double kMetersPerDegree = 111319.5;
+
+QGeoCoordinate meters(double x, double y)
+{
+    return QGeoCoordinate(y / kMetersPerDegree, x / kMetersPerDegree, 0);
+}
+
+// Offsets of each point from the straight chord through its neighbours (meters):
+//  1: 0.5   2: 32.9 from 0-3   3: 50 from 0-6   4: 32.9 from 3-6   5: 0.3
+void appendPolyline(TrajectoryPoints& points)
+{
+    points._append(meters(0,   0));
+    points._append(meters(100, 0.5));
+    points._append(meters(200, 0));
+    points._append(meters(300, 50));
+    points._append(meters(400, 0));
+    points._append(meters(500, 0.3));
+    points._append(meters(600, 0));
+}
+
+}
+
+void TrajectoryPointsTest::_simplifyTest(void)
+{
+    TrajectoryPoints points(nullptr);
+    appendPolyline(points);
+    QCOMPARE(points.count(), 7);
+    QCOMPARE(points.list().count(), 7);
+
+    QVector<int> indices;
+    points._simplify(0, 6, 1.0, indices);
+    QCOMPARE(indices, QVector<int>({ 0, 2, 3, 4, 6 }));
+
+    indices.clear();
+    points._simplify(0, 6, 20.0, indices);
+    QCOMPARE(indices, QVector<int>({ 0, 2, 3, 4, 6 }));
+
+    indices.clear();
+    points._simplify(0, 6, 40.0, indices);
+    QCOMPARE(indices, QVector<int>({ 0, 3, 6 }));
+
+    indices.clear();
+    points._simplify(0, 6, 60.0, indices);
+    QCOMPARE(indices, QVector<int>({ 0, 6 }));
+
+    // A sub range keeps its own ends and reports logical indices
+    indices.clear();
+    points._simplify(3, 6, 20.0, indices);
+    QCOMPARE(indices, QVector<int>({ 3, 4, 6 }));
+}
+
+void TrajectoryPointsTest::_levelOfDetailTest(void)
+{
+    TrajectoryPoints points(nullptr);
+    appendPolyline(points);
+
+    // One pixel is ~38m at zoom 12, ~19m at zoom 13 and ~76m at zoom 11 on the equator
+    QCOMPARE(points.list(13).count(), 5);
+    QCOMPARE(points.list(12).count(), 3);
+    QCOMPARE(points.list(11).count(), 2);
+    QCOMPARE(points._levelsOfDetail.count(), 3);
+    QCOMPARE(points._levelsOfDetail[12].indices, QVector<int>({ 0, 3, 6 }));
+    QCOMPARE(points._levelsOfDetail[12].pointCount, 7);
+
+    const QVariantList zoom12 = points.list(12);
+    QCOMPARE(zoom12[1].value<QGeoCoordinate>(), meters(300, 50));
+
+    // Moving the last point leaves the views valid, they always keep it
+    points._setLast(meters(600, 5));
+    QCOMPARE(points._levelsOfDetail[12].pointCount, 7);
+    QCOMPARE(points.list(12).last().value<QGeoCoordinate>(), meters(600, 5));
+
+    // New points only extend a view from its last kept point. Simplifying everything again would keep point 4
+    // instead of point 6, the earlier part of the view is not revisited.
+    points._append(meters(700, 0.2));
+    points._append(meters(800, 0));
+    QCOMPARE(points.list(12).count(), 4);
+    QCOMPARE(points._levelsOfDetail[12].indices, QVector<int>({ 0, 3, 6, 8 }));
+    QCOMPARE(points._levelsOfDetail[12].pointCount, 9);
+    // Views which were not asked for again are left stale until they are
+    QCOMPARE(points._levelsOfDetail[11].pointCount, 7);
+
+    // Decimation drops the sub meter wiggles at points 1 and 5 and invalidates all views
+    QSignalSpy decimatedSpy(&points, &TrajectoryPoints::pointsDecimated);
+    points._decimate();
+    QCOMPARE(decimatedSpy.count(), 1);
+    QVERIFY(points._levelsOfDetail.isEmpty());
+    QCOMPARE(points.count(), 7);
+
+    points.list(12);
+    QCOMPARE(points._levelsOfDetail.count(), 1);
+
+    QSignalSpy clearedSpy(&points, &TrajectoryPoints::pointsCleared);
+    points.clear();
+    QCOMPARE(clearedSpy.count(), 1);
+    QVERIFY(points._levelsOfDetail.isEmpty());
+    QCOMPARE(points.count(), 0);
+    QVERIFY(points.list(12).isEmpty());
+}
+
+void TrajectoryPointsTest::_fullBufferDecimateTest(void)
+{
+    TrajectoryPoints points(nullptr);
+    QSignalSpy decimatedSpy(&points, &TrajectoryPoints::pointsDecimated);
+
+    // A straight path with 0.3m of jitter, well inside the 1m starting tolerance
+    const int capacity = TrajectoryPoints::_capacity;
+    for (int i=0; i<capacity; i++) {
+        points._append(meters(i * 10.0, (i & 1) ? 0.3 : 0));
+    }
+    QCOMPARE(points.count(), capacity);
+    QCOMPARE(decimatedSpy.count(), 0);
+
+    // The next point simplifies the path down to its ends before being added
+    points._append(meters(capacity * 10.0, 0));
+    QCOMPARE(decimatedSpy.count(), 1);
+    QCOMPARE(points.count(), 3);
+    QCOMPARE(points._decimationTolerance, 1.0);
+
+    const QVariantList list = points.list();
+    QCOMPARE(list[0].value<QGeoCoordinate>(), meters(0, 0));
+    QCOMPARE(list[1].value<QGeoCoordinate>(), meters((capacity - 1) * 10.0, 0.3));
+    QCOMPARE(list[2].value<QGeoCoordinate>(), meters(capacity * 10.0, 0));
+}
@@ -11,6 +11,7 @@
 #include <QDateTime>
 #include <QLocale>
 #include <QQuaternion>
+#include <QElapsedTimer>
 
 #include <Eigen/Eigen>
 
@@ -194,7 +195,9 @@ Vehicle::Vehicle(LinkInterface*             link,
     _mavlink = _toolbox->mavlinkProtocol();
     qCDebug(VehicleLog) << "Link started with Mavlink " << (_mavlink->getCurrentVersion() >= 200 ? "V2" : "V1");
 
-    connect(_mavlink, &MAVLinkProtocol::messageReceived,        this, &Vehicle::_mavlinkMessageReceived);
+    // All messages: link stats, sequence loss, plugins and mavlinkMessageReceived all see every message from the vehicle.
+    // Per message id handling happens in the vehicle's own dispatch table.
+    _mavlink->subscribeMessages(this, QList<uint32_t>(), std::bind(&Vehicle::_mavlinkMessagesReceived, this, std::placeholders::_1, std::placeholders::_2));
     connect(_mavlink, &MAVLinkProtocol::mavlinkMessageStatus,   this, &Vehicle::_mavlinkMessageStatus);
 
     connect(this, &Vehicle::flightModeChanged,          this, &Vehicle::_handleFlightModeChanged);
@@ -461,6 +464,9 @@ void Vehicle::_commonInit()
     _hobbsFact.setRawValue(QVariant(QString("0000:00:00")));
     _addFact(&_hobbsFact,               _hobbsFactName);
 
+    // Fact groups are added dynamically (batteries), each change requires the message dispatch table to be rebuilt
+    connect(this, &FactGroup::factGroupNamesChanged, this, [this]() { _messageDispatchTableDirty = true; });
+
     _addFactGroup(&_gpsFactGroup,               _gpsFactGroupName);
     _addFactGroup(&_gps2FactGroup,              _gps2FactGroupName);
     _addFactGroup(&_windFactGroup,              _windFactGroupName);
@@ -621,6 +627,13 @@ void Vehicle::resetCounters()
     _heardFrom          = false;
 }
 
+void Vehicle::_mavlinkMessagesReceived(LinkInterface* link, const QVector<const mavlink_message_t*>& messages)
+{
+    for (const mavlink_message_t* message: messages) {
+        _mavlinkMessageReceived(link, *message);
+    }
+}
+
 void Vehicle::_mavlinkMessageReceived(LinkInterface* link, mavlink_message_t message)
 {
     // If the link is already running at Mavlink V2 set our max proto version to it.
@@ -679,121 +692,92 @@ void Vehicle::_mavlinkMessageReceived(LinkInterface* link, mavlink_message_t mes
     if (!_terrainProtocolHandler->mavlinkMessageReceived(message)) {
         return;
     }
-    _ftpManager->_mavlinkMessageReceived(message);
-    _parameterManager->mavlinkMessageReceived(message);
-    _imageProtocolManager->mavlinkMessageReceived(message);
-    _remoteIDManager->mavlinkMessageReceived(message);
+    _dispatchMessage(link, message);
 
     _waitForMavlinkMessageMessageReceived(message);
 
+    // This must be emitted after the vehicle processes the message. This way the vehicle state is up to date when anyone else
+    // does processing.
+    emit mavlinkMessageReceived(message);
+
+    _uas->receiveMessage(message);
+}
+
+void Vehicle::_addMessageHandler(uint32_t msgId, MessageHandler_t handler)
+{
+    _messageDispatchTable[msgId].handlers.append(handler);
+}
+
+/// Builds the message id to handler table. Rebuilt whenever the set of fact groups changes.
+void Vehicle::_buildMessageDispatchTable(void)
+{
+    // Stats are kept across rebuilds
+    for (MessageDispatchEntry_t& entry: _messageDispatchTable) {
+        entry.handlers.clear();
+    }
+    _allMessagesFactGroups.clear();
+    _messageDispatchFactGroups.clear();
+
+    _addMessageHandler(MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL,       [this](LinkInterface*, mavlink_message_t& message) { _ftpManager->_mavlinkMessageReceived(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_PARAM_VALUE,                  [this](LinkInterface*, mavlink_message_t& message) { _parameterManager->mavlinkMessageReceived(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_DATA_TRANSMISSION_HANDSHAKE,  [this](LinkInterface*, mavlink_message_t& message) { _imageProtocolManager->mavlinkMessageReceived(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_ENCAPSULATED_DATA,            [this](LinkInterface*, mavlink_message_t& message) { _imageProtocolManager->mavlinkMessageReceived(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_OPEN_DRONE_ID_ARM_STATUS,     [this](LinkInterface*, mavlink_message_t& message) { _remoteIDManager->mavlinkMessageReceived(message); });
+
     // Battery fact groups are created dynamically as new batteries are discovered
-    VehicleBatteryFactGroup::handleMessageForFactGroupCreation(this, message);
+    for (uint32_t msgId: { MAVLINK_MSG_ID_HIGH_LATENCY, MAVLINK_MSG_ID_HIGH_LATENCY2, MAVLINK_MSG_ID_BATTERY_STATUS }) {
+        _addMessageHandler(msgId, [this](LinkInterface*, mavlink_message_t& message) { VehicleBatteryFactGroup::handleMessageForFactGroupCreation(this, message); });
+    }
 
     // Let the fact groups take a whack at the mavlink traffic
     for (FactGroup* factGroup : factGroups()) {
-        factGroup->handleMessage(this, message);
+        _messageDispatchFactGroups.insert(factGroup);
+        QList<uint32_t> msgIds = factGroup->handledMessageIds();
+        if (msgIds.isEmpty()) {
+            _allMessagesFactGroups.append(factGroup);
+        } else {
+            for (uint32_t msgId: msgIds) {
+                _addMessageHandler(msgId, [this, factGroup](LinkInterface*, mavlink_message_t& message) { factGroup->handleMessage(this, message); });
+            }
+        }
     }
 
-    switch (message.msgid) {
-    case MAVLINK_MSG_ID_HOME_POSITION:
-        _handleHomePosition(message);
-        break;
-    case MAVLINK_MSG_ID_HEARTBEAT:
-        _handleHeartbeat(message);
-        break;
-    case MAVLINK_MSG_ID_RADIO_STATUS:
-        _handleRadioStatus(message);
-        break;
-    case MAVLINK_MSG_ID_RC_CHANNELS:
-        _handleRCChannels(message);
-        break;
-    case MAVLINK_MSG_ID_BATTERY_STATUS:
-        _handleBatteryStatus(message);
-        break;
-    case MAVLINK_MSG_ID_SYS_STATUS:
-        _handleSysStatus(message);
-        break;
-    case MAVLINK_MSG_ID_RAW_IMU:
-        _handleRawImuTemp(message);
-        break;
-    case MAVLINK_MSG_ID_SCALED_IMU:
-        emit mavlinkScaledImu1(message);
-        break;
-    case MAVLINK_MSG_ID_SCALED_IMU2:
-        emit mavlinkScaledImu2(message);
-        break;
-    case MAVLINK_MSG_ID_SCALED_IMU3:
-        emit mavlinkScaledImu3(message);
-        break;
-    case MAVLINK_MSG_ID_EXTENDED_SYS_STATE:
-        _handleExtendedSysState(message);
-        break;
-    case MAVLINK_MSG_ID_COMMAND_ACK:
-        _handleCommandAck(message);
-        break;
-    case MAVLINK_MSG_ID_LOGGING_DATA:
-        _handleMavlinkLoggingData(message);
-        break;
-    case MAVLINK_MSG_ID_LOGGING_DATA_ACKED:
-        _handleMavlinkLoggingDataAcked(message);
-        break;
-    case MAVLINK_MSG_ID_GPS_RAW_INT:
-        _handleGpsRawInt(message);
-        break;
-    case MAVLINK_MSG_ID_GLOBAL_POSITION_INT:
-        _handleGlobalPositionInt(message);
-        break;
-    case MAVLINK_MSG_ID_ALTITUDE:
-        _handleAltitude(message);
-        break;
-    case MAVLINK_MSG_ID_VFR_HUD:
-        _handleVfrHud(message);
-        break;
-    case MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT:
-        _handleNavControllerOutput(message);
-        break;
-    case MAVLINK_MSG_ID_CAMERA_IMAGE_CAPTURED:
-        _handleCameraImageCaptured(message);
-        break;
-    case MAVLINK_MSG_ID_ADSB_VEHICLE:
-        _handleADSBVehicle(message);
-        break;
-    case MAVLINK_MSG_ID_HIGH_LATENCY:
-        _handleHighLatency(message);
-        break;
-    case MAVLINK_MSG_ID_HIGH_LATENCY2:
-        _handleHighLatency2(message);
-        break;
-    case MAVLINK_MSG_ID_ATTITUDE:
-        _handleAttitude(message);
-        break;
-    case MAVLINK_MSG_ID_ATTITUDE_QUATERNION:
-        _handleAttitudeQuaternion(message);
-        break;
-    case MAVLINK_MSG_ID_STATUSTEXT:
-        _handleStatusText(message);
-        break;
-    case MAVLINK_MSG_ID_ORBIT_EXECUTION_STATUS:
-        _handleOrbitExecutionStatus(message);
-        break;
-    case MAVLINK_MSG_ID_PING:
-        _handlePing(link, message);
-        break;
-    case MAVLINK_MSG_ID_OBSTACLE_DISTANCE:
-        _handleObstacleDistance(message);
-        break;
-    case MAVLINK_MSG_ID_FENCE_STATUS:
-        _handleFenceStatus(message);
-        break;
-
-    case MAVLINK_MSG_ID_EVENT:
-    case MAVLINK_MSG_ID_CURRENT_EVENT_SEQUENCE:
-    case MAVLINK_MSG_ID_RESPONSE_EVENT_ERROR:
-        _eventHandler(message.compid).handleEvents(message);
-        break;
-
-    case MAVLINK_MSG_ID_SERIAL_CONTROL:
-    {
+    _addMessageHandler(MAVLINK_MSG_ID_HOME_POSITION,            [this](LinkInterface*, mavlink_message_t& message) { _handleHomePosition(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_HEARTBEAT,                [this](LinkInterface*, mavlink_message_t& message) { _handleHeartbeat(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_RADIO_STATUS,             [this](LinkInterface*, mavlink_message_t& message) { _handleRadioStatus(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_RC_CHANNELS,              [this](LinkInterface*, mavlink_message_t& message) { _handleRCChannels(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_BATTERY_STATUS,           [this](LinkInterface*, mavlink_message_t& message) { _handleBatteryStatus(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_SYS_STATUS,               [this](LinkInterface*, mavlink_message_t& message) { _handleSysStatus(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_RAW_IMU,                  [this](LinkInterface*, mavlink_message_t& message) { _handleRawImuTemp(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_SCALED_IMU,               [this](LinkInterface*, mavlink_message_t& message) { emit mavlinkScaledImu1(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_SCALED_IMU2,              [this](LinkInterface*, mavlink_message_t& message) { emit mavlinkScaledImu2(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_SCALED_IMU3,              [this](LinkInterface*, mavlink_message_t& message) { emit mavlinkScaledImu3(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_EXTENDED_SYS_STATE,       [this](LinkInterface*, mavlink_message_t& message) { _handleExtendedSysState(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_COMMAND_ACK,              [this](LinkInterface*, mavlink_message_t& message) { _handleCommandAck(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_LOGGING_DATA,             [this](LinkInterface*, mavlink_message_t& message) { _handleMavlinkLoggingData(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_LOGGING_DATA_ACKED,       [this](LinkInterface*, mavlink_message_t& message) { _handleMavlinkLoggingDataAcked(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_GPS_RAW_INT,              [this](LinkInterface*, mavlink_message_t& message) { _handleGpsRawInt(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_GLOBAL_POSITION_INT,      [this](LinkInterface*, mavlink_message_t& message) { _handleGlobalPositionInt(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_ALTITUDE,                 [this](LinkInterface*, mavlink_message_t& message) { _handleAltitude(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_VFR_HUD,                  [this](LinkInterface*, mavlink_message_t& message) { _handleVfrHud(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT,    [this](LinkInterface*, mavlink_message_t& message) { _handleNavControllerOutput(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_CAMERA_IMAGE_CAPTURED,    [this](LinkInterface*, mavlink_message_t& message) { _handleCameraImageCaptured(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_ADSB_VEHICLE,             [this](LinkInterface*, mavlink_message_t& message) { _handleADSBVehicle(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_HIGH_LATENCY,             [this](LinkInterface*, mavlink_message_t& message) { _handleHighLatency(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_HIGH_LATENCY2,            [this](LinkInterface*, mavlink_message_t& message) { _handleHighLatency2(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_ATTITUDE,                 [this](LinkInterface*, mavlink_message_t& message) { _handleAttitude(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_ATTITUDE_QUATERNION,      [this](LinkInterface*, mavlink_message_t& message) { _handleAttitudeQuaternion(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_STATUSTEXT,               [this](LinkInterface*, mavlink_message_t& message) { _handleStatusText(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_ORBIT_EXECUTION_STATUS,   [this](LinkInterface*, mavlink_message_t& message) { _handleOrbitExecutionStatus(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_PING,                     [this](LinkInterface* link, mavlink_message_t& message) { _handlePing(link, message); });
+    _addMessageHandler(MAVLINK_MSG_ID_OBSTACLE_DISTANCE,        [this](LinkInterface*, mavlink_message_t& message) { _handleObstacleDistance(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_FENCE_STATUS,             [this](LinkInterface*, mavlink_message_t& message) { _handleFenceStatus(message); });
+
+    for (uint32_t msgId: { MAVLINK_MSG_ID_EVENT, MAVLINK_MSG_ID_CURRENT_EVENT_SEQUENCE, MAVLINK_MSG_ID_RESPONSE_EVENT_ERROR }) {
+        _addMessageHandler(msgId, [this](LinkInterface*, mavlink_message_t& message) { _eventHandler(message.compid).handleEvents(message); });
+    }
+
+    _addMessageHandler(MAVLINK_MSG_ID_SERIAL_CONTROL, [this](LinkInterface*, mavlink_message_t& message) {
         mavlink_serial_control_t ser;
         mavlink_msg_serial_control_decode(&message, &ser);
         if (static_cast<size_t>(ser.count) > sizeof(ser.data)) {
@@ -802,40 +786,106 @@ void Vehicle::_mavlinkMessageReceived(LinkInterface* link, mavlink_message_t mes
             emit mavlinkSerialControl(ser.device, ser.flags, ser.timeout, ser.baudrate,
                     QByteArray(reinterpret_cast<const char*>(ser.data), ser.count));
         }
-    }
-        break;
+    });
+
 #ifdef DAILY_BUILD // Disable use of development/WIP MAVLink messages for release builds
-        case MAVLINK_MSG_ID_AVAILABLE_MODES_MONITOR:
-    {
+    _addMessageHandler(MAVLINK_MSG_ID_AVAILABLE_MODES_MONITOR, [this](LinkInterface*, mavlink_message_t& message) {
         // Avoid duplicate requests during initial connection setup
         if (!_initialConnectStateMachine || !_initialConnectStateMachine->active()) {
             mavlink_available_modes_monitor_t availableModesMonitor;
             mavlink_msg_available_modes_monitor_decode(&message, &availableModesMonitor);
             _standardModes->availableModesMonitorReceived(availableModesMonitor.seq);
         }
-        break;
-    }
-    case MAVLINK_MSG_ID_CURRENT_MODE:
-        _handleCurrentMode(message);
-        break;
+    });
+    _addMessageHandler(MAVLINK_MSG_ID_CURRENT_MODE,             [this](LinkInterface*, mavlink_message_t& message) { _handleCurrentMode(message); });
 #endif // DAILY_BUILD
 
-        // Following are ArduPilot dialect messages
+    // Following are ArduPilot dialect messages
 #if !defined(NO_ARDUPILOT_DIALECT)
-    case MAVLINK_MSG_ID_CAMERA_FEEDBACK:
-        _handleCameraFeedback(message);
-        break;
-    case MAVLINK_MSG_ID_RANGEFINDER:
-        _handleRangefinder(message);
-        break;
+    _addMessageHandler(MAVLINK_MSG_ID_CAMERA_FEEDBACK,          [this](LinkInterface*, mavlink_message_t& message) { _handleCameraFeedback(message); });
+    _addMessageHandler(MAVLINK_MSG_ID_RANGEFINDER,              [this](LinkInterface*, mavlink_message_t& message) { _handleRangefinder(message); });
 #endif
+
+    _messageDispatchTableDirty = false;
+}
+
+void Vehicle::_dispatchMessage(LinkInterface* link, mavlink_message_t& message)
+{
+    if (_messageDispatchTableDirty) {
+        _buildMessageDispatchTable();
     }
 
-    // This must be emitted after the vehicle processes the message. This way the vehicle state is up to date when anyone else
-    // does processing.
-    emit mavlinkMessageReceived(message);
+    QElapsedTimer timer;
+    timer.start();
 
-    _uas->receiveMessage(message);
+    // Handlers can add fact groups, which dirties the table, so iterate over a copy
+    const QList<MessageHandler_t> handlers = _messageDispatchTable.value(message.msgid).handlers;
+
+    for (FactGroup* factGroup: _allMessagesFactGroups) {
+        factGroup->handleMessage(this, message);
+    }
+    for (const MessageHandler_t& handler: handlers) {
+        handler(link, message);
+    }
+
+    if (_messageDispatchTableDirty) {
+        // The message which caused a fact group to be created (batteries) must also reach that new fact group
+        const QSet<FactGroup*> previousFactGroups = _messageDispatchFactGroups;
+        _buildMessageDispatchTable();
+        for (FactGroup* factGroup: factGroups()) {
+            if (!previousFactGroups.contains(factGroup)) {
+                const QList<uint32_t> msgIds = factGroup->handledMessageIds();
+                if (msgIds.isEmpty() || msgIds.contains(message.msgid)) {
+                    factGroup->handleMessage(this, message);
+                }
+            }
+        }
+    }
+
+    MessageDispatchEntry_t& entry = _messageDispatchTable[message.msgid];
+    qint64 elapsed = timer.nsecsElapsed();
+    entry.count++;
+    entry.totalNsecs += elapsed;
+    entry.maxNsecs = qMax(entry.maxNsecs, elapsed);
+}
+
+QVariantList Vehicle::messageDispatchStats() const
+{
+    QList<uint32_t> msgIds = _messageDispatchTable.keys();
+    std::sort(msgIds.begin(), msgIds.end(), [this](uint32_t a, uint32_t b) {
+        return _messageDispatchTable[a].totalNsecs > _messageDispatchTable[b].totalNsecs;
+    });
+
+    QVariantList stats;
+    for (uint32_t msgId: msgIds) {
+        const MessageDispatchEntry_t& entry = _messageDispatchTable[msgId];
+        if (entry.count == 0) {
+            continue;
+        }
+
+        const mavlink_message_info_t* info = mavlink_get_message_info_by_id(msgId);
+
+        QVariantMap map;
+        map[QStringLiteral("msgId")]        = msgId;
+        map[QStringLiteral("name")]         = info ? QString(info->name) : QString::number(msgId);
+        map[QStringLiteral("handlerCount")] = entry.handlers.count() + _allMessagesFactGroups.count();
+        map[QStringLiteral("count")]        = static_cast<qulonglong>(entry.count);
+        map[QStringLiteral("totalMsecs")]   = static_cast<double>(entry.totalNsecs) / 1.0e6;
+        map[QStringLiteral("avgUsecs")]     = static_cast<double>(entry.totalNsecs) / static_cast<double>(entry.count) / 1.0e3;
+        map[QStringLiteral("maxUsecs")]     = static_cast<double>(entry.maxNsecs) / 1.0e3;
+        stats.append(map);
+    }
+
+    return stats;
+}
+
+void Vehicle::resetMessageDispatchStats()
+{
+    for (MessageDispatchEntry_t& entry: _messageDispatchTable) {
+        entry.count         = 0;
+        entry.totalNsecs    = 0;
+        entry.maxNsecs      = 0;
+    }
 }
 
 #if !defined(NO_ARDUPILOT_DIALECT)
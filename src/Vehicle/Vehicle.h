@@ -15,6 +15,7 @@
 #include <QGeoCoordinate>
 #include <QTime>
 #include <QQueue>
+#include <QSet>
 #include <QSharedPointer>
 
 #include "FactGroup.h"
@@ -503,6 +504,11 @@ public:
     QGCMAVLink::VehicleClass_t vehicleClass(void) const { return QGCMAVLink::vehicleClass(_vehicleType); }
     Q_INVOKABLE QString vehicleTypeName() const;
 
+    /// @return Per message id handler counts and cost, most expensive first. Each entry is a map with
+    /// msgId, name, handlerCount, count, totalMsecs, avgUsecs and maxUsecs.
+    Q_INVOKABLE QVariantList messageDispatchStats() const;
+    Q_INVOKABLE void resetMessageDispatchStats();
+
     /// Sends a message to the specified link
     /// @return true: message sent, false: Link no longer connected
     bool sendMessageOnLinkThreadSafe(LinkInterface* link, mavlink_message_t message);
@@ -1036,6 +1042,7 @@ signals:
 
 private slots:
     void _mavlinkMessageReceived            (LinkInterface* link, mavlink_message_t message);
+    void _mavlinkMessagesReceived           (LinkInterface* link, const QVector<const mavlink_message_t*>& messages);
     void _sendMessageMultipleNext           ();
     void _parametersReady                   (bool parametersReady);
     void _remoteControlRSSIChanged          (uint8_t rssi);
@@ -1325,6 +1332,25 @@ private:
 
     void _waitForMavlinkMessageMessageReceived(const mavlink_message_t& message);
 
+    // Message dispatch table: each incoming message is only handed to the handlers registered for its message id
+    typedef std::function<void(LinkInterface* link, mavlink_message_t& message)> MessageHandler_t;
+
+    typedef struct {
+        QList<MessageHandler_t> handlers;
+        uint64_t                count       = 0;
+        qint64                  totalNsecs  = 0;
+        qint64                  maxNsecs    = 0;
+    } MessageDispatchEntry_t;
+
+    void _buildMessageDispatchTable (void);
+    void _addMessageHandler         (uint32_t msgId, MessageHandler_t handler);
+    void _dispatchMessage           (LinkInterface* link, mavlink_message_t& message);
+
+    QHash<uint32_t, MessageDispatchEntry_t> _messageDispatchTable;
+    QList<FactGroup*>                       _allMessagesFactGroups;             ///< Fact groups which did not specify message ids
+    QSet<FactGroup*>                        _messageDispatchFactGroups;         ///< Fact groups the table was built from
+    bool                                    _messageDispatchTableDirty = true;  ///< Fact groups changed, table needs rebuild
+
     // requestMessage handling
     typedef struct RequestMessageInfo {
         Vehicle*                    vehicle             = nullptr;
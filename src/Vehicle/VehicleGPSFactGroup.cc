@@ -48,6 +48,11 @@ VehicleGPSFactGroup::VehicleGPSFactGroup(QObject* parent)
     _courseOverGroundFact.setRawValue(std::numeric_limits<float>::quiet_NaN());
 }
 
+QList<uint32_t> VehicleGPSFactGroup::handledMessageIds(void) const
+{
+    return { MAVLINK_MSG_ID_GPS_RAW_INT, MAVLINK_MSG_ID_HIGH_LATENCY, MAVLINK_MSG_ID_HIGH_LATENCY2 };
+}
+
 void VehicleGPSFactGroup::handleMessage(Vehicle* /* vehicle */, mavlink_message_t& message)
 {
     switch (message.msgid) {
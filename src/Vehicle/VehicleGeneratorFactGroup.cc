@@ -54,6 +54,11 @@ VehicleGeneratorFactGroup::VehicleGeneratorFactGroup(QObject* parent)
     _timeMaintenanceFact.setRawValue(qQNaN());
 }
 
+QList<uint32_t> VehicleGeneratorFactGroup::handledMessageIds(void) const
+{
+    return { MAVLINK_MSG_ID_GENERATOR_STATUS };
+}
+
 void VehicleGeneratorFactGroup::handleMessage(Vehicle* /* vehicle */, mavlink_message_t& message)
 {
     switch (message.msgid) {
@@ -30,6 +30,11 @@ VehicleHygrometerFactGroup::VehicleHygrometerFactGroup(QObject* parent)
     _hygroIDFact.setRawValue(std::numeric_limits<unsigned int>::quiet_NaN());
 }
 
+QList<uint32_t> VehicleHygrometerFactGroup::handledMessageIds(void) const
+{
+    return { MAVLINK_MSG_ID_HYGROMETER_SENSOR };
+}
+
 void VehicleHygrometerFactGroup::handleMessage(Vehicle* /* vehicle */, mavlink_message_t& message)
 {
     switch (message.msgid) {
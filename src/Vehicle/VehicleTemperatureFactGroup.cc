@@ -30,6 +30,11 @@ VehicleTemperatureFactGroup::VehicleTemperatureFactGroup(QObject* parent)
     _temperature3Fact.setRawValue      (qQNaN());
 }
 
+QList<uint32_t> VehicleTemperatureFactGroup::handledMessageIds(void) const
+{
+    return { MAVLINK_MSG_ID_SCALED_PRESSURE, MAVLINK_MSG_ID_SCALED_PRESSURE2, MAVLINK_MSG_ID_SCALED_PRESSURE3, MAVLINK_MSG_ID_HIGH_LATENCY, MAVLINK_MSG_ID_HIGH_LATENCY2 };
+}
+
 void VehicleTemperatureFactGroup::handleMessage(Vehicle* /* vehicle */, mavlink_message_t& message)
 {
     switch (message.msgid) {
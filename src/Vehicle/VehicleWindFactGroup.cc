@@ -32,6 +32,18 @@ VehicleWindFactGroup::VehicleWindFactGroup(QObject* parent)
     _verticalSpeedFact.setRawValue  (qQNaN());
 }
 
+QList<uint32_t> VehicleWindFactGroup::handledMessageIds(void) const
+{
+    return {
+        MAVLINK_MSG_ID_WIND_COV,
+#if !defined(NO_ARDUPILOT_DIALECT)
+        MAVLINK_MSG_ID_WIND,
+#endif
+        MAVLINK_MSG_ID_HIGH_LATENCY,
+        MAVLINK_MSG_ID_HIGH_LATENCY2,
+    };
+}
+
 void VehicleWindFactGroup::handleMessage(Vehicle* /* vehicle */, mavlink_message_t& message)
 {
     switch (message.msgid) {
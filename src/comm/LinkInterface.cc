@@ -112,6 +112,20 @@ void LinkInterface::_connectionRemoved(void)
     }
 }
 
+void LinkInterface::_emitTrackedBytesReceived(const QByteArray& bytes)
+{
+    _receiveBacklog.fetch_add(1, std::memory_order_acq_rel);
+    emit bytesReceived(this, bytes);
+}
+
+void LinkInterface::receiveProcessed(void)
+{
+    // Untracked chunks leave the backlog at zero, never let it go negative
+    int backlog = _receiveBacklog.load(std::memory_order_acquire);
+    while (backlog > 0 && !_receiveBacklog.compare_exchange_weak(backlog, backlog - 1, std::memory_order_acq_rel)) {
+    }
+}
+
 #ifdef UNITTEST_BUILD
 #include "MockLink.h"
 bool LinkInterface::isMockLink(void)
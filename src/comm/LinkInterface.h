@@ -39,6 +39,7 @@
 #include <QTimer>
 
 #include <memory>
+#include <atomic>
 
 #include "QGCMAVLink.h"
 #include "LinkConfiguration.h"
@@ -89,6 +90,13 @@ public:
     void    addVehicleReference         (void);
     void    removeVehicleReference      (void);
 
+    /// @return Number of chunks sent through _emitTrackedBytesReceived which the decoder has not processed yet.
+    /// Links which can produce data faster than it can be decoded (log replay) use this to throttle themselves.
+    int     receiveBacklog              (void) const { return _receiveBacklog.load(std::memory_order_acquire); }
+
+    /// Called by the decoder after processing each received chunk. Thread safe.
+    void    receiveProcessed            (void);
+
 signals:
     void bytesReceived      (LinkInterface* link, QByteArray data);
     void bytesSent          (LinkInterface* link, QByteArray data);
@@ -103,6 +111,9 @@ protected:
 
     void _connectionRemoved(void);
 
+    /// Emits bytesReceived with the chunk counted in receiveBacklog
+    void _emitTrackedBytesReceived(const QByteArray& bytes);
+
     SharedLinkConfigurationPtr _config;
 
     ///
@@ -128,6 +139,8 @@ private:
     bool    _isPX4Flow                  = false;
     int     _vehicleReferenceCount      = 0;
 
+    std::atomic<int> _receiveBacklog    { 0 };
+
     QMap<int /* vehicle id */, MavlinkMessagesTimer*> _mavlinkMessagesTimers;
 };
 
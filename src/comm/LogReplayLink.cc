@@ -11,11 +11,15 @@
 #include "LogReplayLink.h"
 #include "LinkManager.h"
 #include "QGCApplication.h"
+#include "MAVLinkDecoder.h"
+#include "QGCLoggingCategory.h"
 
 #include <QFileInfo>
 #include <QtEndian>
 #include <QSignalSpy>
 
+QGC_LOGGING_CATEGORY(LogReplayLinkLog, "LogReplayLinkLog")
+
 const char*  LogReplayLinkConfiguration::_logFilenameKey = "logFilename";
 
 LogReplayLinkConfiguration::LogReplayLinkConfiguration(const QString& name)
@@ -75,6 +79,9 @@ LogReplayLink::LogReplayLink(SharedLinkConfigurationPtr& config)
     , _playbackStartLogTimeUSecs (0)
     , _mavlink                   (nullptr)
     , _logFileSize               (0)
+    , _logMap                    (nullptr)
+    , _fastReplay                (false)
+    , _fastReplayMessages        (0)
 {
     if (!_logReplayConfig) {
         qWarning() << "Internal error";
@@ -88,6 +95,7 @@ LogReplayLink::LogReplayLink(SharedLinkConfigurationPtr& config)
     QObject::connect(this, &LogReplayLink::_playOnThread,               this, &LogReplayLink::_play);
     QObject::connect(this, &LogReplayLink::_pauseOnThread,              this, &LogReplayLink::_pause);
     QObject::connect(this, &LogReplayLink::_setPlaybackSpeedOnThread,   this, &LogReplayLink::_setPlaybackSpeed);
+    QObject::connect(this, &LogReplayLink::_setFastReplayOnThread,      this, &LogReplayLink::_setFastReplay);
     
     moveToThread(this);
 }
@@ -158,16 +166,10 @@ void LogReplayLink::_writeBytes(const QByteArray bytes)
 /// @return A Unix timestamp in microseconds UTC for found message or 0 if parsing failed
 quint64 LogReplayLink::_parseTimestamp(const QByteArray& bytes)
 {
-    quint64 timestamp = qFromBigEndian(*((quint64*)(bytes.constData())));
-    quint64 currentTimestamp = ((quint64)QDateTime::currentMSecsSinceEpoch()) * 1000;
-    
-    // Now if the parsed timestamp is in the future, it must be an old file where the timestamp was stored as
-    // little endian, so switch it.
-    if (timestamp > currentTimestamp) {
-        timestamp = qbswap(timestamp);
+    if (bytes.size() < cbTimestamp) {
+        return 0;
     }
-    
-    return timestamp;
+    return TLogIndex::parseTimestamp(bytes.constData());
 }
 
 /// Reads the next mavlink message from the log
@@ -200,60 +202,35 @@ quint64 LogReplayLink::_readNextMavlinkMessage(QByteArray& bytes)
     return 0;
 }
 
-/// Seeks to the beginning of the next successfully parsed mavlink message in the log file.
-///     @param nextMsg[output] Parsed next message that was found
-/// @return A Unix timestamp in microseconds UTC for found message or 0 if parsing failed
-quint64 LogReplayLink::_seekToNextMavlinkMessage(mavlink_message_t* nextMsg)
+/// Scans forward from a record boundary to the first record with a timestamp at or after the target.
+/// Leaves the file positioned at the start of that record's mavlink message.
+/// @return A Unix timestamp in microseconds UTC for found message
+quint64 LogReplayLink::_seekToTimestamp(quint64 targetUSecs)
 {
     char                nextByte;
-    mavlink_status_t    status;
-    qint64              messageStartPos = -1;
-
-    mavlink_reset_channel_status(_mavlinkChannel);
-
-    while (_logFile.getChar(&nextByte)) {
-        bool messageFound = mavlink_parse_char(_mavlinkChannel, nextByte, nextMsg, &status);
-
-        if (status.parse_state == MAVLINK_PARSE_STATE_GOT_STX) {
-            // This is the possible beginning of a mavlink message
-            messageStartPos = _logFile.pos() - 1;
-        }
-        
-        // If we've found a message, jump back to the start of the message, grab the timestamp,
-        // and go back to the end of this file.
-        if (messageFound && messageStartPos != -1) {
-            _logFile.seek(messageStartPos - cbTimestamp);
-            QByteArray rawTime = _logFile.read(cbTimestamp);
-            return _parseTimestamp(rawTime);
-        }
-    }
-    
-    return 0;
-}
+    quint64             timestamp = 0;
+    mavlink_message_t   rxMessage;
+    mavlink_message_t   message;
+    mavlink_status_t    rxStatus;
 
-quint64 LogReplayLink::_findLastTimestamp(void)
-{
-    char                nextByte;
-    mavlink_status_t    status;
-    quint64             lastTimestamp = 0;
-    mavlink_message_t   msg;
-
-    // We read through the entire file looking for the last good timestamp. This can be somewhat slow, but trying to work from the
-    // end of the file can be way slower due to all the seeking back and forth required. So instead we take the simple reliable approach.
-
-    _logFile.reset();
-    mavlink_reset_channel_status(_mavlinkChannel);
+    memset(&rxStatus, 0, sizeof(rxStatus));
 
     while (_logFile.bytesAvailable() > cbTimestamp) {
-        lastTimestamp = _parseTimestamp(_logFile.read(cbTimestamp));
+        timestamp = _parseTimestamp(_logFile.read(cbTimestamp));
+        if (timestamp >= targetUSecs) {
+            break;
+        }
 
+        // Skip over this record's message
         bool endOfMessage = false;
         while (!endOfMessage && _logFile.getChar(&nextByte)) {
-            endOfMessage = mavlink_parse_char(_mavlinkChannel, nextByte, &msg, &status);
+            endOfMessage = MAVLinkDecoder::parseChar(static_cast<uint8_t>(nextByte), &rxMessage, &rxStatus, &message);
         }
     }
 
-    return lastTimestamp;
+    mavlink_reset_channel_status(_mavlinkChannel);
+
+    return timestamp;
 }
 
 bool LogReplayLink::_loadLogFile(void)
@@ -277,14 +254,20 @@ bool LogReplayLink::_loadLogFile(void)
     }
     logFileInfo.setFile(logFilename);
     _logFileSize = logFileInfo.size();
-    
-    startTimeUSecs = _parseTimestamp(_logFile.read(cbTimestamp));
-    endTimeUSecs = _findLastTimestamp();
 
-    if (endTimeUSecs <= startTimeUSecs) {
+    // Index is normally loaded from the sidecar file, only the first open of a log requires a full scan
+    if (!_logIndex.load(logFilename) || _logIndex.endTimeUSecs() <= _logIndex.startTimeUSecs()) {
         errorMsg = tr("The log file '%1' is corrupt or empty.").arg(logFilename);
         goto Error;
     }
+    startTimeUSecs = _logIndex.startTimeUSecs();
+    endTimeUSecs = _logIndex.endTimeUSecs();
+
+    // Fast replay works directly from the mapping, normal replay continues to read through the file
+    _logMap = _logFile.map(0, _logFile.size());
+    if (!_logMap) {
+        qCWarning(LogReplayLinkLog) << "Unable to map log file, fast replay not available" << _logFile.errorString();
+    }
 
     // Remember the start and end time so we can move around this _logFile with the slider.
     _logEndTimeUSecs = endTimeUSecs;
@@ -315,6 +298,11 @@ Error:
 /// induce a static drift into the log file replay.
 void LogReplayLink::_readNextLogEntry(void)
 {
+    if (_fastReplay) {
+        _readNextLogChunk();
+        return;
+    }
+
     QByteArray bytes;
 
     // Now parse MAVLink messages, grabbing their timestamps as we go. We stop once we
@@ -327,7 +315,7 @@ void LogReplayLink::_readNextLogEntry(void)
     while (timeToNextExecutionMSecs < 3) {
         // Read the next mavlink message from the log
         qint64 nextTimeUSecs = _readNextMavlinkMessage(bytes);
-        emit bytesReceived(this, bytes);
+        _emitTrackedBytesReceived(bytes);
         emit playbackPercentCompleteChanged(((float)(_logCurrentTimeUSecs - _logStartTimeUSecs) / (float)_logDurationUSecs) * 100);
 
         if (_logFile.atEnd()) {
@@ -367,7 +355,9 @@ void LogReplayLink::_play(void)
     
     _playbackStartTimeMSecs = (quint64)QDateTime::currentMSecsSinceEpoch();
     _playbackStartLogTimeUSecs = _logCurrentTimeUSecs;
-    _readTickTimer.start(1);
+    _fastReplayTimer.start();
+    _fastReplayMessages = 0;
+    _readTickTimer.start(_fastReplay ? 0 : 1);
     
     emit playbackStarted();
 }
@@ -414,45 +404,18 @@ void LogReplayLink::movePlayhead(qreal percentComplete)
         percentComplete = 100;
     }
     
-    qreal percentCompleteMult = percentComplete / 100.0;
-    
-    // But if we have a timestamped MAVLink log, then actually aim to hit that percentage in terms of
-    // time through the file.
-    qint64 newFilePos = (qint64)(percentCompleteMult * (qreal)_logFile.size());
-
-    // Now seek to the appropriate position, failing gracefully if we can't.
-    if (!_logFile.seek(newFilePos)) {
-        _replayError(tr("Unable to seek to new position"));
-        return;
-    }
-
-    // But we do align to the next MAVLink message for consistency.
-    mavlink_message_t dummy;
-    _logCurrentTimeUSecs = _seekToNextMavlinkMessage(&dummy);
-
-    // Now calculate the current file location based on time.
-    qreal newRelativeTimeUSecs = (qreal)(_logCurrentTimeUSecs - _logStartTimeUSecs);
-
-    // Calculate the effective baud rate of the file in bytes/s.
-    qreal baudRate = _logFile.size() / (qreal)_logDurationUSecs / 1e6;
-
-    // And the desired time is:
-    qreal desiredTimeUSecs = percentCompleteMult * _logDurationUSecs;
-
-    // And now jump the necessary number of bytes in the proper direction
-    qint64 offset = (newRelativeTimeUSecs - desiredTimeUSecs) * baudRate;
-    if (!_logFile.seek(_logFile.pos() + offset)) {
+    // Jump to the closest indexed record before the desired time and scan forward to the exact record
+    quint64 targetUSecs = _logStartTimeUSecs + static_cast<quint64>((percentComplete / 100.0) * _logDurationUSecs);
+    if (!_logFile.seek(_logIndex.seekOffset(targetUSecs))) {
         _replayError(tr("Unable to seek to new position"));
         return;
     }
 
-    // And scan until we reach the start of a MAVLink message. We make sure to record this timestamp for
-    // smooth jumping around the file.
-    _logCurrentTimeUSecs = _seekToNextMavlinkMessage(&dummy);
+    _logCurrentTimeUSecs = _seekToTimestamp(targetUSecs);
     _signalCurrentLogTimeSecs();
 
     // Now update the UI with our actual final position.
-    newRelativeTimeUSecs = (qreal)(_logCurrentTimeUSecs - _logStartTimeUSecs);
+    qreal newRelativeTimeUSecs = (qreal)(_logCurrentTimeUSecs - _logStartTimeUSecs);
     percentComplete = (newRelativeTimeUSecs / _logDurationUSecs) * 100;
     emit playbackPercentCompleteChanged(percentComplete);
 }
@@ -467,6 +430,100 @@ void LogReplayLink::_setPlaybackSpeed(qreal playbackSpeed)
     _readTickTimer.start(1);
 }
 
+void LogReplayLink::_setFastReplay(bool fastReplay)
+{
+    if (fastReplay && !_logMap) {
+        _replayError(tr("Fast replay is not available for this log file"));
+        return;
+    }
+
+    _fastReplay = fastReplay;
+
+    if (isPlaying()) {
+        _playbackStartTimeMSecs = (quint64)QDateTime::currentMSecsSinceEpoch();
+        _playbackStartLogTimeUSecs = _logCurrentTimeUSecs;
+        _fastReplayTimer.start();
+        _fastReplayMessages = 0;
+        _readTickTimer.start(_fastReplay ? 0 : 1);
+    }
+}
+
+/// Fast replay: walks the mapped log, strips the timestamps and hands the raw packets to the decoder in large
+/// chunks with no real time pacing. Replay only stalls when the decoder falls behind.
+void LogReplayLink::_readNextLogChunk(void)
+{
+    if (receiveBacklog() >= _fastReplayMaxBacklog) {
+        // Decoder is behind, back off instead of spinning
+        _readTickTimer.start(1);
+        return;
+    }
+
+    const qint64    size            = static_cast<qint64>(_logFileSize);
+    const quint64   currentUSecs    = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000;
+    qint64          pos             = _logFile.pos();
+    int             messageCount    = 0;
+    bool            atEnd           = false;
+    QByteArray      chunk;
+
+    chunk.reserve(_fastReplayChunkMessages * 64);
+
+    // File position convention is the same as _readNextMavlinkMessage: start of a packet whose timestamp is _logCurrentTimeUSecs
+    while (messageCount < _fastReplayChunkMessages) {
+        // Skip anything which isn't the start of a packet
+        while (pos < size && _logMap[pos] != MAVLINK_STX && _logMap[pos] != MAVLINK_STX_MAVLINK1) {
+            pos++;
+        }
+        if (pos + 3 > size) {
+            atEnd = true;
+            break;
+        }
+
+        qint64 packetLength;
+        if (_logMap[pos] == MAVLINK_STX) {
+            packetLength = _logMap[pos + 1] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+            if (_logMap[pos + 2] & MAVLINK_IFLAG_SIGNED) {
+                packetLength += MAVLINK_SIGNATURE_BLOCK_LEN;
+            }
+        } else {
+            packetLength = _logMap[pos + 1] + MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_NUM_CHECKSUM_BYTES;
+        }
+        if (pos + packetLength > size) {
+            atEnd = true;
+            break;
+        }
+
+        chunk.append(reinterpret_cast<const char*>(_logMap + pos), static_cast<int>(packetLength));
+        pos += packetLength;
+        messageCount++;
+
+        if (pos + cbTimestamp > size) {
+            atEnd = true;
+            break;
+        }
+        _logCurrentTimeUSecs = TLogIndex::parseTimestamp(reinterpret_cast<const char*>(_logMap + pos), currentUSecs);
+        pos += cbTimestamp;
+    }
+
+    _logFile.seek(atEnd ? size : pos);
+
+    if (!chunk.isEmpty()) {
+        _emitTrackedBytesReceived(chunk);
+    }
+    _fastReplayMessages += static_cast<quint64>(messageCount);
+
+    emit playbackPercentCompleteChanged(((float)(_logCurrentTimeUSecs - _logStartTimeUSecs) / (float)_logDurationUSecs) * 100);
+    _signalCurrentLogTimeSecs();
+
+    if (atEnd) {
+        qint64 elapsedMSecs = qMax(_fastReplayTimer.elapsed(), static_cast<qint64>(1));
+        qCDebug(LogReplayLinkLog) << "Fast replay complete messages:msecs:msgs/sec" << _fastReplayMessages << elapsedMSecs << (_fastReplayMessages * 1000) / static_cast<quint64>(elapsedMSecs);
+        _finishPlayback();
+        return;
+    }
+
+    _readTickTimer.start(0);
+}
+
 /// @brief Called when playback is complete
 void LogReplayLink::_finishPlayback(void)
 {
@@ -486,6 +543,7 @@ LogReplayLinkController::LogReplayLinkController(void)
     , _percentComplete  (0)
     , _playheadSecs     (0)
     , _playbackSpeed    (1)
+    , _fastReplay       (false)
 {
 }
 
@@ -494,6 +552,7 @@ void LogReplayLinkController::setLink(LogReplayLink* link)
     if (_link) {
         disconnect(_link);
         disconnect(this, &LogReplayLinkController::playbackSpeedChanged, _link, &LogReplayLink::setPlaybackSpeed);
+        disconnect(this, &LogReplayLinkController::fastReplayChanged, _link, &LogReplayLink::setFastReplay);
         _isPlaying = false;
         _percentComplete = 0;
         _playheadTime.clear();
@@ -518,6 +577,11 @@ void LogReplayLinkController::setLink(LogReplayLink* link)
         connect(_link, &LogReplayLink::disconnected,                      this, &LogReplayLinkController::_linkDisconnected);
 
         connect(this, &LogReplayLinkController::playbackSpeedChanged, _link, &LogReplayLink::setPlaybackSpeed);
+        connect(this, &LogReplayLinkController::fastReplayChanged, _link, &LogReplayLink::setFastReplay);
+
+        if (_fastReplay) {
+            _link->setFastReplay(true);
+        }
 
         emit linkChanged(_link);
     }
@@ -15,9 +15,13 @@
 #pragma once
 
 #include "MAVLinkProtocol.h"
+#include "TLogIndex.h"
 
 #include <QTimer>
 #include <QFile>
+#include <QElapsedTimer>
+
+Q_DECLARE_LOGGING_CATEGORY(LogReplayLinkLog)
 
 class LinkManager;
 
@@ -64,6 +68,9 @@ public:
     /// @return true: log is currently playing, false: log playback is paused
     bool isPlaying(void) { return _readTickTimer.isActive(); }
 
+    /// @return true: log is replayed as fast as it can be decoded rather than in real time
+    bool fastReplay(void) const { return _fastReplay; }
+
     void play           (void) { emit _playOnThread(); }
     void pause          (void) { emit _pauseOnThread(); }
     void movePlayhead   (qreal percentComplete);
@@ -77,6 +84,9 @@ public slots:
     /// Sets the acceleration factor: -100: 0.01X, 0: 1.0X, 100: 100.0X
     void setPlaybackSpeed(qreal playbackSpeed) { emit _setPlaybackSpeedOnThread(playbackSpeed); }
 
+    /// Switches between real time replay and replaying as fast as the log can be decoded
+    void setFastReplay(bool fastReplay) { emit _setFastReplayOnThread(fastReplay); }
+
 signals:
     void logFileStats                   (int logDurationSecs);
     void playbackStarted                (void);
@@ -89,6 +99,7 @@ signals:
     void _playOnThread              (void);
     void _pauseOnThread             (void);
     void _setPlaybackSpeedOnThread  (qreal playbackSpeed);
+    void _setFastReplayOnThread     (bool fastReplay);
 
 private slots:
     // LinkInterface overrides
@@ -98,6 +109,7 @@ private slots:
     void _play              (void);
     void _pause             (void);
     void _setPlaybackSpeed  (qreal playbackSpeed);
+    void _setFastReplay     (bool fastReplay);
 
 private:
 
@@ -106,9 +118,9 @@ private:
 
     void    _replayError                (const QString& errorMsg);
     quint64 _parseTimestamp             (const QByteArray& bytes);
-    quint64 _seekToNextMavlinkMessage   (mavlink_message_t* nextMsg);
-    quint64 _findLastTimestamp          (void);
+    quint64 _seekToTimestamp            (quint64 targetUSecs);
     quint64 _readNextMavlinkMessage     (QByteArray& bytes);
+    void    _readNextLogChunk           (void);
     bool    _loadLogFile                (void);
     void    _finishPlayback             (void);
     void    _resetPlaybackToBeginning   (void);
@@ -137,8 +149,16 @@ private:
     MAVLinkProtocol*    _mavlink;
     QFile               _logFile;
     quint64             _logFileSize;
+    TLogIndex           _logIndex;
+    const uchar*        _logMap;                ///< Memory mapped log file, nullptr if mapping failed
+
+    bool                _fastReplay;
+    QElapsedTimer       _fastReplayTimer;
+    quint64             _fastReplayMessages;
 
     static const int cbTimestamp = sizeof(quint64);
+    static const int _fastReplayChunkMessages   = 2048;     ///< Messages per chunk handed to the decoder
+    static const int _fastReplayMaxBacklog      = 4;        ///< Undecoded chunks allowed before replay waits
 };
 
 class LogReplayLinkController : public QObject
@@ -152,6 +172,7 @@ public:
     Q_PROPERTY(QString          totalTime       MEMBER _totalTime                                   NOTIFY totalTimeChanged)
     Q_PROPERTY(QString          playheadTime    MEMBER _playheadTime                                NOTIFY playheadTimeChanged)
     Q_PROPERTY(qreal            playbackSpeed   MEMBER _playbackSpeed                               NOTIFY playbackSpeedChanged)
+    Q_PROPERTY(bool             fastReplay      MEMBER _fastReplay                                  NOTIFY fastReplayChanged)
 
     LogReplayLinkController(void);
 
@@ -170,6 +191,7 @@ signals:
     void playheadTimeChanged    (QString playheadTime);
     void totalTimeChanged       (QString totalTime);
     void playbackSpeedChanged   (qreal playbackSpeed);
+    void fastReplayChanged      (bool fastReplay);
 
 private slots:
     void _logFileStats                   (int logDurationSecs);
@@ -190,5 +212,6 @@ private:
     QString         _playheadTime;
     QString         _totalTime;
     qreal           _playbackSpeed;
+    bool            _fastReplay;
 };
 
@@ -0,0 +1,107 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "LogReplayLinkTest.h"
+#include "LogReplayLink.h"
+#include "LinkManager.h"
+#include "MAVLinkProtocol.h"
+#include "QGCApplication.h"
+#include "QGCLoggingCategory.h"
+#include "TLogIndex.h"
+
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QFile>
+#include <QtEndian>
+
+QGC_LOGGING_CATEGORY(LogReplayLinkTestLog, "LogReplayLinkTestLog")
+
+/// Replays a generated tlog of ATTITUDE messages with fast replay and checks that every message is delivered, in order
+void LogReplayLinkTest::_replay(int messageCount, qint64& elapsedMSecs)
+{
+    const quint64 startUSecs    = 1600000000000000ull;
+    const quint64 spacingUSecs  = 10000;
+
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    const QString logFilename = tempDir.filePath("replay.tlog");
+    {
+        QFile logFile(logFilename);
+        QVERIFY(logFile.open(QFile::WriteOnly));
+
+        QByteArray log;
+        for (int i = 0; i < messageCount; i++) {
+            uint8_t             buf[TLogIndex::timestampSize + MAVLINK_MAX_PACKET_LEN];
+            mavlink_message_t   msg;
+
+            qToBigEndian(startUSecs + (static_cast<quint64>(i) * spacingUSecs), buf);
+            mavlink_msg_attitude_pack(1, MAV_COMP_ID_AUTOPILOT1, &msg, static_cast<uint32_t>(i), 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f);
+            int len = TLogIndex::timestampSize + mavlink_msg_to_send_buffer(buf + TLogIndex::timestampSize, &msg);
+            log.append(reinterpret_cast<const char*>(buf), len);
+        }
+        QCOMPARE(logFile.write(log), static_cast<qint64>(log.size()));
+    }
+
+    int         received    = 0;
+    int         outOfOrder  = 0;
+    uint32_t    nextTimeMSecs = 0;
+
+    MAVLinkProtocol* mavlink = qgcApp()->toolbox()->mavlinkProtocol();
+    QMetaObject::Connection connection = connect(mavlink, &MAVLinkProtocol::messageReceived, this, [&](LinkInterface*, mavlink_message_t message) {
+        if (message.msgid == MAVLINK_MSG_ID_ATTITUDE) {
+            const uint32_t timeMSecs = mavlink_msg_attitude_get_time_boot_ms(&message);
+            if (timeMSecs != nextTimeMSecs) {
+                outOfOrder++;
+            }
+            nextTimeMSecs = timeMSecs + 1;
+            received++;
+        }
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+
+    LogReplayLink* link = qgcApp()->toolbox()->linkManager()->startLogReplay(logFilename);
+    QVERIFY(link);
+    QSignalSpy spyAtEnd(link, &LogReplayLink::playbackAtEnd);
+    link->setFastReplay(true);
+
+    QVERIFY(spyAtEnd.wait(60000));
+    while (received < messageCount && timer.elapsed() < 60000) {
+        QTest::qWait(10);
+    }
+    elapsedMSecs = qMax(timer.elapsed(), static_cast<qint64>(1));
+
+    disconnect(connection);
+    link->disconnect();
+
+    // Replay decoders wait for the consumer instead of dropping, so nothing may go missing
+    QCOMPARE(received, messageCount);
+    QCOMPARE(outOfOrder, 0);
+}
+
+void LogReplayLinkTest::_fastReplayTest(void)
+{
+    qint64 elapsedMSecs;
+    _replay(20000, elapsedMSecs);
+}
+
+/// Set QGC_REPLAY_BENCHMARK_MESSAGES=1000000 to measure fast replay throughput
+void LogReplayLinkTest::_fastReplayBenchmark(void)
+{
+    const int messageCount = qEnvironmentVariableIntValue("QGC_REPLAY_BENCHMARK_MESSAGES");
+    if (messageCount <= 0) {
+        QSKIP("Set QGC_REPLAY_BENCHMARK_MESSAGES to run");
+    }
+
+    qint64 elapsedMSecs;
+    _replay(messageCount, elapsedMSecs);
+    qCDebug(LogReplayLinkTestLog) << "Fast replay messages:msecs:msgs/sec" << messageCount << elapsedMSecs << (static_cast<qint64>(messageCount) * 1000) / elapsedMSecs;
+}
@@ -0,0 +1,275 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkDecoder.h"
+#include "QGCLoggingCategory.h"
+
+#include <QMutexLocker>
+
+QGC_LOGGING_CATEGORY(MAVLinkDecoderLog, "MAVLinkDecoderLog")
+
+MAVLinkMessageQueue::MAVLinkMessageQueue(int capacity)
+{
+    uint32_t size = 1;
+    while (size < static_cast<uint32_t>(capacity)) {
+        size <<= 1;
+    }
+    _ring.resize(static_cast<int>(size));
+    _mask = size - 1;
+}
+
+mavlink_message_t* MAVLinkMessageQueue::writeSlot(void)
+{
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= static_cast<uint32_t>(_ring.count())) {
+        return nullptr;
+    }
+    return &_ring.data()[head & _mask];
+}
+
+void MAVLinkMessageQueue::commit(void)
+{
+    _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+int MAVLinkMessageQueue::dequeue(QVector<mavlink_message_t>& batch, int maxCount)
+{
+    uint32_t tail   = _tail.load(std::memory_order_relaxed);
+    uint32_t head   = _head.load(std::memory_order_acquire);
+    int      count  = qMin(static_cast<int>(head - tail), maxCount);
+
+    const mavlink_message_t* ring = _ring.constData();
+    for (int i = 0; i < count; i++) {
+        batch.append(ring[(tail + static_cast<uint32_t>(i)) & _mask]);
+    }
+
+    _tail.store(tail + static_cast<uint32_t>(count), std::memory_order_release);
+    return count;
+}
+
+MAVLinkDecoder::MAVLinkDecoder(LinkInterface* link, QObject* parent)
+    : QObject   (parent)
+    , _link     (link)
+    , _queue    (queueCapacity)
+{
+    memset(&_rxMessage,         0, sizeof(_rxMessage));
+    memset(&_rxStatus,          0, sizeof(_rxStatus));
+    memset(&_overflowMessage,   0, sizeof(_overflowMessage));
+    memset(_firstMessage,       1, sizeof(_firstMessage));
+    memset(_lastIndex,          0, sizeof(_lastIndex));
+
+    _thread.setObjectName(QStringLiteral("MAVLinkDecoder"));
+}
+
+MAVLinkDecoder::~MAVLinkDecoder()
+{
+    stop();
+}
+
+void MAVLinkDecoder::start(void)
+{
+    _waitWhenFull = _link && _link->isLogReplay();
+    _stopping.store(false, std::memory_order_release);
+    moveToThread(&_thread);
+    _thread.start();
+}
+
+void MAVLinkDecoder::stop(void)
+{
+    if (_thread.isRunning()) {
+        {
+            QMutexLocker lock(&_queueSpaceMutex);
+            _stopping.store(true, std::memory_order_release);
+            _queueSpaceCondition.wakeAll();
+        }
+        _thread.quit();
+        _thread.wait();
+    }
+}
+
+int MAVLinkDecoder::dequeue(QVector<mavlink_message_t>& batch, int maxCount)
+{
+    const int count = _queue.dequeue(batch, maxCount);
+    if (count && _waitWhenFull) {
+        QMutexLocker lock(&_queueSpaceMutex);
+        _queueSpaceCondition.wakeAll();
+    }
+    return count;
+}
+
+void MAVLinkDecoder::setForwardingLinks(const SharedLinkInterfacePtr& forwardingLink, const SharedLinkInterfacePtr& forwardingSupportLink)
+{
+    QMutexLocker lock(&_forwardingMutex);
+    _forwardingLink         = forwardingLink;
+    _forwardingSupportLink  = forwardingSupportLink;
+    _forwardingEnabled.store(forwardingLink || forwardingSupportLink, std::memory_order_release);
+}
+
+void MAVLinkDecoder::setObservers(const QList<SharedMAVLinkDecodeObserver>& observers)
+{
+    QMutexLocker lock(&_observersMutex);
+    _observers = observers;
+    _observersEnabled.store(!observers.isEmpty(), std::memory_order_release);
+}
+
+void MAVLinkDecoder::resetStatistics(void)
+{
+    // The sequence tables are owned by the decode thread, so they are cleared there on the next receive
+    _resetPending.store(true, std::memory_order_release);
+    _totalReceiveCounter.store(0, std::memory_order_relaxed);
+    _totalLossCounter.store(0, std::memory_order_relaxed);
+    _totalDroppedCounter.store(0, std::memory_order_relaxed);
+    _runningLossPercent.store(0, std::memory_order_relaxed);
+}
+
+bool MAVLinkDecoder::parseChar(uint8_t c, mavlink_message_t* rxMessage, mavlink_status_t* rxStatus, mavlink_message_t* message)
+{
+    mavlink_status_t status;
+
+    uint8_t result = mavlink_frame_char_buffer(rxMessage, rxStatus, c, message, &status);
+    if (result == MAVLINK_FRAMING_BAD_CRC || result == MAVLINK_FRAMING_BAD_SIGNATURE) {
+        // Treat as a parse failure and resync on the next start of frame
+        rxStatus->parse_error++;
+        rxStatus->msg_received  = MAVLINK_FRAMING_INCOMPLETE;
+        rxStatus->parse_state   = MAVLINK_PARSE_STATE_IDLE;
+        if (c == MAVLINK_STX) {
+            rxStatus->parse_state = MAVLINK_PARSE_STATE_GOT_STX;
+            rxMessage->len = 0;
+            mavlink_start_checksum(rxMessage);
+        }
+        return false;
+    }
+
+    return result == MAVLINK_FRAMING_OK;
+}
+
+void MAVLinkDecoder::receiveBytes(LinkInterface* link, QByteArray bytes)
+{
+    if (_resetPending.exchange(false, std::memory_order_acq_rel)) {
+        memset(_firstMessage, 1, sizeof(_firstMessage));
+    }
+
+    int             messageCount = 0;
+    const uint8_t*  data         = reinterpret_cast<const uint8_t*>(bytes.constData());
+
+    // Observers are picked up once per chunk rather than once per message
+    QList<SharedMAVLinkDecodeObserver> observers;
+    if (_observersEnabled.load(std::memory_order_acquire)) {
+        QMutexLocker lock(&_observersMutex);
+        observers = _observers;
+    }
+
+    for (int position = 0; position < bytes.size(); position++) {
+        // Parse straight into the queue so a framed message is never copied on this thread
+        mavlink_message_t* slot = _queue.writeSlot();
+        if (!slot && _waitWhenFull) {
+            // Make sure the consumer knows about what is already queued, then wait for it to make room
+            if (messageCount && !_notifyPending.exchange(true, std::memory_order_acq_rel)) {
+                emit messagesAvailable(this);
+            }
+            QMutexLocker lock(&_queueSpaceMutex);
+            while (!(slot = _queue.writeSlot()) && !_stopping.load(std::memory_order_acquire)) {
+                _queueSpaceCondition.wait(&_queueSpaceMutex);
+            }
+        }
+        if (!slot) {
+            slot = &_overflowMessage;
+        }
+
+        if (parseChar(data[position], &_rxMessage, &_rxStatus, slot)) {
+            _updateStatistics(*slot);
+            _forward(*slot);
+            for (const SharedMAVLinkDecodeObserver& observer: observers) {
+                observer->messageDecoded(link, *slot);
+            }
+
+            if (slot == &_overflowMessage) {
+                // The consumer is not keeping up. Dropping is preferable to blocking the link thread.
+                if (_totalDroppedCounter.fetch_add(1, std::memory_order_relaxed) % 1000 == 0) {
+                    qCWarning(MAVLinkDecoderLog) << "Decode queue full, dropping messages" << _totalDroppedCounter.load(std::memory_order_relaxed);
+                }
+            } else {
+                _queue.commit();
+                messageCount++;
+            }
+        }
+    }
+
+    if (messageCount && !_notifyPending.exchange(true, std::memory_order_acq_rel)) {
+        emit messagesAvailable(this);
+    }
+
+    if (link) {
+        link->receiveProcessed();
+    }
+}
+
+void MAVLinkDecoder::_updateStatistics(const mavlink_message_t& message)
+{
+    uint8_t expectedSeq = _lastIndex[message.sysid][message.compid] + 1;
+
+    uint64_t totalReceived  = _totalReceiveCounter.load(std::memory_order_relaxed) + 1;
+    uint64_t totalLoss      = _totalLossCounter.load(std::memory_order_relaxed);
+
+    // Determine what the next expected sequence number is, accounting for
+    // never having seen a message for this system/component pair.
+    if (_firstMessage[message.sysid][message.compid]) {
+        _firstMessage[message.sysid][message.compid] = false;
+        expectedSeq = message.seq;
+    }
+
+    if (message.seq != expectedSeq) {
+        //-- Account for overflow during packet loss
+        if (message.seq < expectedSeq) {
+            totalLoss += static_cast<uint64_t>((message.seq + 255) - expectedSeq);
+        } else {
+            totalLoss += static_cast<uint64_t>(message.seq - expectedSeq);
+        }
+    }
+    _lastIndex[message.sysid][message.compid] = message.seq;
+
+    // Calculate new loss ratio
+    uint64_t totalSent = totalReceived + totalLoss;
+    float receiveLossPercent = static_cast<float>(static_cast<double>(totalLoss) / static_cast<double>(totalSent));
+    receiveLossPercent *= 100.0f;
+    receiveLossPercent = (receiveLossPercent * 0.5f) + (_runningLossPercent.load(std::memory_order_relaxed) * 0.5f);
+
+    _totalReceiveCounter.store(totalReceived, std::memory_order_relaxed);
+    _totalLossCounter.store(totalLoss, std::memory_order_relaxed);
+    _runningLossPercent.store(receiveLossPercent, std::memory_order_relaxed);
+}
+
+void MAVLinkDecoder::_forward(const mavlink_message_t& message)
+{
+    if (!_forwardingEnabled.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    SharedLinkInterfacePtr forwardingLink;
+    SharedLinkInterfacePtr forwardingSupportLink;
+    {
+        QMutexLocker lock(&_forwardingMutex);
+        forwardingLink          = _forwardingLink.lock();
+        forwardingSupportLink   = _forwardingSupportLink.lock();
+    }
+
+    if (!forwardingLink && !forwardingSupportLink) {
+        return;
+    }
+
+    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+    int len = mavlink_msg_to_send_buffer(buf, &message);
+
+    if (forwardingLink) {
+        forwardingLink->writeBytesThreadSafe(reinterpret_cast<const char*>(buf), len);
+    }
+    if (forwardingSupportLink) {
+        forwardingSupportLink->writeBytesThreadSafe(reinterpret_cast<const char*>(buf), len);
+    }
+}
@@ -0,0 +1,159 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QByteArray>
+#include <QList>
+#include <QSharedPointer>
+#include <QLoggingCategory>
+
+#include <atomic>
+
+#include "QGCMAVLink.h"
+#include "LinkInterface.h"
+
+Q_DECLARE_LOGGING_CATEGORY(MAVLinkDecoderLog)
+
+/// Single producer/single consumer ring of framed MAVLink messages. The decode thread is the only
+/// producer and the thread owning MAVLinkProtocol is the only consumer, so no locking is needed.
+class MAVLinkMessageQueue
+{
+public:
+    /// @param capacity Number of message slots, rounded up to a power of two
+    MAVLinkMessageQueue(int capacity);
+
+    /// Producer: returns the slot the next message should be parsed into, nullptr if the queue is full
+    mavlink_message_t* writeSlot(void);
+
+    /// Producer: publishes the message previously parsed into writeSlot()
+    void commit(void);
+
+    /// Consumer: moves up to maxCount messages into batch (appended). Returns number of messages moved.
+    int dequeue(QVector<mavlink_message_t>& batch, int maxCount);
+
+    bool    isEmpty (void) const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+    int     capacity(void) const { return _ring.count(); }
+
+private:
+    QVector<mavlink_message_t>  _ring;
+    uint32_t                    _mask;
+    std::atomic<uint32_t>       _head { 0 };    ///< Next slot to write, only modified by producer
+    std::atomic<uint32_t>       _tail { 0 };    ///< Next slot to read, only modified by consumer
+};
+
+/// Sees every framed message on the decode thread, before it is queued for MAVLinkProtocol. Called from the
+/// decode threads of all links at once, so implementations must be thread safe and must never block.
+class MAVLinkDecodeObserver
+{
+public:
+    virtual ~MAVLinkDecodeObserver() = default;
+
+    virtual void messageDecoded(LinkInterface* link, const mavlink_message_t& message) = 0;
+};
+
+typedef QSharedPointer<MAVLinkDecodeObserver> SharedMAVLinkDecodeObserver;
+
+/// Parses the raw byte stream of a single link on a dedicated thread. Framed messages are run through
+/// sequence/loss accounting, forwarded if required and then handed to MAVLinkProtocol through a
+/// MAVLinkMessageQueue. MAVLinkProtocol is notified with a single queued signal per batch.
+class MAVLinkDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkDecoder(LinkInterface* link, QObject* parent = nullptr);
+    ~MAVLinkDecoder();
+
+    /// Moves the decoder to its own thread and starts it. Log replay links are throttled by waiting for
+    /// the consumer when the queue is full, all other links drop messages instead.
+    void start(void);
+
+    /// Stops the decode thread. Pending messages in the queue are left for the consumer.
+    void stop(void);
+
+    LinkInterface*          link    (void) { return _link; }
+    MAVLinkMessageQueue&    queue   (void) { return _queue; }
+
+    /// Consumer: must be called before draining the queue so new arrivals signal again
+    void clearNotify(void) { _notifyPending.store(false, std::memory_order_release); }
+
+    /// Consumer: moves up to maxCount messages into batch and wakes a log replay decode thread waiting for room
+    int dequeue(QVector<mavlink_message_t>& batch, int maxCount);
+
+    /// Sets the links which all decoded messages should be forwarded to. Either may be null.
+    void setForwardingLinks(const SharedLinkInterfacePtr& forwardingLink, const SharedLinkInterfacePtr& forwardingSupportLink);
+
+    /// Sets the observers which see all decoded messages. An observer removed here may still be called
+    /// for the remainder of the chunk of bytes being decoded, it is kept alive until then.
+    void setObservers(const QList<SharedMAVLinkDecodeObserver>& observers);
+
+    /// Resets all sequence/loss accounting
+    void resetStatistics(void);
+
+    uint64_t    totalReceived       (void) const { return _totalReceiveCounter.load(std::memory_order_relaxed); }
+    uint64_t    totalLoss           (void) const { return _totalLossCounter.load(std::memory_order_relaxed); }
+    float       runningLossPercent  (void) const { return _runningLossPercent.load(std::memory_order_relaxed); }
+    uint64_t    totalDropped        (void) const { return _totalDroppedCounter.load(std::memory_order_relaxed); }
+
+    /// Equivalent of mavlink_parse_char which works against caller supplied parse state instead of the global channel state
+    ///     @return true: message framed with good CRC
+    static bool parseChar(uint8_t c, mavlink_message_t* rxMessage, mavlink_status_t* rxStatus, mavlink_message_t* message);
+
+    static const int queueCapacity = 8192;
+
+signals:
+    /// Emitted from the decode thread when the queue transitions from drained to non-empty
+    void messagesAvailable(MAVLinkDecoder* decoder);
+
+public slots:
+    /// Called on the decode thread for every chunk of bytes arriving on the link
+    void receiveBytes(LinkInterface* link, QByteArray bytes);
+
+private:
+    void _updateStatistics  (const mavlink_message_t& message);
+    void _forward           (const mavlink_message_t& message);
+
+    LinkInterface*          _link;
+    QThread                 _thread;
+    MAVLinkMessageQueue     _queue;
+    std::atomic<bool>       _notifyPending  { false };
+    std::atomic<bool>       _stopping       { false };
+    bool                    _waitWhenFull   = false;    ///< true: Block instead of dropping when the queue is full
+    QMutex                  _queueSpaceMutex;
+    QWaitCondition          _queueSpaceCondition;       ///< Signalled by the consumer after it makes room
+
+    // Parser state is private to the decoder so it never races with outbound use of the global channel status
+    mavlink_message_t       _rxMessage;
+    mavlink_status_t        _rxStatus;
+    mavlink_message_t       _overflowMessage;
+
+    bool                    _firstMessage[256][256];
+    uint8_t                 _lastIndex[256][256];
+
+    std::atomic<uint64_t>   _totalReceiveCounter    { 0 };
+    std::atomic<uint64_t>   _totalLossCounter       { 0 };
+    std::atomic<uint64_t>   _totalDroppedCounter    { 0 };
+    std::atomic<float>      _runningLossPercent     { 0 };
+    std::atomic<bool>       _resetPending           { false };
+
+    std::atomic<bool>       _forwardingEnabled      { false };
+    QMutex                  _forwardingMutex;
+    WeakLinkInterfacePtr    _forwardingLink;
+    WeakLinkInterfacePtr    _forwardingSupportLink;
+
+    std::atomic<bool>                   _observersEnabled   { false };
+    QMutex                              _observersMutex;
+    QList<SharedMAVLinkDecodeObserver>  _observers;
+};
@@ -0,0 +1,199 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkDecoderTest.h"
+#include "MAVLinkDecoder.h"
+#include "LinkManager.h"
+#include "QGCLoggingCategory.h"
+
+#include <QElapsedTimer>
+
+QGC_LOGGING_CATEGORY(MAVLinkDecoderTestLog, "MAVLinkDecoderTestLog")
+
+/// Builds a stream of ATTITUDE messages for the specified system id
+///     @param skipEvery Every n'th message is left out of the stream to simulate loss, 0 for no loss
+QByteArray MAVLinkDecoderTest::_buildStream(uint8_t sysid, int messageCount, int skipEvery)
+{
+    uint8_t channel = _linkManager->allocateMavlinkChannel();
+    mavlink_reset_channel_status(channel);
+
+    QByteArray  stream;
+    uint8_t     buf[MAVLINK_MAX_PACKET_LEN];
+
+    for (int i = 0; i < messageCount; i++) {
+        mavlink_message_t msg;
+        mavlink_msg_attitude_pack_chan(sysid, MAV_COMP_ID_AUTOPILOT1, channel, &msg, static_cast<uint32_t>(i), 0.1f, 0.2f, 0.3f, 0, 0, 0);
+        if (skipEvery && (i % skipEvery) == skipEvery - 1) {
+            continue;
+        }
+        int len = mavlink_msg_to_send_buffer(buf, &msg);
+        stream.append(reinterpret_cast<const char*>(buf), len);
+    }
+
+    _linkManager->freeMavlinkChannel(channel);
+    return stream;
+}
+
+void MAVLinkDecoderTest::_queueTest(void)
+{
+    MAVLinkMessageQueue queue(5);
+    QCOMPARE(queue.capacity(), 8);
+    QVERIFY(queue.isEmpty());
+
+    for (int i = 0; i < queue.capacity(); i++) {
+        mavlink_message_t* slot = queue.writeSlot();
+        QVERIFY(slot);
+        slot->seq = static_cast<uint8_t>(i);
+        queue.commit();
+    }
+    QVERIFY(!queue.writeSlot());
+
+    QVector<mavlink_message_t> batch;
+    QCOMPARE(queue.dequeue(batch, 3), 3);
+    QCOMPARE(batch[2].seq, static_cast<uint8_t>(2));
+
+    // Wrap around
+    QVERIFY(queue.writeSlot());
+    queue.commit();
+
+    QCOMPARE(queue.dequeue(batch, 100), queue.capacity() - 2);
+    QVERIFY(queue.isEmpty());
+    for (int i = 0; i < queue.capacity(); i++) {
+        QCOMPARE(batch[i].seq, static_cast<uint8_t>(i));
+    }
+}
+
+void MAVLinkDecoderTest::_decodeTest(void)
+{
+    const int messageCount  = 100;
+    const int skipEvery     = 10;
+
+    MAVLinkDecoder decoder(nullptr);
+    QByteArray stream = _buildStream(1, messageCount, skipEvery);
+
+    // Deliver in small odd sized chunks so messages are split across calls
+    for (int i = 0; i < stream.size(); i += 7) {
+        decoder.receiveBytes(nullptr, stream.mid(i, 7));
+    }
+
+    QVector<mavlink_message_t> batch;
+    decoder.queue().dequeue(batch, MAVLinkDecoder::queueCapacity);
+    QCOMPARE(batch.count(), messageCount - (messageCount / skipEvery));
+    QCOMPARE(decoder.totalReceived(), static_cast<uint64_t>(batch.count()));
+    // The last message of the stream is one of the dropped ones, nothing after it shows it as lost
+    QCOMPARE(decoder.totalLoss(), static_cast<uint64_t>((messageCount / skipEvery) - 1));
+    QCOMPARE(batch[0].msgid, static_cast<uint32_t>(MAVLINK_MSG_ID_ATTITUDE));
+    QCOMPARE(batch[0].sysid, static_cast<uint8_t>(1));
+}
+
+namespace {
+
+class CountingObserver : public MAVLinkDecodeObserver
+{
+public:
+    void messageDecoded(LinkInterface* /*link*/, const mavlink_message_t& message) override
+    {
+        count++;
+        lastSysid = message.sysid;
+    }
+
+    int     count       = 0;
+    uint8_t lastSysid   = 0;
+};
+
+}
+
+void MAVLinkDecoderTest::_observerTest(void)
+{
+    const int messageCount = 20;
+
+    MAVLinkDecoder decoder(nullptr);
+    CountingObserver*           counter = new CountingObserver;
+    SharedMAVLinkDecodeObserver observer(counter);
+    decoder.setObservers({ observer });
+
+    QVector<mavlink_message_t> batch;
+    decoder.receiveBytes(nullptr, _buildStream(3, messageCount, 0));
+    QCOMPARE(counter->count, messageCount);
+    QCOMPARE(counter->lastSysid, static_cast<uint8_t>(3));
+    decoder.queue().dequeue(batch, MAVLinkDecoder::queueCapacity);
+    QCOMPARE(batch.count(), messageCount);
+
+    decoder.setObservers({});
+    decoder.receiveBytes(nullptr, _buildStream(3, messageCount, 0));
+    QCOMPARE(counter->count, messageCount);
+}
+
+/// Runs a decoder thread per simulated vehicle and reports sustained messages/sec delivered to the main thread. Runs
+/// a short stream by default, set QGC_MAVLINK_DECODER_BENCHMARK_MESSAGES=20000 to benchmark.
+void MAVLinkDecoderTest::_multiVehicleRate(void)
+{
+    int messageCount = qEnvironmentVariableIntValue("QGC_MAVLINK_DECODER_BENCHMARK_MESSAGES");
+    if (messageCount <= 0) {
+        messageCount = 1000;
+    }
+    const int vehicleCount      = 12;
+    const int chunkSize         = 512;
+    const int expectedTotal     = vehicleCount * messageCount;
+
+    QList<MAVLinkDecoder*>  decoders;
+    QList<QByteArray>       streams;
+    int                     delivered = 0;
+
+    for (int i = 0; i < vehicleCount; i++) {
+        MAVLinkDecoder* decoder = new MAVLinkDecoder(nullptr);
+        connect(decoder, &MAVLinkDecoder::messagesAvailable, this, [&delivered](MAVLinkDecoder* decoder) {
+            decoder->clearNotify();
+            QVector<mavlink_message_t> batch;
+            while (decoder->queue().dequeue(batch, MAVLinkDecoder::queueCapacity)) {
+                delivered += batch.count();
+                batch.clear();
+            }
+        }, Qt::QueuedConnection);
+        decoder->start();
+        decoders.append(decoder);
+        streams.append(_buildStream(static_cast<uint8_t>(i + 1), messageCount, 0));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int offset = 0;
+    while (true) {
+        bool moreData = false;
+        for (int i = 0; i < vehicleCount; i++) {
+            if (offset < streams[i].size()) {
+                QMetaObject::invokeMethod(decoders[i], "receiveBytes", Qt::QueuedConnection, Q_ARG(LinkInterface*, nullptr), Q_ARG(QByteArray, streams[i].mid(offset, chunkSize)));
+                moreData = true;
+            }
+        }
+        offset += chunkSize;
+        QCoreApplication::processEvents();
+
+        uint64_t dropped = 0;
+        for (MAVLinkDecoder* decoder: decoders) {
+            dropped += decoder->totalDropped();
+        }
+        if (!moreData && delivered + static_cast<int>(dropped) >= expectedTotal) {
+            break;
+        }
+        QVERIFY(timer.elapsed() < 60000);
+    }
+
+    qint64 elapsed = qMax(timer.elapsed(), static_cast<qint64>(1));
+    qCDebug(MAVLinkDecoderTestLog) << "MAVLinkDecoder:" << vehicleCount << "vehicles," << delivered << "messages in" << elapsed << "msecs," << (delivered * 1000) / elapsed << "msgs/sec";
+
+    uint64_t received = 0;
+    for (MAVLinkDecoder* decoder: decoders) {
+        received += decoder->totalReceived();
+        QCOMPARE(decoder->totalLoss(), static_cast<uint64_t>(0));
+        delete decoder;
+    }
+    QCOMPARE(received, static_cast<uint64_t>(expectedTotal));
+}
@@ -0,0 +1,27 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "QGCMAVLink.h"
+
+class MAVLinkDecoderTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _queueTest         (void);
+    void _decodeTest        (void);
+    void _observerTest      (void);
+    void _multiVehicleRate  (void);
+
+private:
+    QByteArray _buildStream(uint8_t sysid, int messageCount, int skipEvery);
+};
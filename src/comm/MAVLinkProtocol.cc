@@ -17,6 +17,7 @@
 #include <QStandardPaths>
 #include <QtEndian>
 #include <QMetaType>
+#include <QMetaMethod>
 #include <QDir>
 #include <QFileInfo>
 
@@ -46,8 +47,6 @@ const char* MAVLinkProtocol::_logFileExtension      = "mavlink";            ///<
 MAVLinkProtocol::MAVLinkProtocol(QGCApplication* app, QGCToolbox* toolbox)
     : QGCTool(app, toolbox)
     , m_enable_version_check(true)
-    , _message({})
-    , _status({})
     , versionMismatchIgnore(false)
     , systemId(255)
     , _current_version(100)
@@ -59,18 +58,14 @@ MAVLinkProtocol::MAVLinkProtocol(QGCApplication* app, QGCToolbox* toolbox)
     , _linkMgr(nullptr)
     , _multiVehicleManager(nullptr)
 {
-    memset(totalReceiveCounter, 0, sizeof(totalReceiveCounter));
-    memset(totalLossCounter,    0, sizeof(totalLossCounter));
-    memset(runningLossPercent,  0, sizeof(runningLossPercent));
-    memset(firstMessage,        1, sizeof(firstMessage));
-    memset(&_status,            0, sizeof(_status));
-    memset(&_message,           0, sizeof(_message));
+
 }
 
 MAVLinkProtocol::~MAVLinkProtocol()
 {
     storeSettings();
     _closeLogFile();
+    qDeleteAll(_decoders);
 }
 
 void MAVLinkProtocol::setVersion(unsigned version)
@@ -99,6 +94,7 @@ void MAVLinkProtocol::setToolbox(QGCToolbox *toolbox)
    _multiVehicleManager =   _toolbox->multiVehicleManager();
 
    qRegisterMetaType<mavlink_message_t>("mavlink_message_t");
+   qRegisterMetaType<MAVLinkDecoder*>("MAVLinkDecoder*");
 
    loadSettings();
 
@@ -106,12 +102,16 @@ void MAVLinkProtocol::setToolbox(QGCToolbox *toolbox)
    // on a per-link basis before those links are used. @see resetMetadataForLink().
 
    connect(this, &MAVLinkProtocol::protocolStatusMessage,   _app, &QGCApplication::criticalMessageBoxOnMainThread);
+   connect(&_logWriter, &TLogWriter::writeError,          this, &MAVLinkProtocol::_logWriteError);
    connect(this, &MAVLinkProtocol::saveTelemetryLog,        _app, &QGCApplication::saveTelemetryLogOnMainThread);
    connect(this, &MAVLinkProtocol::checkTelemetrySavePath,  _app, &QGCApplication::checkTelemetrySavePathOnMainThread);
 
    connect(_multiVehicleManager, &MultiVehicleManager::vehicleAdded, this, &MAVLinkProtocol::_vehicleCountChanged);
    connect(_multiVehicleManager, &MultiVehicleManager::vehicleRemoved, this, &MAVLinkProtocol::_vehicleCountChanged);
 
+   connect(_app->toolbox()->settingsManager()->appSettings()->forwardMavlink(), &Fact::rawValueChanged, this, &MAVLinkProtocol::_updateForwardingLinks);
+   connect(_linkMgr, &LinkManager::mavlinkSupportForwardingEnabledChanged, this, &MAVLinkProtocol::_updateForwardingLinks);
+
    emit versionCheckChanged(m_enable_version_check);
 }
 
@@ -142,248 +142,310 @@ void MAVLinkProtocol::storeSettings()
 
 void MAVLinkProtocol::resetMetadataForLink(LinkInterface *link)
 {
-    int channel = link->mavlinkChannel();
-    totalReceiveCounter[channel] = 0;
-    totalLossCounter[channel]    = 0;
-    runningLossPercent[channel]  = 0.0f;
-    for(int i = 0; i < 256; i++) {
-        firstMessage[channel][i] =  1;
+    MAVLinkDecoder* decoder = _decoders.value(link, nullptr);
+    if (decoder) {
+        decoder->resetStatistics();
     }
     link->setDecodedFirstMavlinkPacket(false);
 }
 
-/**
- * This method parses all outcoming bytes and log a MAVLink packet.
- * @param link The interface to read from
- * @see LinkInterface
- **/
+void MAVLinkProtocol::startDecoding(const SharedLinkInterfacePtr& link)
+{
+    if (_decoders.contains(link.get())) {
+        qCWarning(MAVLinkProtocolLog) << "startDecoding: link already has a decoder";
+        return;
+    }
 
-void MAVLinkProtocol::logSentBytes(LinkInterface* link, QByteArray b){
+    // The decoder has no parent since it is moved to its own thread
+    MAVLinkDecoder* decoder = new MAVLinkDecoder(link.get());
+    _decoders[link.get()] = decoder;
 
-    uint8_t bytes_time[sizeof(quint64)];
+    connect(link.get(), &LinkInterface::bytesReceived,  decoder,    &MAVLinkDecoder::receiveBytes);
+    connect(decoder,    &MAVLinkDecoder::messagesAvailable, this,   &MAVLinkProtocol::_messagesAvailable, Qt::QueuedConnection);
 
-    Q_UNUSED(link);
-    if (!_logSuspendError && !_logSuspendReplay && _tempLogFile.isOpen()) {
+    decoder->setObservers(_decodeObservers);
+    decoder->start();
+    _updateForwardingLinks();
+}
+
+void MAVLinkProtocol::stopDecoding(LinkInterface* link)
+{
+    MAVLinkDecoder* decoder = _decoders.take(link);
+    if (!decoder) {
+        return;
+    }
+
+    disconnect(link, &LinkInterface::bytesReceived, decoder, &MAVLinkDecoder::receiveBytes);
+    decoder->stop();
+    delete decoder;
+
+    _updateForwardingLinks();
+}
+
+float MAVLinkProtocol::runningLossPercent(LinkInterface* link) const
+{
+    MAVLinkDecoder* decoder = _decoders.value(link, nullptr);
+    return decoder ? decoder->runningLossPercent() : 0.0f;
+}
+
+int MAVLinkProtocol::subscribeMessages(QObject* context, const QList<uint32_t>& msgIds, MessageBatchHandler handler)
+{
+    SharedMessageSubscriber_t subscriber(new MessageSubscriber_t);
+
+    subscriber->id      = _nextSubscriptionId++;
+    subscriber->context = context;
+    subscriber->handler = handler;
+    subscriber->active  = true;
+    subscriber->msgIds  = msgIds;
+
+    _subscribers[subscriber->id] = subscriber;
+    if (msgIds.isEmpty()) {
+        _allMessageSubscribers.append(subscriber);
+    } else {
+        for (uint32_t msgId: msgIds) {
+            _msgIdSubscribers[msgId].append(subscriber);
+        }
+    }
+
+    int subscriptionId = subscriber->id;
+    connect(context, &QObject::destroyed, this, [this, subscriptionId]() { unsubscribeMessages(subscriptionId); });
+
+    return subscriptionId;
+}
+
+void MAVLinkProtocol::unsubscribeMessages(int subscriptionId)
+{
+    SharedMessageSubscriber_t subscriber = _subscribers.take(subscriptionId);
+    if (!subscriber) {
+        return;
+    }
+
+    if (subscriber->msgIds.isEmpty()) {
+        _allMessageSubscribers.removeOne(subscriber);
+    } else {
+        for (uint32_t msgId: subscriber->msgIds) {
+            QList<SharedMessageSubscriber_t>& msgIdSubscribers = _msgIdSubscribers[msgId];
+            msgIdSubscribers.removeOne(subscriber);
+            if (msgIdSubscribers.isEmpty()) {
+                _msgIdSubscribers.remove(msgId);
+            }
+        }
+    }
+
+    // A dispatch may be in progress, possibly inside this subscriber's own handler. The handler must stay intact
+    // until that returns, so it is only marked inactive here. The dispatch holds a reference which frees it afterwards.
+    subscriber->active = false;
+}
+
+void MAVLinkProtocol::addDecodeObserver(const SharedMAVLinkDecodeObserver& observer)
+{
+    if (_decodeObservers.contains(observer)) {
+        return;
+    }
+    _decodeObservers.append(observer);
+    for (MAVLinkDecoder* decoder: _decoders) {
+        decoder->setObservers(_decodeObservers);
+    }
+}
 
-        quint64 time = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch() * 1000);
+void MAVLinkProtocol::removeDecodeObserver(const SharedMAVLinkDecodeObserver& observer)
+{
+    if (_decodeObservers.removeOne(observer)) {
+        for (MAVLinkDecoder* decoder: _decoders) {
+            decoder->setObservers(_decodeObservers);
+        }
+    }
+}
 
-        qToBigEndian(time,bytes_time);
+/// Delivers the batch to the subscribers, one call per subscriber
+void MAVLinkProtocol::_dispatchSubscribers(LinkInterface* link, const QVector<mavlink_message_t>& batch)
+{
+    QList<SharedMessageSubscriber_t> activeSubscribers;
 
-        b.insert(0,QByteArray((const char*)bytes_time,sizeof(bytes_time)));
+    for (const mavlink_message_t& batchMessage: batch) {
+        const mavlink_message_t* message = &batchMessage;
 
-        int len = b.count();
+        for (const SharedMessageSubscriber_t& subscriber: _allMessageSubscribers) {
+            if (subscriber->pending.isEmpty()) {
+                activeSubscribers.append(subscriber);
+            }
+            subscriber->pending.append(message);
+        }
 
-        if(_tempLogFile.write(b) != len)
-        {
-            // If there's an error logging data, raise an alert and stop logging.
-            emit protocolStatusMessage(tr("MAVLink Protocol"), tr("MAVLink Logging failed. Could not write to file %1, logging disabled.").arg(_tempLogFile.fileName()));
-            _stopLogging();
-            _logSuspendError = true;
+        auto iter = _msgIdSubscribers.constFind(message->msgid);
+        if (iter != _msgIdSubscribers.constEnd()) {
+            for (const SharedMessageSubscriber_t& subscriber: iter.value()) {
+                if (subscriber->pending.isEmpty()) {
+                    activeSubscribers.append(subscriber);
+                }
+                subscriber->pending.append(message);
+            }
         }
     }
 
+    // Pull all pending lists out before calling anyone since a handler may re-enter the event loop and dispatch another batch
+    QList<QVector<const mavlink_message_t*>> deliveries;
+    for (const SharedMessageSubscriber_t& subscriber: activeSubscribers) {
+        deliveries.append(subscriber->pending);
+        subscriber->pending.clear();
+    }
+
+    for (int i = 0; i < activeSubscribers.count(); i++) {
+        const SharedMessageSubscriber_t& subscriber = activeSubscribers[i];
+        if (subscriber->active && subscriber->context) {
+            subscriber->handler(link, deliveries[i]);
+        }
+    }
+}
+
+void MAVLinkProtocol::_updateForwardingLinks(void)
+{
+    SharedLinkInterfacePtr forwardingLink;
+    SharedLinkInterfacePtr forwardingSupportLink;
+
+    if (_app->toolbox()->settingsManager()->appSettings()->forwardMavlink()->rawValue().toBool()) {
+        forwardingLink = _linkMgr->mavlinkForwardingLink();
+    }
+    if (_linkMgr->mavlinkSupportForwardingEnabled()) {
+        forwardingSupportLink = _linkMgr->mavlinkForwardingSupportLink();
+    }
+
+    for (MAVLinkDecoder* decoder: _decoders) {
+        decoder->setForwardingLinks(forwardingLink, forwardingSupportLink);
+    }
 }
 
 /**
- * This method parses all incoming bytes and constructs a MAVLink packet.
- * It can handle multiple links in parallel, as each link has it's own buffer/
- * parsing state machine.
+ * This method parses all outcoming bytes and log a MAVLink packet.
  * @param link The interface to read from
  * @see LinkInterface
  **/
 
-void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
+void MAVLinkProtocol::logSentBytes(LinkInterface* link, QByteArray b)
+{
+    Q_UNUSED(link);
+
+    if (!_logSuspendError && !_logSuspendReplay && _logWriter.isLogging()) {
+        _logWriter.writeBytes(b.constData(), b.size());
+    }
+}
+
+/**
+ * Dispatches the messages framed by a link's decode thread. Parsing, sequence accounting and
+ * forwarding have already happened on the decode thread, only work which must be done on the
+ * main thread is left here.
+ * @param decoder The decoder which has messages queued
+ **/
+
+void MAVLinkProtocol::_messagesAvailable(MAVLinkDecoder* decoder)
 {
-    // Since receiveBytes signals cross threads we can end up with signals in the queue
+    // The signal is queued, so the decoder may have been deleted since it was emitted
+    LinkInterface* link = _decoders.key(decoder, nullptr);
+    if (!link) {
+        return;
+    }
+
+    // Since messagesAvailable signals cross threads we can end up with signals in the queue
     // that come through after the link is disconnected. For these we just drop the data
     // since the link is closed.
     SharedLinkInterfacePtr linkPtr = _linkMgr->sharedLinkInterfacePointerForLink(link, true);
     if (!linkPtr) {
-        qCDebug(MAVLinkProtocolLog) << "receiveBytes: link gone!" << b.size() << " bytes arrived too late";
+        qCDebug(MAVLinkProtocolLog) << "_messagesAvailable: link gone!";
         return;
     }
 
-    uint8_t mavlinkChannel = link->mavlinkChannel();
+    // Clear before draining so anything arriving from here on raises a new notification
+    decoder->clearNotify();
 
-    for (int position = 0; position < b.size(); position++) {
-        if (mavlink_parse_char(mavlinkChannel, static_cast<uint8_t>(b[position]), &_message, &_status)) {
-            // Got a valid message
-            if (!link->decodedFirstMavlinkPacket()) {
-                link->setDecodedFirstMavlinkPacket(true);
-                mavlink_status_t* mavlinkStatus = mavlink_get_channel_status(mavlinkChannel);
-                if (!(mavlinkStatus->flags & MAVLINK_STATUS_FLAG_IN_MAVLINK1) && (mavlinkStatus->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
-                    qCDebug(MAVLinkProtocolLog) << "Switching outbound to mavlink 2.0 due to incoming mavlink 2.0 packet:" << mavlinkStatus << mavlinkChannel << mavlinkStatus->flags;
-                    mavlinkStatus->flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
-                    // Set all links to v2
-                    setVersion(200);
-                }
-            }
+    // Local batch since message handlers may re-enter the event loop
+    QVector<mavlink_message_t> batch;
+    batch.reserve(_maxMessagesPerDrain);
+    decoder->dequeue(batch, _maxMessagesPerDrain);
 
-            //-----------------------------------------------------------------
-            // MAVLink Status
-            uint8_t lastSeq = lastIndex[_message.sysid][_message.compid];
-            uint8_t expectedSeq = lastSeq + 1;
-            // Increase receive counter
-            totalReceiveCounter[mavlinkChannel]++;
-            // Determine what the next expected sequence number is, accounting for
-            // never having seen a message for this system/component pair.
-            if(firstMessage[_message.sysid][_message.compid]) {
-                firstMessage[_message.sysid][_message.compid] = 0;
-                lastSeq     = _message.seq;
-                expectedSeq = _message.seq;
-            }
-            // And if we didn't encounter that sequence number, record the error
-            //int foo = 0;
-            if (_message.seq != expectedSeq)
-            {
-                //foo = 1;
-                int lostMessages = 0;
-                //-- Account for overflow during packet loss
-                if(_message.seq < expectedSeq) {
-                    lostMessages = (_message.seq + 255) - expectedSeq;
-                } else {
-                    lostMessages = _message.seq - expectedSeq;
-                }
-                // Log how many were lost
-                totalLossCounter[mavlinkChannel] += static_cast<uint64_t>(lostMessages);
-            }
-
-            // And update the last sequence number for this system/component pair
-            lastIndex[_message.sysid][_message.compid] = _message.seq;;
-            // Calculate new loss ratio
-            uint64_t totalSent = totalReceiveCounter[mavlinkChannel] + totalLossCounter[mavlinkChannel];
-            float receiveLossPercent = static_cast<float>(static_cast<double>(totalLossCounter[mavlinkChannel]) / static_cast<double>(totalSent));
-            receiveLossPercent *= 100.0f;
-            receiveLossPercent = (receiveLossPercent * 0.5f) + (runningLossPercent[mavlinkChannel] * 0.5f);
-            runningLossPercent[mavlinkChannel] = receiveLossPercent;
-
-            //qDebug() << foo << _message.seq << expectedSeq << lastSeq << totalLossCounter[mavlinkChannel] << totalReceiveCounter[mavlinkChannel] << totalSentCounter[mavlinkChannel] << "(" << _message.sysid << _message.compid << ")";
-
-            //-----------------------------------------------------------------
-            // MAVLink forwarding
-            bool forwardingEnabled = _app->toolbox()->settingsManager()->appSettings()->forwardMavlink()->rawValue().toBool();
-            if (forwardingEnabled) {
-                SharedLinkInterfacePtr forwardingLink = _linkMgr->mavlinkForwardingLink();
-
-                if (forwardingLink) {
-                    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
-                    int len = mavlink_msg_to_send_buffer(buf, &_message);
-                    forwardingLink->writeBytesThreadSafe((const char*)buf, len);
-                }
-            }
+    bool emitMessageReceived = isSignalConnected(QMetaMethod::fromSignal(&MAVLinkProtocol::messageReceived));
 
-            // MAVLink forwarding support
-            bool forwardingSupportEnabled = _linkMgr->mavlinkSupportForwardingEnabled();
-            if (forwardingSupportEnabled) {
-                SharedLinkInterfacePtr forwardingSupportLink = _linkMgr->mavlinkForwardingSupportLink();
-
-                if (forwardingSupportLink) {
-                    uint8_t buf[MAVLINK_MAX_PACKET_LEN];
-                    int len = mavlink_msg_to_send_buffer(buf, &_message);
-                    forwardingSupportLink->writeBytesThreadSafe((const char*)buf, len);
-                }
-            }
+    for (const mavlink_message_t& message: batch) {
+        _handleMessage(link, decoder, message);
 
-            //-----------------------------------------------------------------
-            // Log data
-            if (!_logSuspendError && !_logSuspendReplay && _tempLogFile.isOpen()) {
-                uint8_t buf[MAVLINK_MAX_PACKET_LEN+sizeof(quint64)];
-
-                // Write the uint64 time in microseconds in big endian format before the message.
-                // This timestamp is saved in UTC time. We are only saving in ms precision because
-                // getting more than this isn't possible with Qt without a ton of extra code.
-                quint64 time = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch() * 1000);
-                qToBigEndian(time, buf);
-
-                // Then write the message to the buffer
-                int len = mavlink_msg_to_send_buffer(buf + sizeof(quint64), &_message);
-
-                // Determine how many bytes were written by adding the timestamp size to the message size
-                len += sizeof(quint64);
-
-                // Now write this timestamp/message pair to the log.
-                QByteArray b(reinterpret_cast<const char*>(buf), len);
-                if(_tempLogFile.write(b) != len)
-                {
-                    // If there's an error logging data, raise an alert and stop logging.
-                    emit protocolStatusMessage(tr("MAVLink Protocol"), tr("MAVLink Logging failed. Could not write to file %1, logging disabled.").arg(_tempLogFile.fileName()));
-                    _stopLogging();
-                    _logSuspendError = true;
-                }
+        // The packet is emitted as a whole, as it is only 255 - 261 bytes short
+        // kind of inefficient, but no issue for a groundstation pc.
+        // It buys as reentrancy for the whole code over all threads
+        if (emitMessageReceived) {
+            emit messageReceived(link, message);
+        }
 
-                // Check for the vehicle arming going by. This is used to trigger log save.
-                if (!_vehicleWasArmed && _message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-                    mavlink_heartbeat_t state;
-                    mavlink_msg_heartbeat_decode(&_message, &state);
-                    if (state.base_mode & MAV_MODE_FLAG_DECODE_POSITION_SAFETY) {
-                        _vehicleWasArmed = true;
-                    }
-                }
-            }
+        // Anyone handling the message could close the connection, which deletes the link
+        // and its decoder, so we check if it's expired
+        if (1 == linkPtr.use_count() || !_decoders.contains(link)) {
+            return;
+        }
+    }
 
-            if (_message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-                _startLogging();
-                mavlink_heartbeat_t heartbeat;
-                mavlink_msg_heartbeat_decode(&_message, &heartbeat);
-                emit vehicleHeartbeatInfo(link, _message.sysid, _message.compid, heartbeat.autopilot, heartbeat.type);
-            } else if (_message.msgid == MAVLINK_MSG_ID_HIGH_LATENCY) {
-                _startLogging();
-                mavlink_high_latency_t highLatency;
-                mavlink_msg_high_latency_decode(&_message, &highLatency);
-                // HIGH_LATENCY does not provide autopilot or type information, generic is our safest bet
-                emit vehicleHeartbeatInfo(link, _message.sysid, _message.compid, MAV_AUTOPILOT_GENERIC, MAV_TYPE_GENERIC);
-            } else if (_message.msgid == MAVLINK_MSG_ID_HIGH_LATENCY2) {
-                _startLogging();
-                mavlink_high_latency2_t highLatency2;
-                mavlink_msg_high_latency2_decode(&_message, &highLatency2);
-                emit vehicleHeartbeatInfo(link, _message.sysid, _message.compid, highLatency2.autopilot, highLatency2.type);
-            }
+    // Subscribers get the whole batch in one call rather than a signal per message
+    _dispatchSubscribers(link, batch);
+    if (1 == linkPtr.use_count() || !_decoders.contains(link)) {
+        return;
+    }
 
-#if 0
-            // Given the current state of SiK Radio firmwares there is no way to make the code below work.
-            // The ArduPilot implementation of SiK Radio firmware always sends MAVLINK_MSG_ID_RADIO_STATUS as a mavlink 1
-            // packet even if the vehicle is sending Mavlink 2.
-
-            // Detect if we are talking to an old radio not supporting v2
-            mavlink_status_t* mavlinkStatus = mavlink_get_channel_status(mavlinkChannel);
-            if (_message.msgid == MAVLINK_MSG_ID_RADIO_STATUS && _radio_version_mismatch_count != -1) {
-                if ((mavlinkStatus->flags & MAVLINK_STATUS_FLAG_IN_MAVLINK1)
-                && !(mavlinkStatus->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
-                    _radio_version_mismatch_count++;
-                }
-            }
+    if (!decoder->queue().isEmpty()) {
+        // More arrived than we dispatch in a single pass, let the event loop breathe before continuing
+        QMetaObject::invokeMethod(this, "_messagesAvailable", Qt::QueuedConnection, Q_ARG(MAVLinkDecoder*, decoder));
+    }
+}
 
-            if (_radio_version_mismatch_count == 5) {
-                // Warn the user if the radio continues to send v1 while the link uses v2
-                emit protocolStatusMessage(tr("MAVLink Protocol"), tr("Detected radio still using MAVLink v1.0 on a link with MAVLink v2.0 enabled. Please upgrade the radio firmware."));
-                // Set to flag warning already shown
-                _radio_version_mismatch_count = -1;
-                // Flick link back to v1
-                qDebug() << "Switching outbound to mavlink 1.0 due to incoming mavlink 1.0 packet:" << mavlinkStatus << mavlinkChannel << mavlinkStatus->flags;
-                mavlinkStatus->flags |= MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
-            }
-#endif
+void MAVLinkProtocol::_handleMessage(LinkInterface* link, MAVLinkDecoder* decoder, const mavlink_message_t& message)
+{
+    if (!link->decodedFirstMavlinkPacket()) {
+        link->setDecodedFirstMavlinkPacket(true);
+        uint8_t mavlinkChannel = link->mavlinkChannel();
+        mavlink_status_t* mavlinkStatus = mavlink_get_channel_status(mavlinkChannel);
+        if (message.magic == MAVLINK_STX && (mavlinkStatus->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
+            qCDebug(MAVLinkProtocolLog) << "Switching outbound to mavlink 2.0 due to incoming mavlink 2.0 packet:" << mavlinkStatus << mavlinkChannel << mavlinkStatus->flags;
+            mavlinkStatus->flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+            // Set all links to v2
+            setVersion(200);
+        }
+    }
 
-            // Update MAVLink status on every 32th packet
-            if ((totalReceiveCounter[mavlinkChannel] & 0x1F) == 0) {
-                emit mavlinkMessageStatus(_message.sysid, totalSent, totalReceiveCounter[mavlinkChannel], totalLossCounter[mavlinkChannel], receiveLossPercent);
+    //-----------------------------------------------------------------
+    // Log data
+    if (!_logSuspendError && !_logSuspendReplay && _logWriter.isLogging()) {
+        // Serialized straight into the writer's buffer, the file itself is written on the writer thread
+        _logWriter.writeMessage(message);
+
+        // Check for the vehicle arming going by. This is used to trigger log save.
+        if (!_vehicleWasArmed && message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+            mavlink_heartbeat_t state;
+            mavlink_msg_heartbeat_decode(&message, &state);
+            if (state.base_mode & MAV_MODE_FLAG_DECODE_POSITION_SAFETY) {
+                _vehicleWasArmed = true;
             }
+        }
+    }
 
-            // The packet is emitted as a whole, as it is only 255 - 261 bytes short
-            // kind of inefficient, but no issue for a groundstation pc.
-            // It buys as reentrancy for the whole code over all threads
-            emit messageReceived(link, _message);
-
-            // Anyone handling the message could close the connection, which deletes the link,
-            // so we check if it's expired
-            if (1 == linkPtr.use_count()) {
-                break;
-            }
+    if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+        _startLogging();
+        mavlink_heartbeat_t heartbeat;
+        mavlink_msg_heartbeat_decode(&message, &heartbeat);
+        emit vehicleHeartbeatInfo(link, message.sysid, message.compid, heartbeat.autopilot, heartbeat.type);
+    } else if (message.msgid == MAVLINK_MSG_ID_HIGH_LATENCY) {
+        _startLogging();
+        mavlink_high_latency_t highLatency;
+        mavlink_msg_high_latency_decode(&message, &highLatency);
+        // HIGH_LATENCY does not provide autopilot or type information, generic is our safest bet
+        emit vehicleHeartbeatInfo(link, message.sysid, message.compid, MAV_AUTOPILOT_GENERIC, MAV_TYPE_GENERIC);
+    } else if (message.msgid == MAVLINK_MSG_ID_HIGH_LATENCY2) {
+        _startLogging();
+        mavlink_high_latency2_t highLatency2;
+        mavlink_msg_high_latency2_decode(&message, &highLatency2);
+        emit vehicleHeartbeatInfo(link, message.sysid, message.compid, highLatency2.autopilot, highLatency2.type);
+    }
 
-            // Reset message parsing
-            memset(&_status,  0, sizeof(_status));
-            memset(&_message, 0, sizeof(_message));
-        }
+    // Update MAVLink status on every 32th packet
+    if ((++_messageStatusCounter & 0x1F) == 0) {
+        uint64_t totalReceived  = decoder->totalReceived();
+        uint64_t totalLoss      = decoder->totalLoss();
+        emit mavlinkMessageStatus(message.sysid, totalReceived + totalLoss, totalReceived, totalLoss, decoder->runningLossPercent());
     }
 }
 
@@ -431,6 +493,9 @@ void MAVLinkProtocol::_vehicleCountChanged(void)
 /// @brief Closes the log file if it is open
 bool MAVLinkProtocol::_closeLogFile(void)
 {
+    // Writer must be finished with the file before anything else touches it
+    _logWriter.stopLogging();
+
     if (_tempLogFile.isOpen()) {
         if (_tempLogFile.size() == 0) {
             // Don't save zero byte files
@@ -474,6 +539,7 @@ void MAVLinkProtocol::_startLogging(void)
             }
 
             qCDebug(MAVLinkProtocolLog) << "Temp log" << _tempLogFile.fileName();
+            _logWriter.startLogging(&_tempLogFile, static_cast<TLogWriter::FsyncPolicy>(appSettings->telemetryFsyncPolicy()->rawValue().toInt()));
             emit checkTelemetrySavePath();
 
             _logSuspendError = false;
@@ -519,6 +585,15 @@ void MAVLinkProtocol::checkForLostLogFiles(void)
     }
 }
 
+void MAVLinkProtocol::_logWriteError(QString errorString)
+{
+    // If there's an error logging data, raise an alert and stop logging.
+    qCWarning(MAVLinkProtocolLog) << "Log write failed" << errorString;
+    emit protocolStatusMessage(tr("MAVLink Protocol"), tr("MAVLink Logging failed. Could not write to file %1, logging disabled.").arg(_tempLogFile.fileName()));
+    _stopLogging();
+    _logSuspendError = true;
+}
+
 void MAVLinkProtocol::suspendLogForReplay(bool suspend)
 {
     _logSuspendReplay = suspend;
@@ -17,8 +17,10 @@
 //  - άÿ·ͨͳƣʡշȣ
 //  - ͨ resetMetadataForLink ·Ԫ
 //  3. Ϣ
-//  - ʵ receiveBytes ֽMAVLinkϢ
-//  - ͨ messageReceived źתϢ
+//  - ÿ·жḶ̌߳ startDecoding / stopDecoding MAVLinkDecoder ֽࣩGUI߳Ͻ
+//  - ̰߳ϢУGUI߳ͨ _messagesAvailable ȡַ
+//  - ͨ subscribeMessages ϢIDַmessageReceived źתϢ
+//  - ͨ addDecodeObserver ڽֱ߳ӹ۲Ϣ
 //  - ¼͵ֽ logSentBytes 
 //  4. ϵͳʶ
 //  - άGCSϵͳID systemId ԣ
@@ -44,12 +46,20 @@
 #include <QFile>
 #include <QMap>
 #include <QByteArray>
+#include <QHash>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QVector>
 #include <QLoggingCategory>
 
+#include <functional>
+
 #include "LinkInterface.h"
+#include "MAVLinkDecoder.h"
 #include "QGCMAVLink.h"
 #include "QGC.h"
 #include "QGCTemporaryFile.h"
+#include "TLogWriter.h"
 #include "QGCToolbox.h"
 
 class LinkManager;
@@ -96,6 +106,35 @@ public:
      */
     virtual void resetMetadataForLink(LinkInterface *link);
 
+    /// Starts a dedicated decode thread for the link. Called by LinkManager when the link is created.
+    void startDecoding(const SharedLinkInterfacePtr& link);
+
+    /// Stops and deletes the decode thread for the link. Called by LinkManager when the link goes away.
+    void stopDecoding(LinkInterface* link);
+
+    /// @return Running loss percentage for the link, 0 if the link is unknown
+    float runningLossPercent(LinkInterface* link) const;
+
+    /// Called once per dispatch cycle with all messages from the batch which match the subscription.
+    /// The message pointers are only valid for the duration of the call.
+    typedef std::function<void(LinkInterface* link, const QVector<const mavlink_message_t*>& messages)> MessageBatchHandler;
+
+    /// Registers a handler for batches of the specified message ids. Only subscribers with specific message ids are
+    /// skipped for other traffic. Each Vehicle subscribes to all messages (it tracks link stats and sequence loss and
+    /// hands everything to plugins and mavlinkMessageReceived), so every message still goes through at least one handler
+    /// per vehicle.
+    ///     @param context Subscription is removed automatically when this object is destroyed
+    ///     @param msgIds Message ids to deliver, an empty list delivers all messages
+    /// Handlers may unsubscribe themselves or others from within the call.
+    /// @return Subscription id to pass to unsubscribeMessages
+    int subscribeMessages(QObject* context, const QList<uint32_t>& msgIds, MessageBatchHandler handler);
+
+    void unsubscribeMessages(int subscriptionId);
+
+    /// Adds an observer which sees every message on the decode thread of its link, see MAVLinkDecodeObserver
+    void addDecodeObserver      (const SharedMAVLinkDecodeObserver& observer);
+    void removeDecodeObserver   (const SharedMAVLinkDecodeObserver& observer);
+
     /// Suspend/Restart logging during replay.
     void suspendLogForReplay(bool suspend);
 
@@ -106,9 +145,6 @@ public:
     virtual void setToolbox(QGCToolbox *toolbox);
 
 public slots:
-    /** @brief Receive bytes from a communication interface */
-    void receiveBytes(LinkInterface* link, QByteArray b);
-
     /** @brief Log bytes sent from a communication interface */
     void logSentBytes(LinkInterface* link, QByteArray b);
 
@@ -131,14 +167,6 @@ public slots:
 
 protected:
     bool        m_enable_version_check;                         ///< Enable checking of version match of MAV and QGC
-    uint8_t     lastIndex[256][256];                            ///< Store the last received sequence ID for each system/componenet pair
-    uint8_t     firstMessage[256][256];                         ///< First message flag
-    uint64_t    totalReceiveCounter[MAVLINK_COMM_NUM_BUFFERS];  ///< The total number of successfully received messages
-    uint64_t    totalLossCounter[MAVLINK_COMM_NUM_BUFFERS];     ///< Total messages lost during transmission.
-    float       runningLossPercent[MAVLINK_COMM_NUM_BUFFERS];   ///< Loss rate
-
-    mavlink_message_t _message;
-    mavlink_status_t _status;
 
     bool        versionMismatchIgnore;
     int         systemId;
@@ -149,7 +177,7 @@ signals:
     /// Heartbeat received on link
     void vehicleHeartbeatInfo(LinkInterface* link, int vehicleId, int componentId, int vehicleFirmwareType, int vehicleType);
 
-    /** @brief Message received and directly copied via signal */
+    /** @brief Message received and directly copied via signal. Prefer subscribeMessages which delivers batches without copies. */
     void messageReceived(LinkInterface* link, mavlink_message_t message);
     /** @brief Emitted if version check is enabled / disabled */
     void versionCheckChanged(bool enabled);
@@ -181,9 +209,25 @@ signals:
     void checkTelemetrySavePath(void);
 
 private slots:
-    void _vehicleCountChanged(void);
+    void _vehicleCountChanged       (void);
+    void _messagesAvailable         (MAVLinkDecoder* decoder);
+    void _updateForwardingLinks     (void);
+    void _logWriteError             (QString errorString);
 
 private:
+    typedef struct {
+        int                                 id;
+        QPointer<QObject>                   context;
+        MessageBatchHandler                 handler;
+        bool                                active;     ///< false: unsubscribed, freed once any dispatch in progress lets go of it
+        QList<uint32_t>                     msgIds;
+        QVector<const mavlink_message_t*>   pending;
+    } MessageSubscriber_t;
+
+    typedef QSharedPointer<MessageSubscriber_t> SharedMessageSubscriber_t;
+
+    void _handleMessage         (LinkInterface* link, MAVLinkDecoder* decoder, const mavlink_message_t& message);
+    void _dispatchSubscribers   (LinkInterface* link, const QVector<mavlink_message_t>& batch);
     bool _closeLogFile(void);
     void _startLogging(void);
     void _stopLogging(void);
@@ -193,10 +237,22 @@ private:
     bool _vehicleWasArmed;      ///< true: Vehicle was armed during log sequence
 
     QGCTemporaryFile    _tempLogFile;            ///< File to log to
+    TLogWriter          _logWriter;              ///< Owns _tempLogFile while logging is active
     static const char*  _tempLogFileTemplate;    ///< Template for temporary log file
     static const char*  _logFileExtension;       ///< Extension for log files
 
     LinkManager*            _linkMgr;
     MultiVehicleManager*    _multiVehicleManager;
+
+    QMap<LinkInterface*, MAVLinkDecoder*>   _decoders;
+    uint32_t                                _messageStatusCounter = 0;
+
+    int                                                         _nextSubscriptionId = 0;
+    QMap<int, SharedMessageSubscriber_t>                        _subscribers;
+    QHash<uint32_t, QList<SharedMessageSubscriber_t>>           _msgIdSubscribers;      ///< Subscribers for specific message ids
+    QList<SharedMessageSubscriber_t>                            _allMessageSubscribers; ///< Subscribers for all message ids
+    QList<SharedMAVLinkDecodeObserver>                          _decodeObservers;
+
+    static const int _maxMessagesPerDrain = 1024;   ///< Upper bound on messages dispatched per event loop pass to keep the UI responsive
 };
 
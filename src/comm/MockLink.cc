@@ -544,18 +544,43 @@ void MockLink::_sendVibration(void)
 
 void MockLink::respondWithMavlinkMessage(const mavlink_message_t& msg)
 {
-    if (!_commLost) {
+    if (!_commLost && !_simulatedDrop()) {
         uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
 
         int cBuffer = mavlink_msg_to_send_buffer(buffer, &msg);
         QByteArray bytes((char *)buffer, cBuffer);
-        emit bytesReceived(this, bytes);
+        if (_simulatedLatencyMsecs > 0) {
+            QTimer::singleShot(_simulatedLatencyMsecs, this, [this, bytes]() { emit bytesReceived(this, bytes); });
+        } else {
+            emit bytesReceived(this, bytes);
+        }
     }
 }
 
+void MockLink::setSimulatedDropPercent(int percent, quint32 seed)
+{
+    QMutexLocker lock{&_simulatedDropMutex};
+    _simulatedDropPercent = percent;
+    _simulatedDropGenerator.seed(seed);
+}
+
+bool MockLink::_simulatedDrop(void)
+{
+    QMutexLocker lock{&_simulatedDropMutex};
+    return _simulatedDropPercent > 0 && static_cast<int>(_simulatedDropGenerator.bounded(100)) < _simulatedDropPercent;
+}
+
 /// @brief Called when QGC wants to write bytes to the MAV
 void MockLink::_writeBytes(const QByteArray bytes)
 {
+    if (_simulatedDrop()) {
+        return;
+    }
+    if (_simulatedLatencyMsecs > 0) {
+        QTimer::singleShot(_simulatedLatencyMsecs, this, [this, bytes]() { _writeBytesQueued(bytes); });
+        return;
+    }
+
     // This prevents the responses to mavlink messages from being sent until the _writeBytes returns.
     emit writeBytesQueuedSignal(bytes);
 }
@@ -659,6 +684,9 @@ void MockLink::_handleIncomingMavlinkMsg(const mavlink_message_t &msg)
     case MAVLINK_MSG_ID_PARAM_MAP_RC:
         _handleParamMapRC(msg);
         break;
+    case MAVLINK_MSG_ID_TERRAIN_DATA:
+        _handleTerrainData(msg);
+        break;
     default:
         break;
     }
@@ -1221,6 +1249,33 @@ void MockLink::sendUnexpectedCommandAck(MAV_CMD command, MAV_RESULT ackResult)
     respondWithMavlinkMessage(commandAck);
 }
 
+void MockLink::sendTerrainRequest(const QGeoCoordinate& swCorner, uint16_t gridSpacing, uint64_t mask)
+{
+    mavlink_message_t msg;
+    mavlink_msg_terrain_request_pack_chan(_vehicleSystemId,
+                                          _vehicleComponentId,
+                                          mavlinkChannel(),
+                                          &msg,
+                                          static_cast<int32_t>(swCorner.latitude() * 1e7),
+                                          static_cast<int32_t>(swCorner.longitude() * 1e7),
+                                          gridSpacing,
+                                          mask);
+    respondWithMavlinkMessage(msg);
+}
+
+void MockLink::_handleTerrainData(const mavlink_message_t& msg)
+{
+    mavlink_terrain_data_t terrainData;
+    mavlink_msg_terrain_data_decode(&msg, &terrainData);
+
+    qCDebug(MockLinkLog) << "TERRAIN_DATA gridbit" << terrainData.gridbit;
+
+    _receivedTerrainDataMask |= 1ull << terrainData.gridbit;
+    for (int16_t height: terrainData.data) {
+        _receivedTerrainDataHeights.append(height);
+    }
+}
+
 void MockLink::_respondWithAutopilotVersion(void)
 {
     mavlink_message_t msg;
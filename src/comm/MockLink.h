@@ -14,6 +14,7 @@
 #include <QLoggingCategory>
 #include <QMap>
 #include <QMutex>
+#include <QRandomGenerator>
 
 #include "MockLinkMissionItemHandler.h"
 #include "MockLinkFTP.h"
@@ -153,6 +154,11 @@ public:
     QString logDownloadFile(void) { return _logDownloadFilename; }
 
     Q_INVOKABLE void setCommLost                    (bool commLost)   { _commLost = commLost; }
+
+    /// Simulates a slow, lossy link such as a telemetry radio. Latency is added and messages are dropped in each direction.
+    /// Drops are drawn from a generator with a fixed seed so runs are repeatable.
+    Q_INVOKABLE void setSimulatedLatency            (int msecs)       { _simulatedLatencyMsecs = msecs; }
+    Q_INVOKABLE void setSimulatedDropPercent        (int percent, quint32 seed = 1);
     Q_INVOKABLE void simulateConnectionRemoved      (void);
     static MockLink* startPX4MockLink               (bool sendStatusText, MockConfiguration::FailureMode_t failureMode = MockConfiguration::FailNone);
     static MockLink* startGenericMockLink           (bool sendStatusText, MockConfiguration::FailureMode_t failureMode = MockConfiguration::FailNone);
@@ -184,6 +190,13 @@ public:
     } RequestMessageFailureMode_t;
     void setRequestMessageFailureMode(RequestMessageFailureMode_t failureMode) { _requestMessageFailureMode = failureMode; }
 
+    /// Sends a TERRAIN_REQUEST to QGC for the 8x7 grid of 4x4 blocks whose south west corner is swCorner
+    void sendTerrainRequest(const QGeoCoordinate& swCorner, uint16_t gridSpacing, uint64_t mask);
+
+    void            clearReceivedTerrainData    (void)          { _receivedTerrainDataMask = 0; _receivedTerrainDataHeights.clear(); }
+    uint64_t        receivedTerrainDataMask     (void) const    { return _receivedTerrainDataMask; }    ///< Blocks received since last clear
+    QList<int16_t>  receivedTerrainDataHeights  (void) const    { return _receivedTerrainDataHeights; } ///< 16 heights for each TERRAIN_DATA received
+
 signals:
     void writeBytesQueuedSignal                 (const QByteArray bytes);
     void highLatencyTransmissionEnabledChanged  (bool highLatencyTransmissionEnabled);
@@ -229,6 +242,7 @@ private:
     void _handleLogRequestList          (const mavlink_message_t& msg);
     void _handleLogRequestData          (const mavlink_message_t& msg);
     void _handleParamMapRC              (const mavlink_message_t& msg);
+    void _handleTerrainData             (const mavlink_message_t& msg);
     bool _handleRequestMessage          (const mavlink_command_long_t& request, bool& noAck);
     float _floatUnionForParam           (int componentId, const QString& paramName);
     void _setParamFloatUnionIntoMap     (int componentId, const QString& paramName, float paramFloat);
@@ -245,6 +259,7 @@ private:
     void _sendADSBVehicles              (void);
     void _moveADSBVehicle               (void);
     void _sendGeneralMetaData           (void);
+    bool _simulatedDrop                 (void);
 
     static MockLink* _startMockLinkWorker(QString configName, MAV_AUTOPILOT firmwareType, MAV_TYPE vehicleType, bool sendStatusText, MockConfiguration::FailureMode_t failureMode);
     static MockLink* _startMockLink(MockConfiguration* mockConfig);
@@ -282,6 +297,10 @@ private:
     double                      _vehicleLongitude;
     double                      _vehicleAltitude;
     bool                        _commLost                       = false;
+    int                         _simulatedLatencyMsecs          = 0;
+    int                         _simulatedDropPercent           = 0;
+    QRandomGenerator            _simulatedDropGenerator;
+    QMutex                      _simulatedDropMutex;
     bool                        _highLatencyTransmissionEnabled = true;
 
     // These are just set for reporting the fields in _respondWithAutopilotVersion()
@@ -315,6 +334,8 @@ private:
     RequestMessageFailureMode_t _requestMessageFailureMode = FailRequestMessageNone;
 
     QMap<MAV_CMD, int>                          _receivedMavCommandCountMap;
+    uint64_t                                    _receivedTerrainDataMask = 0;
+    QList<int16_t>                              _receivedTerrainDataHeights;
     QMap<int, QMap<QString, QVariant>>          _mapParamName2Value;
     QMap<int, QMap<QString, MAV_PARAM_TYPE>>    _mapParamName2MavParamType;
 
@@ -0,0 +1,265 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TLogIndex.h"
+#include "MAVLinkDecoder.h"
+#include "QGCLoggingCategory.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <algorithm>
+#include <limits>
+
+QGC_LOGGING_CATEGORY(TLogIndexLog, "TLogIndexLog")
+
+const char* TLogIndex::_sidecarExtension = "idx";
+
+QString TLogIndex::sidecarFilename(const QString& logFilename)
+{
+    return QStringLiteral("%1.%2").arg(logFilename).arg(_sidecarExtension);
+}
+
+quint64 TLogIndex::parseTimestamp(const char* bytes, quint64 currentUSecs)
+{
+    quint64 timestamp           = qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(bytes));
+    quint64 currentTimestamp    = currentUSecs ? currentUSecs : static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000;
+
+    // Now if the parsed timestamp is in the future, it must be an old file where the timestamp was stored as
+    // little endian, so switch it.
+    if (timestamp > currentTimestamp) {
+        timestamp = qbswap(timestamp);
+    }
+
+    return timestamp;
+}
+
+void TLogIndex::_clear(void)
+{
+    _entries.clear();
+    _startTimeUSecs     = 0;
+    _endTimeUSecs       = 0;
+    _messageCount       = 0;
+    _loadedFromCache    = false;
+    _errorString.clear();
+}
+
+bool TLogIndex::load(const QString& logFilename)
+{
+    _clear();
+
+    QFileInfo logFileInfo(logFilename);
+    if (!logFileInfo.exists()) {
+        _errorString = QStringLiteral("Log file does not exist");
+        return false;
+    }
+    qint64 logSize          = logFileInfo.size();
+    qint64 logModifiedMSecs = logFileInfo.lastModified().toMSecsSinceEpoch();
+
+    if (_loadSidecar(logFilename, logSize, logModifiedMSecs)) {
+        _loadedFromCache = true;
+        return true;
+    }
+
+    if (!_build(logFilename)) {
+        return false;
+    }
+    _saveSidecar(logFilename, logSize, logModifiedMSecs);
+
+    return true;
+}
+
+qint64 TLogIndex::seekOffset(quint64 timestampUSecs) const
+{
+    auto it = std::upper_bound(_entries.constBegin(), _entries.constEnd(), timestampUSecs,
+                               [](quint64 timestamp, const IndexEntry_t& entry) { return timestamp < entry.timestampUSecs; });
+    if (it == _entries.constBegin()) {
+        return _entries.isEmpty() ? 0 : _entries.first().offset;
+    }
+    return (it - 1)->offset;
+}
+
+/// Single pass over the log file. A record is a timestamp followed by a mavlink packet. A record is only accepted
+/// when its timestamp is plausible and its packet passes the crc check. Otherwise the scan resyncs by moving forward a
+/// byte at a time until the next timestamp and start of frame pair which does, so a corrupt record only loses itself.
+bool TLogIndex::_build(const QString& logFilename)
+{
+    QFile logFile(logFilename);
+    if (!logFile.open(QFile::ReadOnly)) {
+        _errorString = logFile.errorString();
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const qint64 size = logFile.size();
+    if (size <= timestampSize) {
+        _errorString = QStringLiteral("No messages found in log");
+        return false;
+    }
+
+    const uchar* data = logFile.map(0, size);
+    if (!data) {
+        _errorString = logFile.errorString();
+        return false;
+    }
+
+    const quint64   currentUSecs    = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000;
+    qint64          pos             = 0;
+    qint64          skippedBytes    = 0;
+
+    while (pos + timestampSize < size) {
+        const quint64   recordTimestamp = parseTimestamp(reinterpret_cast<const char*>(data + pos), currentUSecs);
+        const int       packetLength    = recordTimestamp <= currentUSecs ? _packetLength(data + pos + timestampSize, size - pos - timestampSize) : 0;
+
+        if (packetLength == 0) {
+            skippedBytes++;
+            pos++;
+            continue;
+        }
+
+        if (_messageCount++ == 0) {
+            _startTimeUSecs = recordTimestamp;
+        }
+        _endTimeUSecs = recordTimestamp;
+
+        // Only monotonically increasing entries are added so the index can be binary searched
+        if (_entries.isEmpty() || recordTimestamp >= _entries.last().timestampUSecs + indexIntervalUSecs) {
+            _entries.append({ recordTimestamp, pos });
+        }
+
+        pos += timestampSize + packetLength;
+    }
+
+    logFile.unmap(const_cast<uchar*>(data));
+
+    if (_messageCount == 0 || _endTimeUSecs < _startTimeUSecs) {
+        _errorString = QStringLiteral("No messages found in log");
+        _clear();
+        return false;
+    }
+
+    if (skippedBytes) {
+        qCWarning(TLogIndexLog) << "Skipped corrupt bytes while indexing" << logFilename << skippedBytes;
+    }
+    qCDebug(TLogIndexLog) << "Built index" << logFilename << "messages:entries" << _messageCount << _entries.count() << "msecs" << timer.elapsed();
+
+    return true;
+}
+
+/// @return Length of the valid mavlink packet which starts at bytes, 0 if there isn't one
+int TLogIndex::_packetLength(const uchar* bytes, qint64 available)
+{
+    if (available < 3) {
+        return 0;
+    }
+
+    qint64 packetLength;
+    if (bytes[0] == MAVLINK_STX) {
+        packetLength = bytes[1] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+        if (bytes[2] & MAVLINK_IFLAG_SIGNED) {
+            packetLength += MAVLINK_SIGNATURE_BLOCK_LEN;
+        }
+    } else if (bytes[0] == MAVLINK_STX_MAVLINK1) {
+        packetLength = bytes[1] + MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_NUM_CHECKSUM_BYTES;
+    } else {
+        return 0;
+    }
+    if (packetLength > available) {
+        return 0;
+    }
+
+    mavlink_message_t   rxMessage;
+    mavlink_message_t   message;
+    mavlink_status_t    rxStatus;
+    memset(&rxStatus, 0, sizeof(rxStatus));
+
+    // The packet is only valid if the parser completes it on exactly its last byte
+    for (qint64 i = 0; i < packetLength; i++) {
+        if (MAVLinkDecoder::parseChar(bytes[i], &rxMessage, &rxStatus, &message)) {
+            return i == packetLength - 1 ? static_cast<int>(packetLength) : 0;
+        }
+    }
+    return 0;
+}
+
+bool TLogIndex::_loadSidecar(const QString& logFilename, qint64 logSize, qint64 logModifiedMSecs)
+{
+    QFile sidecarFile(sidecarFilename(logFilename));
+    if (!sidecarFile.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream ds(&sidecarFile);
+
+    quint32 magic, version, entryCount;
+    qint64  sidecarLogSize, sidecarLogModifiedMSecs;
+    quint64 interval;
+
+    ds >> magic >> version;
+    if (ds.status() != QDataStream::Ok || magic != _sidecarMagic || version != _sidecarVersion) {
+        qCDebug(TLogIndexLog) << "Sidecar version mismatch" << sidecarFile.fileName();
+        return false;
+    }
+
+    ds >> sidecarLogSize >> sidecarLogModifiedMSecs >> interval >> _startTimeUSecs >> _endTimeUSecs >> _messageCount >> entryCount;
+    if (ds.status() != QDataStream::Ok || sidecarLogSize != logSize || sidecarLogModifiedMSecs != logModifiedMSecs || interval != indexIntervalUSecs) {
+        qCDebug(TLogIndexLog) << "Sidecar stale" << sidecarFile.fileName();
+        _clear();
+        return false;
+    }
+
+    // Each entry is two 8 byte fields, a count the rest of the file can't hold is corrupt
+    const qint64 maxEntryCount = (sidecarFile.size() - sidecarFile.pos()) / static_cast<qint64>(sizeof(quint64) + sizeof(qint64));
+    if (entryCount > maxEntryCount || entryCount > static_cast<quint32>(std::numeric_limits<int>::max())) {
+        qCWarning(TLogIndexLog) << "Sidecar corrupt" << sidecarFile.fileName() << "entries" << entryCount;
+        _clear();
+        return false;
+    }
+
+    _entries.resize(static_cast<int>(entryCount));
+    for (IndexEntry_t& entry: _entries) {
+        ds >> entry.timestampUSecs >> entry.offset;
+    }
+
+    if (ds.status() != QDataStream::Ok) {
+        qCWarning(TLogIndexLog) << "Sidecar corrupt" << sidecarFile.fileName();
+        _clear();
+        return false;
+    }
+
+    return true;
+}
+
+void TLogIndex::_saveSidecar(const QString& logFilename, qint64 logSize, qint64 logModifiedMSecs)
+{
+    // Failing to save is not an error, the log may be on read only media. The index will just be rebuilt next time.
+    QFile sidecarFile(sidecarFilename(logFilename));
+    if (!sidecarFile.open(QFile::WriteOnly | QFile::Truncate)) {
+        qCDebug(TLogIndexLog) << "Unable to save sidecar" << sidecarFile.fileName() << sidecarFile.errorString();
+        return;
+    }
+
+    QDataStream ds(&sidecarFile);
+
+    ds << _sidecarMagic << _sidecarVersion;
+    ds << logSize << logModifiedMSecs << static_cast<quint64>(indexIntervalUSecs) << _startTimeUSecs << _endTimeUSecs << _messageCount << static_cast<quint32>(_entries.count());
+    for (const IndexEntry_t& entry: _entries) {
+        ds << entry.timestampUSecs << entry.offset;
+    }
+
+    if (ds.status() != QDataStream::Ok) {
+        sidecarFile.remove();
+    }
+}
@@ -0,0 +1,74 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(TLogIndexLog)
+
+/// Time index for a telemetry log. Maps log timestamps to the file offset of the record holding them.
+/// The index is sparse (one entry every indexIntervalUSecs of log time) so it stays small for multi-GB
+/// logs. It is built with a single pass over the log and cached in a sidecar file next to the log so
+/// subsequent opens are instant.
+class TLogIndex
+{
+public:
+    /// Loads the index from the sidecar file, building and saving it if it is missing or stale
+    ///     @return false: log is empty or could not be read, see errorString()
+    bool load(const QString& logFilename);
+
+    /// @return Offset of the latest indexed record whose timestamp is <= timestampUSecs. Scanning forward
+    ///         from here reaches the exact record for the timestamp within indexIntervalUSecs of log time.
+    qint64 seekOffset(quint64 timestampUSecs) const;
+
+    quint64 startTimeUSecs  (void) const { return _startTimeUSecs; }
+    quint64 endTimeUSecs    (void) const { return _endTimeUSecs; }
+    quint64 durationUSecs   (void) const { return _endTimeUSecs - _startTimeUSecs; }
+    quint64 messageCount    (void) const { return _messageCount; }
+    int     entryCount      (void) const { return _entries.count(); }
+    bool    loadedFromCache (void) const { return _loadedFromCache; }
+    QString errorString     (void) const { return _errorString; }
+
+    static QString sidecarFilename(const QString& logFilename);
+
+    /// Parses a tlog record timestamp. Very old logs stored timestamps little endian, those are detected
+    /// by being in the future and swapped.
+    ///     @param currentUSecs Current time to compare against, 0 to query the clock
+    static quint64 parseTimestamp(const char* bytes, quint64 currentUSecs = 0);
+
+    static const quint64    indexIntervalUSecs  = 250000;
+    static const int        timestampSize       = sizeof(quint64);
+
+private:
+    typedef struct {
+        quint64 timestampUSecs;
+        qint64  offset;
+    } IndexEntry_t;
+
+    bool _build         (const QString& logFilename);
+    bool _loadSidecar   (const QString& logFilename, qint64 logSize, qint64 logModifiedMSecs);
+    void _saveSidecar   (const QString& logFilename, qint64 logSize, qint64 logModifiedMSecs);
+    void _clear         (void);
+
+    static int _packetLength(const uchar* bytes, qint64 available);
+
+    QVector<IndexEntry_t>   _entries;
+    quint64                 _startTimeUSecs     = 0;
+    quint64                 _endTimeUSecs       = 0;
+    quint64                 _messageCount       = 0;
+    bool                    _loadedFromCache    = false;
+    QString                 _errorString;
+
+    static const char*      _sidecarExtension;
+    static const quint32    _sidecarMagic       = 0x51544C49;   // "QTLI"
+    static const quint32    _sidecarVersion     = 1;
+};
@@ -0,0 +1,120 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TLogIndexTest.h"
+#include "TLogIndex.h"
+#include "QGCMAVLink.h"
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QtEndian>
+
+void TLogIndexTest::_buildAndSeekTest(void)
+{
+    const int       messageCount    = 100;
+    const quint64   startUSecs      = 1600000000000000ull;
+    const quint64   spacingUSecs    = 10000;
+
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QString logFilename = tempDir.filePath("index.tlog");
+
+    // Write a log with a record every 10ms, keeping track of where each record starts
+    QList<qint64> recordOffsets;
+    {
+        QFile logFile(logFilename);
+        QVERIFY(logFile.open(QFile::WriteOnly));
+
+        for (int i = 0; i < messageCount; i++) {
+            uint8_t             buf[TLogIndex::timestampSize + MAVLINK_MAX_PACKET_LEN];
+            mavlink_message_t   msg;
+
+            recordOffsets.append(logFile.pos());
+            qToBigEndian(startUSecs + (static_cast<quint64>(i) * spacingUSecs), buf);
+            mavlink_msg_attitude_pack(1, MAV_COMP_ID_AUTOPILOT1, &msg, static_cast<uint32_t>(i), 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f);
+            int len = TLogIndex::timestampSize + mavlink_msg_to_send_buffer(buf + TLogIndex::timestampSize, &msg);
+            QCOMPARE(logFile.write(reinterpret_cast<const char*>(buf), len), static_cast<qint64>(len));
+        }
+    }
+
+    TLogIndex index;
+    QVERIFY(index.load(logFilename));
+    QVERIFY(!index.loadedFromCache());
+    QVERIFY(QFile::exists(TLogIndex::sidecarFilename(logFilename)));
+    QCOMPARE(index.messageCount(), static_cast<quint64>(messageCount));
+    QCOMPARE(index.startTimeUSecs(), startUSecs);
+    QCOMPARE(index.endTimeUSecs(), startUSecs + ((messageCount - 1) * spacingUSecs));
+
+    const int recordsPerEntry = static_cast<int>(TLogIndex::indexIntervalUSecs / spacingUSecs);
+    QCOMPARE(index.entryCount(), ((messageCount - 1) / recordsPerEntry) + 1);
+
+    // Seeks land on the indexed record at or before the requested time
+    QCOMPARE(index.seekOffset(0), recordOffsets[0]);
+    QCOMPARE(index.seekOffset(startUSecs + (60 * spacingUSecs)), recordOffsets[2 * recordsPerEntry]);
+    QCOMPARE(index.seekOffset(startUSecs + (2 * recordsPerEntry * spacingUSecs)), recordOffsets[2 * recordsPerEntry]);
+
+    // Second load comes from the sidecar
+    TLogIndex cachedIndex;
+    QVERIFY(cachedIndex.load(logFilename));
+    QVERIFY(cachedIndex.loadedFromCache());
+    QCOMPARE(cachedIndex.entryCount(), index.entryCount());
+    QCOMPARE(cachedIndex.durationUSecs(), index.durationUSecs());
+    QCOMPARE(cachedIndex.seekOffset(startUSecs + (60 * spacingUSecs)), recordOffsets[2 * recordsPerEntry]);
+}
+
+void TLogIndexTest::_corruptRecordTest(void)
+{
+    const int       messageCount    = 100;
+    const int       corruptRecord   = 40;
+    const int       garbageAfter    = 60;
+    const quint64   startUSecs      = 1600000000000000ull;
+    const quint64   spacingUSecs    = 10000;
+
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QString logFilename = tempDir.filePath("corrupt.tlog");
+
+    // One record with a bad crc and some stray bytes, including a start of frame, between two records
+    QList<qint64> recordOffsets;
+    {
+        QFile logFile(logFilename);
+        QVERIFY(logFile.open(QFile::WriteOnly));
+
+        for (int i = 0; i < messageCount; i++) {
+            uint8_t             buf[TLogIndex::timestampSize + MAVLINK_MAX_PACKET_LEN];
+            mavlink_message_t   msg;
+
+            recordOffsets.append(logFile.pos());
+            qToBigEndian(startUSecs + (static_cast<quint64>(i) * spacingUSecs), buf);
+            mavlink_msg_attitude_pack(1, MAV_COMP_ID_AUTOPILOT1, &msg, static_cast<uint32_t>(i), 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f);
+            int len = TLogIndex::timestampSize + mavlink_msg_to_send_buffer(buf + TLogIndex::timestampSize, &msg);
+            if (i == corruptRecord) {
+                buf[TLogIndex::timestampSize + MAVLINK_NUM_HEADER_BYTES + 2] ^= 0xFF;
+            }
+            QCOMPARE(logFile.write(reinterpret_cast<const char*>(buf), len), static_cast<qint64>(len));
+
+            if (i == garbageAfter) {
+                const char garbage[] = { 0x01, static_cast<char>(MAVLINK_STX), 0x10, 0x00, 0x7F };
+                QCOMPARE(logFile.write(garbage, sizeof(garbage)), static_cast<qint64>(sizeof(garbage)));
+            }
+        }
+    }
+
+    // Only the corrupt record is lost, everything after it is still indexed
+    TLogIndex index;
+    QVERIFY(index.load(logFilename));
+    QCOMPARE(index.messageCount(), static_cast<quint64>(messageCount - 1));
+    QCOMPARE(index.startTimeUSecs(), startUSecs);
+    QCOMPARE(index.endTimeUSecs(), startUSecs + ((messageCount - 1) * spacingUSecs));
+
+    const int recordsPerEntry = static_cast<int>(TLogIndex::indexIntervalUSecs / spacingUSecs);
+    QCOMPARE(index.entryCount(), ((messageCount - 1) / recordsPerEntry) + 1);
+    QCOMPARE(index.seekOffset(startUSecs + (3 * recordsPerEntry * spacingUSecs)), recordOffsets[3 * recordsPerEntry]);
+    QCOMPARE(index.seekOffset(startUSecs + ((messageCount - 1) * spacingUSecs)), recordOffsets[3 * recordsPerEntry]);
+}
@@ -0,0 +1,205 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TLogWriter.h"
+#include "QGCLoggingCategory.h"
+
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+QGC_LOGGING_CATEGORY(TLogWriterLog, "TLogWriterLog")
+
+TLogWriter::TLogWriter(QObject* parent)
+    : QThread(parent)
+{
+    static_assert((bufferSize & (bufferSize - 1)) == 0, "bufferSize must be a power of two");
+    _ring.resize(bufferSize);
+    setObjectName(QStringLiteral("TLogWriter"));
+}
+
+TLogWriter::~TLogWriter()
+{
+    stopLogging();
+}
+
+void TLogWriter::startLogging(QFile* file, FsyncPolicy fsyncPolicy)
+{
+    stopLogging();
+
+    _fsyncPolicy = fsyncPolicy;
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    _stopRequested.store(false, std::memory_order_relaxed);
+    _error.store(false, std::memory_order_relaxed);
+    _droppedRecords.store(0, std::memory_order_relaxed);
+
+    // Wall clock is only sampled once, all subsequent timestamps are monotonic offsets from it
+    _epochUsecs = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000;
+    _monotonicTimer.start();
+
+    _file = file;
+    start();
+}
+
+void TLogWriter::stopLogging(void)
+{
+    if (!_file) {
+        return;
+    }
+
+    {
+        // Under the mutex so the wake can't land between the writer's check and its wait
+        QMutexLocker lock(&_wakeMutex);
+        _stopRequested.store(true, std::memory_order_release);
+        _wakeCondition.wakeOne();
+    }
+    wait();
+
+    if (_droppedRecords.load(std::memory_order_relaxed)) {
+        qCWarning(TLogWriterLog) << "Records dropped due to full buffer" << _droppedRecords.load(std::memory_order_relaxed);
+    }
+    _file = nullptr;
+}
+
+quint64 TLogWriter::timestampUsecs(void) const
+{
+    return _epochUsecs + static_cast<quint64>(_monotonicTimer.nsecsElapsed() / 1000);
+}
+
+bool TLogWriter::writeMessage(const mavlink_message_t& message)
+{
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    int length = mavlink_msg_to_send_buffer(buffer, &message);
+    return _writeRecord(reinterpret_cast<const char*>(buffer), length);
+}
+
+bool TLogWriter::writeBytes(const char* data, int length)
+{
+    return _writeRecord(data, length);
+}
+
+bool TLogWriter::_writeRecord(const char* data, int length)
+{
+    if (!_file || _error.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    uint32_t head           = _head.load(std::memory_order_relaxed);
+    uint32_t pending        = head - _tail.load(std::memory_order_acquire);
+    uint32_t recordLength   = static_cast<uint32_t>(sizeof(quint64) + length);
+
+    if (pending + recordLength > static_cast<uint32_t>(bufferSize)) {
+        // Disk can't keep up. Dropping is preferable to stalling the receive path.
+        _droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uchar timestamp[sizeof(quint64)];
+    qToBigEndian(timestampUsecs(), timestamp);
+    _copyToRing(head, reinterpret_cast<const char*>(timestamp), sizeof(timestamp));
+    _copyToRing(head + sizeof(timestamp), data, length);
+    _head.store(head + recordLength, std::memory_order_release);
+
+    // Only wake the writer when crossing the threshold, otherwise it picks things up on its interval
+    if (pending < static_cast<uint32_t>(flushThreshold) && pending + recordLength >= static_cast<uint32_t>(flushThreshold)) {
+        QMutexLocker lock(&_wakeMutex);
+        _wakeCondition.wakeOne();
+    }
+
+    return true;
+}
+
+void TLogWriter::_copyToRing(uint32_t position, const char* data, int length)
+{
+    uint32_t offset = position & (bufferSize - 1);
+    int      first  = qMin(length, static_cast<int>(bufferSize - offset));
+
+    memcpy(_ring.data() + offset, data, static_cast<size_t>(first));
+    if (first < length) {
+        memcpy(_ring.data(), data + first, static_cast<size_t>(length - first));
+    }
+}
+
+/// Writes everything currently in the ring to the file in at most two writes
+///     @return true: data was written
+bool TLogWriter::_drain(void)
+{
+    uint32_t tail       = _tail.load(std::memory_order_relaxed);
+    uint32_t head       = _head.load(std::memory_order_acquire);
+    uint32_t pending    = head - tail;
+
+    if (pending == 0) {
+        return false;
+    }
+
+    uint32_t offset = tail & (bufferSize - 1);
+    qint64   first  = qMin(pending, bufferSize - offset);
+    qint64   second = pending - first;
+
+    if (_file->write(_ring.constData() + offset, first) != first ||
+            (second && _file->write(_ring.constData(), second) != second) ||
+            !_file->flush()) {
+        _error.store(true, std::memory_order_release);
+        emit writeError(_file->errorString());
+        return false;
+    }
+
+    _tail.store(head, std::memory_order_release);
+    return true;
+}
+
+void TLogWriter::_sync(void)
+{
+#ifdef Q_OS_WIN
+    _commit(_file->handle());
+#else
+    fsync(_file->handle());
+#endif
+}
+
+void TLogWriter::run(void)
+{
+    QElapsedTimer   syncTimer;
+    bool            unsynced = false;
+
+    syncTimer.start();
+
+    while (!_stopRequested.load(std::memory_order_acquire) && !_error.load(std::memory_order_acquire)) {
+        _wakeMutex.lock();
+        if (!_stopRequested.load(std::memory_order_acquire) &&
+                _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed) < static_cast<uint32_t>(flushThreshold)) {
+            _wakeCondition.wait(&_wakeMutex, flushIntervalMsecs);
+        }
+        _wakeMutex.unlock();
+
+        if (_drain()) {
+            unsynced = true;
+        }
+
+        if (unsynced && (_fsyncPolicy == FsyncEveryWrite || (_fsyncPolicy == FsyncPeriodic && syncTimer.elapsed() >= fsyncIntervalMsecs))) {
+            _sync();
+            syncTimer.restart();
+            unsynced = false;
+        }
+    }
+
+    if (!_error.load(std::memory_order_acquire)) {
+        _drain();
+        if (_fsyncPolicy != FsyncNever) {
+            _sync();
+        }
+    }
+}
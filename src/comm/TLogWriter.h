@@ -0,0 +1,97 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QThread>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+#include <atomic>
+
+#include "QGCMAVLink.h"
+
+Q_DECLARE_LOGGING_CATEGORY(TLogWriterLog)
+
+/// Writes tlog records (big endian uint64 usec timestamp followed by the raw packet) to a file from a
+/// dedicated thread. Records are copied into a preallocated byte ring by the producer and written out
+/// in large batches, so the receive path never allocates or blocks on disk I/O.
+///
+/// There must only be a single producer thread calling writeMessage/writeBytes.
+class TLogWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    /// Values match the AppSettings telemetryFsyncPolicy enum
+    enum FsyncPolicy {
+        FsyncNever = 0,     ///< Leave it to the OS to decide when data reaches the disk
+        FsyncPeriodic,      ///< Sync at most once every fsyncIntervalMsecs
+        FsyncEveryWrite,    ///< Sync after every batch written to the file
+    };
+
+    TLogWriter(QObject* parent = nullptr);
+    ~TLogWriter();
+
+    /// Starts writing to the specified file which must already be open for writing. The file must
+    /// not be touched by anyone else until stop() returns.
+    void startLogging(QFile* file, FsyncPolicy fsyncPolicy);
+
+    /// Writes out all pending records, syncs the file and stops the writer thread
+    void stopLogging(void);
+
+    bool isLogging(void) const { return _file != nullptr; }
+
+    /// Logs a message along with the current timestamp
+    ///     @return false: record dropped due to full buffer or prior write error
+    bool writeMessage(const mavlink_message_t& message);
+
+    /// Logs raw bytes along with the current timestamp
+    ///     @return false: record dropped due to full buffer or prior write error
+    bool writeBytes(const char* data, int length);
+
+    /// @return Monotonic timestamp in usecs since the Unix epoch, anchored to wall clock when logging started
+    quint64 timestampUsecs(void) const;
+
+    quint64 droppedRecords(void) const { return _droppedRecords.load(std::memory_order_relaxed); }
+
+    static const int bufferSize             = 4 * 1024 * 1024;  ///< Must be a power of two
+    static const int flushThreshold         = 64 * 1024;        ///< Pending bytes which trigger an immediate write
+    static const int flushIntervalMsecs     = 100;              ///< Maximum time records sit in the buffer
+    static const int fsyncIntervalMsecs     = 1000;
+
+signals:
+    /// Emitted from the writer thread when the file can't be written. No further records are accepted.
+    void writeError(QString errorString);
+
+protected:
+    void run(void) override;
+
+private:
+    bool _writeRecord   (const char* data, int length);
+    void _copyToRing    (uint32_t position, const char* data, int length);
+    bool _drain         (void);
+    void _sync          (void);
+
+    QFile*                  _file           = nullptr;
+    FsyncPolicy             _fsyncPolicy    = FsyncPeriodic;
+    QByteArray              _ring;
+    std::atomic<uint32_t>   _head           { 0 };  ///< Byte count written by producer
+    std::atomic<uint32_t>   _tail           { 0 };  ///< Byte count consumed by writer thread
+    std::atomic<bool>       _stopRequested  { false };
+    std::atomic<bool>       _error          { false };
+    std::atomic<quint64>    _droppedRecords { 0 };
+    QMutex                  _wakeMutex;
+    QWaitCondition          _wakeCondition;
+    quint64                 _epochUsecs     = 0;
+    QElapsedTimer           _monotonicTimer;
+};
@@ -0,0 +1,69 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TLogWriterTest.h"
+#include "TLogWriter.h"
+#include "QGCMAVLink.h"
+
+#include <QTemporaryFile>
+#include <QtEndian>
+
+void TLogWriterTest::_writeTest(void)
+{
+    const int       messageCount    = 20000;
+    const QByteArray rawBytes("raw sent bytes");
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+
+    TLogWriter writer;
+    writer.startLogging(&file, TLogWriter::FsyncNever);
+    QVERIFY(writer.isLogging());
+
+    for (int i = 0; i < messageCount; i++) {
+        mavlink_message_t msg;
+        mavlink_msg_attitude_pack(1, MAV_COMP_ID_AUTOPILOT1, &msg, static_cast<uint32_t>(i), 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f);
+        QVERIFY(writer.writeMessage(msg));
+    }
+    QVERIFY(writer.writeBytes(rawBytes.constData(), rawBytes.size()));
+
+    writer.stopLogging();
+    QVERIFY(!writer.isLogging());
+    QCOMPARE(writer.droppedRecords(), 0ull);
+
+    // Read back the records: timestamp followed by packet
+    QVERIFY(file.seek(0));
+    QByteArray  contents    = file.readAll();
+    int         position    = 0;
+    quint64     lastTimestamp = 0;
+
+    mavlink_message_t   rxMessage;
+    mavlink_status_t    rxStatus;
+    mavlink_message_t   message;
+    mavlink_status_t    status;
+    memset(&rxStatus, 0, sizeof(rxStatus));
+
+    for (int i = 0; i < messageCount; i++) {
+        QVERIFY(position + static_cast<int>(sizeof(quint64)) < contents.size());
+        quint64 timestamp = qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(contents.constData() + position));
+        QVERIFY(timestamp >= lastTimestamp);
+        lastTimestamp = timestamp;
+        position += sizeof(quint64);
+
+        bool framed = false;
+        while (!framed && position < contents.size()) {
+            framed = mavlink_frame_char_buffer(&rxMessage, &rxStatus, static_cast<uint8_t>(contents[position++]), &message, &status) == MAVLINK_FRAMING_OK;
+        }
+        QVERIFY(framed);
+        QCOMPARE(mavlink_msg_attitude_get_time_boot_ms(&message), static_cast<uint32_t>(i));
+    }
+
+    QCOMPARE(contents.size() - position, static_cast<int>(sizeof(quint64)) + rawBytes.size());
+    QCOMPARE(contents.right(rawBytes.size()), rawBytes);
+}
@@ -23,6 +23,8 @@
 #include "QGC.h"
 #include "QGCApplication.h"
 #include "AppMessages.h"
+#include "CmdLineOptParser.h"
+#include "TLogExporter.h"
 
 #ifndef NO_SERIAL_LINK
     #include "SerialLink.h"
@@ -40,11 +42,8 @@
     #include "UnitTest.h"
 #endif
 
-#ifdef QT_DEBUG
-    #include "CmdLineOptParser.h"
-    #ifdef Q_OS_WIN
-        #include <crtdbg.h>
-    #endif
+#if defined(QT_DEBUG) && defined(Q_OS_WIN)
+    #include <crtdbg.h>
 #endif
 
 #ifdef QGC_ENABLE_BLUETOOTH
@@ -241,6 +240,28 @@ void sigHandler(int s)
 
 int main(int argc, char *argv[])
 {
+    // Headless tlog export runs without any UI, so it is also allowed alongside a running instance
+    bool    tlogExport = false;
+    bool    tlogExportDirFound = false;
+    bool    tlogExportFactsFound = false;
+    bool    tlogExportHzFound = false;
+    QString tlogExportFile;
+    QString tlogExportDir;
+    QString tlogExportFacts;
+    QString tlogExportHz;
+
+    CmdLineOpt_t rgExportCmdLineOptions[] = {
+        { TLogExporter::logOption,      &tlogExport,            &tlogExportFile },
+        { TLogExporter::dirOption,      &tlogExportDirFound,    &tlogExportDir },
+        { TLogExporter::factsOption,    &tlogExportFactsFound,  &tlogExportFacts },
+        { TLogExporter::hzOption,       &tlogExportHzFound,     &tlogExportHz },
+    };
+    ParseCmdLineOptions(argc, argv, rgExportCmdLineOptions, sizeof(rgExportCmdLineOptions)/sizeof(rgExportCmdLineOptions[0]), false);
+
+    if (tlogExport && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
 #ifndef __mobile__
     // We make the runguard key different for custom and non custom
     // builds, so they can be executed together in the same device.
@@ -250,7 +271,7 @@ int main(int argc, char *argv[])
     runguardString.append("RunGuardKey");
 
     RunGuard guard(runguardString);
-    if (!guard.tryToRun()) {
+    if (!tlogExport && !guard.tryToRun()) {
         // QApplication is necessary to use QMessageBox
         QApplication errorApp(argc, argv);
         QMessageBox::critical(nullptr, QObject::tr("Error"),
@@ -414,7 +435,15 @@ int main(int argc, char *argv[])
         }
     } else
 #endif
-    {
+    if (tlogExport) {
+        TLogExporter exporter(tlogExportFile, tlogExportDir, tlogExportFacts.split(',', Qt::SkipEmptyParts), tlogExportHz.toDouble());
+        QObject::connect(&exporter, &TLogExporter::finished, app, &QGCApplication::exit);
+        if (exporter.start()) {
+            exitCode = app->exec();
+        } else {
+            exitCode = -1;
+        }
+    } else {
 
 #ifdef __android__
         checkAndroidWritePermission();
@@ -46,11 +46,24 @@
 #include "CameraCalcTest.h"
 #include "FWLandingPatternTest.h"
 #include "RequestMessageTest.h"
+#include "TerrainProtocolHandlerTest.h"
+#include "ULogReaderTest.h"
+#include "MAVLinkInspectorStoreTest.h"
+#include "MAVLinkInspectorControllerTest.h"
 #include "FTPManagerTest.h"
 #include "MissionCommandTreeEditorTest.h"
 #include "VehicleLinkManagerTest.h"
 #include "LandingComplexItemTest.h"
 #include "InitialConnectTest.h"
+#include "MAVLinkDecoderTest.h"
+#include "TLogIndexTest.h"
+#include "TLogWriterTest.h"
+#include "QGCTileCacheWorkerTest.h"
+#include "TrajectoryPointsTest.h"
+#include "QGCMemoryTileCacheTest.h"
+#include "LogReplayLinkTest.h"
+#include "TerrainQueryTest.h"
+#include "TerrainTileStoreTest.h"
 
 UT_REGISTER_TEST(ComponentInformationCacheTest)
 UT_REGISTER_TEST(ComponentInformationTranslationTest)
@@ -63,8 +76,21 @@ UT_REGISTER_TEST(VehicleLinkManagerTest)
 UT_REGISTER_TEST(SendMavCommandWithSignallingTest)
 UT_REGISTER_TEST(SendMavCommandWithHandlerTest)
 UT_REGISTER_TEST(RequestMessageTest)
+UT_REGISTER_TEST(TerrainProtocolHandlerTest)
+UT_REGISTER_TEST(ULogReaderTest)
+UT_REGISTER_TEST(MAVLinkInspectorStoreTest)
+UT_REGISTER_TEST(MAVLinkInspectorControllerTest)
 UT_REGISTER_TEST(FTPManagerTest)
 UT_REGISTER_TEST(InitialConnectTest)
+UT_REGISTER_TEST(MAVLinkDecoderTest)
+UT_REGISTER_TEST(TLogIndexTest)
+UT_REGISTER_TEST(TLogWriterTest)
+UT_REGISTER_TEST(QGCTileCacheWorkerTest)
+UT_REGISTER_TEST(LogReplayLinkTest)
+UT_REGISTER_TEST(QGCMemoryTileCacheTest)
+UT_REGISTER_TEST(TerrainQueryTest)
+UT_REGISTER_TEST(TerrainTileStoreTest)
+UT_REGISTER_TEST(TrajectoryPointsTest)
 UT_REGISTER_TEST(MissionItemTest)
 UT_REGISTER_TEST(SimpleMissionItemTest)
 UT_REGISTER_TEST(MissionControllerTest)